@@ -51,8 +51,13 @@
 #ifndef configMAX_TASK_NAME_LEN
 #define configMAX_TASK_NAME_LEN		( 16 )
 #endif
+/* Set to 1 (and add extras/rtos_trace to EXTRA_COMPONENTS) to record
+   scheduler & queue events, see extras/rtos_trace/rtos_trace.h */
+#ifndef configUSE_RTOS_TRACE
+#define configUSE_RTOS_TRACE		0
+#endif
 #ifndef configUSE_TRACE_FACILITY
-#define configUSE_TRACE_FACILITY	0
+#define configUSE_TRACE_FACILITY	configUSE_RTOS_TRACE
 #endif
 #ifndef configUSE_STATS_FORMATTING_FUNCTIONS
 #define configUSE_STATS_FORMATTING_FUNCTIONS 0
@@ -125,6 +130,9 @@ to exclude the API function. */
 #ifndef INCLUDE_vTaskDelay
 #define INCLUDE_vTaskDelay				1
 #endif
+#ifndef INCLUDE_xTaskAbortDelay
+#define INCLUDE_xTaskAbortDelay			1
+#endif
 
 /*set the #define for debug info*/
 #ifndef INCLUDE_xTaskGetCurrentTaskHandle
@@ -134,5 +142,9 @@ to exclude the API function. */
 #define INCLUDE_uxTaskGetStackHighWaterMark 1
 #endif
 
+#if configUSE_RTOS_TRACE
+#include "rtos_trace_hooks.h"
+#endif
+
 #endif /* __DEFAULT_FREERTOS_CONFIG_H */
 
@@ -810,6 +810,30 @@ void vTaskResume( xTaskHandle xTaskToResume ) PRIVILEGED_FUNCTION;
  */
 portBASE_TYPE xTaskResumeFromISR( xTaskHandle xTaskToResume ) PRIVILEGED_FUNCTION;
 
+/**
+ * task. h
+ * <pre>portBASE_TYPE xTaskAbortDelay( xTaskHandle xTask );</pre>
+ *
+ * INCLUDE_xTaskAbortDelay must be defined as 1 for this function to be
+ * available.
+ *
+ * Forces a task that is blocked with a timeout (in vTaskDelay(), or
+ * waiting on a queue or semaphore with a block time other than
+ * portMAX_DELAY) to leave the Blocked state early. A queue or semaphore
+ * call which is interrupted this way returns as if it had timed out.
+ *
+ * Backported from FreeRTOS V9. Must not be called from an ISR.
+ *
+ * @param xTask Handle of the task to unblock.
+ *
+ * @return pdTRUE if the task was blocked and has been made ready,
+ * pdFALSE otherwise.
+ *
+ * \defgroup xTaskAbortDelay xTaskAbortDelay
+ * \ingroup TaskCtrl
+ */
+portBASE_TYPE xTaskAbortDelay( xTaskHandle xTask ) PRIVILEGED_FUNCTION;
+
 /*-----------------------------------------------------------
  * SCHEDULER CONTROL
  *----------------------------------------------------------*/
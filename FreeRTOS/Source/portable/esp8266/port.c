@@ -74,6 +74,7 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <xtensa_ops.h>
+#include <esp/systime.h>
 
 #include "FreeRTOS.h"
 #include "task.h"
@@ -168,9 +169,88 @@ void IRAM SV_ISR(void)
 	}
 }
 
+/* CPU cycles per RTOS tick.
+
+   The SDK's tick handler (sdk__xt_timer_int) has the divisor for an
+   80MHz CPU hardcoded, so the tick would run twice as fast at
+   160MHz. The tick interrupt is handled here instead, using this
+   value which follows CPU frequency changes.
+*/
+static uint32_t uxTickDivisor = configCPU_CLOCK_HZ / configTICK_RATE_HZ;
+
+/* CCOUNT at the next RTOS tick. CCOMPARE0 is set to this or to the
+   port timer alarm, whichever comes first. */
+static uint32_t ulNextTickCCount;
+
+/* The port timer count is ulTimerBase plus the CPU cycles since
+   ulTimerBaseCCount, shifted down to portTIMER_HZ. The base is moved
+   up on every tick, long before CCOUNT can wrap past it, and when
+   the CPU clock changes. */
+static uint32_t ulTimerBase;
+static uint32_t ulTimerBaseCCount;
+static uint32_t ulTimerShift = 4; /* configCPU_CLOCK_HZ / portTIMER_HZ == 1 << 4 */
+
+static portBASE_TYPE xTimerAlarmArmed;
+static uint32_t ulTimerAlarm;
+static void (*pxTimerAlarmHandler)( void );
+
+/* If the next compare is closer than this many cycles once CCOMPARE0
+   is written it may already have been passed, so handle it now. */
+#define portCOMPARE_MIN_CYCLES 64
+
+static inline uint32_t prvTimerCount( uint32_t ccount )
+{
+	return ulTimerBase + ( ( ccount - ulTimerBaseCCount ) >> ulTimerShift );
+}
+
+static inline void prvTimerRebase( uint32_t ccount )
+{
+	uint32_t ulCounts = ( ccount - ulTimerBaseCCount ) >> ulTimerShift;
+	ulTimerBase += ulCounts;
+	ulTimerBaseCCount += ulCounts << ulTimerShift;
+}
+
+/* Program CCOMPARE0 for the next tick or the alarm. Returns pdFALSE if
+   either is already due. Interrupts must be disabled. */
+static portBASE_TYPE IRAM prvSetCompare( void )
+{
+	uint32_t ccount, compare = ulNextTickCCount;
+
+	RSR(ccount, ccount);
+	if( ( int32_t )( compare - ccount ) <= portCOMPARE_MIN_CYCLES )
+		return pdFALSE;
+	if( xTimerAlarmArmed )
+	{
+		int32_t lCounts = ( int32_t )( ulTimerAlarm - prvTimerCount( ccount ) );
+		if( lCounts <= 0 )
+			return pdFALSE;
+		/* Only convert to cycles if the alarm comes before the tick,
+		   which keeps the shift from overflowing */
+		if( ( uint32_t )lCounts < ( ( compare - ccount ) >> ulTimerShift ) )
+			compare = ulTimerBaseCCount + ( ( ulTimerAlarm - ulTimerBase ) << ulTimerShift );
+	}
+	WSR(compare, ccompare0);
+	RSR(ccount, ccount);
+	return ( int32_t )( compare - ccount ) > portCOMPARE_MIN_CYCLES;
+}
+
+/* As prvSetCompare, but from outside the tick interrupt: if something
+   is already due, have the interrupt fire straight away. */
+static void IRAM prvArmCompare( void )
+{
+	if( !prvSetCompare() )
+	{
+		uint32_t ccount;
+		RSR(ccount, ccount);
+		ccount += portCOMPARE_MIN_CYCLES;
+		WSR(ccount, ccompare0);
+	}
+}
+
 void xPortSysTickHandle (void)
 {
 	//CloseNMI();
+	systime_tick();
 	{
 		if(xTaskIncrementTick() !=pdFALSE )
 		{
@@ -180,6 +260,94 @@ void xPortSysTickHandle (void)
 	//OpenNMI();
 }
 
+static void IRAM prvTickTimerInterrupt(void)
+{
+	uint32_t ccount;
+
+	/* Writing CCOMPARE0 clears the interrupt, so it's always written
+	   before leaving */
+	do {
+		RSR(ccount, ccount);
+		if( ( int32_t )( ccount - ulNextTickCCount ) >= 0 )
+		{
+			/* Advancing by a fixed amount from the previous tick
+			   means ticks don't drift with interrupt latency. A
+			   missed tick is caught up on the next time round. */
+			ulNextTickCCount += uxTickDivisor;
+			prvTimerRebase( ccount );
+			xPortSysTickHandle();
+			RSR(ccount, ccount);
+		}
+		if( xTimerAlarmArmed && ( int32_t )( prvTimerCount( ccount ) - ulTimerAlarm ) >= 0 )
+		{
+			xTimerAlarmArmed = pdFALSE;
+			if( pxTimerAlarmHandler )
+				pxTimerAlarmHandler();
+		}
+	} while( !prvSetCompare() );
+}
+
+static void prvTickTimerInit(void)
+{
+	uint32_t ccount;
+
+	RSR(ccount, ccount);
+	prvTimerRebase( ccount );
+	ulNextTickCCount = ccount + uxTickDivisor;
+	prvArmCompare();
+}
+
+void IRAM vPortSetCpuClock( unsigned long ulCpuClockHz )
+{
+	uint32_t ccount;
+	uint32_t ps = _xt_disable_interrupts();
+
+	/* Count the cycles so far at the old rate. CCOUNT has only been
+	   running at the new rate since just before this was called. */
+	RSR(ccount, ccount);
+	prvTimerRebase( ccount );
+	ulTimerShift = 0;
+	while( ( ( unsigned long )portTIMER_HZ << ulTimerShift ) < ulCpuClockHz )
+		ulTimerShift++;
+	uxTickDivisor = ulCpuClockHz / configTICK_RATE_HZ;
+	/* An alarm compare value is in cycles at the old rate */
+	prvArmCompare();
+	_xt_restore_interrupts(ps);
+}
+
+uint32_t IRAM ulPortTimerCount( void )
+{
+	uint32_t ccount, ulCount;
+	uint32_t ps = _xt_disable_interrupts();
+
+	RSR(ccount, ccount);
+	ulCount = prvTimerCount( ccount );
+	_xt_restore_interrupts(ps);
+	return ulCount;
+}
+
+void IRAM vPortSetTimerAlarm( uint32_t ulCount )
+{
+	uint32_t ps = _xt_disable_interrupts();
+
+	ulTimerAlarm = ulCount;
+	xTimerAlarmArmed = pdTRUE;
+	prvArmCompare();
+	_xt_restore_interrupts(ps);
+}
+
+void IRAM vPortClearTimerAlarm( void )
+{
+	/* CCOMPARE0 is left alone, at worst the interrupt fires once for
+	   nothing */
+	xTimerAlarmArmed = pdFALSE;
+}
+
+void vPortSetTimerAlarmHandler( void (*pxHandler)( void ) )
+{
+	pxTimerAlarmHandler = pxHandler;
+}
+
 /*
  * See header file for description.
  */
@@ -189,9 +357,9 @@ portBASE_TYPE xPortStartScheduler( void )
     _xt_isr_unmask(BIT(INUM_SOFT));
 
     /* Initialize system tick timer interrupt and schedule the first tick. */
-    _xt_isr_attach(INUM_TICK, sdk__xt_timer_int);
+    _xt_isr_attach(INUM_TICK, prvTickTimerInterrupt);
+    prvTickTimerInit();
     _xt_isr_unmask(BIT(INUM_TICK));
-    sdk__xt_tick_timer_init();
 
     vTaskSwitchContext();
 
@@ -168,6 +168,30 @@ inline static __attribute__((always_inline)) void portENABLE_INTERRUPTS(void)
     }
 }
 
+/* Recalculate the tick timer divisor after the CPU clock has
+   changed. Called by cpu_freq_set() in esp/clocks.h. */
+void vPortSetCpuClock( unsigned long ulCpuClockHz );
+
+/* Port timer. CCOMPARE0 raises the RTOS tick, and can also raise one
+   alarm for a higher resolution timer service (extras/hrtimer) in
+   the same interrupt. Alarms are set against a free-running 32-bit
+   count at portTIMER_HZ, which is derived from CCOUNT but keeps the
+   same rate when the CPU clock changes. These leave the FRC1 & FRC2
+   hardware timers alone (the SDK's ets/os timers, which the WiFi
+   stack relies on, use FRC2.)
+
+   All of these can be called from ISRs. */
+#define portTIMER_HZ 5000000
+
+uint32_t ulPortTimerCount( void );
+
+/* Call the alarm handler from the tick interrupt once the count
+   reaches ulCount (straight away if it already has.) One-shot:
+   setting a new alarm replaces the previous one. */
+void vPortSetTimerAlarm( uint32_t ulCount );
+void vPortClearTimerAlarm( void );
+void vPortSetTimerAlarmHandler( void (*pxHandler)( void ) );
+
 /* Critical section management. */
 void vPortEnterCritical( void );
 void vPortExitCritical( void );
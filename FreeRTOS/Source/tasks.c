@@ -147,6 +147,10 @@ typedef struct tskTaskControlBlock
 		unsigned long ulRunTimeCounter;			/*< Stores the amount of time the task has spent in the Running state. */
 	#endif
 
+	#if ( INCLUDE_xTaskAbortDelay == 1 )
+		unsigned char ucDelayAborted;			/*< Set by xTaskAbortDelay() so the interrupted blocking call times out. */
+	#endif
+
 	#if ( configUSE_NEWLIB_REENTRANT == 1 )
 		/* Allocate a Newlib reent structure that is specific to this task.
 		Note Newlib support has been included by popular demand, but is not
@@ -1217,6 +1221,61 @@ tskTCB * pxNewTCB;
 #endif /* ( ( INCLUDE_xTaskResumeFromISR == 1 ) && ( INCLUDE_vTaskSuspend == 1 ) ) */
 /*-----------------------------------------------------------*/
 
+#if ( INCLUDE_xTaskAbortDelay == 1 )
+
+	/* Backported from FreeRTOS V9. */
+	portBASE_TYPE xTaskAbortDelay( xTaskHandle xTask )
+	{
+	tskTCB * const pxTCB = ( tskTCB * ) xTask;
+	portBASE_TYPE xReturn = pdFALSE;
+
+		configASSERT( pxTCB );
+
+		vTaskSuspendAll();
+		{
+			/* A task can only be prematurely removed from the Blocked state if
+			it is actually waiting with a timeout, ie in one of the delayed
+			lists. Tasks blocked indefinitely are in the suspended list and
+			are left alone. */
+			if( ( listIS_CONTAINED_WITHIN( pxDelayedTaskList, &( pxTCB->xGenericListItem ) ) != pdFALSE ) ||
+				( listIS_CONTAINED_WITHIN( pxOverflowDelayedTaskList, &( pxTCB->xGenericListItem ) ) != pdFALSE ) )
+			{
+				xReturn = pdTRUE;
+
+				( void ) uxListRemove( &( pxTCB->xGenericListItem ) );
+
+				/* Interrupts can modify event lists, so remove the event
+				list item inside a critical section. If the task was
+				waiting for an event, flag that the wait was aborted so
+				xTaskCheckForTimeOut() reports a timeout. */
+				taskENTER_CRITICAL();
+				{
+					if( listLIST_ITEM_CONTAINER( &( pxTCB->xEventListItem ) ) != NULL )
+					{
+						( void ) uxListRemove( &( pxTCB->xEventListItem ) );
+						pxTCB->ucDelayAborted = pdTRUE;
+					}
+				}
+				taskEXIT_CRITICAL();
+
+				prvAddTaskToReadyList( pxTCB );
+
+				/* The scheduler is suspended so a switch to a higher
+				priority task happens in xTaskResumeAll() below. */
+				if( pxTCB->uxPriority > pxCurrentTCB->uxPriority )
+				{
+					xYieldPending = pdTRUE;
+				}
+			}
+		}
+		( void ) xTaskResumeAll();
+
+		return xReturn;
+	}
+
+#endif /* INCLUDE_xTaskAbortDelay */
+/*-----------------------------------------------------------*/
+
 void vTaskStartScheduler( void )
 {
 portBASE_TYPE xReturn;
@@ -1992,6 +2051,14 @@ void IRAM vTaskSetTimeOutState( xTimeOutType * const pxTimeOut )
 	configASSERT( pxTimeOut );
 	pxTimeOut->xOverflowCount = xNumOfOverflows;
 	pxTimeOut->xTimeOnEntering = xTickCount;
+
+	#if ( INCLUDE_xTaskAbortDelay == 1 )
+	{
+		/* Called at the start of each blocking call. Forget an abort
+		which arrived too late to cut short the previous one. */
+		pxCurrentTCB->ucDelayAborted = pdFALSE;
+	}
+	#endif
 }
 /*-----------------------------------------------------------*/
 
@@ -2007,6 +2074,17 @@ portBASE_TYPE xReturn;
 		/* Minor optimisation.  The tick count cannot change in this block. */
 		const portTickType xConstTickCount = xTickCount;
 
+		#if ( INCLUDE_xTaskAbortDelay == 1 )
+			if( pxCurrentTCB->ucDelayAborted != pdFALSE )
+			{
+				/* The wait was cut short by xTaskAbortDelay(), treat it as a
+				timeout. */
+				pxCurrentTCB->ucDelayAborted = pdFALSE;
+				xReturn = pdTRUE;
+			}
+			else
+		#endif
+
 		#if ( INCLUDE_vTaskSuspend == 1 )
 			/* If INCLUDE_vTaskSuspend is set to 1 and the block time specified is
 			the maximum block time then the task should block indefinitely, and
@@ -2289,6 +2367,12 @@ unsigned portBASE_TYPE x;
 	}
 	#endif /* configUSE_APPLICATION_TASK_TAG */
 
+	#if ( INCLUDE_xTaskAbortDelay == 1 )
+	{
+		pxTCB->ucDelayAborted = pdFALSE;
+	}
+	#endif /* INCLUDE_xTaskAbortDelay */
+
 	#if ( configGENERATE_RUN_TIME_STATS == 1 )
 	{
 		pxTCB->ulRunTimeCounter = 0UL;
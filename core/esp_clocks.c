@@ -0,0 +1,80 @@
+/* Runtime CPU clock switching for esp/clocks.h.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <esp/clocks.h>
+#include <espressif/esp_system.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <errno.h>
+
+static volatile uint32_t cpu_mhz = CPU_CLK_FREQ / 1000000;
+static cpu_freq_listener_t *listeners;
+static uint32_t boost_count;
+
+uint32_t cpu_freq_get(void)
+{
+    return cpu_mhz;
+}
+
+int cpu_freq_set(uint32_t mhz)
+{
+    if(mhz != SYS_CPU_80MHZ && mhz != SYS_CPU_160MHZ)
+        return -EINVAL;
+
+    /* The listener list isn't walked from interrupts, so suspending
+       the scheduler is enough to keep it stable while calling out */
+    vTaskSuspendAll();
+    if(mhz != cpu_mhz) {
+        taskENTER_CRITICAL();
+        sdk_system_update_cpu_freq(mhz);
+        vPortSetCpuClock(mhz * 1000000);
+        cpu_mhz = mhz;
+        taskEXIT_CRITICAL();
+
+        for(cpu_freq_listener_t *l = listeners; l; l = l->next)
+            l->callback(mhz, l->arg);
+    }
+    xTaskResumeAll();
+    return 0;
+}
+
+void cpu_freq_add_listener(cpu_freq_listener_t *listener, cpu_freq_callback_t callback, void *arg)
+{
+    listener->callback = callback;
+    listener->arg = arg;
+    taskENTER_CRITICAL();
+    listener->next = listeners;
+    listeners = listener;
+    taskEXIT_CRITICAL();
+}
+
+void cpu_freq_remove_listener(cpu_freq_listener_t *listener)
+{
+    taskENTER_CRITICAL();
+    for(cpu_freq_listener_t **l = &listeners; *l; l = &(*l)->next) {
+        if(*l == listener) {
+            *l = listener->next;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+void cpu_freq_boost_acquire(void)
+{
+    vTaskSuspendAll();
+    if(boost_count++ == 0)
+        cpu_freq_set(SYS_CPU_160MHZ);
+    xTaskResumeAll();
+}
+
+void cpu_freq_boost_release(void)
+{
+    vTaskSuspendAll();
+    if(boost_count > 0 && --boost_count == 0)
+        cpu_freq_set(SYS_CPU_80MHZ);
+    xTaskResumeAll();
+}
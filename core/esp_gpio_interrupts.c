@@ -24,6 +24,12 @@
 
    OR
 
+   - Register a handler at runtime with gpio_set_pin_handler(), which
+     takes precedence over gpioXX_interrupt_handler() for that pin.
+     Drivers which pick their pins at runtime use this.
+
+   OR
+
    - Implement a single function named gpio_interrupt_handler(). This
      will need to manually check GPIO.STATUS and clear any status
      bits after handling interrupts. This gives you full control, but
@@ -65,6 +71,13 @@ const gpio_interrupt_handler_t gpio_interrupt_handlers[16] = {
     gpio12_interrupt_handler, gpio13_interrupt_handler, gpio14_interrupt_handler,
     gpio15_interrupt_handler };
 
+static gpio_pin_handler_t gpio_pin_handlers[16];
+
+void gpio_set_pin_handler(const uint8_t gpio_num, gpio_pin_handler_t handler)
+{
+    gpio_pin_handlers[gpio_num] = handler;
+}
+
 void __attribute__((weak)) IRAM gpio_interrupt_handler(void)
 {
     uint32_t status_reg = GPIO.STATUS;
@@ -74,7 +87,11 @@ void __attribute__((weak)) IRAM gpio_interrupt_handler(void)
     {
         gpio_idx--;
         status_reg &= ~BIT(gpio_idx);
-        if(FIELD2VAL(GPIO_CONF_INTTYPE, GPIO.CONF[gpio_idx]))
+        if(!FIELD2VAL(GPIO_CONF_INTTYPE, GPIO.CONF[gpio_idx]))
+            continue;
+        if(gpio_pin_handlers[gpio_idx])
+            gpio_pin_handlers[gpio_idx](gpio_idx);
+        else
             gpio_interrupt_handlers[gpio_idx]();
     }
 }
@@ -6,10 +6,15 @@
  * BSD Licensed as described in the file LICENSE
  */
 #include "esp/spi.h"
+#include "esp/spi_buf.h"
 
 #include "esp/iomux.h"
 #include "esp/gpio.h"
+#include "esp/dport_regs.h"
+#include "esp/interrupts.h"
 #include <string.h>
+#include <FreeRTOS.h>
+#include <semphr.h>
 
 #define _SPI0_SCK_GPIO  6
 #define _SPI0_MISO_GPIO 7
@@ -26,8 +31,6 @@
 #define _SPI0_FUNC 1
 #define _SPI1_FUNC 2
 
-#define _SPI_BUF_SIZE 64
-
 static bool _minimal_pins[2] = {false, false};
 
 inline static void _set_pin_function(uint8_t pin, uint32_t function)
@@ -163,45 +166,17 @@ inline static void _start(uint8_t bus)
     SPI(bus).CMD |= SPI_CMD_USR;
 }
 
-inline static uint32_t _swap_bytes(uint32_t value)
-{
-    return (value << 24) | ((value << 8) & 0x00ff0000) | ((value >> 8) & 0x0000ff00) | (value >> 24);
-}
-
-inline static uint32_t _swap_words(uint32_t value)
-{
-    return (value << 16) | (value >> 16);
-}
-
-static void _spi_buf_prepare(uint8_t bus, size_t len, spi_endianness_t e, spi_word_size_t word_size)
-{
-    if (e == SPI_LITTLE_ENDIAN || word_size == SPI_32BIT) return;
-
-    size_t count = word_size == SPI_16BIT ? (len + 1) / 2 : (len + 3) / 4;
-    uint32_t *data = (uint32_t *)&SPI(bus).W0;
-    for (size_t i = 0; i < count; i ++)
-    {
-        data[i] = word_size == SPI_16BIT
-            ? _swap_words(data[i])
-            : _swap_bytes(data[i]);
-    }
-}
-
 static void _spi_buf_transfer(uint8_t bus, const void *out_data, void *in_data,
     size_t len, spi_endianness_t e, spi_word_size_t word_size)
 {
     _wait(bus);
     size_t bytes = len * (uint8_t)word_size;
     _set_size(bus, bytes);
-    memcpy((void *)&SPI(bus).W0, out_data, bytes);
-    _spi_buf_prepare(bus, len, e, word_size);
+    _load_regs(&SPI(bus).W0, out_data, bytes, e, word_size);
     _start(bus);
     _wait(bus);
     if (in_data)
-    {
-        _spi_buf_prepare(bus, len, e, word_size);
-        memcpy(in_data, (void *)&SPI(bus).W0, bytes);
-    }
+        _unload_regs(&SPI(bus).W0, in_data, bytes, e, word_size);
 }
 
 uint8_t spi_transfer_8(uint8_t bus, uint8_t data)
@@ -249,3 +224,188 @@ size_t spi_transfer(uint8_t bus, const void *out_data, void *in_data, size_t len
 
     return len;
 }
+
+/*
+ * Repeated patterns
+ *
+ * The pattern is copied into the data buffer as many times as fits, once,
+ * then sent with back to back transactions. The received data would
+ * overwrite the buffer in full duplex mode, so the bus is switched to
+ * MOSI only for the duration.
+ */
+size_t spi_repeat_send(uint8_t bus, const void *pattern, size_t len, spi_word_size_t word_size, size_t repeats)
+{
+    size_t bytes = len * (uint8_t)word_size;
+    if (!pattern || !bytes || bytes > _SPI_BUF_SIZE || !repeats) return 0;
+
+    // Several copies per transaction only if they tile the buffer exactly
+    uint8_t per_buf = (bytes & 3) ? 1 : _SPI_BUF_SIZE / bytes;
+    spi_endianness_t e = spi_get_endianness(bus);
+
+    _wait(bus);
+    uint32_t user0 = SPI(bus).USER0;
+    SPI(bus).USER0 = user0 & ~SPI_USER0_DUPLEX;
+    for (uint8_t i = 0; i < per_buf; i++)
+        _load_regs(&SPI(bus).W0 + i * bytes / 4, pattern, bytes, e, word_size);
+
+    size_t left = repeats;
+    uint8_t count = 0;
+    while (left)
+    {
+        uint8_t n = left < per_buf ? left : per_buf;
+        _wait(bus);
+        if (n != count)
+        {
+            _set_size(bus, n * bytes);
+            count = n;
+        }
+        _start(bus);
+        left -= n;
+    }
+    _wait(bus);
+    SPI(bus).USER0 = user0;
+    return repeats;
+}
+
+/*
+ * Asynchronous transfers
+ *
+ * The 64 byte data buffer is split into two 32 byte halves. While one
+ * half is on the wire (selected with the MOSI/MISO_HIGHPART bits) the
+ * transaction-done interrupt handler has already loaded the other, so
+ * it only has to start it, then read back and refill the half which
+ * just finished.
+ */
+
+#define _SPI_HALF_SIZE  (_SPI_BUF_SIZE / 2)
+#define _SPI_HALF_WORDS (_SPI_HALF_SIZE / 4)
+
+typedef struct
+{
+    const uint8_t *out;
+    uint8_t *in;
+    size_t remaining;           // bytes not yet loaded into the buffer
+    uint8_t loaded[2];          // bytes loaded into each half, 0 if free
+    uint8_t half;               // half currently on the wire
+    spi_endianness_t e;
+    spi_word_size_t word_size;
+    spi_done_callback_t callback;
+    void *arg;
+    volatile bool busy;
+    xSemaphoreHandle done;
+} _spi_async_t;
+
+static _spi_async_t _async;
+
+static void IRAM _async_load(uint8_t half)
+{
+    uint8_t bytes = _async.remaining > _SPI_HALF_SIZE ? _SPI_HALF_SIZE : _async.remaining;
+    _load_regs(&SPI(1).W0 + half * _SPI_HALF_WORDS, _async.out, bytes, _async.e, _async.word_size);
+    _async.out += bytes;
+    _async.remaining -= bytes;
+    _async.loaded[half] = bytes;
+}
+
+static void IRAM _async_unload(uint8_t half)
+{
+    uint8_t bytes = _async.loaded[half];
+    _unload_regs(&SPI(1).W0 + half * _SPI_HALF_WORDS, _async.in, bytes, _async.e, _async.word_size);
+    _async.in += bytes;
+}
+
+static void IRAM _async_start(uint8_t half)
+{
+    if (half)
+        SPI(1).USER0 |= SPI_USER0_MOSI_HIGHPART | SPI_USER0_MISO_HIGHPART;
+    else
+        SPI(1).USER0 &= ~(SPI_USER0_MOSI_HIGHPART | SPI_USER0_MISO_HIGHPART);
+    _set_size(1, _async.loaded[half]);
+    _async.half = half;
+    _start(1);
+}
+
+static void IRAM _async_finish(portBASE_TYPE *woken)
+{
+    SPI(1).SLAVE0 &= ~SPI_SLAVE0_TRANS_DONE_EN;
+    SPI(1).USER0 &= ~(SPI_USER0_MOSI_HIGHPART | SPI_USER0_MISO_HIGHPART);
+    _async.busy = false;
+    if (_async.callback)
+        _async.callback(1, _async.arg);
+    xSemaphoreGiveFromISR(_async.done, woken);
+}
+
+static void IRAM _spi_interrupt_handler(void)
+{
+    if (!(DPORT.SPI_INT_STATUS & DPORT_SPI_INT_STATUS_SPI1))
+        return;
+    SPI(1).SLAVE0 &= ~SPI_SLAVE0_TRANS_DONE;
+    if (!_async.busy)
+        return;
+
+    portBASE_TYPE woken = pdFALSE;
+    uint8_t half = _async.half;
+    uint8_t next = half ^ 1;
+
+    // Keep the bus busy first, then deal with the finished half
+    if (_async.loaded[next])
+        _async_start(next);
+    if (_async.in)
+        _async_unload(half);
+    _async.loaded[half] = 0;
+    if (_async.remaining)
+        _async_load(half);
+    if (!_async.loaded[next])
+        _async_finish(&woken);
+
+    if (woken)
+        portYIELD();
+}
+
+bool spi_transfer_async(uint8_t bus, const void *out_data, void *in_data, size_t len,
+    spi_word_size_t word_size, spi_done_callback_t callback, void *arg)
+{
+    if (bus != 1 || !out_data || !len || _async.busy) return false;
+
+    if (!_async.done)
+    {
+        vSemaphoreCreateBinary(_async.done);
+        if (!_async.done) return false;
+        _xt_isr_attach(INUM_SPI, _spi_interrupt_handler);
+    }
+    xSemaphoreTake(_async.done, 0);
+
+    _wait(bus);
+    _async.out = out_data;
+    _async.in = in_data;
+    _async.remaining = len * (uint8_t)word_size;
+    _async.e = spi_get_endianness(bus);
+    _async.word_size = word_size;
+    _async.callback = callback;
+    _async.arg = arg;
+    _async.loaded[1] = 0;
+    _async_load(0);
+    if (_async.remaining)
+        _async_load(1);
+
+    _async.busy = true;
+    SPI(1).SLAVE0 = (SPI(1).SLAVE0 & ~SPI_SLAVE0_TRANS_DONE) | SPI_SLAVE0_TRANS_DONE_EN;
+    _xt_isr_unmask(BIT(INUM_SPI));
+    _async_start(0);
+    return true;
+}
+
+bool spi_transfer_busy(uint8_t bus)
+{
+    return bus == 1 && _async.busy;
+}
+
+bool spi_transfer_wait(uint8_t bus, uint32_t timeout)
+{
+    if (bus != 1) return false;
+    while (_async.busy)
+    {
+        if (xSemaphoreTake(_async.done, timeout) != pdTRUE)
+            return !_async.busy;
+    }
+    return true;
+}
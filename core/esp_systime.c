@@ -0,0 +1,34 @@
+/* 64-bit monotonic microsecond system clock
+ *
+ * See esp/systime.h for usage.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <esp/systime.h>
+#include <common_macros.h>
+
+volatile uint32_t _systime_ref_lo;
+volatile uint32_t _systime_ref_hi;
+volatile uint32_t _systime_ms_ref;
+volatile uint32_t _systime_ms_ref_us;
+
+/* Only ever called from the tick interrupt, so there is a single
+   writer. The high word is written before the low reference so a
+   reader which sees the new low reference also sees the new high
+   word; a reader interrupted part way through sees the low reference
+   change and retries. */
+void IRAM systime_tick(void)
+{
+    uint32_t lo = WDEV.SYS_TIME;
+    if(lo < _systime_ref_lo)
+        _systime_ref_hi++;
+    _systime_ref_lo = lo;
+
+    /* Move the millisecond reference up to the last whole millisecond,
+       so systime_ms() only has to convert the time since the last tick */
+    uint32_t ms = (lo - _systime_ms_ref_us) / 1000;
+    _systime_ms_ref += ms;
+    _systime_ms_ref_us += ms * 1000;
+}
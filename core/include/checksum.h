@@ -0,0 +1,70 @@
+/* checksum.h
+ *
+ * Checksums and CRCs shared by the core, lwIP and extras.
+ *
+ * The CRCs are table driven. Tables are words in flash (one 1KB table
+ * serves both the 8 and 16 bit CRCs, CRC-32 uses four more for
+ * slice-by-4), so they cost no RAM and need no unaligned flash reads.
+ *
+ * By default the code is in flash as usual. Build with CHECKSUM_IRAM=1
+ * (see parameters.mk) to put it in IRAM, which mostly helps
+ * checksum_inet() on a busy network interface.
+ *
+ * None of these functions touch any state, so they can be called from
+ * any task or interrupt (from an interrupt only if CHECKSUM_IRAM=1, or
+ * if the flash is known to be mapped.)
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _CHECKSUM_H
+#define _CHECKSUM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/* Set to 0 to use a single 1KB table for CRC-32, byte at a time,
+   instead of 4KB of tables for slice-by-4 (roughly twice as fast). */
+#ifndef CHECKSUM_CRC32_SLICE_BY_4
+#define CHECKSUM_CRC32_SLICE_BY_4 1
+#endif
+
+/* CRC-8/MAXIM, as used by 1-Wire ROM codes and scratchpads (Maxim
+   AN27). Pass 0 to start, or a previous result to continue. */
+uint8_t crc8_maxim(uint8_t crc, const void *data, size_t len);
+
+/* CRC-16/ARC, the reflected 0x8005 polynomial (0xA001) without
+   inversion. 1-Wire devices send the inverse of this, see
+   onewire_check_crc16(). Pass 0 to start, or a previous result to
+   continue. */
+uint16_t crc16_arc(uint16_t crc, const void *data, size_t len);
+
+/* CRC-32 as used by Ethernet, zlib and PNG. Pass 0 to start, or a
+   previous result to continue (the inversions are done inside, as
+   with zlib's crc32()). */
+uint32_t crc32_ieee(uint32_t crc, const void *data, size_t len);
+
+/* Internet (RFC 1071) checksum: the ones' complement sum of the data
+   as native byte order 16 bit words, folded to 16 bits but not
+   inverted. An odd trailing byte is the low byte of a final word. Any
+   alignment works, and the result is the same as lwIP's
+   lwip_standard_chksum(), which it replaces (see lwipopts.h).
+
+   Reads the data a 32 bit word at a time. */
+uint16_t checksum_inet(const void *data, size_t len);
+
+/* XOR of all bytes, starting from 'init'. Reads a word at a time when
+   the data is aligned, so it works on word-only memory (IRAM or mapped
+   flash) as long as data and len are multiples of 4. */
+uint8_t checksum_xor8(uint8_t init, const void *data, size_t len);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
@@ -1,6 +1,6 @@
 /* esp/clocks.h
  *
- * ESP8266 internal clock values
+ * ESP8266 internal clock values, and runtime CPU clock switching.
  *
  * At the moment there's not a lot known about varying clock speeds
  * apart from doubling the CPU clock. It may be possible to set clock
@@ -13,14 +13,69 @@
 #ifndef _ESP_CLOCKS_H
 #define _ESP_CLOCKS_H
 
-/* CPU clock, can be overclocked to 160MHz via a dport register setting */
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/* CPU clock at boot, can be doubled to 160MHz at runtime with
+   cpu_freq_set() */
 #define CPU_CLK_FREQ 80*1000000
 
 /* Main peripheral clock
 
    This is also the master frequency for the UART and the TIMER module
-   (before divisors applied to either.)
+   (before divisors applied to either.) It stays at 80MHz when the CPU
+   clock is doubled, so UART baud rates and FRC1/FRC2 timings don't
+   need to change. Defined with the same tokens as in
+   espressif/esp8266/eagle_soc.h so the two headers can be used
+   together.
  */
 #define APB_CLK_FREQ CPU_CLK_FREQ
 
+/* Called after the CPU clock has changed, with the new frequency in
+   MHz (80 or 160). Runs in the context of the task that called
+   cpu_freq_set(), with the scheduler suspended, so must not block. */
+typedef void (*cpu_freq_callback_t)(uint32_t cpu_mhz, void *arg);
+
+/* Registration record for code with constants derived from the CPU
+   clock (ie anything which converts CCOUNT cycles to time.) Allocated
+   by the caller, usually statically. */
+typedef struct cpu_freq_listener {
+    cpu_freq_callback_t callback;
+    void *arg;
+    struct cpu_freq_listener *next;
+} cpu_freq_listener_t;
+
+/* Current CPU clock in MHz (80 or 160). */
+uint32_t cpu_freq_get(void);
+
+/* Switch the CPU clock to 80 or 160MHz.
+
+   Updates the SDK's notion of the clock (used by sdk_os_delay_us) and
+   the FreeRTOS tick, then calls each registered listener.
+
+   Returns 0 on success or -EINVAL for an unsupported frequency.
+*/
+int cpu_freq_set(uint32_t mhz);
+
+/* Register/unregister to be notified of CPU clock changes. The
+   callback is not called at registration, use cpu_freq_get() for the
+   initial value. */
+void cpu_freq_add_listener(cpu_freq_listener_t *listener, cpu_freq_callback_t callback, void *arg);
+void cpu_freq_remove_listener(cpu_freq_listener_t *listener);
+
+/* Reference counted requests for 160MHz, for bursts of CPU-bound work
+   (TLS handshakes, bulk flash writes) from code that shouldn't need to
+   know what else is running. The CPU runs at 160MHz while any boost
+   is held and drops back to 80MHz when the last one is released. */
+void cpu_freq_boost_acquire(void);
+void cpu_freq_boost_release(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
 #endif
@@ -121,6 +121,48 @@ static inline bool gpio_read(const uint8_t gpio_num)
     return GPIO.IN & BIT(gpio_num);
 }
 
+/* Mask versions of the above, for changing several pins at once. Bit n
+ * of the mask is GPIOn, bits for GPIO16 and up are ignored.
+ *
+ * gpio_set_mask() and gpio_clear_mask() are each a single register
+ * write, so all the pins change on the same clock edge and nothing else
+ * writing to other pins can be clobbered.
+ */
+static inline void gpio_set_mask(const uint32_t mask)
+{
+    GPIO.OUT_SET = mask & GPIO_OUT_PIN_MASK;
+}
+
+static inline void gpio_clear_mask(const uint32_t mask)
+{
+    GPIO.OUT_CLEAR = mask & GPIO_OUT_PIN_MASK;
+}
+
+/* Drive the pins in mask to the corresponding bits of value. This is
+ * two writes: pins going high change just before pins going low.
+ */
+static inline void gpio_write_mask(const uint32_t mask, const uint32_t value)
+{
+    GPIO.OUT_SET = mask & value & GPIO_OUT_PIN_MASK;
+    GPIO.OUT_CLEAR = mask & ~value & GPIO_OUT_PIN_MASK;
+}
+
+/* Toggle the pins in mask. As with gpio_toggle(), only these pins can
+ * be affected if something else writes GPIO.OUT at the same time.
+ */
+static inline void gpio_toggle_mask(const uint32_t mask)
+{
+    uint32_t out = GPIO.OUT;
+    GPIO.OUT_SET = mask & ~out & GPIO_OUT_PIN_MASK;
+    GPIO.OUT_CLEAR = mask & out & GPIO_OUT_PIN_MASK;
+}
+
+/* Read the input levels of all of GPIO0-15 (see gpio_read()) */
+static inline uint32_t gpio_read_mask(void)
+{
+    return GPIO.IN & GPIO_OUT_PIN_MASK;
+}
+
 extern void gpio_interrupt_handler(void);
 
 /* Set the interrupt type for a given pin
@@ -137,6 +179,15 @@ static inline void gpio_set_interrupt(const uint8_t gpio_num, const gpio_inttype
     }
 }
 
+typedef void (* gpio_pin_handler_t)(uint8_t gpio_num);
+
+/* Install a handler for interrupts on one pin at runtime. It is called
+ * by the default gpio_interrupt_handler in place of that pin's
+ * gpioXX_interrupt_handler, with the pin number as argument, so one
+ * driver function can serve several pins. Pass NULL to remove it.
+ */
+void gpio_set_pin_handler(const uint8_t gpio_num, gpio_pin_handler_t handler);
+
 /* Return the interrupt type set for a pin */
 static inline gpio_inttype_t gpio_get_interrupt(const uint8_t gpio_num)
 {
@@ -265,6 +265,108 @@ uint32_t spi_transfer_32(uint8_t bus, uint32_t data);
  */
 size_t spi_transfer(uint8_t bus, const void *out_data, void *in_data, size_t len, spi_word_size_t word_size);
 
+/**
+ * \brief Send a pattern of words repeatedly over SPI
+ * The pattern is loaded into the SPI data buffer once and then sent with
+ * as many transactions as needed, which is much faster than sending a
+ * prepared buffer (e.g. to fill a region of a display with one colour).
+ * Patterns which are a whole number of 32 bit words are replicated to
+ * fill the 64 byte buffer, so that each transaction sends several copies.
+ * Received data is discarded.
+ * \param bus Bus ID: 0 - system, 1 - user
+ * \param pattern Words to send
+ * \param len Pattern size in words, up to 64 bytes
+ * \param word_size Size of the word
+ * \param repeats Number of times to send the pattern
+ * \return Number of patterns sent, 0 if the arguments are invalid
+ */
+size_t spi_repeat_send(uint8_t bus, const void *pattern, size_t len, spi_word_size_t word_size, size_t repeats);
+
+/**
+ * \brief Send the same byte repeatedly over SPI
+ * \param bus Bus ID: 0 - system, 1 - user
+ * \param data Byte to send
+ * \param repeats Number of bytes to send
+ */
+static inline void spi_repeat_send_8(uint8_t bus, uint8_t data, size_t repeats)
+{
+    uint32_t pattern = data * 0x01010101;
+    spi_repeat_send(bus, &pattern, 4, SPI_8BIT, repeats / 4);
+    if (repeats & 3)
+        spi_repeat_send(bus, &pattern, repeats & 3, SPI_8BIT, 1);
+}
+/**
+ * \brief Send the same 16 bit word repeatedly over SPI
+ * \param bus Bus ID: 0 - system, 1 - user
+ * \param data Word to send
+ * \param repeats Number of words to send
+ */
+static inline void spi_repeat_send_16(uint8_t bus, uint16_t data, size_t repeats)
+{
+    uint32_t pattern = data * 0x00010001;
+    spi_repeat_send(bus, &pattern, 2, SPI_16BIT, repeats / 2);
+    if (repeats & 1)
+        spi_repeat_send(bus, &pattern, 1, SPI_16BIT, 1);
+}
+/**
+ * \brief Send the same 32 bit dword repeatedly over SPI
+ * \param bus Bus ID: 0 - system, 1 - user
+ * \param data dword to send
+ * \param repeats Number of dwords to send
+ */
+static inline void spi_repeat_send_32(uint8_t bus, uint32_t data, size_t repeats)
+{
+    spi_repeat_send(bus, &data, 1, SPI_32BIT, repeats);
+}
+
+/**
+ * Completion callback for spi_transfer_async(), called from the SPI interrupt
+ */
+typedef void (*spi_done_callback_t)(uint8_t bus, void *arg);
+
+/**
+ * \brief Start an interrupt driven transfer of a buffer of words over SPI
+ * Returns as soon as the first block has been started. The rest of the
+ * buffer is transferred from the SPI transaction-done interrupt, 32 bytes
+ * at a time: the data buffer is used as two halves (W0..W7 and W8..W15),
+ * so the next block is already loaded when a transaction finishes and
+ * received data is copied out while the following block is on the wire.
+ *
+ * Only bus 1 is supported. The buffers must stay valid until the transfer
+ * completes, and no other transfers may be made on the bus until then.
+ * Must be called from task context.
+ *
+ * Example:
+ *
+ *     spi_transfer_async(1, frame, NULL, sizeof(frame), SPI_8BIT, NULL, NULL);
+ *     // ... prepare the next frame ...
+ *     spi_transfer_wait(1, portMAX_DELAY);
+ *
+ * \param bus Bus ID: 1 - user
+ * \param out_data Data to send
+ * \param in_data Receive buffer. If NULL, received data will be lost.
+ * \param len Buffer size in words
+ * \param word_size Size of the word
+ * \param callback Called from the SPI interrupt when the transfer is complete, may be NULL
+ * \param arg Passed to the callback
+ * \return false if the bus is busy or the arguments are invalid
+ */
+bool spi_transfer_async(uint8_t bus, const void *out_data, void *in_data, size_t len,
+    spi_word_size_t word_size, spi_done_callback_t callback, void *arg);
+/**
+ * \brief Check whether an asynchronous transfer is in progress
+ * \param bus Bus ID: 1 - user
+ * \return true if spi_transfer_async() has not completed yet
+ */
+bool spi_transfer_busy(uint8_t bus);
+/**
+ * \brief Block the calling task until an asynchronous transfer completes
+ * \param bus Bus ID: 1 - user
+ * \param timeout Maximum time to wait, in RTOS ticks
+ * \return false on timeout
+ */
+bool spi_transfer_wait(uint8_t bus, uint32_t timeout);
+
 #ifdef __cplusplus
 }
 #endif
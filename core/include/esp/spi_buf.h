@@ -0,0 +1,110 @@
+/*
+ * Copying between buffers and the SPI data registers
+ *
+ * Private to the SPI driver (core/esp_spi.c). These only touch the
+ * register array they are given, so they are kept here where
+ * examples/tests/spi_swap_test can check them against a model of the
+ * wire on a PC.
+ *
+ * Part of esp-open-rtos
+ * Copyright (c) Ruslan V. Uss, 2016
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _ESP_SPI_BUF_H_
+#define _ESP_SPI_BUF_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "common_macros.h"
+#include "esp/spi.h"
+
+#define _SPI_BUF_SIZE 64
+
+inline static uint32_t _swap_bytes(uint32_t value)
+{
+    return (value << 24) | ((value << 8) & 0x00ff0000) | ((value >> 8) & 0x0000ff00) | (value >> 24);
+}
+
+inline static uint32_t _swap_words(uint32_t value)
+{
+    return (value << 16) | (value >> 16);
+}
+
+/*
+ * The data buffer is shifted out starting from the low byte of W0. With
+ * SPI_BIG_ENDIAN set the hardware reverses the byte order of each 32 bit
+ * register, so to keep the words of the user's buffer in order the
+ * buffer is pre-swapped in the other direction:
+ *
+ *   word size  memory (bytes)   register value     sent as
+ *   8 bit      a b c d          0xdcba -> 0xabcd    a b c d
+ *   16 bit     a b c d          0xdcba -> 0xbadc    b a d c
+ *   32 bit     a b c d          0xdcba (no swap)    d c b a
+ *
+ * i.e. 16 bit words are sent big endian and 32 bit words are sent as the
+ * value they hold, regardless of the byte order. In little endian mode
+ * the buffer is used as is. The same swap is applied on the way back.
+ */
+inline static uint32_t _swap_for(uint32_t value, spi_endianness_t e, spi_word_size_t word_size)
+{
+    if (e == SPI_LITTLE_ENDIAN || word_size == SPI_32BIT)
+        return value;
+    return word_size == SPI_16BIT ? _swap_words(value) : _swap_bytes(value);
+}
+
+/*
+ * Copy 'bytes' from a buffer into the data registers, swapping in the
+ * same pass. Word aligned buffers are read directly (the last word may
+ * be partly beyond the end of the buffer, but never crosses a word
+ * boundary), anything else goes through a copy on the stack.
+ */
+static void IRAM _load_regs(volatile uint32_t *w, const void *src, uint8_t bytes,
+    spi_endianness_t e, spi_word_size_t word_size)
+{
+    uint32_t words = (bytes + 3) / 4;
+    if (((uintptr_t)src & 3) == 0)
+    {
+        const uint32_t *s = src;
+        for (uint32_t i = 0; i < words; i++)
+            w[i] = _swap_for(s[i], e, word_size);
+    }
+    else
+    {
+        uint32_t buf[_SPI_BUF_SIZE / 4];
+        memcpy(buf, src, bytes);
+        for (uint32_t i = 0; i < words; i++)
+            w[i] = _swap_for(buf[i], e, word_size);
+    }
+}
+
+/*
+ * Copy 'bytes' from the data registers into a buffer, swapping in the
+ * same pass. Only whole words are stored directly, so nothing past the
+ * end of the buffer is touched.
+ */
+static void IRAM _unload_regs(volatile uint32_t *w, void *dst, uint8_t bytes,
+    spi_endianness_t e, spi_word_size_t word_size)
+{
+    uint32_t words = bytes / 4;
+    uint8_t rest = bytes & 3;
+    if (((uintptr_t)dst & 3) == 0)
+    {
+        uint32_t *d = dst;
+        for (uint32_t i = 0; i < words; i++)
+            d[i] = _swap_for(w[i], e, word_size);
+        if (rest)
+        {
+            uint32_t last = _swap_for(w[words], e, word_size);
+            memcpy(d + words, &last, rest);
+        }
+    }
+    else
+    {
+        uint32_t buf[_SPI_BUF_SIZE / 4];
+        for (uint32_t i = 0; i < words + (rest ? 1 : 0); i++)
+            buf[i] = _swap_for(w[i], e, word_size);
+        memcpy(dst, buf, bytes);
+    }
+}
+
+#endif /* _ESP_SPI_BUF_H_ */
@@ -0,0 +1,82 @@
+/* esp/systime.h
+ *
+ * 64-bit monotonic microsecond system clock.
+ *
+ * Based on the free-running 1MHz WDEV SYS_TIME counter (the same
+ * counter sdk_system_get_time() returns), extended to 64 bits. The
+ * FreeRTOS tick interrupt records the high word each time it runs, so
+ * the 32-bit counter wrapping (every ~71 minutes) is always noticed
+ * regardless of whether anyone is reading the clock.
+ *
+ * systime_us() takes no locks and doesn't disable interrupts, so it
+ * can be called from tasks and ISRs (but not the NMI.) The result
+ * never goes backwards.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _ESP_SYSTIME_H
+#define _ESP_SYSTIME_H
+#include <stdint.h>
+#include <esp/wdev_regs.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/* Last value of SYS_TIME seen by the tick interrupt, and the high word
+   that goes with it. Private, use systime_us(). */
+extern volatile uint32_t _systime_ref_lo;
+extern volatile uint32_t _systime_ref_hi;
+
+/* Millisecond count at the last whole millisecond before the last
+   tick, and SYS_TIME at that millisecond. Private, use systime_ms(). */
+extern volatile uint32_t _systime_ms_ref;
+extern volatile uint32_t _systime_ms_ref_us;
+
+/* Microseconds since boot. */
+static inline uint64_t systime_us(void)
+{
+    uint32_t ref, hi, lo;
+    /* If the tick interrupt updated the reference while we were
+       reading it, read again. */
+    do {
+        ref = _systime_ref_lo;
+        hi = _systime_ref_hi;
+        lo = WDEV.SYS_TIME;
+    } while(ref != _systime_ref_lo);
+    if(lo < ref)
+        hi++; /* counter wrapped since the last tick */
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/* Milliseconds since boot, truncated to 32 bits (wraps after ~49
+   days.) Compare values by subtraction, as for tick counts.
+
+   Avoids a 64-bit division: the tick interrupt keeps a millisecond
+   reference, and the microseconds since then (normally less than a
+   tick) are divided by 1000 as a multiply by 2^26/1000 and a shift,
+   which is exact below 64000. */
+static inline uint32_t systime_ms(void)
+{
+    uint32_t ref_us, ms, us;
+    do {
+        ref_us = _systime_ms_ref_us;
+        ms = _systime_ms_ref;
+        us = WDEV.SYS_TIME - ref_us;
+    } while(ref_us != _systime_ms_ref_us);
+    if(us < 64000)
+        return ms + ((us * 67109) >> 26);
+    return ms + us / 1000; /* before the first tick, or ticks held off */
+}
+
+/* Called from the FreeRTOS tick interrupt to track SYS_TIME wrapping.
+   Needs to run at least once every 2^32 microseconds. */
+void systime_tick(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
@@ -11,6 +11,8 @@
 #include <common_macros.h>
 #include <xtensa_ops.h>
 #include <esp/uart.h>
+#include <esp/systime.h>
+#include <sys/time.h>
 #include <stdlib.h>
 
 extern void *xPortSupervisorStackPointer;
@@ -41,7 +43,7 @@ IRAM caddr_t _sbrk_r (struct _reent *r, int incr)
 }
 
 /* syscall implementation for stdio write to UART */
-long _write_r(struct _reent *r, int fd, const char *ptr, int len )
+__attribute__((weak)) long _write_r(struct _reent *r, int fd, const char *ptr, int len )
 {
     if(fd != r->_stdout->_file) {
         r->_errno = EBADF;
@@ -76,6 +78,20 @@ __attribute__((weak)) long _read_r( struct _reent *r, int fd, char *ptr, int len
     return i;
 }
 
+/* syscall implementation for gettimeofday(), returns the time since
+   boot. Overridden by extras/sntp once the real time is known. */
+__attribute__((weak)) int _gettimeofday_r(struct _reent *r, struct timeval *tp, void *tzp)
+{
+    if(tzp || !tp) {
+        r->_errno = EINVAL;
+        return -1;
+    }
+    uint64_t now = systime_us();
+    tp->tv_sec = now / 1000000;
+    tp->tv_usec = now % 1000000;
+    return 0;
+}
+
 /* Stub syscall implementations follow, to allow compiling newlib functions that
    pull these in via various codepaths
 */
@@ -0,0 +1,49 @@
+/* Example of deferred-format logging with extras/binlog.
+ *
+ * A task logs how many CPU cycles each log call takes. Set BINARY to
+ * 1 to send binary records instead, and decode them on the host with:
+ *
+ *   utils/binlog_decode.py build/binlog.out --port /dev/ttyUSB0
+ *
+ * This sample code is in the public domain.
+ */
+#include "espressif/esp_common.h"
+#include "esp/uart.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "xtensa_ops.h"
+
+#define BINLOG_MODULE demo
+#include "binlog.h"
+
+BINLOG_MODULE_DEFINE(demo);
+
+#define BINARY 0
+
+static void log_task(void *pvParameters)
+{
+    uint32_t count = 0;
+    uint32_t cycles = 0;
+    while(1) {
+        uint32_t start, end;
+        RSR(start, ccount);
+        BINLOG_INFO("iteration %u, previous log call took %u cycles", count, cycles);
+        RSR(end, ccount);
+        cycles = end - start;
+
+        /* Compiled out at the default BINLOG_LEVEL */
+        BINLOG_DEBUG("not shown");
+
+        if(count % 10 == 0)
+            BINLOG_WARN("%s: %u records dropped so far", "demo", binlog_dropped());
+        count++;
+        vTaskDelay(100 / portTICK_RATE_MS);
+    }
+}
+
+void user_init(void)
+{
+    uart_set_baud(0, 115200);
+    binlog_init(BINARY ? BINLOG_MODE_BINARY : BINLOG_MODE_TEXT);
+    xTaskCreate(log_task, (signed char *)"log", 256, NULL, 2, NULL);
+}
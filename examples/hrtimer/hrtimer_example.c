@@ -0,0 +1,55 @@
+/* Example of several high resolution timers sharing one hardware timer.
+ *
+ * Two GPIOs are toggled from interrupt-context timers at different
+ * rates, and a task-context timer prints how many toggles have
+ * happened once a second.
+ *
+ * This sample code is in the public domain.
+ */
+#include "espressif/esp_common.h"
+#include "esp/uart.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "esp8266.h"
+#include "hrtimer.h"
+
+#include <stdio.h>
+
+const int gpio_fast = 12;
+const int gpio_slow = 14;
+
+static hrtimer_t fast_timer;
+static hrtimer_t slow_timer;
+static hrtimer_t report_timer;
+
+static volatile uint32_t fast_count;
+
+static void IRAM toggle_gpio(void *arg)
+{
+    int gpio = (int)arg;
+    if(gpio == gpio_fast)
+        fast_count++;
+    gpio_toggle(gpio);
+}
+
+static void report(void *arg)
+{
+    /* runs in the hrtimer task, so printf is OK here */
+    printf("%u fast toggles, %u overruns\n", fast_count, fast_timer.overruns);
+}
+
+void user_init(void)
+{
+    uart_set_baud(0, 115200);
+
+    gpio_enable(gpio_fast, GPIO_OUTPUT);
+    gpio_enable(gpio_slow, GPIO_OUTPUT);
+
+    hrtimer_init(&fast_timer, toggle_gpio, (void *)gpio_fast, HRTIMER_ISR);
+    hrtimer_init(&slow_timer, toggle_gpio, (void *)gpio_slow, HRTIMER_ISR);
+    hrtimer_init(&report_timer, report, NULL, HRTIMER_TASK);
+
+    hrtimer_start(&fast_timer, 50, 50);          /* 10kHz square wave */
+    hrtimer_start(&slow_timer, 1000, 1250);      /* 400Hz square wave */
+    hrtimer_start(&report_timer, 1000000, 1000000);
+}
@@ -11,6 +11,7 @@
  */
 #include "espressif/esp_common.h"
 #include "esp/uart.h"
+#include "esp/clocks.h"
 
 #include <string.h>
 
@@ -210,14 +211,19 @@ void http_get_task(void *pvParameters)
          */
         printf("  . Performing the SSL/TLS handshake...");
 
+        /* The handshake is dominated by public key maths, run the CPU
+           at 160MHz until it's done */
+        cpu_freq_boost_acquire();
         while((ret = mbedtls_ssl_handshake(&ssl)) != 0)
         {
             if(ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE)
             {
                 printf(" failed\n  ! mbedtls_ssl_handshake returned -0x%x\n\n", -ret);
+                cpu_freq_boost_release();
                 goto exit;
             }
         }
+        cpu_freq_boost_release();
 
         printf(" ok\n");
 
@@ -0,0 +1,60 @@
+/* Play a tone through an I2S DAC (e.g. a PCM5102 or MAX98357A).
+ *
+ * Connect the DAC to GPIO3 (DIN), GPIO15 (BCK) and GPIO2 (LRCK). A 440Hz
+ * triangle wave is generated into each DMA buffer as the previous one
+ * finishes playing, so the CPU only runs once per buffer.
+ *
+ * GPIO3 is the UART0 RX pin, so the serial console is output only.
+ *
+ * This sample code is in the public domain.
+ */
+#include "espressif/esp_common.h"
+#include "esp/uart.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "i2s_dma.h"
+
+#include <stdio.h>
+
+#define SAMPLE_RATE 22050
+#define TONE_HZ     440
+#define AMPLITUDE   8000
+
+/* Phase step per frame, in 1/65536ths of a cycle */
+#define PHASE_STEP  ((uint32_t)((uint64_t)TONE_HZ * 65536 / SAMPLE_RATE))
+
+static uint32_t phase;
+
+static void fill_buffer(uint32_t *buf, size_t len, void *arg)
+{
+    for (size_t i = 0; i < len / 4; i++) {
+        uint16_t p = phase;
+        int32_t level = p < 32768 ? p : 65535 - p;  /* 0..32767 */
+        int16_t sample = (level - 16384) * AMPLITUDE / 16384;
+        /* Same sample on both channels */
+        buf[i] = ((uint32_t)(uint16_t)sample << 16) | (uint16_t)sample;
+        phase += PHASE_STEP;
+    }
+}
+
+void user_init(void)
+{
+    uart_set_baud(0, 115200);
+
+    i2s_dma_config_t config = {
+        .tx = true,
+        .clock_div = i2s_dma_sample_rate_div(SAMPLE_RATE, 16),
+        .bits = 16,
+        .buf_count = 2,
+        .buf_size = 512,
+        .tx_callback = fill_buffer,
+    };
+    int res = i2s_dma_init(&config);
+    if (res < 0) {
+        printf("i2s_dma_init failed: %d\n", res);
+        return;
+    }
+    printf("Bit clock %u Hz (clkm %u, bck %u)\n", i2s_dma_bit_freq(config.clock_div),
+           config.clock_div.clkm_div, config.clock_div.bclk_div);
+    i2s_dma_start();
+}
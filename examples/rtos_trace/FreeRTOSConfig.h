@@ -0,0 +1,10 @@
+/* rtos_trace FreeRTOSConfig overrides.
+
+   Turns on the extras/rtos_trace kernel hooks, defaults are found in
+   FreeRTOS/Source/include/FreeRTOSConfig.h
+*/
+
+#define configUSE_RTOS_TRACE 1
+
+/* Use the defaults for everything else */
+#include_next<FreeRTOSConfig.h>
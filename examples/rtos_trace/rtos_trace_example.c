@@ -0,0 +1,76 @@
+/* Example of recording scheduler events with extras/rtos_trace
+ *
+ * A producer and a consumer task pass items through a queue, while a
+ * low priority task holds a mutex the consumer also wants. After a few
+ * seconds the trace is dumped to the serial port.
+ *
+ * Capture the serial output to a file and convert it with
+ *   utils/rtos_trace_decode.py serial.log -o trace.json
+ * then open trace.json in chrome://tracing or ui.perfetto.dev
+ *
+ * This sample code is in the public domain.
+ */
+#include "espressif/esp_common.h"
+#include "esp/uart.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+#include "rtos_trace.h"
+
+static xQueueHandle queue;
+static xSemaphoreHandle mutex;
+
+static void producer_task(void *pvParameters)
+{
+    uint32_t count = 0;
+    while(1) {
+        rtos_trace_user(1, count);
+        xQueueSend(queue, &count, portMAX_DELAY);
+        count++;
+        vTaskDelay(20 / portTICK_RATE_MS);
+    }
+}
+
+static void consumer_task(void *pvParameters)
+{
+    uint32_t value;
+    while(1) {
+        xQueueReceive(queue, &value, portMAX_DELAY);
+        xSemaphoreTake(mutex, portMAX_DELAY);
+        xSemaphoreGive(mutex);
+    }
+}
+
+static void background_task(void *pvParameters)
+{
+    while(1) {
+        xSemaphoreTake(mutex, portMAX_DELAY);
+        /* hold the mutex for a while, so the consumer blocks on it and
+           this task inherits its priority */
+        for(volatile int i = 0; i < 20000; i++) { }
+        xSemaphoreGive(mutex);
+        vTaskDelay(5 / portTICK_RATE_MS);
+    }
+}
+
+static void dump_task(void *pvParameters)
+{
+    vTaskDelay(3000 / portTICK_RATE_MS);
+    rtos_trace_dump();
+    vTaskDelete(NULL);
+}
+
+void user_init(void)
+{
+    uart_set_baud(0, 115200);
+    printf("SDK version:%s\n", sdk_system_get_sdk_version());
+
+    queue = xQueueCreate(4, sizeof(uint32_t));
+    mutex = xSemaphoreCreateMutex();
+
+    xTaskCreate(producer_task, (signed char *)"producer", 256, NULL, 3, NULL);
+    xTaskCreate(consumer_task, (signed char *)"consumer", 256, NULL, 4, NULL);
+    xTaskCreate(background_task, (signed char *)"background", 256, NULL, 1, NULL);
+    xTaskCreate(dump_task, (signed char *)"dump", 512, NULL, 5, NULL);
+}
@@ -0,0 +1,39 @@
+/* Breathing LED using the hardware sigma-delta modulator.
+ *
+ * Connect an LED (with a resistor) to GPIO14. The modulator drives the
+ * pin by itself; a timer interrupt only runs while the level is fading,
+ * or sits between two of the modulator's 256 steps.
+ *
+ * This sample code is in the public domain.
+ */
+#include "espressif/esp_common.h"
+#include "esp/uart.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "sigma_delta.h"
+
+#define LED_PIN 14
+#define FADE_MS 2000
+
+/* The dim end of the fade is a quarter of the modulator's smallest
+   step, which is only reachable by dithering */
+static void breathe_task(void *pvParameters)
+{
+    while (1) {
+        sigma_delta_fade(0xffff, FADE_MS);
+        vTaskDelay((FADE_MS + 500) / portTICK_RATE_MS);
+        sigma_delta_fade(0x0040, FADE_MS);
+        vTaskDelay((FADE_MS + 500) / portTICK_RATE_MS);
+    }
+}
+
+void user_init(void)
+{
+    uart_set_baud(0, 115200);
+
+    /* Slow edges are kinder to the LED and don't matter to the eye */
+    sigma_delta_enable(200, 0);
+    sigma_delta_attach(LED_PIN);
+
+    xTaskCreate(breathe_task, (signed char *)"breathe", 256, NULL, 2, NULL);
+}
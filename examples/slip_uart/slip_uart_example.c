@@ -0,0 +1,92 @@
+/* TCP echo & discard servers reachable over a SLIP link on UART0.
+ *
+ * On a Linux host with the ESP8266 on /dev/ttyUSB0:
+ *
+ *   sudo slattach -L -p slip -s 921600 /dev/ttyUSB0 &
+ *   sudo ip addr add 192.168.240.1 peer 192.168.240.2 dev sl0
+ *   sudo ip link set sl0 up mtu 1500
+ *   ping 192.168.240.2
+ *   dd if=/dev/zero bs=1k count=1024 | nc -q 1 192.168.240.2 9
+ *
+ * The discard server (port 9) gives a TCP throughput figure for the
+ * link without any radio involved, the echo server (port 7) a round
+ * trip one.
+ *
+ * Nothing is printed after the link comes up, as stdout shares
+ * UART0 with the SLIP frames.
+ *
+ * This sample code is in the public domain.
+ */
+#include "espressif/esp_common.h"
+#include "esp/uart.h"
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "lwip/sockets.h"
+#include "slip_uart.h"
+
+#define BAUD_RATE 921600
+
+static void tcp_server(int port, bool echo)
+{
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    bind(listener, (struct sockaddr *)&addr, sizeof(addr));
+    listen(listener, 1);
+
+    while(1) {
+        int s = accept(listener, NULL, NULL);
+        if(s < 0)
+            continue;
+        char buf[256];
+        int len;
+        while((len = read(s, buf, sizeof(buf))) > 0) {
+            if(echo)
+                write(s, buf, len);
+        }
+        close(s);
+    }
+}
+
+static void echo_task(void *pvParameters)
+{
+    tcp_server(7, true);
+}
+
+static void discard_task(void *pvParameters)
+{
+    tcp_server(9, false);
+}
+
+static void slip_task(void *pvParameters)
+{
+    ip_addr_t ipaddr, netmask, gw;
+    IP4_ADDR(&ipaddr, 192, 168, 240, 2);
+    IP4_ADDR(&netmask, 255, 255, 255, 255);
+    IP4_ADDR(&gw, 192, 168, 240, 1);
+
+    printf("Starting SLIP at %d baud, 192.168.240.2\n", BAUD_RATE);
+    uart_set_baud(0, BAUD_RATE);
+    if(!slip_uart_init(0, &ipaddr, &netmask, &gw, true)) {
+        printf("SLIP interface failed to start\n");
+        vTaskDelete(NULL);
+    }
+
+    xTaskCreate(echo_task, (signed char *)"echo", 512, NULL, 2, NULL);
+    xTaskCreate(discard_task, (signed char *)"discard", 512, NULL, 2, NULL);
+    vTaskDelete(NULL);
+}
+
+void user_init(void)
+{
+    uart_set_baud(0, 115200);
+    sdk_wifi_set_opmode(NULL_MODE);
+    xTaskCreate(slip_task, (signed char *)"slipinit", 384, NULL, 2, NULL);
+}
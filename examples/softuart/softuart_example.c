@@ -0,0 +1,101 @@
+/* Software UART loopback test.
+ *
+ * Wire GPIO4 to GPIO5, GPIO12 to GPIO13, GPIO14 to GPIO15 and GPIO0 to
+ * GPIO2. All SOFTUART_MAX_CHANNELS channels run at once, in pairs which
+ * each send a test pattern to the other at 57600 baud, and the received
+ * data is checked. Once a second the error counters and the CPU cycles
+ * spent per received byte are printed.
+ *
+ * GPIO0, 2 and 15 select the boot mode. Each is wired to an input at
+ * reset, so its pull-up or pull-down still decides.
+ *
+ * This sample code is in the public domain.
+ */
+#include "espressif/esp_common.h"
+#include "esp/uart.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "softuart.h"
+
+#include <stdio.h>
+
+#define BAUD 57600
+
+#define CHANNELS 4
+
+#if CHANNELS > SOFTUART_MAX_CHANNELS
+#error This example needs SOFTUART_MAX_CHANNELS of at least 4
+#endif
+
+static const softuart_config_t configs[CHANNELS] = {
+    { .baud = BAUD, .rx_gpio = 13, .tx_gpio = 4, .de_gpio = SOFTUART_NO_PIN },
+    { .baud = BAUD, .rx_gpio = 5, .tx_gpio = 12, .de_gpio = SOFTUART_NO_PIN },
+    { .baud = BAUD, .rx_gpio = 2, .tx_gpio = 14, .de_gpio = SOFTUART_NO_PIN },
+    { .baud = BAUD, .rx_gpio = 15, .tx_gpio = 0, .de_gpio = SOFTUART_NO_PIN },
+};
+
+static uint32_t mismatches[CHANNELS];
+
+static void tx_task(void *pvParameters)
+{
+    int channel = (int)pvParameters;
+    uint8_t buf[32];
+    uint8_t next = 0;
+    while(1) {
+        for(int i = 0; i < sizeof(buf); i++)
+            buf[i] = next++;
+        softuart_write(channel, buf, sizeof(buf), portMAX_DELAY);
+    }
+}
+
+static void rx_task(void *pvParameters)
+{
+    int channel = (int)pvParameters;
+    uint8_t buf[32];
+    uint8_t expected = 0;
+    bool synced = false;
+    while(1) {
+        size_t len = softuart_read(channel, buf, sizeof(buf), portMAX_DELAY);
+        for(int i = 0; i < len; i++) {
+            if(synced && buf[i] != expected)
+                mismatches[channel]++;
+            synced = true;
+            expected = buf[i] + 1;
+        }
+    }
+}
+
+static void report_task(void *pvParameters)
+{
+    while(1) {
+        vTaskDelay(1000 / portTICK_RATE_MS);
+        for(int ch = 0; ch < CHANNELS; ch++) {
+            softuart_stats_t stats;
+            softuart_get_stats(ch, &stats, true);
+            printf("ch%d: rx %u tx %u, framing %u noise %u overrun %u mismatch %u, %u cycles/byte\n",
+                   ch, stats.rx_bytes, stats.tx_bytes, stats.rx_framing_errors, stats.rx_noise,
+                   stats.rx_overruns, mismatches[ch],
+                   stats.rx_bytes ? stats.rx_cycles / stats.rx_bytes : 0);
+        }
+    }
+}
+
+static void init_task(void *pvParameters)
+{
+    for(int ch = 0; ch < CHANNELS; ch++) {
+        if(softuart_open(ch, &configs[ch]) < 0) {
+            printf("Failed to open channel %d\n", ch);
+            vTaskDelete(NULL);
+        }
+        xTaskCreate(rx_task, (signed char *)"rx", 256, (void *)ch, 3, NULL);
+        xTaskCreate(tx_task, (signed char *)"tx", 256, (void *)ch, 2, NULL);
+    }
+    xTaskCreate(report_task, (signed char *)"report", 256, NULL, 1, NULL);
+    vTaskDelete(NULL);
+}
+
+void user_init(void)
+{
+    uart_set_baud(0, 115200);
+    xTaskCreate(init_task, (signed char *)"init", 256, NULL, 2, NULL);
+}
@@ -0,0 +1,198 @@
+/* Checks and benchmarks the core checksums & CRCs (checksum.h).
+ *
+ * Each function is checked against its standard check value and
+ * against a simple bit-at-a-time version over random data, lengths and
+ * alignments, then timed over a TCP segment sized buffer. Results are
+ * printed on the serial port.
+ *
+ * The same file builds on a PC, where times are in ns instead of CPU
+ * cycles:
+ *   cc -O2 -I../../../core/include checksum_benchmark.c ../../../core/checksum.c
+ *
+ * Build with CHECKSUM_IRAM=1 to compare IRAM and flash placement.
+ *
+ * This sample code is in the public domain.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "checksum.h"
+
+#ifdef __XTENSA__
+#include "espressif/esp_common.h"
+#include "esp/uart.h"
+#include "xtensa_ops.h"
+
+#define TIME_UNIT "cycles"
+
+static inline uint32_t timestamp(void)
+{
+    uint32_t ccount;
+    RSR(ccount, ccount);
+    return ccount;
+}
+#else
+#include <time.h>
+
+#define TIME_UNIT "ns"
+
+static inline uint32_t timestamp(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+#endif
+
+#define BENCH_LEN 1460
+#define CHECK_ROUNDS 500
+
+static uint8_t buf[BENCH_LEN + 4] __attribute__((aligned(4)));
+
+/* Reference versions, one bit (or one byte) at a time */
+
+static uint8_t ref_crc8_maxim(uint8_t crc, const uint8_t *p, size_t len)
+{
+    while(len--) {
+        crc ^= *p++;
+        for(int i = 0; i < 8; i++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0x8C : crc >> 1;
+    }
+    return crc;
+}
+
+static uint16_t ref_crc16_arc(uint16_t crc, const uint8_t *p, size_t len)
+{
+    while(len--) {
+        crc ^= *p++;
+        for(int i = 0; i < 8; i++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+    }
+    return crc;
+}
+
+static uint32_t ref_crc32_ieee(uint32_t crc, const uint8_t *p, size_t len)
+{
+    crc = ~crc;
+    while(len--) {
+        crc ^= *p++;
+        for(int i = 0; i < 8; i++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+    }
+    return ~crc;
+}
+
+/* Pairs of bytes from the start as little endian words, which is what
+   lwip_standard_chksum() sums on this CPU */
+static uint16_t ref_checksum_inet(const uint8_t *p, size_t len)
+{
+    uint32_t sum = 0;
+    for(size_t i = 0; i < len; i++)
+        sum += (i & 1) ? p[i] << 8 : p[i];
+    while(sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+    return sum;
+}
+
+static uint8_t ref_checksum_xor8(uint8_t x, const uint8_t *p, size_t len)
+{
+    while(len--)
+        x ^= *p++;
+    return x;
+}
+
+static int check(const char *name, uint32_t got, uint32_t expected)
+{
+    if(got == expected)
+        return 0;
+    printf("FAIL %s: got 0x%08x expected 0x%08x\r\n", name, (unsigned)got, (unsigned)expected);
+    return 1;
+}
+
+static int check_all(void)
+{
+    const uint8_t *digits = (const uint8_t *)"123456789";
+    int fails = 0;
+
+    fails += check("crc8_maxim check", crc8_maxim(0, digits, 9), 0xA1);
+    fails += check("crc16_arc check", crc16_arc(0, digits, 9), 0xBB3D);
+    fails += check("crc32_ieee check", crc32_ieee(0, digits, 9), 0xCBF43926);
+
+    for(int round = 0; round < CHECK_ROUNDS; round++) {
+        for(size_t i = 0; i < sizeof(buf); i++)
+            buf[i] = (round & 1) ? 0xff : rand();
+        size_t offs = rand() % 4;
+        size_t len = rand() % (BENCH_LEN + 1);
+        size_t split = rand() % (len + 1);
+        const uint8_t *p = buf + offs;
+
+        fails += check("crc8_maxim", crc8_maxim(crc8_maxim(0, p, split), p + split, len - split),
+                       ref_crc8_maxim(0, p, len));
+        fails += check("crc16_arc", crc16_arc(crc16_arc(0, p, split), p + split, len - split),
+                       ref_crc16_arc(0, p, len));
+        fails += check("crc32_ieee", crc32_ieee(crc32_ieee(0, p, split), p + split, len - split),
+                       ref_crc32_ieee(0, p, len));
+        fails += check("checksum_inet", checksum_inet(p, len), ref_checksum_inet(p, len));
+        fails += check("checksum_xor8", checksum_xor8(0xEF, p, len), ref_checksum_xor8(0xEF, p, len));
+        if(fails)
+            break;
+    }
+    return fails;
+}
+
+#define BENCH(name, expr) do {                                          \
+        uint32_t start = timestamp();                                   \
+        volatile uint32_t result = (expr);                              \
+        uint32_t time = timestamp() - start;                            \
+        (void)result;                                                   \
+        printf("%-24s %7u " TIME_UNIT "\r\n", name, (unsigned)time);   \
+    } while(0)
+
+static void benchmark(void)
+{
+    for(size_t i = 0; i < sizeof(buf); i++)
+        buf[i] = rand();
+
+    printf("\r\nTimes for %d bytes:\r\n", BENCH_LEN);
+    /* Run everything once first, so nothing is timed with a cold
+       flash cache */
+    for(int pass = 0; pass < 2; pass++) {
+        if(pass)
+            printf("\r\n");
+        BENCH("crc8_maxim", crc8_maxim(0, buf, BENCH_LEN));
+        BENCH("  bitwise", ref_crc8_maxim(0, buf, BENCH_LEN));
+        BENCH("crc16_arc", crc16_arc(0, buf, BENCH_LEN));
+        BENCH("  bitwise", ref_crc16_arc(0, buf, BENCH_LEN));
+        BENCH("crc32_ieee", crc32_ieee(0, buf, BENCH_LEN));
+        BENCH("  bitwise", ref_crc32_ieee(0, buf, BENCH_LEN));
+        BENCH("checksum_inet", checksum_inet(buf, BENCH_LEN));
+        BENCH("  unaligned", checksum_inet(buf + 1, BENCH_LEN));
+        BENCH("  bytewise", ref_checksum_inet(buf, BENCH_LEN));
+        BENCH("checksum_xor8", checksum_xor8(0, buf, BENCH_LEN));
+        BENCH("  bytewise", ref_checksum_xor8(0, buf, BENCH_LEN));
+    }
+}
+
+static void run(void)
+{
+    printf("\r\nChecking checksums...\r\n");
+    int fails = check_all();
+    printf("%s\r\n", fails ? "FAILED" : "PASS");
+    benchmark();
+    printf("Done.\r\n");
+}
+
+#ifdef __XTENSA__
+void user_init(void)
+{
+    uart_set_baud(0, 115200);
+    run();
+}
+#else
+int main(void)
+{
+    run();
+    return 0;
+}
+#endif
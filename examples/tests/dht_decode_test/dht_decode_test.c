@@ -0,0 +1,173 @@
+/* Checks the DHT reply decoder (extras/dht/dht_decode.c) against
+ * synthetic edge captures.
+ *
+ * Each trace is the CCOUNT of every falling edge of a reply, as the
+ * driver's GPIO interrupt records them: the response, 40 data bits and
+ * the end of the frame. The sensor's timing is spread over the
+ * datasheet tolerances (response 80us low and 80us high, bits 50us low
+ * then 26-28us high for a 0 or 70us for a 1), every edge gets a few us
+ * of interrupt latency, and the captures start at random CCOUNT values
+ * so some wrap around. Random data is checked at 80 and 160MHz:
+ *
+ *  - every trace decodes to the data sent, with edges up to 12us late
+ *  - a single edge up to 30us late gives the data sent or an error,
+ *    never wrong data (the two bits it moves change the checksum)
+ *  - no edges fail with -ETIMEDOUT; a truncated reply (as when an edge
+ *    is missed), a response outside its limits or a bit held high for
+ *    100-200us too long with -EIO; and a wrong checksum with -EBADMSG
+ *
+ * Results are printed on the serial port. The same file builds on a
+ * PC:
+ *   cc -O2 -I../../../extras/dht dht_decode_test.c ../../../extras/dht/dht_decode.c
+ *
+ * This sample code is in the public domain.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include "dht_decode.h"
+
+#ifdef __XTENSA__
+#include "espressif/esp_common.h"
+#include "esp/uart.h"
+#endif
+
+#define ROUNDS 5000
+
+static uint32_t cpu_mhz;
+
+/* Random time in ns between min and max us */
+static uint32_t spread(uint32_t min_us, uint32_t max_us)
+{
+    return min_us * 1000 + rand() % ((max_us - min_us) * 1000 + 1);
+}
+
+/* The falling edge times of a reply, in ns from the end of phase A */
+static void reply(const uint8_t data[DHT_DATA_BYTES], uint32_t ns[DHT_CAPTURE_EDGES])
+{
+    uint32_t t = spread(20, 40);
+    int n = 0;
+
+    ns[n++] = t;
+    t += spread(75, 85) + spread(75, 85);
+    for(int i = 0; i < 40; i++) {
+        bool bit = (data[i / 8] >> (7 - i % 8)) & 1;
+        ns[n++] = t;
+        t += spread(48, 55) + (bit ? spread(68, 75) : spread(24, 30));
+    }
+    ns[n++] = t;
+}
+
+/* Timestamps as the interrupt takes them, 1-3us after each edge */
+static void capture(const uint32_t ns[DHT_CAPTURE_EDGES], uint32_t edges[DHT_CAPTURE_EDGES])
+{
+    uint32_t base = rand() * 2u;
+    for(int i = 0; i < DHT_CAPTURE_EDGES; i++)
+        edges[i] = base + (uint64_t)(ns[i] + spread(1, 3)) * cpu_mhz / 1000;
+}
+
+static void random_data(uint8_t data[DHT_DATA_BYTES])
+{
+    for(int i = 0; i < 4; i++)
+        data[i] = rand();
+    data[4] = data[0] + data[1] + data[2] + data[3];
+}
+
+static int fail(int round, const char *what, int res)
+{
+    printf("FAIL round %d: %s (%d), %uMHz CPU\r\n", round, what, res, (unsigned)cpu_mhz);
+    return 1;
+}
+
+static int check_round(int round)
+{
+    uint8_t data[DHT_DATA_BYTES], out[DHT_DATA_BYTES];
+    uint32_t ns[DHT_CAPTURE_EDGES], edges[DHT_CAPTURE_EDGES];
+    int fails = 0, res;
+
+    cpu_mhz = (rand() & 1) ? 160 : 80;
+    random_data(data);
+    reply(data, ns);
+
+    /* Every edge late */
+    capture(ns, edges);
+    for(int i = 0; i < DHT_CAPTURE_EDGES; i++)
+        edges[i] += rand() % (12 * cpu_mhz);
+    res = dht_decode(edges, DHT_CAPTURE_EDGES, cpu_mhz, out);
+    if(res != 0 || memcmp(out, data, DHT_DATA_BYTES))
+        fails += fail(round, "latency", res);
+
+    /* One edge very late */
+    capture(ns, edges);
+    edges[rand() % DHT_CAPTURE_EDGES] += rand() % (30 * cpu_mhz);
+    res = dht_decode(edges, DHT_CAPTURE_EDGES, cpu_mhz, out);
+    if(res == 0 && memcmp(out, data, DHT_DATA_BYTES))
+        fails += fail(round, "wrong data from a late edge", res);
+
+    /* Errors */
+    capture(ns, edges);
+    res = dht_decode(edges, 0, cpu_mhz, out);
+    if(res != -ETIMEDOUT)
+        fails += fail(round, "no edges", res);
+    res = dht_decode(edges, 1 + rand() % (DHT_CAPTURE_EDGES - 1), cpu_mhz, out);
+    if(res != -EIO)
+        fails += fail(round, "truncated reply", res);
+
+    /* Response too short or too long */
+    uint32_t bad[DHT_CAPTURE_EDGES];
+    memcpy(bad, edges, sizeof(edges));
+    bad[0] = bad[1] - ((rand() & 1) ? 100 : 240) * cpu_mhz;
+    res = dht_decode(bad, DHT_CAPTURE_EDGES, cpu_mhz, out);
+    if(res != -EIO)
+        fails += fail(round, "response out of range", res);
+
+    /* The line held high in the middle of a bit */
+    memcpy(bad, edges, sizeof(edges));
+    uint32_t stall = (100 + rand() % 100) * cpu_mhz;
+    for(int i = 2 + rand() % (DHT_CAPTURE_EDGES - 2); i < DHT_CAPTURE_EDGES; i++)
+        bad[i] += stall;
+    res = dht_decode(bad, DHT_CAPTURE_EDGES, cpu_mhz, out);
+    if(res != -EIO)
+        fails += fail(round, "stalled bit", res);
+
+    data[4] += 1 + rand() % 255;
+    reply(data, ns);
+    capture(ns, edges);
+    res = dht_decode(edges, DHT_CAPTURE_EDGES, cpu_mhz, out);
+    if(res != -EBADMSG)
+        fails += fail(round, "wrong checksum", res);
+    return fails;
+}
+
+static int check_all(void)
+{
+    int fails = 0;
+    for(int round = 0; round < ROUNDS && !fails; round++)
+        fails += check_round(round);
+    return fails;
+}
+
+static void run(void)
+{
+    printf("\r\nChecking DHT reply decoding...\r\n");
+    int fails = check_all();
+    printf("%s\r\n", fails ? "FAILED" : "PASS");
+    printf("Done.\r\n");
+}
+
+#ifdef __XTENSA__
+void user_init(void)
+{
+    uart_set_baud(0, 115200);
+    run();
+}
+#else
+int main(void)
+{
+    run();
+    return 0;
+}
+#endif
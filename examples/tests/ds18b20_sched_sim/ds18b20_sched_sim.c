@@ -0,0 +1,435 @@
+/* Runs the DS18B20 scheduler (extras/ds18b20/ds18b20_sched.c) on a PC
+ * against simulated sensors, and checks its rounds.
+ *
+ * The ds18b20 and onewire calls the scheduler makes are stubbed: each
+ * sensor has a resolution, a power mode and a random temperature, and
+ * each stub checks that it's called at a sensible point in the round.
+ * Ticks only pass in vTaskDelay() and, at random, in scratchpad reads,
+ * a few of which take long enough to make the round overrun.
+ * The task runs until its last round of a run is done, or until it
+ * would wait for a trigger forever.
+ *
+ * Each run has 1-4 buses with 1-4 sensors each, at random resolutions,
+ * with some buses parasitically powered. Some rounds have a bus whose
+ * conversion command fails, and some scratchpad reads fail. Runs are
+ * triggered only, or periodic with a period longer or shorter than a
+ * round. The checks are:
+ *
+ *  - every sensor is set to its resolution when the task starts
+ *  - each round starts one conversion per bus, all at the same tick
+ *  - a sensor is read as soon as its conversion time has passed since
+ *    the start (its bus's slowest sensor's on a parasite bus) and the
+ *    read before it is done, and the reading has that read's tick
+ *  - readings come in order of that ready time, every sensor once
+ *  - a bus with external power is depowered as soon as its conversion
+ *    starts, a parasite bus not until its slowest sensor is done and
+ *    before any of its sensors are read
+ *  - a failed bus isn't read and its sensors report NaN, as does a
+ *    failed read; otherwise the temperature is the raw reading with
+ *    the bits below the reported resolution masked
+ *  - the callback and the queue get the same readings
+ *  - periodic rounds start a period apart, or straight after the last
+ *    one if it ran over, and a trigger during a round starts another
+ *    straight after it
+ *  - sensors with a bad pin or resolution are refused
+ *
+ * There are no sensors to simulate on the ESP8266 itself, so this only
+ * builds on a PC (and has no Makefile, so build-examples skips it):
+ *   cc -O2 -I../host_sim/include -I../../../extras -I../../../core/include \
+ *       ds18b20_sched_sim.c ../../../extras/ds18b20/ds18b20_sched.c -lm
+ *
+ * This sample code is in the public domain.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <setjmp.h>
+#include "ds18b20/ds18b20_sched.h"
+
+#define RUNS 2000
+#define MAX_BUSES 4
+#define MAX_PER_BUS 4
+#define MAX_SENSORS (MAX_BUSES * MAX_PER_BUS)
+
+#define ms_to_ticks(ms) (((ms) + portTICK_RATE_MS - 1) / portTICK_RATE_MS)
+
+static portTickType ticks;
+static jmp_buf task_exit;
+static pdTASK_CODE task_code;
+static void *task_params;
+static int run_no;
+static int fails;
+
+/* This run */
+static ds18b20_sched_t sched;
+static ds18b20_sensor_t sensors[MAX_SENSORS];
+static bool parasite[MAX_SENSORS];
+static int resolution_set[MAX_SENSORS];
+static size_t count;
+static uint32_t buses, parasite_buses;
+static int bus_bits[16];        /* slowest resolution on each bus */
+static int rounds, rounds_wanted;
+static bool retrigger, trigger_again;
+static portTickType next;       /* when the next periodic round is due */
+static portTickType round_end;
+
+/* This round */
+static bool in_round;
+static portTickType start;
+static uint32_t measured, failed, depowered;
+static int16_t raw[MAX_SENSORS];
+static bool read_failed[MAX_SENSORS];
+static size_t order[MAX_SENSORS];
+static size_t nread;
+static portTickType busy_until; /* when the last read ended */
+static bool was_read;           /* the sensor being reported was read */
+static ds18b20_reading_t last_reading;
+
+static void fail(const char *what, long long n)
+{
+    if (!fails)
+        printf("FAIL run %d round %d: %s (%lld)\r\n", run_no, rounds, what, n);
+    fails++;
+}
+
+static int find_sensor(int pin, ds18b20_addr_t addr)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (sensors[i].pin == pin && sensors[i].addr == addr)
+            return i;
+    }
+    return -1;
+}
+
+static int ready_bits(size_t i)
+{
+    int pin = sensors[i].pin;
+    return (parasite_buses & BIT(pin)) ? bus_bits[pin] : sensors[i].resolution;
+}
+
+static portTickType ready_tick(size_t i)
+{
+    return start + ms_to_ticks(ds18b20_conversion_ms(ready_bits(i)));
+}
+
+static void start_round(void)
+{
+    /* When the task should start it: when due, or at once if the last
+       round ran over (a trigger counts as running over) */
+    portTickType expected = ((int32_t)(next - round_end) > 0) ? next : round_end;
+    if (sched.period_ms) {
+        if (ticks != expected)
+            fail("round start, ticks out", (int32_t)(ticks - expected));
+        next += ms_to_ticks(sched.period_ms);
+        if ((int32_t)(next - ticks) <= 0)
+            next = ticks + ms_to_ticks(sched.period_ms);
+    } else if (ticks != round_end) {
+        fail("triggered round start, ticks out", (int32_t)(ticks - round_end));
+    }
+
+    in_round = true;
+    start = ticks;
+    measured = failed = depowered = 0;
+    nread = 0;
+    busy_until = start;
+    for (size_t i = 0; i < count; i++) {
+        raw[i] = -55 * 16 + rand() % (180 * 16);
+        read_failed[i] = rand() % 10 == 0;
+    }
+    /* Sensors in order of ready time, in array order within that */
+    size_t n = 0;
+    for (int bits = 9; bits <= 12; bits++) {
+        for (size_t i = 0; i < count; i++) {
+            if (ready_bits(i) == bits)
+                order[n++] = i;
+        }
+    }
+}
+
+static void end_round(void)
+{
+    if (measured != buses)
+        fail("buses measured", measured ^ buses);
+    uint32_t want = (buses & ~failed) | (parasite_buses & buses);
+    if ((depowered & want) != want)
+        fail("buses not depowered", want & ~depowered);
+    in_round = false;
+    round_end = ticks;
+    rounds++;
+    if (trigger_again) {
+        trigger_again = false;
+        ds18b20_sched_trigger(&sched);
+    } else if (sched.period_ms && rounds == rounds_wanted) {
+        longjmp(task_exit, 1);
+    }
+}
+
+/* ds18b20 and onewire stubs */
+
+bool ds18b20_set_resolution(int pin, ds18b20_addr_t addr, int bits)
+{
+    int i = find_sensor(pin, addr);
+    if (i < 0)
+        fail("resolution set on an unknown sensor", pin);
+    else
+        resolution_set[i] = bits;
+    return true;
+}
+
+bool ds18b20_parasite_powered(int pin, ds18b20_addr_t addr)
+{
+    int i = find_sensor(pin, addr);
+    return i >= 0 && parasite[i];
+}
+
+bool ds18b20_measure(int pin, ds18b20_addr_t addr, bool wait)
+{
+    if (!in_round)
+        start_round();
+    if (addr != DS18B20_ANY || wait)
+        fail("conversion not broadcast, or waited for", pin);
+    if (!(buses & BIT(pin)) || (measured & BIT(pin)))
+        fail("conversion started twice or on a bus with no sensors", pin);
+    if (ticks != start)
+        fail("conversions not started together", (int32_t)(ticks - start));
+    measured |= BIT(pin);
+    /* One round in four has a failed bus */
+    if (rand() % (4 * __builtin_popcount(buses)) == 0) {
+        failed |= BIT(pin);
+        return false;
+    }
+    return true;
+}
+
+void onewire_depower(int pin)
+{
+    if (!(measured & BIT(pin)) || (depowered & BIT(pin)))
+        fail("depowered before starting, or twice", pin);
+    depowered |= BIT(pin);
+    if (parasite_buses & BIT(pin)) {
+        portTickType due = start + ms_to_ticks(ds18b20_conversion_ms(bus_bits[pin]));
+        if ((int32_t)(ticks - due) < 0)
+            fail("parasite bus depowered early, ticks", (int32_t)(ticks - due));
+    } else if (ticks != start) {
+        fail("powered bus not depowered at once, ticks", (int32_t)(ticks - start));
+    }
+}
+
+bool ds18b20_read_scratchpad(int pin, ds18b20_addr_t addr, uint8_t *buffer)
+{
+    int i = find_sensor(pin, addr);
+    if (i < 0) {
+        fail("read of an unknown sensor", pin);
+        return false;
+    }
+    if (failed & BIT(pin))
+        fail("read of a failed bus", pin);
+    if ((parasite_buses & BIT(pin)) && !(depowered & BIT(pin)))
+        fail("read of a parasite bus still powered", pin);
+    /* As soon as it's ready, or the last read is done */
+    portTickType want = ready_tick(i);
+    if ((int32_t)(busy_until - want) > 0)
+        want = busy_until;
+    if (ticks != want)
+        fail("read time, ticks late", (int32_t)(ticks - want));
+
+    /* A read takes a tick now and then, and very occasionally much
+       longer (a stuck bus), so some rounds run over the period */
+    ticks += (rand() % 100 == 0) ? 150 : rand() % 2;
+    busy_until = ticks;
+    was_read = true;
+    memset(buffer, 0, 8);
+    buffer[0] = raw[i];
+    buffer[1] = raw[i] >> 8;
+    buffer[4] = (resolution_set[i] - 9) << 5 | 0x1f;
+    return !read_failed[i];
+}
+
+/* FreeRTOS stubs */
+
+portBASE_TYPE xTaskCreate(pdTASK_CODE code, const signed char *name, uint16_t stack,
+                          void *params, unsigned portBASE_TYPE priority, xTaskHandle *handle)
+{
+    task_code = code;
+    task_params = params;
+    return pdPASS;
+}
+
+portTickType xTaskGetTickCount(void)
+{
+    return ticks;
+}
+
+void vTaskDelay(portTickType t)
+{
+    /* Waiting for a trigger that will never come */
+    if (t == portMAX_DELAY)
+        longjmp(task_exit, 1);
+    ticks += t;
+    if ((int32_t)(ticks - round_end) > ms_to_ticks(10000)) {
+        fail("no round finished for 10s", 0);
+        longjmp(task_exit, 1);
+    }
+}
+
+static void check_reading(const ds18b20_reading_t *r)
+{
+    if (!in_round || nread >= count) {
+        fail("reading outside a round", nread);
+        return;
+    }
+    size_t i = order[nread];
+    if (r->pin != sensors[i].pin || r->addr != sensors[i].addr) {
+        fail("reading out of order, expected sensor", i);
+        return;
+    }
+    /* Taken after the read, or when the read would have been */
+    if (!was_read) {
+        portTickType due = ready_tick(i);
+        if ((int32_t)(due - busy_until) > 0)
+            busy_until = due;
+    }
+    was_read = false;
+    if (r->timestamp != busy_until)
+        fail("reading timestamp, ticks late", (int32_t)(r->timestamp - busy_until));
+
+    if ((failed & BIT(sensors[i].pin)) || read_failed[i]) {
+        if (!isnan(r->temperature))
+            fail("no NaN for a failed read", i);
+    } else {
+        int bits = resolution_set[i];
+        float want = (raw[i] & ~((1 << (12 - bits)) - 1)) / 16.0f;
+        if (r->resolution != bits)
+            fail("reported resolution", r->resolution);
+        if (r->temperature != want)
+            fail("temperature, 1/16C out", (long long)((r->temperature - want) * 16));
+    }
+}
+
+static void finish_reading(void)
+{
+    if (++nread == count)
+        end_round();
+}
+
+static void callback(const ds18b20_reading_t *r, void *arg)
+{
+    if (arg != &sched)
+        fail("callback arg", 0);
+    check_reading(r);
+    last_reading = *r;
+    if (!sched.queue)
+        finish_reading();
+}
+
+portBASE_TYPE xQueueSend(xQueueHandle queue, const void *item, portTickType t)
+{
+    const ds18b20_reading_t *r = item;
+    if (queue != sched.queue || t != 0)
+        fail("queue send", t);
+    if (!sched.callback)
+        check_reading(r);
+    else if (memcmp(r, &last_reading, sizeof(*r)) && !(isnan(r->temperature) && isnan(last_reading.temperature)))
+        fail("queue and callback readings differ", nread);
+    finish_reading();
+    return pdTRUE;
+}
+
+static void setup_run(void)
+{
+    static const uint32_t periods[] = { 0, 500, 1000, 2000 };
+
+    memset(&sched, 0, sizeof(sched));
+    memset(bus_bits, 0, sizeof(bus_bits));
+    count = 0;
+    buses = parasite_buses = 0;
+    int nbuses = 1 + rand() % MAX_BUSES;
+    while (__builtin_popcount(buses) < nbuses)
+        buses |= BIT(rand() % 16);
+    for (int pin = 0; pin < 16; pin++) {
+        if (!(buses & BIT(pin)))
+            continue;
+        bool bus_parasite = rand() % 3 == 0;
+        int n = 1 + rand() % MAX_PER_BUS;
+        for (int j = 0; j < n; j++) {
+            sensors[count].pin = pin;
+            sensors[count].addr = ((uint64_t)rand() << 32 | rand()) << 8 | 0x28;
+            sensors[count].resolution = 9 + rand() % 4;
+            /* At least one, maybe more, on a parasite bus */
+            parasite[count] = bus_parasite && (j == 0 || rand() & 1);
+            if (parasite[count])
+                parasite_buses |= BIT(pin);
+            if (sensors[count].resolution > bus_bits[pin])
+                bus_bits[pin] = sensors[count].resolution;
+            resolution_set[count] = 0;
+            count++;
+        }
+    }
+
+    sched.sensors = sensors;
+    sched.count = count;
+    sched.period_ms = periods[rand() % 4];
+    switch (rand() % 3) {
+    case 0:  sched.callback = callback; break;
+    case 1:  sched.queue = (xQueueHandle)&sched; break;
+    default: sched.callback = callback; sched.queue = (xQueueHandle)&sched; break;
+    }
+    sched.arg = &sched;
+    rounds = 0;
+    rounds_wanted = 1 + rand() % 5;
+    retrigger = trigger_again = false;
+    in_round = false;
+}
+
+static void check_bad_sensors(void)
+{
+    ds18b20_sensor_t bad = { .pin = 4, .addr = DS18B20_ANY, .resolution = 12 };
+    ds18b20_sched_t s = { .sensors = &bad, .count = 1 };
+    switch (rand() % 3) {
+    case 0:  bad.pin = 16; break;
+    case 1:  bad.resolution = 8; break;
+    default: bad.resolution = 13; break;
+    }
+    task_code = NULL;
+    if (ds18b20_sched_start(&s) || task_code)
+        fail("bad sensor accepted", bad.pin * 100 + bad.resolution);
+}
+
+static void run(void)
+{
+    setup_run();
+    check_bad_sensors();
+    if (!ds18b20_sched_start(&sched) || !task_code)
+        return fail("ds18b20_sched_start", 0);
+
+    next = round_end = ticks;
+    if (!sched.period_ms) {
+        ds18b20_sched_trigger(&sched);
+        retrigger = trigger_again = rand() & 1;
+    }
+    if (!setjmp(task_exit))
+        task_code(task_params);
+
+    for (size_t i = 0; i < count; i++) {
+        if (resolution_set[i] != sensors[i].resolution)
+            fail("resolution not set, sensor", i);
+    }
+    if (in_round)
+        fail("round left unfinished", nread);
+    int want = sched.period_ms ? rounds_wanted : 1 + retrigger;
+    if (rounds != want)
+        fail("rounds run", rounds);
+    vSemaphoreDelete(sched.trigger);
+}
+
+int main(void)
+{
+    printf("\r\nChecking the DS18B20 scheduler against simulated sensors...\r\n");
+    for (run_no = 0; run_no < RUNS && !fails; run_no++)
+        run();
+    printf("%s\r\n", fails ? "FAILED" : "PASS");
+    return fails != 0;
+}
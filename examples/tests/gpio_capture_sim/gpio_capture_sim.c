@@ -0,0 +1,307 @@
+/* Runs the GPIO edge capture driver (extras/gpio_capture) on a PC
+ * against a simulated input pin, and checks what it records.
+ *
+ * The simulated pin changes level at scheduled CCOUNT times. When the
+ * change matches the capture's edge type, the pin handler is called a
+ * random 20-220 cycles later, standing in for interrupt latency, and
+ * its own CCOUNT read is noted as the time the event should carry.
+ * For a single edge type, some pulses end before the handler runs.
+ * systime_us() counts from the same simulated cycles.
+ *
+ * Each round picks the CPU at 80 or 160MHz, a random edge type and a
+ * random starting level, and a CCOUNT which wraps part way through.
+ * The checks are:
+ *
+ *  - events come out of a 16 entry ring in order, over many refills,
+ *    with the CCOUNT of the handler (bit 0 cleared), the pin, and the
+ *    level after the edge: toggling from the starting level for
+ *    GPIO_INTTYPE_EDGE_ANY, fixed for the other types
+ *  - event times are the handler's time in systime_us() microseconds,
+ *    to within 1us, including across the CCOUNT wrap
+ *  - edges arriving with the ring full are counted as overflows and
+ *    the oldest events are kept, and gpio_capture_count() counts them
+ *  - a capture without a ring measures the frequency of a square wave
+ *    to within the error the interrupt latency allows, gives 0 on the
+ *    first call and when no edges arrived, and for EDGE_ANY reports
+ *    the high and low pulse widths
+ *  - a second capture on the same pin fails with -EBUSY, and stopping
+ *    releases the pin's handler and interrupt
+ *
+ * There is no way to feed edges to the ESP8266 itself, so this only
+ * builds on a PC (and has no Makefile, so build-examples skips it):
+ *   cc -O2 -I../host_sim/include -I../../../extras/gpio_capture -I../../../core/include \
+ *       gpio_capture_sim.c ../../../extras/gpio_capture/gpio_capture.c
+ *
+ * This sample code is in the public domain.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include "esp/gpio.h"
+#include "gpio_capture.h"
+
+#define ROUNDS 2000
+#define PIN 5
+#define RING_SIZE 16
+#define MAX_EDGES 1024
+
+/* Simulated time, in CPU cycles since the start. CCOUNT and
+   systime_us() are both counted from it. */
+static uint64_t cycles;
+static uint32_t ccount_base;    /* CCOUNT at cycles 0 */
+static uint64_t us_base;        /* systime_us() at cycles_base */
+static uint64_t cycles_base;
+static uint32_t cpu_mhz = 80;
+
+static sim_gpio_regs_t regs;
+static bool level;
+static gpio_pin_handler_t handler;
+static gpio_inttype_t int_type;
+static bool in_handler;
+static bool handler_read;       /* the handler has read CCOUNT */
+static uint64_t handler_cycles;
+
+/* Events the driver should have put in its ring */
+static struct {
+    uint32_t ccount;
+    uint64_t time_us;
+    bool level;
+} expected[MAX_EDGES];
+static int expected_head, expected_tail;
+static uint32_t edges_sent, overflows_expected;
+
+uint32_t sim_ccount(void)
+{
+    cycles += 1 + rand() % 4;
+    if (in_handler && !handler_read) {
+        handler_read = true;
+        handler_cycles = cycles;
+    }
+    return ccount_base + (uint32_t)cycles;
+}
+
+uint64_t systime_us(void)
+{
+    return us_base + (cycles - cycles_base) / cpu_mhz;
+}
+
+sim_gpio_regs_t *sim_gpio(void)
+{
+    regs.IN = level ? BIT(PIN) : 0;
+    return &regs;
+}
+
+void sim_critical(bool enter)
+{
+}
+
+uint32_t cpu_freq_get(void)
+{
+    return cpu_mhz;
+}
+
+/* Reads are made with no timeout, so never wait */
+void vTaskDelay(portTickType ticks)
+{
+}
+
+void gpio_set_pin_handler(const uint8_t gpio_num, gpio_pin_handler_t h)
+{
+    if (gpio_num == PIN)
+        handler = h;
+}
+
+void gpio_set_interrupt(const uint8_t gpio_num, const gpio_inttype_t type)
+{
+    if (gpio_num == PIN)
+        int_type = type;
+}
+
+/* Change the pin at 'at' cycles, and run the handler if it should */
+static void drive_at(uint64_t at, bool new_level)
+{
+    if (at > cycles)
+        cycles = at;
+    if (new_level == level)
+        return;
+    level = new_level;
+    if (!handler || !(int_type == GPIO_INTTYPE_EDGE_ANY
+                      || (int_type == GPIO_INTTYPE_EDGE_POS && level)
+                      || (int_type == GPIO_INTTYPE_EDGE_NEG && !level)))
+        return;
+
+    bool edge_level = level;
+    cycles += 20 + rand() % 200;
+    /* A pulse shorter than the latency: the pin is back where it was by
+       the time the handler runs, and the second edge is of the other
+       type. With EDGE_ANY it would be merged into the first interrupt,
+       which isn't simulated. */
+    if (int_type != GPIO_INTTYPE_EDGE_ANY && rand() % 8 == 0)
+        level = !level;
+    in_handler = true;
+    handler_read = false;
+    handler(PIN);
+    in_handler = false;
+    edges_sent++;
+
+    if (expected_head - expected_tail == RING_SIZE) {
+        overflows_expected++;
+        return;
+    }
+    int i = expected_head++ % MAX_EDGES;
+    expected[i].ccount = (ccount_base + (uint32_t)handler_cycles) & ~1;
+    expected[i].time_us = us_base + (handler_cycles - cycles_base) / cpu_mhz;
+    expected[i].level = edge_level;
+}
+
+static int fail(int round, const char *what, long long n)
+{
+    printf("FAIL round %d: %s (%lld), %uMHz CPU\r\n", round, what, n, (unsigned)cpu_mhz);
+    return 1;
+}
+
+/* Read everything in the ring, a random number of events at a time */
+static int check_read(int round, gpio_capture_t *cap)
+{
+    gpio_capture_event_t events[RING_SIZE];
+    int fails = 0;
+    size_t n;
+    while ((n = gpio_capture_read(cap, events, 1 + rand() % RING_SIZE, 0)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            if (expected_tail == expected_head)
+                return fails + fail(round, "more events than edges", i);
+            int e = expected_tail++ % MAX_EDGES;
+            long long dt = (long long)(events[i].time_us - expected[e].time_us);
+            if (events[i].ccount != expected[e].ccount)
+                fails += fail(round, "event CCOUNT", events[i].ccount - expected[e].ccount);
+            if (dt < -1 || dt > 1)
+                fails += fail(round, "event time", dt);
+            if (events[i].level != expected[e].level)
+                fails += fail(round, "event level", events[i].level);
+            if (events[i].pin != PIN)
+                fails += fail(round, "event pin", events[i].pin);
+            if (fails)
+                return fails;
+        }
+    }
+    if (expected_tail != expected_head)
+        fails += fail(round, "events missing", expected_head - expected_tail);
+    return fails;
+}
+
+static int check_ring(int round, gpio_inttype_t type)
+{
+    static uint32_t ring[RING_SIZE];
+    gpio_capture_t cap, other;
+    int fails = 0;
+
+    expected_head = expected_tail = 0;
+    edges_sent = overflows_expected = 0;
+    if (gpio_capture_init(&cap, PIN, type, ring, RING_SIZE) < 0)
+        return fail(round, "gpio_capture_init", 0);
+    if (gpio_capture_init(&other, PIN, type, NULL, 0) != -EBUSY)
+        fails += fail(round, "second capture on the pin", 0);
+
+    uint64_t at = cycles;
+    for (int batch = 0; batch < 20 && !fails; batch++) {
+        /* Sometimes more than the ring holds */
+        int toggles = rand() % (RING_SIZE * 5 / 2);
+        for (int i = 0; i < toggles; i++) {
+            at += 300 + rand() % 3000;
+            drive_at(at, !level);
+        }
+        fails += check_read(round, &cap);
+    }
+    if (gpio_capture_count(&cap) != edges_sent)
+        fails += fail(round, "edge count", (long long)gpio_capture_count(&cap) - edges_sent);
+    if (gpio_capture_overflows(&cap) != overflows_expected)
+        fails += fail(round, "overflows", (long long)gpio_capture_overflows(&cap) - overflows_expected);
+
+    gpio_capture_stop(&cap);
+    if (handler || int_type != GPIO_INTTYPE_NONE)
+        fails += fail(round, "pin not released", int_type);
+    return fails;
+}
+
+static int check_frequency(int round, gpio_inttype_t type)
+{
+    gpio_capture_t cap;
+    int fails = 0;
+
+    if (gpio_capture_init(&cap, PIN, type, NULL, 0) < 0)
+        return fail(round, "gpio_capture_init without a ring", 0);
+
+    /* Periods of 1000-21000 cycles, duty cycle 50% for EDGE_ANY (see
+       gpio_capture_frequency()) */
+    uint32_t period = 1000 + rand() % 20000;
+    uint32_t high = (type == GPIO_INTTYPE_EDGE_ANY) ? period / 2 : period / 10 + rand() % (period * 8 / 10);
+    int periods = 10 + rand() % 50;
+
+    uint64_t at = cycles + 1000;
+    for (int i = 0; i < 2; i++) {
+        drive_at(at += period - high, true);
+        drive_at(at += high, false);
+    }
+    if (gpio_capture_frequency(&cap) != 0)
+        fails += fail(round, "first frequency reading", 0);
+    for (int i = 0; i < periods; i++) {
+        drive_at(at += period - high, true);
+        drive_at(at += high, false);
+    }
+    float hz = gpio_capture_frequency(&cap);
+    float want = (float)cpu_mhz * 1000000 / period;
+    /* Each end of the measurement can be late by the latency */
+    float error = 230.0f * 2 / ((float)periods * period) + 1e-5f;
+    if (hz < want * (1 - error) || hz > want * (1 + error))
+        fails += fail(round, "frequency, mHz out", (long long)((hz - want) * 1000));
+    if (gpio_capture_frequency(&cap) != 0)
+        fails += fail(round, "frequency with no edges", 0);
+
+    uint32_t high_us, low_us;
+    bool widths = gpio_capture_pulse_width(&cap, &high_us, &low_us);
+    if (type == GPIO_INTTYPE_EDGE_ANY) {
+        /* Late by up to the latency at one end, and rounded down */
+        long long dh = (long long)high_us - high / cpu_mhz;
+        long long dl = (long long)low_us - (period - high) / cpu_mhz;
+        if (!widths)
+            fails += fail(round, "no pulse widths", 0);
+        else if (dh < -4 || dh > 4 || dl < -4 || dl > 4)
+            fails += fail(round, "pulse width", dh * 1000 + dl);
+    }
+    gpio_capture_stop(&cap);
+    return fails;
+}
+
+static int check_round(int round)
+{
+    static const gpio_inttype_t types[] = {
+        GPIO_INTTYPE_EDGE_POS, GPIO_INTTYPE_EDGE_NEG, GPIO_INTTYPE_EDGE_ANY,
+    };
+
+    /* Keep systime_us() running through the clock change */
+    us_base = systime_us();
+    cycles_base = cycles;
+    cpu_mhz = (rand() & 1) ? 160 : 80;
+    /* CCOUNT wraps within the first 100000 cycles */
+    ccount_base = (uint32_t)(0 - cycles - rand() % 100000);
+    level = rand() & 1;
+
+    gpio_inttype_t type = types[rand() % 3];
+    int fails = check_ring(round, type);
+    if (!fails)
+        fails += check_frequency(round, type);
+    return fails;
+}
+
+int main(void)
+{
+    printf("\r\nChecking GPIO capture against a simulated pin...\r\n");
+    int fails = 0;
+    for (int round = 0; round < ROUNDS && !fails; round++)
+        fails += check_round(round);
+    printf("%s\r\n", fails ? "FAILED" : "PASS");
+    return fails != 0;
+}
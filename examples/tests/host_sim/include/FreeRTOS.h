@@ -0,0 +1,23 @@
+/* Host stand-in for FreeRTOS.h, see sim_hw.h */
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sim_hw.h"
+#include "esp8266.h"
+
+#define portBASE_TYPE long
+typedef uint32_t portTickType;
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdPASS  pdTRUE
+#define portMAX_DELAY ((portTickType)0xffffffff)
+#define portTICK_RATE_MS 10
+
+/* There's only the one thread, so nothing to switch to */
+#define portYIELD()
+
+#endif
@@ -0,0 +1,9 @@
+/* Host stand-in for esp/clocks.h, see sim_hw.h */
+#ifndef _ESP_CLOCKS_H
+#define _ESP_CLOCKS_H
+
+#include "sim_hw.h"
+
+#define APB_CLK_FREQ 80000000
+
+#endif
@@ -0,0 +1,56 @@
+/* Host stand-in for esp/gpio.h, see sim_hw.h */
+#ifndef _ESP_GPIO_H
+#define _ESP_GPIO_H
+
+#include "sim_hw.h"
+
+#ifndef BIT
+#define BIT(X) (1U << (X))
+#endif
+
+#define GPIO (*sim_gpio())
+
+typedef enum {
+    GPIO_INPUT,
+    GPIO_OUTPUT,
+    GPIO_OUT_OPEN_DRAIN,
+} gpio_direction_t;
+
+typedef enum {
+    GPIO_INTTYPE_NONE       = 0,
+    GPIO_INTTYPE_EDGE_POS   = 1,
+    GPIO_INTTYPE_EDGE_NEG   = 2,
+    GPIO_INTTYPE_EDGE_ANY   = 3,
+    GPIO_INTTYPE_LEVEL_LOW  = 4,
+    GPIO_INTTYPE_LEVEL_HIGH = 5,
+} gpio_inttype_t;
+
+typedef void (* gpio_pin_handler_t)(uint8_t gpio_num);
+
+/* Provided by the test program, which calls the handler itself when
+   it changes the pin */
+void gpio_set_pin_handler(const uint8_t gpio_num, gpio_pin_handler_t handler);
+void gpio_set_interrupt(const uint8_t gpio_num, const gpio_inttype_t int_type);
+
+static inline void gpio_enable(const uint8_t gpio_num, const gpio_direction_t direction)
+{
+}
+
+static inline void gpio_set_pullup(uint8_t gpio_num, bool enabled, bool enabled_during_sleep)
+{
+}
+
+static inline void gpio_write(const uint8_t gpio_num, const bool set)
+{
+    if (set)
+        GPIO.OUT_SET = BIT(gpio_num);
+    else
+        GPIO.OUT_CLEAR = BIT(gpio_num);
+}
+
+static inline bool gpio_read(const uint8_t gpio_num)
+{
+    return GPIO.IN & BIT(gpio_num);
+}
+
+#endif
@@ -0,0 +1,18 @@
+/* Host stand-in for esp/interrupts.h, see sim_hw.h */
+#ifndef _ESP_INTERRUPTS_H
+#define _ESP_INTERRUPTS_H
+
+#include "sim_hw.h"
+
+static inline uint32_t _xt_disable_interrupts(void)
+{
+    sim_critical(true);
+    return 0;
+}
+
+static inline void _xt_restore_interrupts(uint32_t new_ps)
+{
+    sim_critical(false);
+}
+
+#endif
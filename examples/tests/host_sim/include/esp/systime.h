@@ -0,0 +1,7 @@
+/* Host stand-in for esp/systime.h, see sim_hw.h */
+#ifndef _ESP_SYSTIME_H
+#define _ESP_SYSTIME_H
+
+#include "sim_hw.h"
+
+#endif
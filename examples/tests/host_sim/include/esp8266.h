@@ -0,0 +1,7 @@
+/* Host stand-in for esp8266.h, see sim_hw.h */
+#ifndef _ESP8266_H
+#define _ESP8266_H
+
+#include "esp/gpio.h"
+
+#endif
@@ -0,0 +1,10 @@
+/* Host stand-in for espressif/esp_misc.h, see sim_hw.h */
+#ifndef __ESP_MISC_H__
+#define __ESP_MISC_H__
+
+#include <stdint.h>
+
+/* Declared for headers which include this, not simulated */
+void sdk_os_delay_us(uint16_t us);
+
+#endif
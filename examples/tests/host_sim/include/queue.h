@@ -0,0 +1,12 @@
+/* Host stand-in for queue.h, see sim_hw.h */
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include "FreeRTOS.h"
+
+typedef struct sim_queue *xQueueHandle;
+
+/* Provided by the test program if it uses queues */
+portBASE_TYPE xQueueSend(xQueueHandle queue, const void *item, portTickType ticks);
+
+#endif
@@ -0,0 +1,55 @@
+/* Host stand-in for semphr.h, see sim_hw.h
+ *
+ * Binary semaphores only. As nothing else runs while a task waits, a
+ * take that would block can only time out: it calls vTaskDelay() with
+ * the timeout, which the test program provides, and fails.
+ */
+#ifndef SEMAPHORE_H
+#define SEMAPHORE_H
+
+#include <stdlib.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+typedef struct {
+    bool given;
+} sim_semaphore_t;
+
+typedef sim_semaphore_t *xSemaphoreHandle;
+
+#define vSemaphoreCreateBinary(s) do { \
+        (s) = calloc(1, sizeof(sim_semaphore_t)); \
+        if (s) \
+            (s)->given = true; \
+    } while (0)
+
+static inline void vSemaphoreDelete(xSemaphoreHandle s)
+{
+    free(s);
+}
+
+static inline portBASE_TYPE xSemaphoreTake(xSemaphoreHandle s, portTickType ticks)
+{
+    if (!s->given) {
+        if (ticks)
+            vTaskDelay(ticks);
+        return pdFALSE;
+    }
+    s->given = false;
+    return pdTRUE;
+}
+
+static inline portBASE_TYPE xSemaphoreGive(xSemaphoreHandle s)
+{
+    if (s->given)
+        return pdFALSE;
+    s->given = true;
+    return pdTRUE;
+}
+
+static inline portBASE_TYPE xSemaphoreGiveFromISR(xSemaphoreHandle s, portBASE_TYPE *woken)
+{
+    return xSemaphoreGive(s);
+}
+
+#endif
@@ -0,0 +1,37 @@
+/* Hooks for running the bit-banged drivers on a PC against a simulated
+ * bus. The headers in this directory stand in for the real ones and
+ * route every GPIO register access and CCOUNT read to these functions,
+ * which each test program provides.
+ *
+ * This sample code is in the public domain.
+ */
+#ifndef _SIM_HW_H
+#define _SIM_HW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    uint32_t OUT_SET;
+    uint32_t OUT_CLEAR;
+    uint32_t IN;
+} sim_gpio_regs_t;
+
+/* Called for every access to GPIO. Should apply the OUT_SET and
+   OUT_CLEAR writes made since the last call, which are left in the
+   registers, clear them, and update IN. */
+sim_gpio_regs_t *sim_gpio(void);
+
+/* Read CCOUNT. Should also apply any writes waiting in the registers,
+   as drivers read CCOUNT straight after changing a line. */
+uint32_t sim_ccount(void);
+
+/* taskENTER_CRITICAL() and taskEXIT_CRITICAL() */
+void sim_critical(bool enter);
+
+uint32_t cpu_freq_get(void);
+
+/* esp/systime.h */
+uint64_t systime_us(void);
+
+#endif
@@ -0,0 +1,36 @@
+/* Host stand-in for task.h, see sim_hw.h */
+#ifndef TASK_H
+#define TASK_H
+
+#include "FreeRTOS.h"
+
+#define taskENTER_CRITICAL() sim_critical(true)
+#define taskEXIT_CRITICAL()  sim_critical(false)
+
+typedef void *xTaskHandle;
+typedef void (*pdTASK_CODE)(void *pvParameters);
+
+/* Provided by the test program if it uses them. vTaskDelay() is also
+   how a semaphore take waits out its timeout, see semphr.h. */
+portBASE_TYPE xTaskCreate(pdTASK_CODE code, const signed char *name, uint16_t stack,
+                          void *params, unsigned portBASE_TYPE priority, xTaskHandle *handle);
+portTickType xTaskGetTickCount(void);
+void vTaskDelay(portTickType ticks);
+
+/* Nothing else runs while a task waits, so semaphore takes wait out
+   their whole timeout (see semphr.h) and timeouts never expire before
+   they do */
+typedef struct {
+    portTickType start;
+} xTimeOutType;
+
+static inline void vTaskSetTimeOutState(xTimeOutType *time_out)
+{
+}
+
+static inline portBASE_TYPE xTaskCheckForTimeOut(xTimeOutType *time_out, portTickType *ticks)
+{
+    return pdFALSE;
+}
+
+#endif
@@ -0,0 +1,10 @@
+/* Host stand-in for xtensa_ops.h, see sim_hw.h */
+#ifndef _XTENSA_OPS_H
+#define _XTENSA_OPS_H
+
+#include "sim_hw.h"
+
+/* Only CCOUNT is simulated */
+#define RSR(var, reg) (var) = sim_ccount()
+
+#endif
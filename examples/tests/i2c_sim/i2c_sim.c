@@ -0,0 +1,328 @@
+/* Runs the bit-banged I2C driver (extras/i2c) on a PC against a
+ * simulated open drain bus and slave, and checks the protocol.
+ *
+ * The slave is a 256 byte register file at address 0x42, with an
+ * auto-incrementing register pointer set by the first byte of a write.
+ * It decodes the bus from the line levels alone, the way real hardware
+ * does: start and stop conditions, address and data bits sampled on
+ * rising SCL, ACK driven and data shifted out after falling SCL.
+ *
+ * Random transfers are run at 100kHz, 400kHz and 1MHz with the CPU at
+ * 80 or 160MHz, with random delays between CCOUNT reads and occasional
+ * long gaps standing in for interrupts. In some transfers the CPU clock
+ * changes during those gaps, as it would if another task called
+ * cpu_freq_set(). The checks are:
+ *
+ *  - data written can be read back, over a repeated start
+ *  - every transfer has exactly one start, one repeated start if it
+ *    reads after writing, and one stop, so SDA never changes while SCL
+ *    is high in the middle of a byte
+ *  - SCL high and low times are never shorter than half a period, even
+ *    across a clock change
+ *  - a wrong address fails with -EIO
+ *  - clock stretching is waited for, and fails with -ETIMEDOUT once it
+ *    goes on longer than the stretch timeout
+ *  - SDA held low fails with -EBUSY
+ *
+ * There is no bus to simulate on the ESP8266 itself, so this only
+ * builds on a PC (and has no Makefile, so build-examples skips it):
+ *   cc -O2 -I../host_sim/include -I../../../extras/i2c i2c_sim.c ../../../extras/i2c/i2c.c
+ *
+ * This sample code is in the public domain.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include "esp8266.h"
+#include "esp/clocks.h"
+#include "i2c.h"
+
+#define SCL_PIN 4
+#define SDA_PIN 5
+#define SCL BIT(SCL_PIN)
+#define SDA BIT(SDA_PIN)
+
+#define SLAVE_ADDR 0x42
+#define ROUNDS 3000
+
+/* Simulated time, as CCOUNT and in 160MHz cycles (which a clock change
+   doesn't affect) */
+static uint32_t now;
+static uint32_t wall;
+static uint32_t cpu_mhz = 80;
+static bool clock_changes;
+
+static sim_gpio_regs_t regs;
+static uint32_t out = SCL | SDA;    /* what the master drives, 1 = released */
+static bool last_scl = true, last_sda = true;
+
+/* Slave */
+enum { IDLE, ADDRESS, WRITING, READING, IGNORING };
+static struct {
+    uint8_t mem[256];
+    uint8_t ptr;
+    int state;
+    int bit;
+    uint8_t shift;
+    bool ack_slot;
+    bool first_byte;
+    bool sda;               /* what the slave drives, 1 = released */
+    bool scl;
+    uint32_t stretch;       /* cycles to hold SCL low after each byte */
+    uint32_t stretch_until;
+    bool stuck_sda;         /* something else holding SDA low */
+} slave = { .sda = true, .scl = true };
+
+/* Bus checks */
+static struct {
+    int starts;
+    int stops;
+    uint32_t last_scl_edge;
+    uint32_t min_high;
+    uint32_t min_low;
+    int scl_edges;
+} bus_log;
+
+uint32_t cpu_freq_get(void)
+{
+    return cpu_mhz;
+}
+
+void sim_critical(bool enter)
+{
+}
+
+/* The slave sees every line change */
+static void slave_update(bool scl, bool sda)
+{
+    if (scl && last_scl && sda != last_sda) {
+        if (!sda) {
+            bus_log.starts++;
+            slave.state = ADDRESS;
+            slave.bit = 0;
+            slave.ack_slot = false;
+        } else {
+            bus_log.stops++;
+            slave.state = IDLE;
+        }
+        slave.sda = true;
+    } else if (scl && !last_scl) {
+        /* Rising SCL, sample */
+        if ((slave.state == ADDRESS || slave.state == WRITING) && !slave.ack_slot) {
+            slave.shift = slave.shift << 1 | sda;
+            slave.bit++;
+        } else if (slave.state == READING && slave.ack_slot && sda) {
+            slave.state = IGNORING;     /* NACK, the master has finished */
+        }
+    } else if (!scl && last_scl) {
+        /* Falling SCL, drive the next bit */
+        if (slave.ack_slot) {
+            slave.ack_slot = false;
+            slave.bit = 0;
+            slave.sda = true;
+            if (slave.state == READING) {
+                slave.shift = slave.mem[slave.ptr++];
+                slave.sda = slave.shift >> 7;
+                slave.bit = 1;
+            }
+            if (slave.stretch && slave.state != IGNORING) {
+                slave.scl = false;
+                slave.stretch_until = now + slave.stretch;
+            }
+        } else if ((slave.state == ADDRESS || slave.state == WRITING) && slave.bit == 8) {
+            slave.ack_slot = true;
+            slave.sda = false;
+            if (slave.state == ADDRESS) {
+                if (slave.shift >> 1 == SLAVE_ADDR) {
+                    slave.state = (slave.shift & 1) ? READING : WRITING;
+                    slave.first_byte = true;
+                } else {
+                    slave.state = IGNORING;
+                    slave.ack_slot = false;
+                    slave.sda = true;
+                }
+            } else if (slave.first_byte) {
+                slave.ptr = slave.shift;
+                slave.first_byte = false;
+            } else {
+                slave.mem[slave.ptr++] = slave.shift;
+            }
+        } else if (slave.state == READING) {
+            if (slave.bit == 8) {
+                slave.ack_slot = true;
+                slave.sda = true;
+            } else {
+                slave.sda = (slave.shift >> (7 - slave.bit)) & 1;
+                slave.bit++;
+            }
+        }
+    }
+}
+
+/* Settle the wired-AND lines, letting the slave react to each change */
+static void update_lines(void)
+{
+    while (1) {
+        bool scl = (out & SCL) && slave.scl;
+        bool sda = (out & SDA) && slave.sda && !slave.stuck_sda;
+        if (scl == last_scl && sda == last_sda)
+            break;
+        if (scl != last_scl) {
+            uint32_t width = wall - bus_log.last_scl_edge;
+            /* The first edges of a transfer follow an idle bus */
+            if (bus_log.scl_edges++ > 2) {
+                if (last_scl && width < bus_log.min_high)
+                    bus_log.min_high = width;
+                if (!last_scl && width < bus_log.min_low)
+                    bus_log.min_low = width;
+            }
+            bus_log.last_scl_edge = wall;
+        }
+        slave_update(scl, sda);
+        last_scl = scl;
+        last_sda = sda;
+    }
+    regs.IN = (last_scl ? SCL : 0) | (last_sda ? SDA : 0);
+}
+
+static void apply_writes(void)
+{
+    out = (out | regs.OUT_SET) & ~regs.OUT_CLEAR;
+    regs.OUT_SET = 0;
+    regs.OUT_CLEAR = 0;
+    update_lines();
+}
+
+sim_gpio_regs_t *sim_gpio(void)
+{
+    apply_writes();
+    return &regs;
+}
+
+uint32_t sim_ccount(void)
+{
+    uint32_t step = 1 + rand() % 6;
+    if (rand() % 2000 == 0) {
+        step += 3000;           /* an interrupt */
+        if (clock_changes)
+            cpu_mhz = (cpu_mhz == 80) ? 160 : 80;
+    }
+    now += step;
+    wall += step * (160 / cpu_mhz);
+    if (!slave.scl && (int32_t)(now - slave.stretch_until) >= 0)
+        slave.scl = true;
+    apply_writes();
+    return now;
+}
+
+static int fail(int round, const char *what, int res)
+{
+    printf("FAIL round %d: %s (%d), %uMHz CPU\r\n", round, what, res, (unsigned)cpu_mhz);
+    return 1;
+}
+
+static void log_reset(void)
+{
+    memset(&bus_log, 0, sizeof(bus_log));
+    bus_log.min_high = bus_log.min_low = UINT32_MAX;
+    bus_log.last_scl_edge = wall;
+}
+
+static int check_round(int round)
+{
+    static const uint32_t freqs[] = { 100000, 400000, 1000000 };
+    i2c_bus_t bus;
+    uint8_t wbuf[9], rbuf[8];
+    int fails = 0;
+
+    cpu_mhz = (rand() & 1) ? 160 : 80;
+    uint32_t freq = freqs[rand() % 3];
+    if (i2c_bus_init(&bus, SCL_PIN, SDA_PIN, freq) < 0)
+        return fail(round, "i2c_bus_init", -1);
+
+    /* Stretching of up to 250us, a quarter of the default timeout, and
+       sometimes of more than the whole timeout */
+    uint32_t timeout = I2C_DEFAULT_STRETCH_US * cpu_mhz;
+    switch (rand() % 4) {
+    case 0:  slave.stretch = rand() % (timeout / 4); break;
+    case 1:  slave.stretch = timeout + 1000 + rand() % 1000; break;
+    default: slave.stretch = 0; break;
+    }
+    /* The stretch and its timeout are in cycles, so only change the clock
+       when there is none */
+    clock_changes = !slave.stretch && (rand() & 1);
+
+    size_t n = 1 + rand() % 8;
+    wbuf[0] = rand();
+    for (size_t i = 1; i <= n; i++)
+        wbuf[i] = rand();
+
+    log_reset();
+    int res = i2c_bus_transfer(&bus, SLAVE_ADDR, wbuf, n + 1, NULL, 0);
+    if (slave.stretch > timeout) {
+        if (res != -ETIMEDOUT)
+            fails += fail(round, "stretching past the timeout", res);
+        /* Let the slave go and the bus settle */
+        slave.stretch = 0;
+        sim_ccount();
+        slave.scl = true;
+        i2c_bus_stop(&bus);
+        return fails;
+    }
+    if (res < 0)
+        return fail(round, "write", res);
+    if (bus_log.starts != 1 || bus_log.stops != 1)
+        fails += fail(round, "write start/stop count", bus_log.starts * 10 + bus_log.stops);
+
+    log_reset();
+    res = i2c_bus_transfer(&bus, SLAVE_ADDR, wbuf, 1, rbuf, n);
+    if (res < 0)
+        return fail(round, "read", res);
+    if (memcmp(rbuf, wbuf + 1, n))
+        fails += fail(round, "data read back", 0);
+    if (bus_log.starts != 2 || bus_log.stops != 1)
+        fails += fail(round, "read start/stop count", bus_log.starts * 10 + bus_log.stops);
+
+    uint32_t half = (APB_CLK_FREQ / 2 + freq - 1) / freq * 2;
+    if (bus_log.min_high < half)
+        fails += fail(round, "SCL high too short", bus_log.min_high);
+    if (bus_log.min_low < half)
+        fails += fail(round, "SCL low too short", bus_log.min_low);
+
+    slave.stretch = 0;
+    clock_changes = false;
+    if (rand() % 10 == 0) {
+        res = i2c_bus_transfer(&bus, SLAVE_ADDR + 1, wbuf, 2, NULL, 0);
+        if (res != -EIO)
+            fails += fail(round, "wrong address", res);
+    }
+    return fails;
+}
+
+static int check_all(void)
+{
+    int fails = 0;
+    for (int round = 0; round < ROUNDS && !fails; round++)
+        fails += check_round(round);
+
+    /* Something holding SDA low */
+    i2c_bus_t bus;
+    i2c_bus_init(&bus, SCL_PIN, SDA_PIN, I2C_DEFAULT_FREQ);
+    slave.stuck_sda = true;
+    int res = i2c_bus_start(&bus);
+    slave.stuck_sda = false;
+    if (res != -EBUSY)
+        fails += fail(ROUNDS, "SDA held low", res);
+    return fails;
+}
+
+int main(void)
+{
+    printf("\r\nChecking I2C against a simulated slave...\r\n");
+    int fails = check_all();
+    printf("%s\r\n", fails ? "FAILED" : "PASS");
+    return fails != 0;
+}
@@ -0,0 +1,495 @@
+/* Runs the 1-Wire driver (extras/onewire) on a PC against simulated
+ * buses of devices, and checks searches and overdrive.
+ *
+ * Each simulated device decodes its bus from the line level alone, the
+ * way a real one does: resets and presence pulses, ROM commands
+ * (search, match, skip and their overdrive versions), and a read
+ * command which returns 9 bytes made from the device's ROM code. It
+ * samples written bits and drives read bits at fixed points after the
+ * start of each slot, and keeps to standard or overdrive timing.
+ *
+ * Random sets of up to 4 buses, each with up to 6 devices with random
+ * ROM codes, are run with the CPU at 80 or 160MHz, with and without
+ * random interrupts (gaps of up to 100us between CCOUNT reads whenever
+ * interrupts aren't masked). The checks are:
+ *
+ *  - onewire_search_next() finds every device on a bus exactly once
+ *  - onewire_search_next_multi() does the same on all the buses at once
+ *  - after onewire_search_prefix() the first device found is one with
+ *    that family code, when there is one
+ *  - an empty bus gives no presence pulse
+ *  - with one device on a bus, data reads back after a skip ROM and a
+ *    match ROM, at standard speed and after the overdrive versions
+ *  - no slot is held low for longer than 120us (16us at overdrive),
+ *    and at overdrive no reset is held low for longer than 80us
+ *  - there is always at least 1us of recovery between slots
+ *
+ * There is no bus to simulate on the ESP8266 itself, so this only
+ * builds on a PC (and has no Makefile, so build-examples skips it):
+ *   cc -O2 -I../host_sim/include -I../../../extras/onewire -I../../../core/include \
+ *       onewire_sim.c ../../../extras/onewire/onewire.c ../../../core/checksum.c
+ *
+ * This sample code is in the public domain.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "esp/gpio.h"
+#include "onewire.h"
+
+#define ROUNDS 100
+#define MAX_BUSES 4
+#define MAX_DEVICES 6
+
+#define CMD_SEARCH        0xf0
+#define CMD_SELECT_ROM    0x55
+#define CMD_SKIP_ROM      0xcc
+#define CMD_OD_SKIP_ROM   0x3c
+#define CMD_OD_SELECT_ROM 0x69
+#define CMD_READ          0xbe
+
+/* Simulated time, in CPU cycles */
+static uint32_t now;
+static uint32_t cpu_mhz = 80;
+static bool interrupts;
+static int critical;
+
+static sim_gpio_regs_t regs;
+static uint32_t out = 0xffff;   /* what the master drives, 1 = released */
+
+enum { IDLE, ROM_COMMAND, SEARCH, MATCH, FUNCTION, SENDING };
+
+typedef struct {
+    uint64_t rom;
+    bool overdrive;
+    bool overdrive_next;    /* switch at the next slot */
+    int state;
+    int nbits;
+    uint64_t shift;
+    int search_phase;       /* 0 bit, 1 complement, 2 master's choice */
+    int search_bit;
+    int data_bit;
+    bool holding;           /* pulling the line low between these times */
+    uint32_t hold_from;
+    uint32_t hold_until;
+    bool sample_pending;
+    uint32_t sample_at;
+} device_t;
+
+typedef struct {
+    int pin;
+    int ndevices;
+    device_t devices[MAX_DEVICES];
+    bool master_low;
+    uint32_t fell;
+    uint32_t rose;
+} bus_t;
+
+static bus_t buses[MAX_BUSES];
+static int nbuses;
+
+static int violations;
+
+uint32_t cpu_freq_get(void)
+{
+    return cpu_mhz;
+}
+
+void sim_critical(bool enter)
+{
+    critical += enter ? 1 : -1;
+}
+
+static uint32_t us(double t)
+{
+    return (uint32_t)(t * cpu_mhz);
+}
+
+static uint8_t device_data(const device_t *d, int i)
+{
+    return (d->rom >> (i * 7)) ^ i;
+}
+
+static bool device_sends(const device_t *d, bool *bit)
+{
+    if (d->state == SEARCH && d->search_phase < 2) {
+        *bit = ((d->rom >> d->search_bit) & 1) ^ (d->search_phase == 1);
+        return true;
+    }
+    if (d->state == SENDING) {
+        *bit = (device_data(d, d->data_bit / 8) >> (d->data_bit % 8)) & 1;
+        return true;
+    }
+    return false;
+}
+
+static void device_receive(device_t *d, bool bit)
+{
+    switch (d->state) {
+    case ROM_COMMAND:
+        d->shift |= (uint64_t)bit << d->nbits;
+        if (++d->nbits < 8)
+            break;
+        d->nbits = 0;
+        switch ((uint8_t)d->shift) {
+        case CMD_SEARCH:
+            d->state = SEARCH;
+            d->search_phase = 0;
+            d->search_bit = 0;
+            break;
+        case CMD_SKIP_ROM:
+            d->state = FUNCTION;
+            break;
+        case CMD_SELECT_ROM:
+            d->state = MATCH;
+            break;
+        case CMD_OD_SKIP_ROM:
+            d->overdrive_next = true;
+            d->state = FUNCTION;
+            break;
+        case CMD_OD_SELECT_ROM:
+            d->overdrive_next = true;
+            d->state = MATCH;
+            break;
+        default:
+            d->state = IDLE;
+            break;
+        }
+        d->shift = 0;
+        break;
+    case SEARCH:
+        /* Devices which don't match the master's choice drop out */
+        if (bit != ((d->rom >> d->search_bit) & 1)) {
+            d->state = IDLE;
+            break;
+        }
+        d->search_phase = 0;
+        if (++d->search_bit == 64)
+            d->state = FUNCTION;
+        break;
+    case MATCH:
+        d->shift |= (uint64_t)bit << d->nbits;
+        if (++d->nbits < 64)
+            break;
+        d->state = d->shift == d->rom ? FUNCTION : IDLE;
+        if (d->state == IDLE)
+            d->overdrive = false;
+        d->nbits = 0;
+        d->shift = 0;
+        break;
+    case FUNCTION:
+        d->shift |= (uint64_t)bit << d->nbits;
+        if (++d->nbits < 8)
+            break;
+        d->state = (uint8_t)d->shift == CMD_READ ? SENDING : IDLE;
+        d->data_bit = 0;
+        d->nbits = 0;
+        d->shift = 0;
+        break;
+    }
+}
+
+static void device_slot_start(device_t *d)
+{
+    bool bit;
+
+    if (d->overdrive_next) {
+        d->overdrive = true;
+        d->overdrive_next = false;
+    }
+    if (d->state == IDLE)
+        return;
+    if (device_sends(d, &bit)) {
+        if (!bit) {
+            d->holding = true;
+            d->hold_from = now;
+            d->hold_until = now + us(d->overdrive ? 3 : 30);
+        }
+        if (d->state == SEARCH)
+            d->search_phase++;
+        else if (++d->data_bit == 72)
+            d->state = IDLE;
+    } else {
+        d->sample_pending = true;
+        d->sample_at = now + us(d->overdrive ? 3.5 : 30);
+    }
+}
+
+static void device_line_released(device_t *d, uint32_t low)
+{
+    if (low >= us(480)) {
+        d->overdrive = false;
+        d->overdrive_next = false;
+    } else if (!d->overdrive || low < us(48)) {
+        return;     /* the end of a slot */
+    }
+    d->state = ROM_COMMAND;
+    d->nbits = 0;
+    d->shift = 0;
+    d->sample_pending = false;
+    /* Presence pulse */
+    d->holding = true;
+    d->hold_from = now + us(d->overdrive ? 3 : 30);
+    d->hold_until = d->hold_from + us(d->overdrive ? 10 : 100);
+}
+
+static bool device_low(const device_t *d)
+{
+    return d->holding && (int32_t)(now - d->hold_from) >= 0
+        && (int32_t)(now - d->hold_until) < 0;
+}
+
+static bool bus_level(const bus_t *b)
+{
+    if (!(out & BIT(b->pin)))
+        return false;
+    for (int i = 0; i < b->ndevices; i++) {
+        if (device_low(&b->devices[i]))
+            return false;
+    }
+    return true;
+}
+
+static void violation(const bus_t *b, const char *what, uint32_t cycles)
+{
+    if (violations++ < 10)
+        printf("  bus on GPIO%d: %s (%uus)\r\n", b->pin, what, (unsigned)(cycles / cpu_mhz));
+}
+
+static void update_buses(void)
+{
+    regs.IN = out;
+    for (int n = 0; n < nbuses; n++) {
+        bus_t *b = &buses[n];
+        bool master_low = !(out & BIT(b->pin));
+        if (master_low && !b->master_low) {
+            if (now - b->rose < us(1))
+                violation(b, "recovery too short", now - b->rose);
+            b->fell = now;
+            for (int i = 0; i < b->ndevices; i++)
+                device_slot_start(&b->devices[i]);
+        } else if (!master_low && b->master_low) {
+            uint32_t low = now - b->fell;
+            b->rose = now;
+            bool od = onewire_is_overdrive(b->pin);
+            if (low > us(od ? 16 : 120) && low < us(od ? 48 : 480))
+                violation(b, "slot held low too long", low);
+            if (od && low > us(80) && low < us(480))
+                violation(b, "overdrive reset too long", low);
+            for (int i = 0; i < b->ndevices; i++)
+                device_line_released(&b->devices[i], low);
+        }
+        b->master_low = master_low;
+        for (int i = 0; i < b->ndevices; i++) {
+            device_t *d = &b->devices[i];
+            if (d->sample_pending && (int32_t)(now - d->sample_at) >= 0) {
+                d->sample_pending = false;
+                device_receive(d, bus_level(b));
+            }
+        }
+        if (!bus_level(b))
+            regs.IN &= ~BIT(b->pin);
+    }
+}
+
+static void apply_writes(void)
+{
+    out = (out | regs.OUT_SET) & ~regs.OUT_CLEAR;
+    regs.OUT_SET = 0;
+    regs.OUT_CLEAR = 0;
+    update_buses();
+}
+
+sim_gpio_regs_t *sim_gpio(void)
+{
+    apply_writes();
+    return &regs;
+}
+
+uint32_t sim_ccount(void)
+{
+    /* Writes land before anything that comes after them */
+    apply_writes();
+    now += 4 + rand() % 8;
+    if (interrupts && !critical && rand() % 300 == 0)
+        now += us(1 + rand() % 100);
+    update_buses();
+    return now;
+}
+
+static uint64_t random_rom(void)
+{
+    uint64_t rom = 0;
+    for (int i = 0; i < 8; i++)
+        rom = rom << 8 | (rand() & 0xff);
+    /* Family codes are never 0, which the search takes as no device */
+    return (rom & ~0xffULL) | (1 + rand() % 255);
+}
+
+static int fail(int round, const char *what, int bus)
+{
+    printf("FAIL round %d: %s", round, what);
+    if (bus >= 0)
+        printf(", bus %d", bus);
+    printf(", %uMHz CPU, interrupts %s\r\n", (unsigned)cpu_mhz, interrupts ? "on" : "off");
+    return 1;
+}
+
+static bool on_bus(const bus_t *b, onewire_addr_t addr)
+{
+    for (int i = 0; i < b->ndevices; i++) {
+        if (b->devices[i].rom == addr)
+            return true;
+    }
+    return false;
+}
+
+static int check_search(int round)
+{
+    bus_t *b = &buses[0];
+    onewire_search_t search;
+    onewire_addr_t found[MAX_DEVICES + 1];
+    int nfound = 0;
+
+    onewire_search_start(&search);
+    for (int i = 0; i <= MAX_DEVICES; i++) {
+        onewire_addr_t addr = onewire_search_next(&search, b->pin);
+        if (addr == ONEWIRE_NONE)
+            break;
+        if (!on_bus(b, addr))
+            return fail(round, "search found a device that isn't there", 0);
+        for (int j = 0; j < nfound; j++) {
+            if (found[j] == addr)
+                return fail(round, "search found a device twice", 0);
+        }
+        found[nfound++] = addr;
+    }
+    if (nfound != b->ndevices)
+        return fail(round, "search missed a device", 0);
+
+    if (b->ndevices) {
+        uint8_t family = b->devices[rand() % b->ndevices].rom & 0xff;
+        onewire_search_start(&search);
+        onewire_search_prefix(&search, family);
+        onewire_addr_t addr = onewire_search_next(&search, b->pin);
+        if (addr == ONEWIRE_NONE || (addr & 0xff) != family)
+            return fail(round, "prefix search", 0);
+    }
+    return 0;
+}
+
+static int check_search_multi(int round)
+{
+    onewire_search_t searches[MAX_BUSES];
+    onewire_addr_t addrs[MAX_BUSES];
+    int pins[MAX_BUSES], nfound[MAX_BUSES];
+
+    for (int n = 0; n < nbuses; n++) {
+        onewire_search_start(&searches[n]);
+        pins[n] = buses[n].pin;
+        nfound[n] = 0;
+    }
+    for (int i = 0; i <= MAX_DEVICES; i++) {
+        if (!onewire_search_next_multi(searches, pins, nbuses, addrs))
+            break;
+        for (int n = 0; n < nbuses; n++) {
+            if (addrs[n] == ONEWIRE_NONE)
+                continue;
+            if (!on_bus(&buses[n], addrs[n]))
+                return fail(round, "multi search found a device that isn't there", n);
+            nfound[n]++;
+        }
+    }
+    for (int n = 0; n < nbuses; n++) {
+        if (nfound[n] != buses[n].ndevices)
+            return fail(round, "multi search found the wrong number of devices", n);
+    }
+    return 0;
+}
+
+static bool read_data(int pin, const device_t *d)
+{
+    uint8_t cmd = CMD_READ, buf[9];
+    if (!onewire_write(pin, cmd) || !onewire_read_bytes(pin, buf, sizeof(buf)))
+        return false;
+    for (int i = 0; i < 9; i++) {
+        if (buf[i] != device_data(d, i))
+            return false;
+    }
+    return true;
+}
+
+static int check_overdrive(int round)
+{
+    bus_t *b = &buses[0];
+    device_t *d = &b->devices[0];
+    int pin = b->pin;
+
+    if (!(onewire_reset(pin) && onewire_skip_rom(pin) && read_data(pin, d)))
+        return fail(round, "skip ROM read", 0);
+    if (!(onewire_reset(pin) && onewire_select(pin, d->rom) && read_data(pin, d)))
+        return fail(round, "match ROM read", 0);
+
+    if (!(onewire_reset(pin) && onewire_overdrive_skip_rom(pin)))
+        return fail(round, "overdrive skip ROM", 0);
+    for (int i = 0; i < 3; i++) {
+        if (!(onewire_reset(pin) && onewire_skip_rom(pin) && read_data(pin, d) && d->overdrive))
+            return fail(round, "overdrive skip ROM read", 0);
+    }
+
+    /* A standard speed reset takes the device out of overdrive */
+    onewire_set_overdrive(pin, false);
+    if (!(onewire_reset(pin) && !d->overdrive && onewire_select(pin, d->rom) && read_data(pin, d)))
+        return fail(round, "match ROM read after overdrive", 0);
+
+    if (!(onewire_reset(pin) && onewire_overdrive_select(pin, d->rom) && read_data(pin, d)
+          && d->overdrive))
+        return fail(round, "overdrive match ROM read", 0);
+    if (!(onewire_reset(pin) && onewire_select(pin, d->rom) && read_data(pin, d)))
+        return fail(round, "overdrive match ROM read after reset", 0);
+
+    onewire_set_overdrive(pin, false);
+    onewire_reset(pin);
+    return 0;
+}
+
+static int check_round(int round)
+{
+    int fails = 0;
+
+    cpu_mhz = (rand() & 1) ? 160 : 80;
+    interrupts = rand() & 1;
+    nbuses = 1 + rand() % MAX_BUSES;
+    for (int n = 0; n < nbuses; n++) {
+        bus_t *b = &buses[n];
+        memset(b, 0, sizeof(*b));
+        b->pin = 2 * n + 1 + (rand() & 1);
+        b->ndevices = rand() % (MAX_DEVICES + 1);
+        for (int i = 0; i < b->ndevices; i++)
+            b->devices[i].rom = random_rom();
+        b->rose = now - us(1000);   /* idle since long ago */
+        onewire_set_overdrive(b->pin, false);
+    }
+
+    fails += check_search(round);
+    fails += check_search_multi(round);
+    if (buses[0].ndevices == 0 && onewire_reset(buses[0].pin))
+        fails += fail(round, "presence pulse on an empty bus", 0);
+    if (buses[0].ndevices == 1)
+        fails += check_overdrive(round);
+    if (violations)
+        fails += fail(round, "bus timing", -1);
+    return fails;
+}
+
+int main(void)
+{
+    printf("\r\nChecking 1-Wire against simulated devices...\r\n");
+    int fails = 0;
+    for (int round = 0; round < ROUNDS && !fails; round++)
+        fails += check_round(round);
+    printf("%s\r\n", fails ? "FAILED" : "PASS");
+    return fails != 0;
+}
@@ -0,0 +1,197 @@
+/* Checks the PWM edge schedule builder (extras/pwm/pwm_schedule.c) by
+ * playing the schedules it builds and looking at the pin timelines.
+ *
+ * Random configurations of up to MAX_PWM_PINS channels, with random
+ * duty cycles (including always off and always on), phases, periods
+ * and pin masks, are built and then run for three periods from random
+ * starting levels, the way the FRC1 handler runs them. For each
+ * configuration:
+ *
+ *  - the event intervals add up to exactly one period
+ *  - no interval is shorter than the minimum gap
+ *  - no event both sets and clears a pin
+ *  - the outputs are the same in every period after the first
+ *  - every pin of a channel switches together
+ *  - each channel has at most one pulse per period, its rising edge is
+ *    within the minimum gap of the phase, and its high time is within
+ *    twice the minimum gap of the duty cycle (both edges can move)
+ *
+ * Results are printed on the serial port. The same file builds on a
+ * PC:
+ *   cc -O2 -I../../../extras/pwm pwm_schedule_test.c ../../../extras/pwm/pwm_schedule.c
+ *
+ * This sample code is in the public domain.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "pwm_schedule.h"
+
+#ifdef __XTENSA__
+#include "espressif/esp_common.h"
+#include "esp/uart.h"
+#endif
+
+#define ROUNDS 20000
+/* FRC1 runs at 5MHz with the /16 prescaler */
+#define TIMER_HZ 5000000
+
+static pwm_schedule_t sched;
+
+static uint8_t nchannels;
+static uint16_t masks[MAX_PWM_PINS];
+static uint16_t duty[MAX_PWM_PINS];
+static uint16_t phase[MAX_PWM_PINS];
+static uint32_t period, min_gap;
+
+/* Pin levels at each event of each of the three periods played */
+static uint16_t levels[3][PWM_MAX_EVENTS];
+
+static int fail(const char *what, int channel)
+{
+    printf("FAIL %s: period %u, gap %u, channel %d of %d\r\n", what,
+           (unsigned)period, (unsigned)min_gap, channel, nchannels);
+    for(int i = 0; i < nchannels; i++)
+        printf("  channel %d: mask 0x%04x duty %u phase %u\r\n", i, masks[i], duty[i], phase[i]);
+    for(int i = 0; i < sched.count; i++)
+        printf("  event %d: ticks %u set 0x%04x clear 0x%04x\r\n", i,
+               (unsigned)sched.events[i].ticks, sched.events[i].set, sched.events[i].clear);
+    return 1;
+}
+
+/* Distance between two times in a period, either way round */
+static uint32_t circular_distance(uint32_t a, uint32_t b)
+{
+    uint32_t d = a > b ? a - b : b - a;
+    return d < period - d ? d : period - d;
+}
+
+static void random_config(void)
+{
+    uint16_t freq = 1 + rand() % 2000;
+    period = TIMER_HZ / freq;
+    min_gap = (uint64_t)period * freq * PWM_MIN_EDGE_GAP_US / 1000000 + 1;
+
+    /* Each channel gets one or two GPIOs of its own */
+    uint16_t pins = 0xffff;
+    nchannels = 1 + rand() % MAX_PWM_PINS;
+    for(int i = 0; i < nchannels; i++) {
+        masks[i] = 0;
+        for(int n = 1 + (rand() & 1); n; n--) {
+            int pin;
+            do
+                pin = rand() % 16;
+            while(!(pins & (1 << pin)));
+            pins &= ~(1 << pin);
+            masks[i] |= 1 << pin;
+        }
+        switch(rand() % 8) {
+        case 0:  duty[i] = 0; break;
+        case 1:  duty[i] = UINT16_MAX; break;
+        case 2:  duty[i] = rand() % 64; break;
+        case 3:  duty[i] = UINT16_MAX - rand() % 64; break;
+        default: duty[i] = rand(); break;
+        }
+        phase[i] = (rand() % 4) ? (uint16_t)rand() : 0;
+    }
+}
+
+static int check_schedule(void)
+{
+    uint32_t total = 0;
+    for(int i = 0; i < sched.count; i++) {
+        const pwm_event_t *ev = &sched.events[i];
+        if(ev->ticks < min_gap)
+            return fail("interval shorter than the minimum gap", -1);
+        if(ev->set & ev->clear)
+            return fail("event sets and clears a pin", -1);
+        total += ev->ticks;
+    }
+    if(total != period)
+        return fail("intervals don't add up to the period", -1);
+
+    uint16_t out = rand();
+    for(int p = 0; p < 3; p++) {
+        for(int i = 0; i < sched.count; i++) {
+            out = (out | sched.events[i].set) & ~sched.events[i].clear;
+            levels[p][i] = out;
+        }
+    }
+    for(int i = 0; i < sched.count; i++) {
+        if(levels[1][i] != levels[2][i])
+            return fail("outputs differ between periods", -1);
+    }
+    return 0;
+}
+
+static int check_channel(int c)
+{
+    uint16_t mask = masks[c];
+    uint32_t ideal_on = ((uint64_t)phase[c] * period) >> 16;
+    uint32_t ideal_high = (uint64_t)duty[c] * period / UINT16_MAX;
+
+    /* Walk the steady state period, the level before the first event is
+       the one at the end of the previous period */
+    bool level = levels[1][sched.count - 1] & mask;
+    uint32_t time = 0, high = 0, rise = 0;
+    int rises = 0;
+    for(int i = 0; i < sched.count; i++) {
+        uint16_t pins = levels[2][i] & mask;
+        if(pins != 0 && pins != mask)
+            return fail("pins of a channel differ", c);
+        if(pins && !level) {
+            rises++;
+            rise = time;
+        }
+        level = pins;
+        if(level)
+            high += sched.events[i].ticks;
+        time += sched.events[i].ticks;
+    }
+
+    if(rises > 1)
+        return fail("more than one pulse per period", c);
+    if((duty[c] == 0 && high != 0) || (duty[c] == UINT16_MAX && high != period))
+        return fail("always off or on channel switched", c);
+    if((high > ideal_high ? high - ideal_high : ideal_high - high) > 2 * min_gap)
+        return fail("high time too far from the duty cycle", c);
+    if(rises && circular_distance(rise, ideal_on) > min_gap)
+        return fail("rising edge too far from the phase", c);
+    return 0;
+}
+
+static int check_all(void)
+{
+    int fails = 0;
+    for(int round = 0; round < ROUNDS && !fails; round++) {
+        random_config();
+        pwm_schedule_build(&sched, period, min_gap, nchannels, masks, duty, phase);
+        fails += check_schedule();
+        for(int c = 0; c < nchannels && !fails; c++)
+            fails += check_channel(c);
+    }
+    return fails;
+}
+
+static void run(void)
+{
+    printf("\r\nChecking PWM schedules...\r\n");
+    int fails = check_all();
+    printf("%s\r\n", fails ? "FAILED" : "PASS");
+    printf("Done.\r\n");
+}
+
+#ifdef __XTENSA__
+void user_init(void)
+{
+    uart_set_baud(0, 115200);
+    run();
+}
+#else
+int main(void)
+{
+    run();
+    return 0;
+}
+#endif
@@ -0,0 +1,247 @@
+/* Checks and benchmarks the SPI driver's register load and unload
+ * (esp/spi_buf.h), which swap a buffer into the hardware's byte order
+ * while copying it.
+ *
+ * The check runs _load_regs() and _unload_regs() on a plain array
+ * standing in for the W0-W15 data registers and compares the bytes the
+ * hardware would shift out (and back in) with a model of the wire taken
+ * straight from the byte order rules: little endian sends the buffer as
+ * it is, big endian sends each 16 or 32 bit word most significant byte
+ * first. Every word size, both byte orders, every length up to 64 bytes
+ * and every buffer alignment is covered, with guard bytes either side
+ * of the destination.
+ *
+ * The benchmark times a 64 byte register load both ways: the single
+ * pass copy and the memcpy-then-swap-in-place it replaced. On target it
+ * also times spi_transfer() of a TCP segment sized buffer on the HSPI
+ * bus at 40MHz (nothing needs to be connected) for each word size and
+ * byte order. Results are printed on the serial port.
+ *
+ * The same file builds on a PC, where times are in ns instead of CPU
+ * cycles and only the register copies are timed:
+ *   cc -O2 -I../../../core/include spi_swap_test.c
+ *
+ * This sample code is in the public domain.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "esp/spi_buf.h"
+
+#ifdef __XTENSA__
+#include "espressif/esp_common.h"
+#include "esp/uart.h"
+#include "xtensa_ops.h"
+
+#define TIME_UNIT "cycles"
+
+static inline uint32_t timestamp(void)
+{
+    uint32_t ccount;
+    RSR(ccount, ccount);
+    return ccount;
+}
+#else
+#include <time.h>
+
+#define TIME_UNIT "ns"
+
+static inline uint32_t timestamp(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+#endif
+
+#define BENCH_LEN 1460
+#define GUARD 4
+#define GUARD_BYTE 0xA5
+
+static const spi_word_size_t word_sizes[] = { SPI_8BIT, SPI_16BIT, SPI_32BIT };
+static const spi_endianness_t orders[] = { SPI_LITTLE_ENDIAN, SPI_BIG_ENDIAN };
+
+/* Model of the hardware: the bytes shifted out of the data registers,
+   in order. Little endian starts at the low byte of W0, big endian
+   reverses each 32 bit register. */
+static void regs_to_wire(const uint32_t *w, uint8_t *wire, size_t bytes, spi_endianness_t e)
+{
+    for(size_t i = 0; i < bytes; i++) {
+        unsigned shift = e == SPI_BIG_ENDIAN ? 24 - (i & 3) * 8 : (i & 3) * 8;
+        wire[i] = w[i / 4] >> shift;
+    }
+}
+
+/* The received bytes as they land in the data registers, the rest of
+   the registers keep whatever they held */
+static void wire_to_regs(const uint8_t *wire, uint32_t *w, size_t bytes, spi_endianness_t e)
+{
+    for(size_t i = 0; i < bytes; i++) {
+        unsigned shift = e == SPI_BIG_ENDIAN ? 24 - (i & 3) * 8 : (i & 3) * 8;
+        w[i / 4] = (w[i / 4] & ~(0xffu << shift)) | ((uint32_t)wire[i] << shift);
+    }
+}
+
+/* Model of the driver: the order the bytes of a buffer of words should
+   be on the wire. Byte j of each word goes out as byte 'size - 1 - j'
+   when big endian. */
+static size_t wire_index(size_t i, spi_endianness_t e, spi_word_size_t word_size)
+{
+    if(e == SPI_LITTLE_ENDIAN)
+        return i;
+    size_t size = word_size;
+    return i - i % size + (size - 1 - i % size);
+}
+
+static int fail(const char *what, spi_word_size_t word_size, spi_endianness_t e,
+                size_t bytes, size_t offs, size_t at)
+{
+    printf("FAIL %s: %d bit %s, %u bytes at offset %u, byte %u\r\n", what,
+           word_size * 8, e == SPI_BIG_ENDIAN ? "big endian" : "little endian",
+           (unsigned)bytes, (unsigned)offs, (unsigned)at);
+    return 1;
+}
+
+static int check_one(spi_word_size_t word_size, spi_endianness_t e, size_t bytes, size_t offs)
+{
+    uint32_t src_buf[_SPI_BUF_SIZE / 4 + 2];
+    uint32_t dst_buf[_SPI_BUF_SIZE / 4 + 4];
+    uint32_t regs[_SPI_BUF_SIZE / 4];
+    uint8_t wire[_SPI_BUF_SIZE];
+    uint8_t *src = (uint8_t *)src_buf + offs;
+    uint8_t *dst = (uint8_t *)dst_buf + GUARD + offs;
+
+    for(size_t i = 0; i < bytes; i++)
+        src[i] = rand();
+
+    /* Out */
+    memset(regs, 0, sizeof(regs));
+    _load_regs(regs, src, bytes, e, word_size);
+    regs_to_wire(regs, wire, bytes, e);
+    for(size_t i = 0; i < bytes; i++) {
+        if(wire[wire_index(i, e, word_size)] != src[i])
+            return fail("load", word_size, e, bytes, offs, i);
+    }
+
+    /* In: what was sent comes back in the same order */
+    for(size_t i = 0; i < sizeof(regs) / 4; i++)
+        regs[i] = rand();
+    wire_to_regs(wire, regs, bytes, e);
+    memset(dst_buf, GUARD_BYTE, sizeof(dst_buf));
+    _unload_regs(regs, dst, bytes, e, word_size);
+    for(size_t i = 0; i < bytes; i++) {
+        if(dst[i] != src[i])
+            return fail("unload", word_size, e, bytes, offs, i);
+    }
+    for(uint8_t *p = (uint8_t *)dst_buf; p < (uint8_t *)(dst_buf + sizeof(dst_buf) / 4); p++) {
+        if((p < dst || p >= dst + bytes) && *p != GUARD_BYTE)
+            return fail("unload overrun", word_size, e, bytes, offs, p - dst);
+    }
+    return 0;
+}
+
+static int check_all(void)
+{
+    int fails = 0;
+    for(int s = 0; s < 3; s++) {
+        spi_word_size_t word_size = word_sizes[s];
+        for(int o = 0; o < 2; o++) {
+            /* Transfers are whole words */
+            for(size_t bytes = word_size; bytes <= _SPI_BUF_SIZE; bytes += word_size) {
+                for(size_t offs = 0; offs < 4; offs++)
+                    fails += check_one(word_size, orders[o], bytes, offs);
+            }
+        }
+    }
+    return fails;
+}
+
+/* What _load_regs() replaced: copy, then swap the registers in place */
+static void old_load_regs(volatile uint32_t *w, const void *src, uint8_t bytes,
+    spi_endianness_t e, spi_word_size_t word_size)
+{
+    memcpy((void *)w, src, bytes);
+    if (e == SPI_LITTLE_ENDIAN || word_size == SPI_32BIT) return;
+    size_t len = bytes / word_size;
+    size_t count = word_size == SPI_16BIT ? (len + 1) / 2 : (len + 3) / 4;
+    for (size_t i = 0; i < count; i ++)
+        w[i] = word_size == SPI_16BIT ? _swap_words(w[i]) : _swap_bytes(w[i]);
+}
+
+static uint32_t buf[BENCH_LEN / 4 + 1];
+
+#ifdef __XTENSA__
+#define BENCH_REGS (&SPI(1).W0)
+#else
+static volatile uint32_t bench_regs[_SPI_BUF_SIZE / 4];
+#define BENCH_REGS bench_regs
+#endif
+
+#define BENCH(name, expr) do {                                          \
+        uint32_t start = timestamp();                                   \
+        expr;                                                           \
+        uint32_t time = timestamp() - start;                            \
+        printf("%-28s %7u " TIME_UNIT "\r\n", name, (unsigned)time);   \
+    } while(0)
+
+static void benchmark(void)
+{
+    for(size_t i = 0; i < sizeof(buf) / 4; i++)
+        buf[i] = rand();
+
+#ifdef __XTENSA__
+    spi_init(1, SPI_MODE0, SPI_FREQ_DIV_40M, true, SPI_LITTLE_ENDIAN, true);
+#endif
+    printf("\r\nTimes for 64 byte register loads, %d byte transfers:\r\n", BENCH_LEN);
+    /* Run everything once first, so nothing is timed with a cold
+       flash cache */
+    for(int pass = 0; pass < 2; pass++) {
+        if(pass)
+            printf("\r\n");
+        for(int s = 0; s < 3; s++) {
+            for(int o = 0; o < 2; o++) {
+                spi_word_size_t word_size = word_sizes[s];
+                spi_endianness_t e = orders[o];
+                printf("%d bit %s\r\n", word_size * 8, e == SPI_BIG_ENDIAN ? "big endian" : "little endian");
+                BENCH("  load", _load_regs(BENCH_REGS, buf, _SPI_BUF_SIZE, e, word_size));
+                BENCH("  unaligned load", _load_regs(BENCH_REGS, (uint8_t *)buf + 1, _SPI_BUF_SIZE, e, word_size));
+                BENCH("  memcpy and swap", old_load_regs(BENCH_REGS, buf, _SPI_BUF_SIZE, e, word_size));
+#ifdef __XTENSA__
+                spi_set_endianness(1, e);
+                BENCH("  spi_transfer", spi_transfer(1, buf, buf, BENCH_LEN / word_size, word_size));
+                BENCH("  spi_transfer, send only", spi_transfer(1, buf, NULL, BENCH_LEN / word_size, word_size));
+#endif
+            }
+        }
+    }
+#ifdef __XTENSA__
+    spi_set_endianness(1, SPI_LITTLE_ENDIAN);
+    printf("On the wire at 40MHz: %u cycles\r\n",
+           (unsigned)((uint64_t)BENCH_LEN * 8 * sdk_system_get_cpu_freq() / 40));
+#endif
+}
+
+static void run(void)
+{
+    printf("\r\nChecking SPI register loads...\r\n");
+    int fails = check_all();
+    printf("%s\r\n", fails ? "FAILED" : "PASS");
+    benchmark();
+    printf("Done.\r\n");
+}
+
+#ifdef __XTENSA__
+void user_init(void)
+{
+    uart_set_baud(0, 115200);
+    run();
+}
+#else
+int main(void)
+{
+    run();
+    return 0;
+}
+#endif
@@ -0,0 +1,180 @@
+/* Checks the WS2812 I2S encoder (extras/ws2812_i2s/ws2812_i2s_encode.c)
+ * against a per-bit model of the signal on the wire.
+ *
+ * ws2812_i2s runs the I2S at 16 bits per channel, so the DMA hands it
+ * each 32 bit word as two halfwords: the one at the higher address
+ * (bits 31-16) goes out first, then the one at the lower address, each
+ * MSB first. The check reads the encoded buffer back that way, as
+ * halfwords in memory, and compares it bit for bit with a model taken
+ * from the WS2812 datasheet: pixels in order, G then R then B, MSB
+ * first, each bit a 1110 or 1000 symbol.
+ *
+ *  - every byte value encodes to its four symbols per nibble
+ *  - random strips of 0 to 64 pixels encode to the modelled bits, and
+ *    nothing is written past the end
+ *  - the first bit sent is the MSB of the first pixel's green byte
+ *  - every symbol's high time at WS2812_I2S_BIT_FREQ is inside the
+ *    datasheet's T0H (250-550ns) and T1H (650-950ns) limits
+ *
+ * Results are printed on the serial port. The same file builds on a
+ * PC:
+ *   cc -O2 -I../../../extras/ws2812_i2s ws2812_encode_test.c ../../../extras/ws2812_i2s/ws2812_i2s_encode.c
+ *
+ * This sample code is in the public domain.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ws2812_i2s_encode.h"
+
+#ifdef __XTENSA__
+#include "espressif/esp_common.h"
+#include "esp/uart.h"
+#endif
+
+#define ROUNDS 2000
+#define MAX_PIXELS 64
+#define MAX_WORDS (MAX_PIXELS * WS2812_I2S_WORDS_PER_PIXEL)
+#define MAX_BITS (MAX_WORDS * 32)
+#define GUARD 0xa5a5a5a5
+
+static uint32_t rgbs[MAX_PIXELS];
+static uint32_t words[MAX_WORDS + 1];
+static uint8_t wire[MAX_BITS], model[MAX_BITS];
+
+/* The bits the I2S sends for 'count' words, in the order it sends them */
+static size_t wire_bits(const uint32_t *src, size_t count, uint8_t *bits)
+{
+    const uint8_t *mem = (const uint8_t *)src;
+    size_t n = 0;
+    for(size_t i = 0; i < count; i++) {
+        for(int offset = 2; offset >= 0; offset -= 2) {
+            uint16_t half;
+            memcpy(&half, mem + i * 4 + offset, 2);
+            for(int b = 15; b >= 0; b--)
+                bits[n++] = (half >> b) & 1;
+        }
+    }
+    return n;
+}
+
+/* The bits WS2812 pixels expect */
+static size_t model_bits(const uint32_t *pixels, size_t count, uint8_t *bits)
+{
+    static const int shifts[3] = { 8, 16, 0 };  /* G, R, B */
+    size_t n = 0;
+    for(size_t i = 0; i < count; i++) {
+        for(int c = 0; c < 3; c++) {
+            uint8_t byte = pixels[i] >> shifts[c];
+            for(int b = 7; b >= 0; b--) {
+                bool one = (byte >> b) & 1;
+                bits[n++] = 1;
+                bits[n++] = one;
+                bits[n++] = one;
+                bits[n++] = 0;
+            }
+        }
+    }
+    return n;
+}
+
+static int fail(int round, const char *what, int n)
+{
+    printf("FAIL round %d: %s (%d)\r\n", round, what, n);
+    return 1;
+}
+
+static int check_bytes(void)
+{
+    int fails = 0;
+    for(int v = 0; v < 256; v++) {
+        uint32_t word = ws2812_i2s_encode_byte(v);
+        uint32_t pixel = (uint32_t)v << 8;      /* green is sent first */
+        wire_bits(&word, 1, wire);
+        model_bits(&pixel, 1, model);
+        if(memcmp(wire, model, 32))
+            fails += fail(-1, "byte", v);
+    }
+    return fails;
+}
+
+static int check_round(int round)
+{
+    int fails = 0;
+    size_t count = rand() % (MAX_PIXELS + 1);
+    for(size_t i = 0; i < count; i++)
+        rgbs[i] = ((uint32_t)rand() << 16 ^ rand()) & 0xffffff;
+    if(count && rand() % 4 == 0)
+        rgbs[0] = 0x000080;                     /* green MSB only */
+
+    size_t n = count * WS2812_I2S_WORDS_PER_PIXEL;
+    words[n] = GUARD;
+    ws2812_i2s_encode(words, rgbs, count);
+    if(words[n] != GUARD)
+        fails += fail(round, "wrote past the end", count);
+
+    size_t bits = wire_bits(words, n, wire);
+    if(model_bits(rgbs, count, model) != bits)
+        return fails + fail(round, "length", bits);
+    for(size_t i = 0; i < bits; i++) {
+        if(wire[i] != model[i])
+            return fails + fail(round, "bit", i);
+    }
+    if(count && wire[1] != ((rgbs[0] >> 15) & 1))
+        fails += fail(round, "first bit is not green's MSB", wire[1]);
+    return fails;
+}
+
+/* High time of each symbol against the datasheet */
+static int check_timing(void)
+{
+    int fails = 0;
+    uint32_t word = ws2812_i2s_encode_byte(0x0f);
+    wire_bits(&word, 1, wire);
+    for(int i = 0; i < 32; i += 4) {
+        int high = 0;
+        while(high < 4 && wire[i + high])
+            high++;
+        for(int j = high; j < 4; j++) {
+            if(wire[i + j])
+                fails += fail(-1, "symbol goes high twice", i);
+        }
+        uint32_t ns = (uint64_t)high * 1000000000 / WS2812_I2S_BIT_FREQ;
+        bool one = i >= 16;
+        if(one ? (ns < 650 || ns > 950) : (ns < 250 || ns > 550))
+            fails += fail(-1, one ? "T1H" : "T0H", ns);
+    }
+    return fails;
+}
+
+static int check_all(void)
+{
+    int fails = check_bytes() + check_timing();
+    for(int round = 0; round < ROUNDS && !fails; round++)
+        fails += check_round(round);
+    return fails;
+}
+
+static void run(void)
+{
+    printf("\r\nChecking WS2812 I2S encoding...\r\n");
+    int fails = check_all();
+    printf("%s\r\n", fails ? "FAILED" : "PASS");
+    printf("Done.\r\n");
+}
+
+#ifdef __XTENSA__
+void user_init(void)
+{
+    uart_set_baud(0, 115200);
+    run();
+}
+#else
+int main(void)
+{
+    run();
+    return 0;
+}
+#endif
@@ -0,0 +1,60 @@
+/* Rainbow animation on a WS2812 strip driven by DMA.
+ *
+ * Connect the strip's data input to GPIO3 (the UART0 RX pin, so the
+ * serial console is output only). Frames are shown at 30 fps; the CPU
+ * only encodes each frame, everything else is done by the DMA.
+ *
+ * This sample code is in the public domain.
+ */
+#include "espressif/esp_common.h"
+#include "esp/uart.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "ws2812_i2s.h"
+
+#include <stdio.h>
+
+#define PIXELS 600
+#define FRAME_MS 33
+
+static uint32_t pixels[PIXELS];
+
+/* Colour wheel: 0..255 goes red -> green -> blue -> red */
+static uint32_t wheel(uint8_t pos)
+{
+    uint8_t third = pos % 85 * 3;
+    switch (pos / 85) {
+    case 0:
+        return ((255 - third) << 16) | (third << 8);
+    case 1:
+        return ((255 - third) << 8) | third;
+    default:
+        return (third << 16) | (255 - third);
+    }
+}
+
+static void rainbow_task(void *pvParameters)
+{
+    uint8_t offset = 0;
+    portTickType last = xTaskGetTickCount();
+
+    while (1) {
+        for (int i = 0; i < PIXELS; i++)
+            pixels[i] = wheel(offset + i * 256 / PIXELS);
+        ws2812_i2s_show(pixels, portMAX_DELAY);
+        offset++;
+        vTaskDelayUntil(&last, FRAME_MS / portTICK_RATE_MS);
+    }
+}
+
+void user_init(void)
+{
+    uart_set_baud(0, 115200);
+
+    int res = ws2812_i2s_init(PIXELS);
+    if (res < 0) {
+        printf("ws2812_i2s_init failed: %d\n", res);
+        return;
+    }
+    xTaskCreate(rainbow_task, (signed char *)"rainbow", 256, NULL, 2, NULL);
+}
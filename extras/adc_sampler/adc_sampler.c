@@ -0,0 +1,191 @@
+/* adc_sampler.c
+ *
+ * Continuous, timer paced ADC sampling.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <errno.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+#include <espressif/esp_system.h>
+#include <esp/systime.h>
+#include <common_macros.h>
+#include <hrtimer.h>
+#include "adc_sampler.h"
+
+#define RING_MASK (ADC_SAMPLER_RING_SIZE - 1)
+
+#if ADC_SAMPLER_RING_SIZE & RING_MASK
+#error ADC_SAMPLER_RING_SIZE must be a power of 2
+#endif
+
+/* Ring entries keep the low word of the timestamp, the high word is
+   filled in when the sample is read */
+typedef struct {
+    uint32_t time_us;
+    uint16_t value;
+} entry_t;
+
+static struct {
+    bool running;
+    uint8_t oversample;
+    uint16_t batch;
+    hrtimer_t timer;
+    xSemaphoreHandle due;       /* given by the timer, taken by the sampler task */
+    volatile uint32_t due_us;   /* low word of the time it was given */
+    xSemaphoreHandle sem;
+    volatile uint32_t head;     /* written by the sampler task */
+    volatile uint32_t tail;     /* written by the reader */
+    uint32_t samples;
+    uint32_t overflows;
+    uint32_t missed;
+    entry_t ring[ADC_SAMPLER_RING_SIZE];
+} sampler;
+
+/* Runs in the timer interrupt. If the sampler task hasn't started on
+   the last period yet, this one is skipped. */
+static void IRAM sample_due(void *arg)
+{
+    portBASE_TYPE woken = pdFALSE;
+    if(xSemaphoreGiveFromISR(sampler.due, &woken) != pdTRUE) {
+        sampler.missed++;
+        return;
+    }
+    sampler.due_us = (uint32_t)systime_us();
+    if(woken)
+        portYIELD();
+}
+
+static void take_sample(uint32_t time_us)
+{
+    uint32_t sum = 0;
+    for(int i = 0; i < sampler.oversample; i++)
+        sum += sdk_system_adc_read();
+
+    sampler.samples++;
+    uint32_t head = sampler.head;
+    uint32_t used = head - sampler.tail;
+    if(used == ADC_SAMPLER_RING_SIZE) {
+        sampler.overflows++;
+        return;
+    }
+    entry_t *entry = &sampler.ring[head & RING_MASK];
+    entry->time_us = time_us;
+    entry->value = (sum << ADC_SAMPLER_SHIFT) / sampler.oversample;
+    sampler.head = head + 1;
+    /* The reader only waits while fewer than a batch are waiting */
+    if(used + 1 == sampler.batch)
+        xSemaphoreGive(sampler.sem);
+}
+
+static void sampler_task(void *pvParameters)
+{
+    while(1) {
+        xSemaphoreTake(sampler.due, portMAX_DELAY);
+        if(sampler.running)
+            take_sample(sampler.due_us);
+    }
+}
+
+int adc_sampler_start(const adc_sampler_config_t *config)
+{
+    if(config->rate_hz == 0 || config->oversample == 0
+       || config->oversample > ADC_SAMPLER_MAX_OVERSAMPLE
+       || config->rate_hz > ADC_SAMPLER_MAX_READS_PER_SEC / config->oversample
+       || config->batch > ADC_SAMPLER_RING_SIZE)
+        return -EINVAL;
+    if(sampler.running)
+        return -EBUSY;
+
+    if(!sampler.sem) {
+        vSemaphoreCreateBinary(sampler.sem);
+        if(!sampler.sem)
+            return -ENOMEM;
+    }
+    if(!sampler.due) {
+        vSemaphoreCreateBinary(sampler.due);
+        if(!sampler.due)
+            return -ENOMEM;
+        xSemaphoreTake(sampler.due, 0);
+        if(xTaskCreate(sampler_task, (signed char *)"adc", ADC_SAMPLER_TASK_STACK_SIZE,
+                       NULL, ADC_SAMPLER_TASK_PRIORITY, NULL) != pdPASS) {
+            vSemaphoreDelete(sampler.due);
+            sampler.due = NULL;
+            return -ENOMEM;
+        }
+    }
+    xSemaphoreTake(sampler.sem, 0);
+    xSemaphoreTake(sampler.due, 0);
+    sampler.oversample = config->oversample;
+    sampler.batch = config->batch ? config->batch : 1;
+    sampler.tail = sampler.head;
+    sampler.samples = 0;
+    sampler.overflows = 0;
+    sampler.missed = 0;
+
+    /* Schedule in hrtimer counts so rates which don't divide 1MHz keep
+       their average spacing */
+    uint32_t period = HRTIMER_US_TO_TICKS(1000000) / config->rate_hz;
+    hrtimer_init(&sampler.timer, sample_due, NULL, HRTIMER_ISR);
+    int r = hrtimer_start_at(&sampler.timer, hrtimer_get_ticks() + period, period);
+    if(r < 0)
+        return r;
+    sampler.running = true;
+    return 0;
+}
+
+void adc_sampler_stop(void)
+{
+    if(!sampler.running)
+        return;
+    hrtimer_stop(&sampler.timer);
+    sampler.running = false;
+    /* Let a waiting reader have what's left */
+    xSemaphoreGive(sampler.sem);
+}
+
+size_t adc_sampler_available(void)
+{
+    return sampler.head - sampler.tail;
+}
+
+size_t adc_sampler_read(adc_sample_t *samples, size_t max, portTickType timeout)
+{
+    if(max == 0 || !sampler.sem)
+        return 0;
+
+    xTimeOutType time_out;
+    vTaskSetTimeOutState(&time_out);
+    while(sampler.running && sampler.head - sampler.tail < sampler.batch) {
+        if(xTaskCheckForTimeOut(&time_out, &timeout) != pdFALSE
+           || xSemaphoreTake(sampler.sem, timeout) != pdTRUE)
+            break;
+    }
+
+    uint32_t tail = sampler.tail;
+    uint32_t count = sampler.head - tail;
+    if(count > max)
+        count = max;
+    /* Sample times are in the past, and less than a 32 bit wrap
+       (71 minutes) old unless the ring has been left that long */
+    uint64_t now_us = systime_us();
+    for(uint32_t i = 0; i < count; i++) {
+        const entry_t *entry = &sampler.ring[tail++ & RING_MASK];
+        samples[i].time_us = now_us - (uint32_t)((uint32_t)now_us - entry->time_us);
+        samples[i].value = entry->value;
+    }
+    sampler.tail = tail;
+    return count;
+}
+
+void adc_sampler_get_stats(adc_sampler_stats_t *stats)
+{
+    taskENTER_CRITICAL();
+    stats->samples = sampler.samples;
+    stats->overflows = sampler.overflows;
+    stats->missed = sampler.missed + sampler.timer.overruns;
+    taskEXIT_CRITICAL();
+}
@@ -0,0 +1,115 @@
+/* adc_sampler.h
+ *
+ * Continuous, timer paced sampling of the ADC (TOUT pin) into a ring.
+ *
+ * An hrtimer interrupt fires at the sample rate and wakes the sampler
+ * task, which takes a burst of 'oversample' sdk_system_adc_read()
+ * readings and averages them (a boxcar decimation filter), so no task
+ * has to sit in a polling loop and the sample spacing doesn't depend
+ * on the priority of the code that uses the samples. Each sample is
+ * timestamped with systime_us() in the interrupt and pushed into a
+ * ring, which is read in batches with adc_sampler_read().
+ *
+ * Sample values are the averaged reading scaled to 16 bits: 64 times
+ * the 10-bit ADC count, so averaging several noisy readings keeps the
+ * extra resolution instead of rounding it away. Full scale is 1.0V,
+ * and as with sdk_system_adc_read(), RF must be enabled.
+ *
+ * sdk_system_adc_read() blocks until its conversion is done, so tasks
+ * below ADC_SAMPLER_TASK_PRIORITY wait for each burst. The default is
+ * just below the hrtimer task, which keeps the spacing tight; lower it
+ * if other work matters more than the samples. A burst is limited to
+ * ADC_SAMPLER_MAX_OVERSAMPLE readings, and rate_hz * oversample to
+ * ADC_SAMPLER_MAX_READS_PER_SEC so lower priority tasks still get some
+ * time. If the task hasn't started on one period when the next comes,
+ * that period is counted as missed.
+ *
+ * There's only one ADC, so there's only one sampler.
+ *
+ * Uses extras/hrtimer.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _ADC_SAMPLER_H
+#define _ADC_SAMPLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <FreeRTOS.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/* Number of samples in the ring, must be a power of 2 */
+#ifndef ADC_SAMPLER_RING_SIZE
+#define ADC_SAMPLER_RING_SIZE 256
+#endif
+
+/* Limit on readings per second, rate_hz * oversample */
+#ifndef ADC_SAMPLER_MAX_READS_PER_SEC
+#define ADC_SAMPLER_MAX_READS_PER_SEC 20000
+#endif
+
+/* Priority & stack size of the task which takes the readings */
+#ifndef ADC_SAMPLER_TASK_PRIORITY
+#define ADC_SAMPLER_TASK_PRIORITY (configMAX_PRIORITIES - 2)
+#endif
+#ifndef ADC_SAMPLER_TASK_STACK_SIZE
+#define ADC_SAMPLER_TASK_STACK_SIZE 256
+#endif
+
+#define ADC_SAMPLER_MAX_OVERSAMPLE 16
+
+/* Sample values are ADC counts shifted up by this many bits */
+#define ADC_SAMPLER_SHIFT 6
+
+typedef struct {
+    uint32_t rate_hz;       /* Samples per second, at least 1, see ADC_SAMPLER_MAX_READS_PER_SEC */
+    uint8_t oversample;     /* Readings averaged per sample, 1 to ADC_SAMPLER_MAX_OVERSAMPLE */
+    uint16_t batch;         /* adc_sampler_read() waits for this many samples (0 means 1) */
+} adc_sampler_config_t;
+
+typedef struct {
+    uint64_t time_us;       /* systime_us() time the timer fired */
+    uint16_t value;         /* Average ADC count << ADC_SAMPLER_SHIFT */
+} adc_sample_t;
+
+typedef struct {
+    uint32_t samples;       /* Samples taken */
+    uint32_t overflows;     /* Samples dropped because the ring was full */
+    uint32_t missed;        /* Timer periods skipped while a burst overran */
+} adc_sampler_stats_t;
+
+/* Start sampling. Must be called from task context.
+
+   Returns 0, -EINVAL for a bad rate or oversample count (including
+   more than ADC_SAMPLER_MAX_READS_PER_SEC readings a second), or -EBUSY
+   if the sampler is already running.
+*/
+int adc_sampler_start(const adc_sampler_config_t *config);
+
+/* Stop sampling. Samples left in the ring can still be read. */
+void adc_sampler_stop(void);
+
+/* Number of samples waiting in the ring */
+size_t adc_sampler_available(void);
+
+/* Read up to 'max' samples, oldest first. If fewer than the batch
+   size given to adc_sampler_start() are waiting, waits up to 'timeout'
+   for them first. Returns the number read, which is less than the
+   batch size only on timeout or if the sampler was stopped. Only one
+   task may read at a time. */
+size_t adc_sampler_read(adc_sample_t *samples, size_t max, portTickType timeout);
+
+/* Counters since adc_sampler_start() */
+void adc_sampler_get_stats(adc_sampler_stats_t *stats);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,10 @@
+# Component makefile for extras/adc_sampler
+#
+# Needs extras/hrtimer as well
+
+INC_DIRS += $(adc_sampler_ROOT)
+
+# args for passing into compile rule generation
+adc_sampler_SRC_DIR =  $(adc_sampler_ROOT)
+
+$(eval $(call component_compile_rules,adc_sampler))
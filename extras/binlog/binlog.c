@@ -0,0 +1,203 @@
+/* Deferred-format logging.
+ *
+ * See binlog.h for usage.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <string.h>
+#include <stdio.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <common_macros.h>
+#include <esp/interrupts.h>
+#include <esp/wdev_regs.h>
+#include <esp/uart.h>
+#include "binlog.h"
+
+#if (BINLOG_RING_WORDS & (BINLOG_RING_WORDS - 1)) != 0
+#error "BINLOG_RING_WORDS must be a power of 2"
+#endif
+
+#define RING_MASK (BINLOG_RING_WORDS - 1)
+
+/* Words before the arguments: format pointer, timestamp, meta */
+#define RECORD_HEADER_WORDS 3
+
+#define META_NARGS(meta) ((meta) & 0x0f)
+#define META_LEVEL(meta) (((meta) >> 4) & 0x07)
+#define META_MODULE(meta) (((meta) >> 8) & 0xff)
+
+/* Binary mode framing, decoded by utils/binlog_decode.py:
+ *
+ *   BINLOG_SYNC, type, payload length, payload..., checksum
+ *
+ * where checksum is the low 8 bits of the sum of type, length and
+ * payload bytes. Multi-byte values are little endian.
+ */
+#define BINLOG_SYNC 0xa5
+#define FRAME_RECORD  0x01 /* raw record words */
+#define FRAME_MODULE  0x02 /* module index, then name */
+#define FRAME_DROPPED 0x03 /* 32-bit total of dropped records */
+
+static uint32_t ring[BINLOG_RING_WORDS];
+
+/* Total words written/consumed, index into the ring is (x & RING_MASK).
+   Only the binlog task advances ring_tail. */
+static volatile uint32_t ring_head;
+static volatile uint32_t ring_tail;
+static volatile uint32_t dropped;
+
+binlog_module_t binlog_module_default = { "default", BINLOG_DEFAULT_LEVEL, 0, NULL };
+
+static binlog_module_t *modules[BINLOG_MAX_MODULES] = { &binlog_module_default };
+static uint8_t num_modules = 1;
+
+static binlog_mode_t output_mode;
+
+/* The hot path. Reserving space and copying the record in happens
+   inside one short rsil window so records can be written from any
+   task or ISR without locks. Like portDISABLE_INTERRUPTS, don't touch
+   the interrupt level when called from the NMI.
+*/
+void IRAM binlog_record(const char *fmt, uint32_t meta, const uint32_t *args)
+{
+    uint32_t nargs = META_NARGS(meta);
+    uint32_t timestamp = WDEV.SYS_TIME;
+    uint32_t ps = 0;
+    if(!sdk_NMIIrqIsOn)
+        ps = _xt_disable_interrupts();
+
+    uint32_t head = ring_head;
+    if(BINLOG_RING_WORDS - (head - ring_tail) < RECORD_HEADER_WORDS + nargs) {
+        dropped++;
+    } else {
+        ring[head++ & RING_MASK] = (uint32_t)fmt;
+        ring[head++ & RING_MASK] = timestamp;
+        ring[head++ & RING_MASK] = meta;
+        for(uint32_t i = 0; i < nargs; i++)
+            ring[head++ & RING_MASK] = args[i];
+        ring_head = head;
+    }
+
+    if(!sdk_NMIIrqIsOn)
+        _xt_restore_interrupts(ps);
+}
+
+/* Called from constructors (BINLOG_MODULE_DEFINE), before the
+   scheduler starts */
+void binlog_register_module(binlog_module_t *module)
+{
+    if(num_modules == BINLOG_MAX_MODULES) {
+        printf("binlog: too many modules, %s logs as default\n", module->name);
+        return;
+    }
+    module->index = num_modules;
+    modules[num_modules++] = module;
+}
+
+bool binlog_set_level(const char *module, int level)
+{
+    bool found = false;
+    for(int i = 0; i < num_modules; i++) {
+        if(!module || !strcmp(module, modules[i]->name)) {
+            modules[i]->level = level;
+            found = true;
+        }
+    }
+    return found;
+}
+
+uint32_t binlog_dropped(void)
+{
+    return dropped;
+}
+
+void __attribute__((weak)) binlog_output(const uint8_t *data, uint32_t len)
+{
+    for(uint32_t i = 0; i < len; i++)
+        uart_putc(0, data[i]);
+}
+
+static void send_frame(uint8_t type, const void *payload, uint8_t len)
+{
+    uint8_t header[3] = { BINLOG_SYNC, type, len };
+    uint8_t sum = type + len;
+    for(int i = 0; i < len; i++)
+        sum += ((const uint8_t *)payload)[i];
+    binlog_output(header, sizeof(header));
+    binlog_output(payload, len);
+    binlog_output(&sum, 1);
+}
+
+static void send_modules(void)
+{
+    uint8_t buf[33];
+    for(int i = 0; i < num_modules; i++) {
+        size_t len = strnlen(modules[i]->name, sizeof(buf) - 1);
+        buf[0] = i;
+        memcpy(buf + 1, modules[i]->name, len);
+        send_frame(FRAME_MODULE, buf, len + 1);
+    }
+}
+
+static void print_record(const uint32_t *rec)
+{
+    static const char level_chars[] = "-EWIDV??";
+    uint32_t meta = rec[2];
+    const uint32_t *a = rec + RECORD_HEADER_WORDS;
+    uint8_t module = META_MODULE(meta);
+
+    printf("%6u.%06u %c %s: ", rec[1] / 1000000, rec[1] % 1000000,
+           level_chars[META_LEVEL(meta)],
+           module < num_modules ? modules[module]->name : "?");
+    /* Arguments beyond those in the format are ignored by printf */
+    printf((const char *)rec[0], a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+    printf("\n");
+}
+
+static void binlog_task(void *pvParameters)
+{
+    uint32_t rec[RECORD_HEADER_WORDS + BINLOG_MAX_ARGS];
+    uint32_t dropped_reported = 0;
+
+    if(output_mode == BINLOG_MODE_BINARY)
+        send_modules();
+
+    while(1) {
+        uint32_t tail = ring_tail;
+        if(tail == ring_head) {
+            uint32_t d = dropped;
+            if(d != dropped_reported) {
+                if(output_mode == BINLOG_MODE_BINARY)
+                    send_frame(FRAME_DROPPED, &d, sizeof(d));
+                else
+                    printf("binlog: %u records dropped\n", d - dropped_reported);
+                dropped_reported = d;
+            }
+            vTaskDelay(BINLOG_POLL_TICKS);
+            continue;
+        }
+
+        /* Copy the record out so the slot can be released before the
+           (slow) output */
+        uint32_t nwords = RECORD_HEADER_WORDS + META_NARGS(ring[(tail + 2) & RING_MASK]);
+        memset(rec, 0, sizeof(rec));
+        for(uint32_t i = 0; i < nwords; i++)
+            rec[i] = ring[(tail + i) & RING_MASK];
+        ring_tail = tail + nwords;
+
+        if(output_mode == BINLOG_MODE_BINARY)
+            send_frame(FRAME_RECORD, rec, nwords * sizeof(uint32_t));
+        else
+            print_record(rec);
+    }
+}
+
+void binlog_init(binlog_mode_t mode)
+{
+    output_mode = mode;
+    xTaskCreate(binlog_task, (signed char *)"binlog", BINLOG_TASK_STACK_SIZE,
+                NULL, BINLOG_TASK_PRIORITY, NULL);
+}
@@ -0,0 +1,181 @@
+/* binlog.h
+ *
+ * Deferred-format logging.
+ *
+ * A log call only stores the format string pointer, a microsecond
+ * timestamp and the raw 32-bit arguments into a RAM ring (a few dozen
+ * instructions, with interrupts masked only while the record is
+ * copied in.) A low priority "binlog" task drains the ring later,
+ * either formatting the records with printf (BINLOG_MODE_TEXT) or
+ * sending them out unformatted (BINLOG_MODE_BINARY) to be decoded on
+ * the host against the program ELF with utils/binlog_decode.py.
+ *
+ * Usage:
+ *
+ *   BINLOG_MODULE_DEFINE(wifi);   // once per module, in one source file
+ *
+ *   #define BINLOG_MODULE wifi    // in each file logging for it, before
+ *   #include <binlog.h>           // including binlog.h
+ *
+ *   BINLOG_INFO("connected, channel %d rssi %d", ch, rssi);
+ *
+ * Files without BINLOG_MODULE log to the "default" module.
+ *
+ * Because formatting happens later, arguments must be integers or
+ * pointers (at most BINLOG_MAX_ARGS of them.) A %s argument must
+ * point to a string which is still valid when the record is printed,
+ * normally a string literal or other constant. Floating point and
+ * 64-bit arguments are not supported.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _BINLOG_H
+#define _BINLOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define BINLOG_LEVEL_NONE    0
+#define BINLOG_LEVEL_ERROR   1
+#define BINLOG_LEVEL_WARN    2
+#define BINLOG_LEVEL_INFO    3
+#define BINLOG_LEVEL_DEBUG   4
+#define BINLOG_LEVEL_VERBOSE 5
+
+/* Log calls above this level are compiled out. Can be set globally in
+   the program Makefile (EXTRA_CFLAGS) or per file before including
+   binlog.h */
+#ifndef BINLOG_LEVEL
+#define BINLOG_LEVEL BINLOG_LEVEL_INFO
+#endif
+
+/* Initial runtime level of each module, see binlog_set_level() */
+#ifndef BINLOG_DEFAULT_LEVEL
+#define BINLOG_DEFAULT_LEVEL BINLOG_LEVEL_INFO
+#endif
+
+/* Ring size in 32-bit words, must be a power of 2. A record takes 3
+   words plus one per argument. */
+#ifndef BINLOG_RING_WORDS
+#define BINLOG_RING_WORDS 1024
+#endif
+
+#define BINLOG_MAX_ARGS 8
+
+/* Modules beyond this number log as "default" */
+#ifndef BINLOG_MAX_MODULES
+#define BINLOG_MAX_MODULES 32
+#endif
+
+#ifndef BINLOG_TASK_PRIORITY
+#define BINLOG_TASK_PRIORITY (tskIDLE_PRIORITY + 1)
+#endif
+#ifndef BINLOG_TASK_STACK_SIZE
+#define BINLOG_TASK_STACK_SIZE 512
+#endif
+/* How often the binlog task checks the ring, in ticks */
+#ifndef BINLOG_POLL_TICKS
+#define BINLOG_POLL_TICKS 2
+#endif
+
+typedef enum {
+    BINLOG_MODE_TEXT,   /* format on the device and print to stdout */
+    BINLOG_MODE_BINARY, /* send raw records via binlog_output() */
+} binlog_mode_t;
+
+typedef struct binlog_module {
+    const char *name;
+    uint8_t level;      /* runtime filter, records above this level are discarded */
+    uint8_t index;      /* assigned at startup, identifies the module in records */
+    struct binlog_module *next;
+} binlog_module_t;
+
+/* Start the binlog task. Records are collected from startup, before
+   this is called. */
+void binlog_init(binlog_mode_t mode);
+
+/* Set the runtime level for a module by name, or for all modules if
+   module is NULL. Returns false if no module matched. */
+bool binlog_set_level(const char *module, int level);
+
+/* Number of records discarded because the ring was full */
+uint32_t binlog_dropped(void);
+
+/* Output function for BINLOG_MODE_BINARY. The default writes the bytes
+   to UART0 with uart_putc(), a program can provide its own. */
+void binlog_output(const uint8_t *data, uint32_t len);
+
+/* Internals used by the macros below */
+
+void binlog_record(const char *fmt, uint32_t meta, const uint32_t *args);
+void binlog_register_module(binlog_module_t *module);
+
+extern binlog_module_t binlog_module_default;
+
+#define _BINLOG_CAT(a, b) _BINLOG_CAT_(a, b)
+#define _BINLOG_CAT_(a, b) a##b
+
+#ifdef BINLOG_MODULE
+#define _BINLOG_MOD _BINLOG_CAT(binlog_module_, BINLOG_MODULE)
+extern binlog_module_t _BINLOG_MOD;
+#else
+#define _BINLOG_MOD binlog_module_default
+#endif
+
+#define BINLOG_MODULE_DEFINE(name)                                      \
+    binlog_module_t binlog_module_##name = { #name, BINLOG_DEFAULT_LEVEL, 0, 0 }; \
+    static void __attribute__((constructor)) binlog_register_##name(void) \
+    {                                                                   \
+        binlog_register_module(&binlog_module_##name);                  \
+    }                                                                   \
+    extern binlog_module_t binlog_module_##name
+
+/* Argument counting & casting, for up to BINLOG_MAX_ARGS arguments */
+#define _BINLOG_NARGS(...) _BINLOG_NARGS_(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define _BINLOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, N, ...) N
+
+#define _BINLOG_ARG(x) (uint32_t)(x)
+#define _BINLOG_ARGS0() 0
+#define _BINLOG_ARGS1(a) _BINLOG_ARG(a)
+#define _BINLOG_ARGS2(a, ...) _BINLOG_ARG(a), _BINLOG_ARGS1(__VA_ARGS__)
+#define _BINLOG_ARGS3(a, ...) _BINLOG_ARG(a), _BINLOG_ARGS2(__VA_ARGS__)
+#define _BINLOG_ARGS4(a, ...) _BINLOG_ARG(a), _BINLOG_ARGS3(__VA_ARGS__)
+#define _BINLOG_ARGS5(a, ...) _BINLOG_ARG(a), _BINLOG_ARGS4(__VA_ARGS__)
+#define _BINLOG_ARGS6(a, ...) _BINLOG_ARG(a), _BINLOG_ARGS5(__VA_ARGS__)
+#define _BINLOG_ARGS7(a, ...) _BINLOG_ARG(a), _BINLOG_ARGS6(__VA_ARGS__)
+#define _BINLOG_ARGS8(a, ...) _BINLOG_ARG(a), _BINLOG_ARGS7(__VA_ARGS__)
+
+/* Record word 2: argument count, level and module index */
+#define _BINLOG_META(lvl, nargs) ((nargs) | ((lvl) << 4) | (_BINLOG_MOD.index << 8))
+
+/* Format strings go in their own flash section, the host decoder looks
+   them up there by address */
+#define BINLOG(lvl, fmt, ...) do {                                    \
+        if((lvl) <= BINLOG_LEVEL && (lvl) <= _BINLOG_MOD.level) {       \
+            static const char _binlog_fmt[]                             \
+                __attribute__((section(".irom0.binlog"), aligned(4))) = fmt; \
+            binlog_record(_binlog_fmt,                                  \
+                          _BINLOG_META(lvl, _BINLOG_NARGS(__VA_ARGS__)), \
+                          (const uint32_t[]) {                          \
+                              _BINLOG_CAT(_BINLOG_ARGS, _BINLOG_NARGS(__VA_ARGS__))(__VA_ARGS__) \
+                          });                                           \
+        }                                                               \
+    } while(0)
+
+#define BINLOG_ERROR(fmt, ...)   BINLOG(BINLOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#define BINLOG_WARN(fmt, ...)    BINLOG(BINLOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define BINLOG_INFO(fmt, ...)    BINLOG(BINLOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define BINLOG_DEBUG(fmt, ...)   BINLOG(BINLOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#define BINLOG_VERBOSE(fmt, ...) BINLOG(BINLOG_LEVEL_VERBOSE, fmt, ##__VA_ARGS__)
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
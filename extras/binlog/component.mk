@@ -0,0 +1,10 @@
+# Component makefile for extras/binlog
+#
+# Binary mode output is decoded on the host with utils/binlog_decode.py
+
+INC_DIRS += $(binlog_ROOT)
+
+# args for passing into compile rule generation
+binlog_SRC_DIR =  $(binlog_ROOT)
+
+$(eval $(call component_compile_rules,binlog))
@@ -31,11 +31,12 @@
 
 #include "FreeRTOS.h"
 #include "task.h"
+#include "esp/systime.h"
 
 namespace esp_open_rtos {
 namespace timer {
 
-#define __millis()  (xTaskGetTickCount() * portTICK_RATE_MS)
+#define __millis()  systime_ms()
 
 /******************************************************************************************************************
  * countdown_t
@@ -93,7 +94,7 @@ public:
     }
     
 private:
-    portTickType interval_end_ms;
+    uint32_t interval_end_ms;
 };
 
 } // namespace timer {
@@ -31,6 +31,7 @@
 
 #include "FreeRTOS.h"
 #include "task.h"
+#include "esp/systime.h"
 
 namespace esp_open_rtos {
 namespace thread {
@@ -74,7 +75,7 @@ protected:
      */
     inline unsigned long millis()
     {
-        return xTaskGetTickCount() * portTICK_RATE_MS;
+        return systime_ms();
     }
     
 private:
@@ -1,4 +1,6 @@
 # Component makefile for extras/dht
+#
+# Needs extras/hrtimer as well
 
 INC_DIRS += $(ROOT)extras/dht
 
@@ -9,13 +9,12 @@
 #include "FreeRTOS.h"
 #include "string.h"
 #include "task.h"
+#include "semphr.h"
 #include "esp/gpio.h"
+#include "esp/clocks.h"
+#include "xtensa_ops.h"
 
-#include <espressif/esp_misc.h> // sdk_os_delay_us
-
-// DHT timer precision in microseconds
-#define DHT_TIMER_INTERVAL   2
-#define DHT_DATA_BITS  40
+#include <errno.h>
 
 // #define DEBUG_DHT
 
@@ -53,76 +52,36 @@
  *
 */
 
+// Phase A, held longer than the 18ms DHT11 minimum
+#define DHT_START_US            20000
+// From the end of phase A to the last edge is about 5.5ms. The capture
+// always runs for this long, rather than finishing early at the last
+// edge, so the timer only ever expires once per stage.
+#define DHT_CAPTURE_US          7000
 
-/**
- * Wait specified time for pin to go to a specified state.
- * If timeout is reached and pin doesn't go to a requested state
- * false is returned.
- * The elapsed time is returned in pointer 'duration' if it is not NULL.
- */
-static bool dht_await_pin_state(uint8_t pin, uint32_t timeout,
-        bool expected_pin_state, uint32_t *duration)
-{
-    for (uint32_t i = 0; i < timeout; i += DHT_TIMER_INTERVAL) {
-        // need to wait at least a single interval to prevent reading a jitter
-        sdk_os_delay_us(DHT_TIMER_INTERVAL);
-        if (gpio_read(pin) == expected_pin_state) {
-            if (duration) {
-                *duration = i;
-            }
-            return true;
-        }
-    }
-
-    return false;
-}
-
-/**
- * Request data from DHT and read raw bit stream.
- * The function call should be protected from task switching.
- * Return false if error occurred.
- */
-static inline bool dht_fetch_data(uint8_t pin, bool bits[DHT_DATA_BITS])
-{
-    uint32_t low_duration;
-    uint32_t high_duration;
-
-    // Phase 'A' pulling signal low to initiate read sequence
-    gpio_write(pin, 0);
-    sdk_os_delay_us(20000);
-    gpio_write(pin, 1);
+// How long dht_read_data() waits for a read, which normally takes 27ms,
+// before giving up on the hrtimer task
+#define DHT_READ_TIMEOUT_MS     200
 
-    // Step through Phase 'B', 40us
-    if (!dht_await_pin_state(pin, 40, false, NULL)) {
-        debug("Initialization error, problem in phase 'B'\n");
-        return false;
-    }
+enum {
+    DHT_IDLE,
+    DHT_START,      // phase A
+    DHT_CAPTURE,    // waiting for the reply edges
+};
 
-    // Step through Phase 'C', 88us
-    if (!dht_await_pin_state(pin, 88, true, NULL)) {
-        debug("Initialization error, problem in phase 'C'\n");
-        return false;
-    }
+static dht_sensor_t *dht_sensors[16];
 
-    // Step through Phase 'D', 88us
-    if (!dht_await_pin_state(pin, 88, false, NULL)) {
-        debug("Initialization error, problem in phase 'D'\n");
-        return false;
-    }
+static void IRAM dht_edge(uint8_t gpio_num)
+{
+    uint32_t now;
+    RSR(now, ccount);
+    dht_sensor_t *sensor = dht_sensors[gpio_num];
 
-    // Read in each of the 40 bits of data...
-    for (int i = 0; i < DHT_DATA_BITS; i++) {
-        if (!dht_await_pin_state(pin, 65, true, &low_duration)) {
-            debug("LOW bit timeout\n");
-            return false;
-        }
-        if (!dht_await_pin_state(pin, 75, false, &high_duration)){
-            debug("HIGHT bit timeout\n");
-            return false;
-        }
-        bits[i] = high_duration > low_duration;
+    if (!sensor || sensor->stage != DHT_CAPTURE
+        || sensor->edge_count >= DHT_CAPTURE_EDGES) {
+        return;
     }
-    return true;
+    sensor->edges[sensor->edge_count++] = now;
 }
 
 /**
@@ -148,38 +107,155 @@ static inline int16_t dht_convert_data(uint8_t msb, uint8_t lsb)
     return data;
 }
 
-bool dht_read_data(uint8_t pin, int16_t *humidity, int16_t *temperature)
+static void dht_stop(dht_sensor_t *sensor)
 {
-    bool bits[DHT_DATA_BITS];
-    uint8_t data[DHT_DATA_BITS/8] = {0};
-    bool result;
-
-    gpio_enable(pin, GPIO_OUT_OPEN_DRAIN);
-
     taskENTER_CRITICAL();
-    result = dht_fetch_data(pin, bits);
+    gpio_set_interrupt(sensor->pin, GPIO_INTTYPE_NONE);
+    gpio_set_pin_handler(sensor->pin, NULL);
+    sensor->stage = DHT_IDLE;
+    dht_sensors[sensor->pin] = NULL;
     taskEXIT_CRITICAL();
+}
 
-    if (!result) {
-        return false;
+static void dht_finish(dht_sensor_t *sensor)
+{
+    uint8_t data[DHT_DATA_BYTES];
+    int16_t humidity = 0, temperature = 0;
+
+    dht_stop(sensor);
+
+    int result = dht_decode(sensor->edges, sensor->edge_count, sensor->cycles_per_us, data);
+    switch (result) {
+    case 0:
+        sensor->stats.ok++;
+        humidity = dht_convert_data(data[0], data[1]);
+        temperature = dht_convert_data(data[2], data[3]);
+        debug("Sensor data: humidity=%d, temp=%d\n", humidity, temperature);
+        break;
+    case -ETIMEDOUT:
+        sensor->stats.no_response++;
+        break;
+    case -EBADMSG:
+        sensor->stats.checksum++;
+        break;
+    default:
+        sensor->stats.framing++;
+        break;
     }
 
-    for (uint8_t i = 0; i < DHT_DATA_BITS; i++) {
-        // Read each bit into 'result' byte array...
-        data[i/8] <<= 1;
-        data[i/8] |= bits[i];
+    if (sensor->callback) {
+        sensor->callback(result, humidity, temperature, sensor->arg);
     }
+}
 
-    if (data[4] != ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) {
-        debug("Checksum failed, invalid data received from sensor\n");
-        return false;
+static void dht_timer(void *arg)
+{
+    dht_sensor_t *sensor = arg;
+
+    switch (sensor->stage) {
+    case DHT_START:
+        // Release the line and catch the whole reply
+        taskENTER_CRITICAL();
+        sensor->edge_count = 0;
+        sensor->stage = DHT_CAPTURE;
+        dht_sensors[sensor->pin] = sensor;
+        gpio_set_pin_handler(sensor->pin, dht_edge);
+        GPIO.STATUS_CLEAR = BIT(sensor->pin);
+        gpio_set_interrupt(sensor->pin, GPIO_INTTYPE_EDGE_NEG);
+        gpio_write(sensor->pin, 1);
+        taskEXIT_CRITICAL();
+        if (hrtimer_start(&sensor->timer, DHT_CAPTURE_US, 0) < 0) {
+            // No timer to end the capture, so there's no read either
+            dht_stop(sensor);
+            if (sensor->callback) {
+                sensor->callback(-ENOSPC, 0, 0, sensor->arg);
+            }
+        }
+        break;
+    case DHT_CAPTURE:
+        dht_finish(sensor);
+        break;
+    default:
+        break;
     }
+}
 
-    *humidity = dht_convert_data(data[0], data[1]);
-    *temperature = dht_convert_data(data[2], data[3]);
+void dht_sensor_init(dht_sensor_t *sensor, uint8_t pin)
+{
+    memset(sensor, 0, sizeof(*sensor));
+    sensor->pin = pin;
+    hrtimer_init(&sensor->timer, dht_timer, sensor, HRTIMER_TASK);
+}
 
-    debug("Sensor data: humidity=%d, temp=%d\n", *humidity, *temperature);
+int dht_read_async(dht_sensor_t *sensor, dht_callback_t callback, void *arg)
+{
+    if (sensor->stage != DHT_IDLE) {
+        return -EBUSY;
+    }
+    sensor->callback = callback;
+    sensor->arg = arg;
+    sensor->cycles_per_us = cpu_freq_get();
+    sensor->stage = DHT_START;
 
+    // Phase 'A' pulling signal low to initiate read sequence
+    gpio_enable(sensor->pin, GPIO_OUT_OPEN_DRAIN);
+    gpio_write(sensor->pin, 0);
+    int res = hrtimer_start(&sensor->timer, DHT_START_US, 0);
+    if (res < 0) {
+        gpio_write(sensor->pin, 1);
+        sensor->stage = DHT_IDLE;
+        return res;
+    }
+    sensor->stats.reads++;
+    return 0;
+}
+
+typedef struct {
+    xSemaphoreHandle done;
+    int result;
+    int16_t humidity;
+    int16_t temperature;
+} dht_wait_t;
+
+static void dht_read_done(int result, int16_t humidity, int16_t temperature, void *arg)
+{
+    dht_wait_t *wait = arg;
+    wait->result = result;
+    wait->humidity = humidity;
+    wait->temperature = temperature;
+    xSemaphoreGive(wait->done);
+}
+
+bool dht_read_data(uint8_t pin, int16_t *humidity, int16_t *temperature)
+{
+    dht_sensor_t sensor;
+    dht_wait_t wait;
+
+    vSemaphoreCreateBinary(wait.done);
+    if (!wait.done) {
+        return false;
+    }
+    xSemaphoreTake(wait.done, 0);
+
+    dht_sensor_init(&sensor, pin);
+    wait.result = dht_read_async(&sensor, dht_read_done, &wait);
+    if (wait.result == 0
+        && xSemaphoreTake(wait.done, DHT_READ_TIMEOUT_MS / portTICK_RATE_MS) != pdTRUE) {
+        // The hrtimer task never got to it (it runs above this task, so
+        // it isn't part way through the read now). The sensor is on the
+        // stack, so nothing may be left referring to it.
+        hrtimer_stop(&sensor.timer);
+        dht_stop(&sensor);
+        gpio_write(pin, 1);
+        wait.result = -ETIMEDOUT;
+    }
+    vSemaphoreDelete(wait.done);
+
+    if (wait.result < 0) {
+        return false;
+    }
+    *humidity = wait.humidity;
+    *temperature = wait.temperature;
     return true;
 }
 
@@ -10,6 +10,9 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <hrtimer.h>
+#include "dht_decode.h"
 
 #define DHT11       11
 #define DHT22       22
@@ -17,9 +20,70 @@
 // Type of sensor to use
 #define DHT_TYPE    DHT22
 
+/**
+ * Counts of read outcomes for one sensor.
+ */
+typedef struct {
+    uint32_t reads;         // reads started
+    uint32_t ok;
+    uint32_t no_response;   // no edges at all (-ETIMEDOUT)
+    uint32_t framing;       // edges missing or mistimed (-EIO)
+    uint32_t checksum;      // decoded but the checksum was wrong (-EBADMSG)
+} dht_stats_t;
+
+/**
+ * Called when an asynchronous read finishes, from the hrtimer task. 'result'
+ * is 0, or a negative error code as described for dht_stats_t (or -ENOSPC,
+ * not counted there, if no hrtimer was free to time the reply), in which
+ * case humidity and temperature are 0. May start another read.
+ */
+typedef void (*dht_callback_t)(int result, int16_t humidity, int16_t temperature, void *arg);
+
+/**
+ * One sensor, allocated by the caller. Only stats is public.
+ */
+typedef struct {
+    uint8_t pin;
+    dht_stats_t stats;
+
+    dht_callback_t callback;
+    void *arg;
+    hrtimer_t timer;
+    volatile uint8_t stage;
+    volatile uint8_t edge_count;
+    uint8_t cycles_per_us;
+    uint32_t edges[DHT_CAPTURE_EDGES];   // CCOUNT of each falling edge
+} dht_sensor_t;
+
+/**
+ * Set up a sensor on the given pin. Call from task context.
+ */
+void dht_sensor_init(dht_sensor_t *sensor, uint8_t pin);
+
+/**
+ * Start a read and return straight away. The reply is captured by a GPIO
+ * interrupt which timestamps each falling edge, and decoded afterwards in
+ * the hrtimer task, so no CPU time is spent waiting and other interrupts
+ * only matter if they delay an edge by more than 10-20us (depending on the
+ * sensor's timing). The checksum catches most of the resulting errors.
+ *
+ * Takes about 27ms. Sensors need about 2s (DHT22) or 1s (DHT11) between
+ * reads. The sensor structure must stay valid until the callback. Only one
+ * sensor structure can be in use on a pin at a time.
+ *
+ * Returns 0, -EBUSY if a read of this sensor is in progress, or -ENOSPC if
+ * no hrtimer is free (see hrtimer_start()).
+ */
+int dht_read_async(dht_sensor_t *sensor, dht_callback_t callback, void *arg);
+
 /**
  * Read data from sensor on specified pin.
  *
+ * Uses dht_read_async(), blocking the calling task (but not the CPU) until
+ * the read finishes. Fails if it hasn't finished within 200ms, which only
+ * happens if the hrtimer task is kept from running. Call from a task of
+ * lower priority than the hrtimer task.
+ *
  * Humidity and temperature is returned as integers.
  * For example: humidity=625 is 62.5 %
  *              temperature=24.4 is 24.4 degrees Celsius
@@ -0,0 +1,68 @@
+/*
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Jonathan Hartsuiker (https://github.com/jsuiker)
+ * BSD Licensed as described in the file LICENSE
+ *
+ */
+
+#include "dht_decode.h"
+#include <string.h>
+#include <errno.h>
+
+#define DHT_DATA_BITS  40
+
+// #define DEBUG_DHT
+
+#ifdef DEBUG_DHT
+#include <stdio.h>
+#define debug(fmt, ...) printf("%s" fmt "\n", "dht: ", ## __VA_ARGS__);
+#else
+#define debug(fmt, ...) /* (do nothing) */
+#endif
+
+// Falling edge to falling edge. Phases C and D are 80us each, a data bit
+// is 50us low then 26-28us high for '0' or 70us high for '1'. The limits
+// leave room for an edge to be timestamped up to 30us late.
+#define DHT_RESPONSE_MIN_US     120
+#define DHT_RESPONSE_MAX_US     220
+#define DHT_BIT_MIN_US          40
+#define DHT_BIT_MAX_US          170
+#define DHT_BIT_THRESHOLD_US    98
+
+int dht_decode(const uint32_t *edges, size_t count, uint32_t cycles_per_us,
+               uint8_t data[DHT_DATA_BYTES])
+{
+    uint32_t us;
+
+    if (count == 0) {
+        debug("No response\n");
+        return -ETIMEDOUT;
+    }
+    if (count < DHT_CAPTURE_EDGES) {
+        debug("Only %d edges\n", count);
+        return -EIO;
+    }
+
+    us = (edges[1] - edges[0]) / cycles_per_us;
+    if (us < DHT_RESPONSE_MIN_US || us > DHT_RESPONSE_MAX_US) {
+        debug("Initialization error, response took %dus\n", us);
+        return -EIO;
+    }
+
+    memset(data, 0, DHT_DATA_BYTES);
+    for (int i = 0; i < DHT_DATA_BITS; i++) {
+        us = (edges[i + 2] - edges[i + 1]) / cycles_per_us;
+        if (us < DHT_BIT_MIN_US || us > DHT_BIT_MAX_US) {
+            debug("Bit %d took %dus\n", i, us);
+            return -EIO;
+        }
+        data[i/8] <<= 1;
+        data[i/8] |= us > DHT_BIT_THRESHOLD_US;
+    }
+
+    if (data[4] != ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) {
+        debug("Checksum failed, invalid data received from sensor\n");
+        return -EBADMSG;
+    }
+    return 0;
+}
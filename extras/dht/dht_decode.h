@@ -0,0 +1,36 @@
+/*
+ * Decoding of DHT11/DHT22 replies from falling edge times
+ *
+ * Kept apart from the driver with no hardware dependencies, so captures
+ * can be decoded and checked on a PC (see examples/tests/dht_decode_test).
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Jonathan Hartsuiker (https://github.com/jsuiker)
+ * BSD Licensed as described in the file LICENSE
+ *
+ */
+
+#ifndef __DHT_DECODE_H__
+#define __DHT_DECODE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Falling edges in a complete reply: the response, 40 data bits and the end
+#define DHT_CAPTURE_EDGES   42
+
+// Bytes of data in a reply, the last is the checksum
+#define DHT_DATA_BYTES      5
+
+/**
+ * Decode captured falling edge times (CCOUNT values) into the data bytes.
+ * Used by the asynchronous reader (dht.h).
+ *
+ * Returns 0, -ETIMEDOUT if there are no edges, -EIO if there are too few
+ * or their timing is outside the specification, or -EBADMSG if the checksum
+ * doesn't match.
+ */
+int dht_decode(const uint32_t *edges, size_t count, uint32_t cycles_per_us,
+               uint8_t data[DHT_DATA_BYTES]);
+
+#endif  // __DHT_DECODE_H__
@@ -220,4 +220,40 @@ bool ds18b20_read_temp_multi(int pin, ds18b20_addr_t *addr_list, int addr_count,
     return result;
 }
 
+static bool ds18b20_address(int pin, ds18b20_addr_t addr) {
+    if (!onewire_reset(pin)) {
+        return false;
+    }
+    if (addr == DS18B20_ANY) {
+        return onewire_skip_rom(pin);
+    }
+    return onewire_select(pin, addr);
+}
+
+bool ds18b20_set_resolution(int pin, ds18b20_addr_t addr, int bits) {
+    uint8_t scratchpad[8];
+
+    if (bits < 9 || bits > 12) {
+        return false;
+    }
+    // Writing the scratchpad sets the alarm registers too, so keep them
+    if (!ds18b20_read_scratchpad(pin, addr, scratchpad)) {
+        return false;
+    }
+    uint8_t cmd[4] = { DS18B20_WRITE_SCRATCHPAD, scratchpad[2], scratchpad[3],
+                       ((bits - 9) << 5) | 0x1f };
+    if (!ds18b20_address(pin, addr)) {
+        return false;
+    }
+    return onewire_write_bytes(pin, cmd, sizeof(cmd));
+}
 
+bool ds18b20_parasite_powered(int pin, ds18b20_addr_t addr) {
+    if (!ds18b20_address(pin, addr)) {
+        return false;
+    }
+    onewire_write(pin, DS18B20_READ_PWRSUPPLY);
+    // Parasitically powered devices pull the first read slot low
+    int r = onewire_read(pin);
+    return r >= 0 && !(r & 1);
+}
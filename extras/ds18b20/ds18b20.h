@@ -132,6 +132,44 @@ bool ds18b20_measure_and_read_multi(int pin, ds18b20_addr_t *addr_list, int addr
  */
 bool ds18b20_read_scratchpad(int pin, ds18b20_addr_t addr, uint8_t *buffer);
 
+/** Set the resolution of a sensor's measurements.
+ *
+ *  Lower resolutions convert faster (see ds18b20_conversion_ms()).  The
+ *  setting is not copied to the sensor's EEPROM, so it reverts to the stored
+ *  value (12 bits unless changed) when the sensor loses power.
+ *
+ *  @param pin     The GPIO pin connected to the DS18B20 device
+ *  @param addr    The 64-bit address of the device.  This can be set to
+ *                 ::DS18B20_ANY if there is exactly one device on the bus
+ *                 (the alarm registers are read back first, to keep them).
+ *  @param bits    The resolution, 9 (0.5 deg C) to 12 (0.0625 deg C) bits.
+ *
+ *  @returns `true` if the resolution was set, or `false` on error.
+ */
+bool ds18b20_set_resolution(int pin, ds18b20_addr_t addr, int bits);
+
+/** Maximum time in milliseconds a conversion at the given resolution takes
+ *  (94ms at 9 bits up to 750ms at 12 bits).
+ */
+static inline uint32_t ds18b20_conversion_ms(int bits) {
+    int shift = 12 - bits;
+    return (750 + (1 << shift) - 1) >> shift;
+}
+
+/** Check whether any of the addressed devices are parasitically powered.
+ *
+ *  Parasitically powered devices need the bus held high for the whole of a
+ *  conversion, so nothing else can be done on that bus meanwhile.
+ *
+ *  @param pin     The GPIO pin connected to the DS18B20 bus
+ *  @param addr    The 64-bit address of the device, or ::DS18B20_ANY to
+ *                 check all devices on the bus.
+ *
+ *  @returns `true` if a parasitically powered device answered, `false` if
+ *  none did or there was no device.
+ */
+bool ds18b20_parasite_powered(int pin, ds18b20_addr_t addr);
+
 // The following are obsolete/deprecated APIs
 
 typedef struct {
@@ -0,0 +1,154 @@
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+#include "math.h"
+
+#include "ds18b20_sched.h"
+
+#define ms_to_ticks(ms) (((ms) + portTICK_RATE_MS - 1) / portTICK_RATE_MS)
+
+// Resolution a sensor's reading waits for. On a parasitically powered bus
+// that's the slowest sensor on the bus, as the bus is held high until then.
+static int ready_resolution(const ds18b20_sched_t *sched, const ds18b20_sensor_t *sensor) {
+    if (sched->parasite & BIT(sensor->pin)) {
+        return sched->bus_resolution[sensor->pin];
+    }
+    return sensor->resolution;
+}
+
+static void read_sensor(ds18b20_sched_t *sched, const ds18b20_sensor_t *sensor, bool bus_ok) {
+    ds18b20_reading_t reading = {
+        .pin = sensor->pin,
+        .addr = sensor->addr,
+        .resolution = sensor->resolution,
+        .temperature = NAN,
+    };
+    uint8_t scratchpad[8];
+
+    if (bus_ok && ds18b20_read_scratchpad(sensor->pin, sensor->addr, scratchpad)) {
+        int16_t raw = scratchpad[1] << 8 | scratchpad[0];
+        // Bits below the resolution are undefined
+        reading.resolution = 9 + ((scratchpad[4] >> 5) & 3);
+        raw &= ~((1 << (12 - reading.resolution)) - 1);
+        reading.temperature = raw / 16.0f;
+    }
+    reading.timestamp = xTaskGetTickCount();
+
+    if (sched->callback) {
+        sched->callback(&reading, sched->arg);
+    }
+    if (sched->queue) {
+        xQueueSend(sched->queue, &reading, 0);
+    }
+}
+
+static void run_round(ds18b20_sched_t *sched) {
+    uint32_t buses = 0, failed = 0;
+
+    for (size_t i = 0; i < sched->count; i++) {
+        buses |= BIT(sched->sensors[i].pin);
+    }
+
+    // Buses are only busy for a millisecond or so each, so start them one
+    // after the other and time every conversion from the first.
+    portTickType start = xTaskGetTickCount();
+    for (int pin = 0; pin < 16; pin++) {
+        if (!(buses & BIT(pin))) {
+            continue;
+        }
+        if (!ds18b20_measure(pin, DS18B20_ANY, false)) {
+            failed |= BIT(pin);
+        } else if (!(sched->parasite & BIT(pin))) {
+            onewire_depower(pin);
+        }
+    }
+
+    for (int bits = 9; bits <= 12; bits++) {
+        bool waited = false;
+        for (size_t i = 0; i < sched->count; i++) {
+            const ds18b20_sensor_t *sensor = &sched->sensors[i];
+            if (ready_resolution(sched, sensor) != bits) {
+                continue;
+            }
+            if (!waited) {
+                portTickType wait = ms_to_ticks(ds18b20_conversion_ms(bits));
+                portTickType elapsed = xTaskGetTickCount() - start;
+                if (elapsed < wait) {
+                    vTaskDelay(wait - elapsed);
+                }
+                for (int pin = 0; pin < 16; pin++) {
+                    if ((sched->parasite & BIT(pin)) && sched->bus_resolution[pin] == bits) {
+                        onewire_depower(pin);
+                    }
+                }
+                waited = true;
+            }
+            read_sensor(sched, sensor, !(failed & BIT(sensor->pin)));
+        }
+    }
+}
+
+static void ds18b20_sched_task(void *pvParameters) {
+    ds18b20_sched_t *sched = pvParameters;
+    portTickType period = ms_to_ticks(sched->period_ms);
+
+    sched->parasite = 0;
+    for (size_t i = 0; i < sched->count; i++) {
+        const ds18b20_sensor_t *sensor = &sched->sensors[i];
+        int pin = sensor->pin;
+        ds18b20_set_resolution(pin, sensor->addr, sensor->resolution);
+        if (sensor->resolution > sched->bus_resolution[pin]) {
+            sched->bus_resolution[pin] = sensor->resolution;
+        }
+        if (ds18b20_parasite_powered(pin, sensor->addr)) {
+            sched->parasite |= BIT(pin);
+        }
+    }
+
+    portTickType next = xTaskGetTickCount();
+    while (1) {
+        if (period) {
+            // A triggered round doesn't move the periodic ones
+            portTickType now = xTaskGetTickCount();
+            if ((int32_t)(next - now) <= 0 || xSemaphoreTake(sched->trigger, next - now) != pdTRUE) {
+                now = xTaskGetTickCount();
+                next += period;
+                if ((int32_t)(next - now) <= 0) {
+                    next = now + period;   // fell behind, don't try to catch up
+                }
+            }
+        } else {
+            xSemaphoreTake(sched->trigger, portMAX_DELAY);
+        }
+        run_round(sched);
+    }
+}
+
+bool ds18b20_sched_start(ds18b20_sched_t *sched) {
+    for (size_t i = 0; i < sched->count; i++) {
+        const ds18b20_sensor_t *sensor = &sched->sensors[i];
+        if (sensor->pin < 0 || sensor->pin > 15 ||
+            sensor->resolution < 9 || sensor->resolution > 12) {
+            return false;
+        }
+    }
+    for (int pin = 0; pin < 16; pin++) {
+        sched->bus_resolution[pin] = 0;
+    }
+    vSemaphoreCreateBinary(sched->trigger);
+    if (!sched->trigger) {
+        return false;
+    }
+    xSemaphoreTake(sched->trigger, 0);
+    if (xTaskCreate(ds18b20_sched_task, (signed char *)"ds18b20", DS18B20_SCHED_STACK_SIZE,
+                    sched, sched->priority, NULL) != pdPASS) {
+        vSemaphoreDelete(sched->trigger);
+        return false;
+    }
+    return true;
+}
+
+void ds18b20_sched_trigger(ds18b20_sched_t *sched) {
+    xSemaphoreGive(sched->trigger);
+}
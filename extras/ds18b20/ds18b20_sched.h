@@ -0,0 +1,88 @@
+#ifndef DRIVER_DS18B20_SCHED_H_
+#define DRIVER_DS18B20_SCHED_H_
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+#include "ds18b20/ds18b20.h"
+
+/** @file ds18b20_sched.h
+ *
+ *  Background measurement of any number of DS18B20 sensors on one or more
+ *  buses.
+ *
+ *  A scheduler task starts a conversion on every bus at once (one broadcast
+ *  CONVERT_T per bus), sleeps until the fastest sensors are done, reads their
+ *  scratchpads, sleeps until the next group is done, and so on. Each reading
+ *  is timestamped and passed to a callback and/or a queue, so the tasks using
+ *  the temperatures never wait for a conversion.
+ *
+ *  Each sensor has its own resolution: a 9 bit sensor is read 94ms into a
+ *  round while 12 bit sensors on the same bus are still converting. This
+ *  relies on the sensors having a power supply. A bus with any parasitically
+ *  powered sensor has to be held high until its slowest sensor is done, so
+ *  all its sensors are read together at that point.
+ *
+ *  While the scheduler is running it owns the buses it uses, so don't use
+ *  them from anywhere else.
+ */
+
+/** Stack size for the scheduler task, in words */
+#ifndef DS18B20_SCHED_STACK_SIZE
+#define DS18B20_SCHED_STACK_SIZE 256
+#endif
+
+/** One sensor for the scheduler */
+typedef struct {
+    int pin;                /**< GPIO0-15 connected to the sensor's bus */
+    ds18b20_addr_t addr;    /**< Address, or ::DS18B20_ANY if alone on the bus */
+    uint8_t resolution;     /**< 9 to 12 bits, set when the scheduler starts */
+} ds18b20_sensor_t;
+
+/** One timestamped reading from the scheduler */
+typedef struct {
+    int pin;
+    ds18b20_addr_t addr;
+    uint8_t resolution;         /**< Resolution reported by the sensor */
+    float temperature;          /**< In degrees Celsius, NaN on error */
+    portTickType timestamp;     /**< Tick count when it was read */
+} ds18b20_reading_t;
+
+/** Called from the scheduler task with each reading. The reading is only
+ *  valid during the call. */
+typedef void (*ds18b20_sched_callback_t)(const ds18b20_reading_t *reading, void *arg);
+
+/** Scheduler state, allocated by the caller. Fill in the first group of
+ *  fields and leave the rest to ds18b20_sched_start(). */
+typedef struct {
+    const ds18b20_sensor_t *sensors; /**< Must stay valid while running */
+    size_t count;
+    uint32_t period_ms;         /**< Time between rounds, 0 for triggered only */
+    xQueueHandle queue;         /**< Of ds18b20_reading_t, may be NULL */
+    ds18b20_sched_callback_t callback; /**< May be NULL */
+    void *arg;                  /**< Passed to callback */
+    unsigned portBASE_TYPE priority; /**< Of the scheduler task */
+
+    /* Private */
+    xSemaphoreHandle trigger;
+    uint32_t parasite;          /* buses with a parasitically powered sensor */
+    uint8_t bus_resolution[16]; /* highest resolution on each bus */
+} ds18b20_sched_t;
+
+/** Start the scheduler task.
+ *
+ *  The task first sets each sensor's resolution and checks how each bus is
+ *  powered, then starts a round every `period_ms` (if not 0) and whenever
+ *  ds18b20_sched_trigger() is called. Readings which don't fit in the queue
+ *  are dropped.
+ *
+ *  @returns `true` if the task was started, `false` if a sensor has a bad
+ *  pin or resolution or the task couldn't be created.
+ */
+bool ds18b20_sched_start(ds18b20_sched_t *sched);
+
+/** Start a round as soon as the current one (if any) is finished. */
+void ds18b20_sched_trigger(ds18b20_sched_t *sched);
+
+#endif
@@ -0,0 +1,8 @@
+# Component makefile for extras/gpio_capture
+
+INC_DIRS += $(gpio_capture_ROOT)
+
+# args for passing into compile rule generation
+gpio_capture_SRC_DIR =  $(gpio_capture_ROOT)
+
+$(eval $(call component_compile_rules,gpio_capture))
@@ -0,0 +1,202 @@
+/* gpio_capture.c
+ *
+ * Timestamped GPIO edge capture.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <errno.h>
+#include <string.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+#include <common_macros.h>
+#include <xtensa_ops.h>
+#include <esp/gpio.h>
+#include <esp/clocks.h>
+#include <esp/interrupts.h>
+#include <esp/systime.h>
+#include "gpio_capture.h"
+
+static gpio_capture_t *captures[16];
+
+/* Ring entries are CCOUNT with the level in bit 0 */
+#define ENTRY_LEVEL BIT(0)
+
+static void IRAM capture_edge(uint8_t gpio_num)
+{
+    uint32_t now;
+    RSR(now, ccount);
+    gpio_capture_t *cap = captures[gpio_num];
+    bool level;
+    if(cap->type == GPIO_INTTYPE_EDGE_ANY)
+        level = cap->level = !cap->level;
+    else
+        level = cap->type == GPIO_INTTYPE_EDGE_POS;
+
+    uint32_t edges = cap->edges;
+    if(edges) {
+        /* The pulse that just ended has the opposite level */
+        if(level)
+            cap->low = now - cap->last;
+        else
+            cap->high = now - cap->last;
+    }
+    cap->last = now;
+    cap->edges = edges + 1;
+
+    if(!cap->ring)
+        return;
+    uint32_t head = cap->head;
+    uint32_t used = head - cap->tail;
+    if(used > cap->mask) {
+        cap->overflows++;
+        return;
+    }
+    cap->ring[head & cap->mask] = (now & ~ENTRY_LEVEL) | level;
+    cap->head = head + 1;
+    /* The reader only waits when the ring is empty */
+    if(used == 0) {
+        portBASE_TYPE woken = pdFALSE;
+        xSemaphoreGiveFromISR(cap->sem, &woken);
+        if(woken)
+            portYIELD();
+    }
+}
+
+int gpio_capture_init(gpio_capture_t *cap, uint8_t pin, gpio_inttype_t type,
+                      uint32_t *ring, size_t size)
+{
+    if(pin >= 16 || (type != GPIO_INTTYPE_EDGE_POS && type != GPIO_INTTYPE_EDGE_NEG
+                     && type != GPIO_INTTYPE_EDGE_ANY))
+        return -EINVAL;
+    if(ring ? (size == 0 || (size & (size - 1))) : size != 0)
+        return -EINVAL;
+    if(captures[pin])
+        return -EBUSY;
+
+    memset(cap, 0, sizeof(*cap));
+    cap->pin = pin;
+    cap->type = type;
+    if(ring) {
+        vSemaphoreCreateBinary(cap->sem);
+        if(!cap->sem)
+            return -ENOMEM;
+        xSemaphoreTake(cap->sem, 0);
+        cap->ring = ring;
+        cap->mask = size - 1;
+    }
+
+    gpio_enable(pin, GPIO_INPUT);
+    cap->level = gpio_read(pin);
+    captures[pin] = cap;
+    gpio_set_pin_handler(pin, capture_edge);
+    gpio_set_interrupt(pin, type);
+    return 0;
+}
+
+void gpio_capture_stop(gpio_capture_t *cap)
+{
+    if(captures[cap->pin] != cap)
+        return;
+    gpio_set_interrupt(cap->pin, GPIO_INTTYPE_NONE);
+    gpio_set_pin_handler(cap->pin, NULL);
+    captures[cap->pin] = NULL;
+    if(cap->sem) {
+        vSemaphoreDelete(cap->sem);
+        cap->sem = NULL;
+    }
+    cap->ring = NULL;
+}
+
+size_t gpio_capture_available(const gpio_capture_t *cap)
+{
+    return cap->head - cap->tail;
+}
+
+size_t gpio_capture_read(gpio_capture_t *cap, gpio_capture_event_t *events,
+                         size_t max, portTickType timeout)
+{
+    if(!cap->ring || max == 0)
+        return 0;
+
+    xTimeOutType time_out;
+    vTaskSetTimeOutState(&time_out);
+    while(cap->head == cap->tail) {
+        if(xTaskCheckForTimeOut(&time_out, &timeout) != pdFALSE
+           || xSemaphoreTake(cap->sem, timeout) != pdTRUE)
+            return 0;
+    }
+
+    uint32_t tail = cap->tail;
+    uint32_t count = cap->head - tail;
+    if(count > max)
+        count = max;
+
+    /* Sample both clocks together, after the last edge being read */
+    uint32_t now_ccount;
+    uint32_t ps = _xt_disable_interrupts();
+    uint64_t now_us = systime_us();
+    RSR(now_ccount, ccount);
+    _xt_restore_interrupts(ps);
+    uint32_t cycles_per_us = cpu_freq_get();
+
+    for(uint32_t i = 0; i < count; i++) {
+        uint32_t entry = cap->ring[tail++ & cap->mask];
+        uint32_t ccount = entry & ~ENTRY_LEVEL;
+        events[i].time_us = now_us - (now_ccount - ccount) / cycles_per_us;
+        events[i].ccount = ccount;
+        events[i].pin = cap->pin;
+        events[i].level = entry & ENTRY_LEVEL;
+    }
+    cap->tail = tail;
+    return count;
+}
+
+uint32_t gpio_capture_count(const gpio_capture_t *cap)
+{
+    return cap->edges;
+}
+
+uint32_t gpio_capture_overflows(const gpio_capture_t *cap)
+{
+    return cap->overflows;
+}
+
+float gpio_capture_frequency(gpio_capture_t *cap)
+{
+    uint32_t ps = _xt_disable_interrupts();
+    uint32_t edges = cap->edges;
+    uint32_t last = cap->last;
+    _xt_restore_interrupts(ps);
+
+    uint32_t count = edges - cap->freq_edges;
+    uint32_t cycles = last - cap->freq_last;
+    bool valid = cap->freq_valid;
+    cap->freq_valid = edges != 0;
+    cap->freq_edges = edges;
+    cap->freq_last = last;
+
+    if(!valid || count == 0 || cycles == 0)
+        return 0;
+    float hz = (float)count * cpu_freq_get() * 1000000.0f / cycles;
+    if(cap->type == GPIO_INTTYPE_EDGE_ANY)
+        hz /= 2;
+    return hz;
+}
+
+bool gpio_capture_pulse_width(const gpio_capture_t *cap, uint32_t *high_us, uint32_t *low_us)
+{
+    uint32_t ps = _xt_disable_interrupts();
+    uint32_t high = cap->high;
+    uint32_t low = cap->low;
+    _xt_restore_interrupts(ps);
+
+    uint32_t cycles_per_us = cpu_freq_get();
+    if(high_us)
+        *high_us = high / cycles_per_us;
+    if(low_us)
+        *low_us = low / cycles_per_us;
+    return high && low;
+}
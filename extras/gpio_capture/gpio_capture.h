@@ -0,0 +1,133 @@
+/* gpio_capture.h
+ *
+ * Timestamped GPIO edge capture, for decoding IR remotes and 433MHz
+ * receivers, and measuring frequency, pulse widths and pulse counts.
+ *
+ * Each edge on a capture pin raises a GPIO interrupt which reads
+ * CCOUNT and pushes it, with the pin level after the edge, as one word
+ * into the pin's ring. The ring is single producer (the interrupt) and
+ * single consumer (one task), so neither side takes a lock. The handler also
+ * keeps an edge count and the widths of the last high and low pulses,
+ * and nothing else: around 30 cycles per edge on top of the
+ * gpio_interrupt_handler dispatch, plus a semaphore give when an edge
+ * arrives in an empty ring.
+ *
+ * The level isn't read from the pin, which by the time the handler runs
+ * may have moved on to the next edge. It follows from the edge type,
+ * and with GPIO_INTTYPE_EDGE_ANY it toggles on each edge, starting from
+ * the level at gpio_capture_init(). Two edges closer together than the
+ * interrupt latency raise one interrupt, so they count as one edge and
+ * the levels reported after them are inverted.
+ *
+ * Timestamps are kept as raw CCOUNT and converted to systime_us()
+ * microseconds when read, so events have to be read within one CCOUNT
+ * wrap (26s at 160MHz, 53s at 80MHz) of happening. The conversion
+ * uses the CPU frequency at the time of reading, so changing it while
+ * events are waiting in a ring skews their times.
+ *
+ * Uses gpio_set_pin_handler() for the capture pins.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _GPIO_CAPTURE_H
+#define _GPIO_CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <FreeRTOS.h>
+#include <semphr.h>
+#include <esp/gpio.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/* One captured edge */
+typedef struct {
+    uint64_t time_us;   /* systime_us() time of the edge */
+    uint32_t ccount;    /* CCOUNT at the edge, bit 0 cleared */
+    uint8_t pin;
+    bool level;         /* Pin level just after the edge */
+} gpio_capture_event_t;
+
+/* Capture state for one pin, allocated by the caller and set up by
+   gpio_capture_init(). All fields are private. */
+typedef struct {
+    uint8_t pin;
+    gpio_inttype_t type;
+    uint32_t *ring;
+    uint32_t mask;
+    xSemaphoreHandle sem;
+    volatile uint32_t head;     /* written by the interrupt handler */
+    volatile uint32_t tail;     /* written by the reader */
+    volatile uint32_t edges;
+    volatile uint32_t overflows;
+    volatile uint32_t last;     /* CCOUNT of the last edge */
+    volatile uint32_t high;     /* cycles, last high pulse */
+    volatile uint32_t low;      /* cycles, last low pulse */
+    bool level;                 /* after the last edge, for EDGE_ANY */
+    /* edges and last at the previous gpio_capture_frequency() call */
+    bool freq_valid;
+    uint32_t freq_edges;
+    uint32_t freq_last;
+} gpio_capture_t;
+
+/* Start capturing edges of 'type' (one of the GPIO_INTTYPE_EDGE_xxx
+   values) on GPIO0-15. The pin is made an input, pullups are left as
+   they are.
+
+   'ring' holds 'size' events, which must be a power of 2. Pass NULL
+   and 0 to only count edges and measure pulses, without recording
+   each edge. The ring has to stay valid until gpio_capture_stop().
+
+   Returns 0, -EINVAL for a bad pin, type or size, -EBUSY if the pin
+   already has a capture running, or -ENOMEM.
+*/
+int gpio_capture_init(gpio_capture_t *cap, uint8_t pin, gpio_inttype_t type,
+                      uint32_t *ring, size_t size);
+
+/* Stop capturing and release the pin's interrupt. Events still in the
+   ring are discarded. */
+void gpio_capture_stop(gpio_capture_t *cap);
+
+/* Number of events waiting in the ring */
+size_t gpio_capture_available(const gpio_capture_t *cap);
+
+/* Read up to 'max' events, oldest first, waiting up to 'timeout' for
+   the first one if the ring is empty. Returns the number read. Only
+   one task may read a given capture. */
+size_t gpio_capture_read(gpio_capture_t *cap, gpio_capture_event_t *events,
+                         size_t max, portTickType timeout);
+
+/* Edges seen since gpio_capture_init(), including any lost to ring
+   overflows. Wraps at 2^32. For a pulse counter, capture one edge
+   type without a ring and compare this between two readings. */
+uint32_t gpio_capture_count(const gpio_capture_t *cap);
+
+/* Events dropped because the ring was full */
+uint32_t gpio_capture_overflows(const gpio_capture_t *cap);
+
+/* Average signal frequency in Hz since the previous call, from the
+   time between the last edge before that call and the last edge
+   before this one. Timing whole periods rather than counting edges
+   per second gives the full CCOUNT resolution however long the
+   interval is, but calls must be less than a CCOUNT wrap apart (see
+   above.) With GPIO_INTTYPE_EDGE_ANY an odd number of edges is half a
+   period out unless the duty cycle is 50%, so use one edge type if
+   that matters. Returns 0 on the first call, or if no edges arrived
+   since the previous one. */
+float gpio_capture_frequency(gpio_capture_t *cap);
+
+/* Widths of the most recent high and low pulses in microseconds,
+   either may be NULL. Needs GPIO_INTTYPE_EDGE_ANY. Returns false
+   until both a high and a low pulse have been seen. */
+bool gpio_capture_pulse_width(const gpio_capture_t *cap, uint32_t *high_us, uint32_t *low_us);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,8 @@
+# Component makefile for extras/hrtimer
+
+INC_DIRS += $(hrtimer_ROOT)
+
+# args for passing into compile rule generation
+hrtimer_SRC_DIR =  $(hrtimer_ROOT)
+
+$(eval $(call component_compile_rules,hrtimer))
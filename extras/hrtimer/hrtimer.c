@@ -0,0 +1,257 @@
+/* High resolution software timers multiplexed onto the port timer
+ * alarm (CCOMPARE0, shared with the RTOS tick).
+ *
+ * See hrtimer.h for usage.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+#include <common_macros.h>
+#include <esp/interrupts.h>
+#include "hrtimer.h"
+
+/* timer->state bits */
+#define STATE_QUEUED BIT(0) /* HRTIMER_TASK callback on the pending list */
+
+static hrtimer_t *heap[HRTIMER_MAX_TIMERS];
+static int heap_size;
+
+static bool alarm_handler_set;
+
+/* HRTIMER_TASK timers which have expired and are waiting for the
+   task, oldest first. A list through the timers themselves rather
+   than a queue of pointers, so hrtimer_stop() can take a timer off
+   it and nothing refers to the timer afterwards. */
+static hrtimer_t *pending_head;
+static hrtimer_t *pending_tail;
+static xSemaphoreHandle task_sem;
+
+/* Timer ordering, valid while all deadlines are within 2^31 counts
+   of each other */
+static inline bool expires_before(const hrtimer_t *a, const hrtimer_t *b)
+{
+    return (int32_t)(a->expiry - b->expiry) < 0;
+}
+
+static inline void heap_set(int index, hrtimer_t *timer)
+{
+    heap[index] = timer;
+    timer->heap_index = index;
+}
+
+static void IRAM heap_sift_up(int index)
+{
+    hrtimer_t *timer = heap[index];
+    while(index > 0) {
+        int parent = (index - 1) / 2;
+        if(!expires_before(timer, heap[parent]))
+            break;
+        heap_set(index, heap[parent]);
+        index = parent;
+    }
+    heap_set(index, timer);
+}
+
+static void IRAM heap_sift_down(int index)
+{
+    hrtimer_t *timer = heap[index];
+    while(1) {
+        int child = index * 2 + 1;
+        if(child >= heap_size)
+            break;
+        if(child + 1 < heap_size && expires_before(heap[child + 1], heap[child]))
+            child++;
+        if(!expires_before(heap[child], timer))
+            break;
+        heap_set(index, heap[child]);
+        index = child;
+    }
+    heap_set(index, timer);
+}
+
+static void IRAM heap_remove(hrtimer_t *timer)
+{
+    int index = timer->heap_index;
+    timer->heap_index = -1;
+    heap_size--;
+    if(index == heap_size)
+        return;
+    heap_set(index, heap[heap_size]);
+    heap_sift_up(index);
+    heap_sift_down(heap[index]->heap_index);
+}
+
+/* Set the port timer alarm for the earliest deadline. If that has
+   already passed the alarm goes off straight away. */
+static inline void set_alarm(void)
+{
+    if(heap_size == 0)
+        vPortClearTimerAlarm();
+    else
+        vPortSetTimerAlarm(heap[0]->expiry);
+}
+
+/* Called from the tick interrupt */
+static void IRAM alarm_handler(void)
+{
+    portBASE_TYPE task_woken = pdFALSE;
+
+    uint32_t now = ulPortTimerCount();
+    while(heap_size > 0 && (int32_t)(heap[0]->expiry - now) <= 0) {
+        hrtimer_t *timer = heap[0];
+        if(timer->period) {
+            timer->expiry += timer->period;
+            if((int32_t)(timer->expiry - now) <= 0) {
+                /* fell more than a period behind, skip the missed expiries */
+                timer->overruns++;
+                timer->expiry = now + timer->period;
+            }
+            heap_sift_down(0);
+        } else {
+            heap_remove(timer);
+        }
+
+        if(timer->flags & HRTIMER_TASK) {
+            if(timer->state & STATE_QUEUED) {
+                timer->overruns++; /* previous expiry hasn't run yet */
+            } else {
+                timer->state |= STATE_QUEUED;
+                timer->next_pending = NULL;
+                if(pending_tail)
+                    pending_tail->next_pending = timer;
+                else
+                    pending_head = timer;
+                pending_tail = timer;
+                xSemaphoreGiveFromISR(task_sem, &task_woken);
+            }
+        } else {
+            timer->callback(timer->arg);
+        }
+        now = ulPortTimerCount();
+    }
+    /* If the next deadline has passed by now, the port calls back
+       again before leaving the interrupt */
+    set_alarm();
+
+    if(task_woken)
+        portYIELD();
+}
+
+static void hrtimer_task(void *pvParameters)
+{
+    while(1) {
+        xSemaphoreTake(task_sem, portMAX_DELAY);
+        while(1) {
+            uint32_t ps = _xt_disable_interrupts();
+            hrtimer_t *timer = pending_head;
+            if(timer) {
+                pending_head = timer->next_pending;
+                if(!pending_head)
+                    pending_tail = NULL;
+                timer->state &= ~STATE_QUEUED;
+            }
+            _xt_restore_interrupts(ps);
+            if(!timer)
+                break;
+            timer->callback(timer->arg);
+        }
+    }
+}
+
+/* Interrupts must be disabled */
+static void IRAM pending_remove(hrtimer_t *timer)
+{
+    hrtimer_t *prev = NULL;
+    for(hrtimer_t *t = pending_head; t; prev = t, t = t->next_pending) {
+        if(t == timer) {
+            if(prev)
+                prev->next_pending = t->next_pending;
+            else
+                pending_head = t->next_pending;
+            if(pending_tail == t)
+                pending_tail = prev;
+            break;
+        }
+    }
+    timer->state &= ~STATE_QUEUED;
+}
+
+void hrtimer_init(hrtimer_t *timer, hrtimer_callback_t callback, void *arg, uint32_t flags)
+{
+    /* Two tasks may get here first at the same time */
+    if(!alarm_handler_set || ((flags & HRTIMER_TASK) && !task_sem)) {
+        vTaskSuspendAll();
+        if(!alarm_handler_set) {
+            vPortSetTimerAlarmHandler(alarm_handler);
+            alarm_handler_set = true;
+        }
+        if((flags & HRTIMER_TASK) && !task_sem) {
+            vSemaphoreCreateBinary(task_sem);
+            xSemaphoreTake(task_sem, 0);
+            xTaskCreate(hrtimer_task, (signed char *)"hrtimer", HRTIMER_TASK_STACK_SIZE,
+                        NULL, HRTIMER_TASK_PRIORITY, NULL);
+        }
+        xTaskResumeAll();
+    }
+    timer->expiry = 0;
+    timer->period = 0;
+    timer->callback = callback;
+    timer->arg = arg;
+    timer->flags = flags;
+    timer->state = 0;
+    timer->heap_index = -1;
+    timer->overruns = 0;
+    timer->next_pending = NULL;
+}
+
+int IRAM hrtimer_start_at(hrtimer_t *timer, uint32_t ticks, uint32_t period_ticks)
+{
+    if(period_ticks > HRTIMER_US_TO_TICKS(HRTIMER_MAX_US))
+        return -EINVAL;
+
+    uint32_t ps = _xt_disable_interrupts();
+    if(timer->heap_index >= 0) {
+        heap_remove(timer);
+    } else if(heap_size == HRTIMER_MAX_TIMERS) {
+        _xt_restore_interrupts(ps);
+        return -ENOSPC;
+    }
+
+    timer->expiry = ticks;
+    timer->period = period_ticks;
+    heap_set(heap_size++, timer);
+    heap_sift_up(timer->heap_index);
+
+    /* Only move the alarm if the earliest deadline changed */
+    if(timer->heap_index == 0)
+        set_alarm();
+    _xt_restore_interrupts(ps);
+    return 0;
+}
+
+int IRAM hrtimer_start(hrtimer_t *timer, uint32_t us, uint32_t period_us)
+{
+    if(us > HRTIMER_MAX_US || period_us > HRTIMER_MAX_US)
+        return -EINVAL;
+    return hrtimer_start_at(timer, hrtimer_get_ticks() + HRTIMER_US_TO_TICKS(us),
+                            HRTIMER_US_TO_TICKS(period_us));
+}
+
+void IRAM hrtimer_stop(hrtimer_t *timer)
+{
+    uint32_t ps = _xt_disable_interrupts();
+    if(timer->heap_index >= 0) {
+        /* If this was the earliest deadline the alarm is left as-is,
+           it fires once more and finds nothing due */
+        heap_remove(timer);
+    }
+    if(timer->state & STATE_QUEUED)
+        pending_remove(timer);
+    _xt_restore_interrupts(ps);
+}
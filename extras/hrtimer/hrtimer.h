@@ -0,0 +1,158 @@
+/* hrtimer.h
+ *
+ * High resolution software timers multiplexed onto the port timer
+ * alarm.
+ *
+ * Timers run against the FreeRTOS port timer count (ulPortTimerCount,
+ * 5MHz or 0.2us per count), which is derived from CCOUNT but keeps
+ * its rate when the CPU clock changes. Armed timers are kept in a
+ * min-heap sorted by expiry time and only the earliest deadline is
+ * passed to the port, which raises it from the CCOMPARE0 interrupt it
+ * also uses for the RTOS tick. So any number of drivers share the
+ * one compare register, and the FRC1/FRC2 hardware timers are left
+ * alone (the SDK's ets/os timers, and with them the WiFi stack,
+ * depend on FRC2.)
+ *
+ * Callbacks run either directly in the tick interrupt handler (the
+ * default, lowest latency) or, with HRTIMER_TASK, from a high
+ * priority "hrtimer" task which is created on first use.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _HRTIMER_H
+#define _HRTIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <common_macros.h>
+#include <FreeRTOS.h>
+#include <semphr.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/* Maximum number of simultaneously armed timers */
+#ifndef HRTIMER_MAX_TIMERS
+#define HRTIMER_MAX_TIMERS 16
+#endif
+
+/* Priority & stack size of the task which runs HRTIMER_TASK callbacks */
+#ifndef HRTIMER_TASK_PRIORITY
+#define HRTIMER_TASK_PRIORITY (configMAX_PRIORITIES - 1)
+#endif
+#ifndef HRTIMER_TASK_STACK_SIZE
+#define HRTIMER_TASK_STACK_SIZE 384
+#endif
+
+/* vTaskDelayUs busy-waits rather than blocking for delays shorter than
+   this, as two context switches cost more than they save. */
+#ifndef HRTIMER_DELAY_SPIN_US
+#define HRTIMER_DELAY_SPIN_US 50
+#endif
+
+/* Port timer counts per microsecond */
+#define HRTIMER_TICKS_PER_US (portTIMER_HZ / 1000000)
+
+/* Deadlines are compared as signed 32-bit differences of timer counts,
+   so intervals are limited to well under half the counter range
+   (2^31 counts is ~429 seconds.) */
+#define HRTIMER_MAX_US 200000000
+
+#define HRTIMER_US_TO_TICKS(us) ((uint32_t)(us) * HRTIMER_TICKS_PER_US)
+#define HRTIMER_TICKS_TO_US(ticks) ((uint32_t)(ticks) / HRTIMER_TICKS_PER_US)
+
+typedef void (*hrtimer_callback_t)(void *arg);
+
+/* Flags for hrtimer_init */
+#define HRTIMER_ISR  0       /* Run callback in the tick interrupt handler */
+#define HRTIMER_TASK BIT(0)  /* Run callback in the hrtimer task */
+
+/* Timer structure, allocated by the caller (statically, or anywhere
+   that outlives the timer being armed.) Fields are private. */
+typedef struct hrtimer {
+    uint32_t expiry;          /* Timer count when next due */
+    uint32_t period;          /* Timer counts, 0 for a one-shot timer */
+    hrtimer_callback_t callback;
+    void *arg;
+    uint8_t flags;
+    volatile uint8_t state;
+    int16_t heap_index;       /* -1 when not armed */
+    uint32_t overruns;        /* Number of expiries missed or coalesced */
+    struct hrtimer *next_pending;
+} hrtimer_t;
+
+/* Initialise a timer structure. Must be called from task context
+   (creates the hrtimer task the first time HRTIMER_TASK is used.)
+   Don't initialise a timer which is armed, stop it first. */
+void hrtimer_init(hrtimer_t *timer, hrtimer_callback_t callback, void *arg, uint32_t flags);
+
+/* Arm a timer to fire 'us' microseconds from now, and then every
+   'period_us' microseconds if period_us is non-zero. Restarting an
+   armed timer reschedules it.
+
+   Periodic timers are rescheduled relative to their previous expiry
+   time, so they don't drift.
+
+   Can be called from an ISR or from inside a timer callback.
+
+   Returns 0 on success, -EINVAL if an interval is out of range or
+   -ENOSPC if HRTIMER_MAX_TIMERS timers are already armed.
+*/
+int hrtimer_start(hrtimer_t *timer, uint32_t us, uint32_t period_us);
+
+/* Arm a timer to fire at an absolute timer count (see
+   hrtimer_get_ticks()), with an optional period in timer counts. Useful
+   for chaining precisely spaced events. */
+int hrtimer_start_at(hrtimer_t *timer, uint32_t ticks, uint32_t period_ticks);
+
+/* Disarm a timer. Also cancels an HRTIMER_TASK callback which has
+   been queued but not yet run. Safe to call on a timer which isn't
+   armed. Can be called from an ISR or from inside a timer callback.
+
+   Once this returns hrtimer holds no reference to the timer, so it
+   can go out of scope or be initialised again. (From a task below
+   HRTIMER_TASK_PRIORITY, that is. An ISR or a higher priority task
+   can interrupt the hrtimer task just as it starts the callback.) */
+void hrtimer_stop(hrtimer_t *timer);
+
+/* Returns true if the timer is armed. */
+static inline bool hrtimer_is_active(const hrtimer_t *timer)
+{
+    return timer->heap_index >= 0;
+}
+
+/* Current timer count (HRTIMER_TICKS_PER_US counts per microsecond). */
+static inline uint32_t hrtimer_get_ticks(void)
+{
+    return ulPortTimerCount();
+}
+
+/* Block the calling task for 'us' microseconds.
+
+   The task blocks in vTaskDelay() as usual but is woken early, via
+   xTaskAbortDelay(), by an hrtimer at the requested time, so other
+   tasks run in the meantime and the task doesn't oversleep to the
+   next 10ms tick. Wakeup latency is that of an HRTIMER_TASK callback
+   plus a context switch, typically some tens of microseconds. Delays
+   shorter than HRTIMER_DELAY_SPIN_US busy-wait instead.
+
+   The calling task's priority must be lower than
+   HRTIMER_TASK_PRIORITY. Not for use from ISRs.
+*/
+void vTaskDelayUs(uint32_t us);
+
+/* Take a semaphore, waiting at most 'us' microseconds. As for
+   vTaskDelayUs, the wait is ended by an hrtimer rather than the tick.
+
+   Returns pdTRUE if the semaphore was taken, pdFALSE on timeout.
+*/
+portBASE_TYPE xSemaphoreTakeUs(xSemaphoreHandle semaphore, uint32_t us);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,87 @@
+/* Sub-tick blocking delays using hrtimer.
+ *
+ * See hrtimer.h for usage.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+#include <espressif/esp_misc.h>
+#include "hrtimer.h"
+
+#if !INCLUDE_xTaskAbortDelay
+#error "vTaskDelayUs needs INCLUDE_xTaskAbortDelay set to 1"
+#endif
+
+/* If the timer fires before the waiting task has actually blocked,
+   try again after this long */
+#define WAKE_RETRY_US 20
+
+#define US_PER_TICK (portTICK_RATE_MS * 1000)
+
+/* Block time used as a backstop, in case the wakeup timer can't be
+   armed. Always long enough that the timer gets there first. */
+#define FALLBACK_TICKS(us) ((us) / US_PER_TICK + 2)
+
+struct delay_wait {
+    hrtimer_t timer;
+    xTaskHandle task;
+};
+
+static void wake_task(void *arg)
+{
+    struct delay_wait *wait = arg;
+    if(xTaskAbortDelay(wait->task) != pdTRUE) {
+        /* task is still on its way to blocking */
+        hrtimer_start(&wait->timer, WAKE_RETRY_US, 0);
+    }
+}
+
+/* The timer is on the stack of each wait. hrtimer_stop() at the end
+   of the wait takes it off both the armed heap and the hrtimer task's
+   pending list, so nothing refers to it once the wait returns and
+   the next wait can initialise its own. After the first call
+   hrtimer_init() only fills in the fields. */
+static bool start_wait(struct delay_wait *wait, uint32_t us)
+{
+    wait->task = xTaskGetCurrentTaskHandle();
+    hrtimer_init(&wait->timer, wake_task, wait, HRTIMER_TASK);
+    return hrtimer_start(&wait->timer, us, 0) == 0;
+}
+
+void vTaskDelayUs(uint32_t us)
+{
+    if(us < HRTIMER_DELAY_SPIN_US) {
+        sdk_os_delay_us(us);
+        return;
+    }
+
+    /* Sleep whole ticks for anything beyond the hrtimer range */
+    while(us > HRTIMER_MAX_US) {
+        vTaskDelay(HRTIMER_MAX_US / US_PER_TICK);
+        us -= HRTIMER_MAX_US / US_PER_TICK * US_PER_TICK;
+    }
+
+    struct delay_wait wait;
+    bool armed = start_wait(&wait, us);
+    vTaskDelay(FALLBACK_TICKS(us));
+    if(armed)
+        hrtimer_stop(&wait.timer);
+}
+
+portBASE_TYPE xSemaphoreTakeUs(xSemaphoreHandle semaphore, uint32_t us)
+{
+    if(us == 0 || us > HRTIMER_MAX_US) {
+        return xSemaphoreTake(semaphore, us ? FALLBACK_TICKS(us) : 0);
+    }
+
+    struct delay_wait wait;
+    bool armed = start_wait(&wait, us);
+    portBASE_TYPE result = xSemaphoreTake(semaphore, FALLBACK_TICKS(us));
+    if(armed)
+        hrtimer_stop(&wait.timer);
+    return result;
+}
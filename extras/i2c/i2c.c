@@ -22,206 +22,297 @@
  * THE SOFTWARE.
  */
 
+#include <errno.h>
+#include <stdio.h>
 #include <esp8266.h>
-#include <espressif/esp_misc.h> // sdk_os_delay_us
+#include <esp/clocks.h>
+#include <xtensa_ops.h>
 #include "i2c.h"
 
 
 // I2C driver for ESP8266 written for use with esp-open-rtos
 // Based on https://en.wikipedia.org/wiki/I²C#Example_of_bit-banging_the_I.C2.B2C_Master_protocol
+//
+// Both lines are open drain outputs, so releasing a line (letting the
+// pullup take it high) and pulling it low are single GPIO.OUT_SET and
+// OUT_CLEAR writes, and the level is always readable from GPIO.IN.
+// Each half clock period is timed from CCOUNT, so the clock runs at the
+// configured rate rather than whatever the call overhead allows.
 
-// With calling overhead, we end up at ~100kbit/s
-#define CLK_HALF_PERIOD_US (1)
+static i2c_bus_t default_bus;
 
-#define CLK_STRETCH  (10)
+int i2c_bus_init(i2c_bus_t *bus, uint8_t scl_pin, uint8_t sda_pin, uint32_t freq)
+{
+    if (scl_pin >= 16 || sda_pin >= 16 || scl_pin == sda_pin ||
+        freq == 0 || freq > I2C_MAX_FREQ)
+        return -EINVAL;
 
-static bool started;
-static uint8_t g_scl_pin;
-static uint8_t g_sda_pin;
+    bus->scl_mask = BIT(scl_pin);
+    bus->sda_mask = BIT(sda_pin);
+    bus->half_period = (APB_CLK_FREQ / 2 + freq - 1) / freq;
+    bus->started = false;
+    i2c_bus_set_stretch_timeout(bus, I2C_DEFAULT_STRETCH_US);
 
-void i2c_init(uint8_t scl_pin, uint8_t sda_pin)
+    GPIO.OUT_SET = bus->scl_mask | bus->sda_mask;
+    gpio_enable(scl_pin, GPIO_OUT_OPEN_DRAIN);
+    gpio_enable(sda_pin, GPIO_OUT_OPEN_DRAIN);
+    gpio_set_pullup(scl_pin, true, true);
+    gpio_set_pullup(sda_pin, true, true);
+    return 0;
+}
+
+void i2c_bus_set_stretch_timeout(i2c_bus_t *bus, uint32_t us)
 {
-    started = false;
-    g_scl_pin = scl_pin;
-    g_sda_pin = sda_pin;
+    bus->stretch_timeout = us * (APB_CLK_FREQ / 1000000);
 }
 
-static void i2c_delay(void)
+static inline uint32_t ccount(void)
 {
-    sdk_os_delay_us(CLK_HALF_PERIOD_US);
+    uint32_t r;
+    RSR(r, ccount);
+    return r;
 }
 
-// Set SCL as input and return current level of line, 0 or 1
-static bool read_scl(void)
+static inline bool read_sda(i2c_bus_t *bus)
 {
-    gpio_enable(g_scl_pin, GPIO_INPUT);
-    return gpio_read(g_scl_pin); // Clock high, valid ACK
+    return GPIO.IN & bus->sda_mask;
 }
 
-// Set SDA as input and return current level of line, 0 or 1
-static bool read_sda(void)
+// Every line change is timestamped, and the next half period is timed
+// from it. An interrupt can make a half period longer but never
+// shorter than it should be.
+static inline void set_sda(i2c_bus_t *bus, bool level)
 {
-    gpio_enable(g_sda_pin, GPIO_INPUT);
-    // TODO: Without this delay we get arbitration lost in i2c_stop
-    i2c_delay();
-    return gpio_read(g_sda_pin); // Clock high, valid ACK
+    if (level)
+        GPIO.OUT_SET = bus->sda_mask;
+    else
+        GPIO.OUT_CLEAR = bus->sda_mask;
+    bus->edge = ccount();
 }
 
-// Actively drive SCL signal low
-static void clear_scl(void)
+static inline void clear_scl(i2c_bus_t *bus)
 {
-    gpio_enable(g_scl_pin, GPIO_OUTPUT);
-    gpio_write(g_scl_pin, 0);
+    GPIO.OUT_CLEAR = bus->scl_mask;
+    bus->edge = ccount();
 }
 
-// Actively drive SDA signal low
-static void clear_sda(void)
+// 80MHz cycles to CPU cycles. Read for every wait rather than once per
+// transfer, as another task can change the CPU clock in the middle of
+// one (cpu_freq_set(), cpu_freq_boost_acquire()).
+static inline uint8_t cpu_shift(void)
 {
-    gpio_enable(g_sda_pin, GPIO_OUTPUT);
-    gpio_write(g_sda_pin, 0);
+    return (cpu_freq_get() == 160) ? 1 : 0;
 }
 
-// Output start condition
-void i2c_start(void)
+// Wait until half a clock period after the last line change
+static void i2c_delay(i2c_bus_t *bus)
+{
+    uint32_t due = bus->edge + (bus->half_period << cpu_shift());
+    while ((int32_t)(ccount() - due) < 0)
+        ;
+}
+
+// Release SCL and wait for it to go high, allowing for clock stretching
+static int release_scl(i2c_bus_t *bus)
 {
-    uint32_t clk_stretch = CLK_STRETCH;
-    if (started) { // if started, do a restart cond
-        // Set SDA to 1
-        (void) read_sda();
-        i2c_delay();
-        while (read_scl() == 0 && clk_stretch--) ;
-        // Repeated start setup time, minimum 4.7us
-        i2c_delay();
+    GPIO.OUT_SET = bus->scl_mask;
+    uint32_t start = ccount();
+    uint32_t timeout = bus->stretch_timeout << cpu_shift();
+    while (!(GPIO.IN & bus->scl_mask)) {
+        if (ccount() - start > timeout)
+            return -ETIMEDOUT;
     }
-    if (read_sda() == 0) {
-        printf("I2C: arbitration lost in i2c_start\n");
+    // Time the high half of the clock from when SCL actually rose
+    bus->edge = ccount();
+    return 0;
+}
+
+int i2c_bus_start(i2c_bus_t *bus)
+{
+    int res;
+    if (bus->started) {
+        // Repeated start: SCL is low, release SDA then SCL
+        set_sda(bus, 1);
+        i2c_delay(bus);
+        if ((res = release_scl(bus)) < 0)
+            return res;
+        // Repeated start setup time
+        i2c_delay(bus);
+    } else {
+        bus->edge = ccount();
+        if (!(GPIO.IN & bus->scl_mask))
+            return -EBUSY;
+    }
+    if (!read_sda(bus)) {
+        bus->started = false;
+        return -EBUSY;
     }
     // SCL is high, set SDA from 1 to 0.
-    clear_sda();
-    i2c_delay();
-    clear_scl();
-    started = true;
+    set_sda(bus, 0);
+    i2c_delay(bus);
+    clear_scl(bus);
+    bus->started = true;
+    return 0;
 }
 
-// Output stop condition
-void i2c_stop(void)
+int i2c_bus_stop(i2c_bus_t *bus)
 {
-    uint32_t clk_stretch = CLK_STRETCH;
-    // Set SDA to 0
-    clear_sda();
-    i2c_delay();
-    // Clock stretching
-    while (read_scl() == 0 && clk_stretch--) ;
-    // Stop bit setup time, minimum 4us
-    i2c_delay();
+    // SCL is low, set SDA to 0
+    set_sda(bus, 0);
+    i2c_delay(bus);
+    int res = release_scl(bus);
+    // Stop bit setup time
+    i2c_delay(bus);
     // SCL is high, set SDA from 0 to 1
-    if (read_sda() == 0) {
-        printf("I2C: arbitration lost in i2c_stop\n");
-    }
-    i2c_delay();
-    started = false;
+    set_sda(bus, 1);
+    i2c_delay(bus);
+    bus->started = false;
+    if (res == 0 && !read_sda(bus))
+        res = -EBUSY;
+    return res;
 }
 
 // Write a bit to I2C bus
-static void i2c_write_bit(bool bit)
+static int i2c_write_bit(i2c_bus_t *bus, bool bit)
 {
-    uint32_t clk_stretch = CLK_STRETCH;
-    if (bit) {
-        (void) read_sda();
-    } else {
-        clear_sda();
-    }
-    i2c_delay();
-    // Clock stretching
-    while (read_scl() == 0 && clk_stretch--) ;
+    int res;
+    set_sda(bus, bit);
+    i2c_delay(bus);
+    if ((res = release_scl(bus)) < 0)
+        return res;
     // SCL is high, now data is valid
+    i2c_delay(bus);
     // If SDA is high, check that nobody else is driving SDA
-    if (bit && read_sda() == 0) {
-        printf("I2C: arbitration lost in i2c_write_bit\n");
-    }
-    i2c_delay();
-    clear_scl();
+    if (bit && !read_sda(bus))
+        res = -EBUSY;
+    clear_scl(bus);
+    return res;
 }
 
 // Read a bit from I2C bus
-static bool i2c_read_bit(void)
+static int i2c_read_bit(i2c_bus_t *bus)
 {
-    uint32_t clk_stretch = CLK_STRETCH;
-    bool bit;
+    int res;
     // Let the slave drive data
-    (void) read_sda();
-    i2c_delay();
-    // Clock stretching
-    while (read_scl() == 0 && clk_stretch--) ;
-    // SCL is high, now data is valid
-    bit = read_sda();
-    i2c_delay();
-    clear_scl();
+    set_sda(bus, 1);
+    i2c_delay(bus);
+    if ((res = release_scl(bus)) < 0)
+        return res;
+    // SCL is high, now data is valid. Sample at the end of the high
+    // half, giving the slave as long as possible.
+    i2c_delay(bus);
+    bool bit = read_sda(bus);
+    clear_scl(bus);
     return bit;
 }
 
-bool i2c_write(uint8_t byte)
+int i2c_bus_write(i2c_bus_t *bus, uint8_t byte)
 {
-    bool nack;
-    uint8_t bit;
-    for (bit = 0; bit < 8; bit++) {
-        i2c_write_bit((byte & 0x80) != 0);
+    int res;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+        if ((res = i2c_write_bit(bus, byte & 0x80)) < 0)
+            return res;
         byte <<= 1;
     }
-    nack = i2c_read_bit();
-    return !nack;
+    res = i2c_read_bit(bus);
+    if (res < 0)
+        return res;
+    return res ? -EIO : 0;
 }
 
-uint8_t i2c_read(bool ack)
+int i2c_bus_read(i2c_bus_t *bus, bool last)
 {
+    int res;
     uint8_t byte = 0;
-    uint8_t bit;
-    for (bit = 0; bit < 8; bit++) {
-        byte = (byte << 1) | i2c_read_bit();
+    for (uint8_t bit = 0; bit < 8; bit++) {
+        if ((res = i2c_read_bit(bus)) < 0)
+            return res;
+        byte = (byte << 1) | res;
     }
-    i2c_write_bit(ack);
+    if ((res = i2c_write_bit(bus, last)) < 0)
+        return res;
     return byte;
 }
 
-bool i2c_slave_write(uint8_t slave_addr, uint8_t *data, uint8_t len)
+int i2c_bus_transfer(i2c_bus_t *bus, uint8_t slave_addr, const uint8_t *wbuf, size_t wlen,
+                     uint8_t *rbuf, size_t rlen)
 {
-    bool success = false;
+    int res = 0;
     do {
-        i2c_start();
-        if (!i2c_write(slave_addr << 1))
-            break;
-        while (len--) {
-            if (!i2c_write(*data++))
+        if (wlen || !rlen) {
+            if ((res = i2c_bus_start(bus)) < 0)
+                break;
+            if ((res = i2c_bus_write(bus, slave_addr << 1)) < 0)
+                break;
+            while (wlen--) {
+                if ((res = i2c_bus_write(bus, *wbuf++)) < 0)
+                    break;
+            }
+            if (res < 0)
                 break;
         }
-        i2c_stop();
-        success = true;
-    } while(0);
-    return success;
+        if (rlen) {
+            if ((res = i2c_bus_start(bus)) < 0)
+                break;
+            if ((res = i2c_bus_write(bus, slave_addr << 1 | 1)) < 0)
+                break;
+            while (rlen) {
+                if ((res = i2c_bus_read(bus, rlen == 1)) < 0)
+                    break;
+                *rbuf++ = res;
+                rlen--;
+            }
+            if (res < 0)
+                break;
+            res = 0;
+        }
+    } while (0);
+
+    // A slave holding SDA low mid-byte can stop the stop condition from
+    // working, but there's nothing better to try
+    int stop_res = i2c_bus_stop(bus);
+    return res < 0 ? res : stop_res;
+}
+
+void i2c_init(uint8_t scl_pin, uint8_t sda_pin)
+{
+    i2c_bus_init(&default_bus, scl_pin, sda_pin, I2C_DEFAULT_FREQ);
+}
+
+void i2c_start(void)
+{
+    if (i2c_bus_start(&default_bus) < 0) {
+        printf("I2C: arbitration lost in i2c_start\n");
+    }
+}
+
+void i2c_stop(void)
+{
+    if (i2c_bus_stop(&default_bus) < 0) {
+        printf("I2C: arbitration lost in i2c_stop\n");
+    }
+}
+
+bool i2c_write(uint8_t byte)
+{
+    return i2c_bus_write(&default_bus, byte) == 0;
+}
+
+uint8_t i2c_read(bool ack)
+{
+    int res = i2c_bus_read(&default_bus, ack);
+    // An idle bus reads as all ones
+    return res < 0 ? 0xff : res;
+}
+
+bool i2c_slave_write(uint8_t slave_addr, uint8_t *data, uint8_t len)
+{
+    return i2c_bus_transfer(&default_bus, slave_addr, data, len, NULL, 0) == 0;
 }
 
 bool i2c_slave_read(uint8_t slave_addr, uint8_t data, uint8_t *buf, uint32_t len)
 {
-    bool success = false;
-    do {
-        i2c_start();
-        if (!i2c_write(slave_addr << 1)) {
-            break;
-        }
-        i2c_write(data);
-        i2c_stop();
-        i2c_start();
-        if (!i2c_write(slave_addr << 1 | 1)) { // Slave address + read
-            break;
-        }
-        while(len) {
-            *buf = i2c_read(len == 1);
-            buf++;
-            len--;
-        }
-        success = true;
-    } while(0);
-    i2c_stop();
+    bool success = i2c_bus_transfer(&default_bus, slave_addr, &data, 1, buf, len) == 0;
     if (!success) {
         printf("I2C: write error\n");
     }
@@ -1,18 +1,18 @@
-/* 
+/*
  * The MIT License (MIT)
- * 
+ *
  * Copyright (c) 2015 Johan Kanflo (github.com/kanflo)
- * 
+ *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
  * in the Software without restriction, including without limitation the rights
  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
  * copies of the Software, and to permit persons to whom the Software is
  * furnished to do so, subject to the following conditions:
- * 
+ *
  * The above copyright notice and this permission notice shall be included in
  * all copies or substantial portions of the Software.
- * 
+ *
  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
@@ -24,10 +24,69 @@
 
 #ifndef __I2C_H__
 #define __I2C_H__
-#endif
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+// Bus clock used by i2c_init()
+#define I2C_DEFAULT_FREQ 100000
+
+// Fastest supported bus clock. Above ~400kHz the CPU should run at
+// 160MHz, if the code can't keep up the clock just runs slower.
+#define I2C_MAX_FREQ 1000000
+
+// How long a slave may hold SCL low before an operation fails with
+// -ETIMEDOUT, unless changed with i2c_bus_set_stretch_timeout()
+#define I2C_DEFAULT_STRETCH_US 1000
+
+// One bus. Any number of buses can be used, on any pair of GPIO0-15.
+// Fields are private. Buses have no locking, so use each one from a
+// single task at a time.
+typedef struct {
+    uint32_t scl_mask;
+    uint32_t sda_mask;
+    uint32_t half_period;      // in 80MHz cycles
+    uint32_t stretch_timeout;  // in 80MHz cycles
+    uint32_t edge;             // CCOUNT of the last line change
+    bool started;
+} i2c_bus_t;
+
+// Set up a bus on the given pins, which are made open drain outputs
+// with internal pullups (external pullups are still needed above
+// 100kHz or so.) Returns 0, or -EINVAL for a bad pin or frequency.
+int i2c_bus_init(i2c_bus_t *bus, uint8_t scl_pin, uint8_t sda_pin, uint32_t freq);
+
+void i2c_bus_set_stretch_timeout(i2c_bus_t *bus, uint32_t us);
+
+// Low level operations. All return a negative error code on failure:
+//   -EIO        the slave didn't acknowledge a byte
+//   -ETIMEDOUT  SCL was held low for longer than the stretch timeout
+//   -EBUSY      a line was held low by something else (lost
+//               arbitration, or a slave stuck mid-transfer)
+
+// Send a start condition, or a repeated start if already started
+int i2c_bus_start(i2c_bus_t *bus);
+int i2c_bus_stop(i2c_bus_t *bus);
+
+// Write a byte, returns 0 if the slave acknowledged it
+int i2c_bus_write(i2c_bus_t *bus, uint8_t byte);
+
+// Read a byte and return it. 'last' should be true for the final byte
+// of a read, which isn't acknowledged.
+int i2c_bus_read(i2c_bus_t *bus, bool last);
+
+// Complete transaction with a 7 bit address: write 'wlen' bytes, then
+// (after a repeated start) read 'rlen' bytes, then stop. Either length
+// can be 0. Returns 0 on success.
+int i2c_bus_transfer(i2c_bus_t *bus, uint8_t slave_addr, const uint8_t *wbuf, size_t wlen,
+                     uint8_t *rbuf, size_t rlen);
+
+// The functions below use a single default bus at I2C_DEFAULT_FREQ.
 
 // Init bitbanging I2C driver on given pins
 void i2c_init(uint8_t scl_pin, uint8_t sda_pin);
@@ -35,7 +94,8 @@ void i2c_init(uint8_t scl_pin, uint8_t sda_pin);
 // Write a byte to I2C bus. Return true if slave acked.
 bool i2c_write(uint8_t byte);
 
-// Read a byte from I2C bus. Return true if slave acked.
+// Read a byte from I2C bus. Send a NACK after it if 'ack' is true (the
+// name is historical), as needed for the last byte of a read.
 uint8_t i2c_read(bool ack);
 
 // Write 'len' bytes from 'buf' to slave. Return true if slave acked.
@@ -49,3 +109,9 @@ bool i2c_slave_read(uint8_t slave_addr, uint8_t data, uint8_t *buf, uint32_t len
 // devices where the i2c_slave_[read|write] functions above are of no use.
 void i2c_start(void);
 void i2c_stop(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* __I2C_H__ */
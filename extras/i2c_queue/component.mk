@@ -0,0 +1,10 @@
+# Component makefile for extras/i2c_queue
+#
+# Needs extras/i2c as well
+
+INC_DIRS += $(i2c_queue_ROOT)
+
+# args for passing into compile rule generation
+i2c_queue_SRC_DIR =  $(i2c_queue_ROOT)
+
+$(eval $(call component_compile_rules,i2c_queue))
@@ -0,0 +1,94 @@
+/* I2C transaction service.
+ *
+ * See i2c_queue.h for usage.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <errno.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+#include "i2c_queue.h"
+
+static void i2c_queue_task(void *pvParameters)
+{
+    i2c_queue_t *q = pvParameters;
+    while(1) {
+        taskENTER_CRITICAL();
+        i2c_trans_t *trans = q->queue;
+        if(trans) {
+            q->queue = trans->next;
+            trans->queued = false;
+        }
+        taskEXIT_CRITICAL();
+        if(!trans) {
+            xSemaphoreTake(q->queue_sem, portMAX_DELAY);
+            continue;
+        }
+
+        trans->result = i2c_bus_transfer(q->bus, trans->addr, trans->wbuf, trans->wlen,
+                                         trans->rbuf, trans->rlen);
+        if(trans->callback)
+            trans->callback(trans);
+        /* A resubmitted transaction completes when it runs again. Once
+           done is set the submitter may reuse trans, so don't read it
+           after that. */
+        if(trans->queued)
+            continue;
+        xSemaphoreHandle sem = trans->done_sem;
+        trans->done = true;
+        if(sem)
+            xSemaphoreGive(sem);
+    }
+}
+
+int i2c_queue_init(i2c_queue_t *q, i2c_bus_t *bus)
+{
+    q->bus = bus;
+    q->queue = NULL;
+    vSemaphoreCreateBinary(q->queue_sem);
+    if(!q->queue_sem)
+        return -ENOMEM;
+    xSemaphoreTake(q->queue_sem, 0);
+    if(xTaskCreate(i2c_queue_task, (signed char *)"i2c", I2C_QUEUE_TASK_STACK_SIZE,
+                   q, I2C_QUEUE_TASK_PRIORITY, NULL) != pdPASS) {
+        vSemaphoreDelete(q->queue_sem);
+        return -ENOMEM;
+    }
+    return 0;
+}
+
+int i2c_queue_submit(i2c_queue_t *q, i2c_trans_t *trans)
+{
+    taskENTER_CRITICAL();
+    if(trans->queued) {
+        taskEXIT_CRITICAL();
+        return -EBUSY;
+    }
+    trans->done = false;
+    trans->queued = true;
+    i2c_trans_t **p = &q->queue;
+    while(*p && (*p)->priority >= trans->priority)
+        p = &(*p)->next;
+    trans->next = *p;
+    *p = trans;
+    taskEXIT_CRITICAL();
+    xSemaphoreGive(q->queue_sem);
+    return 0;
+}
+
+int i2c_queue_transfer(i2c_queue_t *q, i2c_trans_t *trans, xSemaphoreHandle sem,
+                       portTickType timeout)
+{
+    /* Clear a give left over from an earlier timed out transaction */
+    xSemaphoreTake(sem, 0);
+    if(trans->queued)
+        return -EBUSY;
+    trans->done_sem = sem;
+    i2c_queue_submit(q, trans);
+    if(xSemaphoreTake(sem, timeout) != pdTRUE)
+        return -ETIMEDOUT;
+    return trans->result;
+}
@@ -0,0 +1,101 @@
+/* i2c_queue.h
+ *
+ * I2C transaction service: one task owns each bus and carries out
+ * queued transactions, so any number of device drivers can share the
+ * bus without locking or knowing about each other.
+ *
+ * A transaction is a descriptor (write some bytes, then read some
+ * bytes, from one slave address) which the caller fills in and keeps
+ * valid until it completes. Transactions run in priority order, and
+ * in order of submission within a priority. The bus task works through
+ * everything queued before it blocks again, so a burst of submissions
+ * goes out back-to-back.
+ *
+ * Completion is reported by any combination of a callback (called
+ * from the bus task, which may submit follow-up transactions or
+ * resubmit the same one), trans->done and a semaphore given by the bus
+ * task. They happen in that order, so once done is set the bus task
+ * has finished with the descriptor. If the callback resubmits it, done
+ * and the semaphore wait for the resubmitted transaction instead.
+ *
+ * Once a bus has a queue, only use it through the queue.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _I2C_QUEUE_H
+#define _I2C_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+#include <i2c/i2c.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#ifndef I2C_QUEUE_TASK_PRIORITY
+#define I2C_QUEUE_TASK_PRIORITY (configMAX_PRIORITIES - 3)
+#endif
+#ifndef I2C_QUEUE_TASK_STACK_SIZE
+#define I2C_QUEUE_TASK_STACK_SIZE 256
+#endif
+
+struct i2c_trans;
+typedef void (*i2c_trans_callback_t)(struct i2c_trans *trans);
+
+/* Queued transaction. The caller fills in the first group of fields,
+   zeroes the rest before first use (an initialiser does that) and must
+   keep the structure (and buffers) valid until it is done. */
+typedef struct i2c_trans {
+    uint8_t addr;                  /* 7 bit slave address */
+    uint8_t priority;              /* higher goes first */
+    const uint8_t *wbuf;
+    size_t wlen;
+    uint8_t *rbuf;
+    size_t rlen;                   /* read after a repeated start */
+    i2c_trans_callback_t callback; /* called from the bus task, may be NULL */
+    void *arg;
+    xSemaphoreHandle done_sem;     /* given when done, may be NULL */
+
+    volatile bool done;
+    int result;                    /* as i2c_bus_transfer(), valid once done */
+    bool queued;
+    struct i2c_trans *next;
+} i2c_trans_t;
+
+/* Service for one bus, allocated by the caller. Fields are private. */
+typedef struct {
+    i2c_bus_t *bus;
+    i2c_trans_t *queue;            /* sorted by priority, FIFO within one */
+    xSemaphoreHandle queue_sem;    /* given when the queue becomes non-empty */
+} i2c_queue_t;
+
+/* Start the bus task for an initialised bus. Call from task context.
+   Returns 0, or -ENOMEM if the task or semaphore can't be created. */
+int i2c_queue_init(i2c_queue_t *q, i2c_bus_t *bus);
+
+/* Queue a transaction. Can be called from any task, or from a
+   transaction callback. Returns 0, or -EBUSY if the transaction is
+   already queued (e.g. still waiting after i2c_queue_transfer() timed
+   out), in which case it is left where it is. */
+int i2c_queue_submit(i2c_queue_t *q, i2c_trans_t *trans);
+
+/* Submit a transaction and wait for it, using 'sem' (a binary
+   semaphore owned by the caller, normally one per driver) to block.
+   Returns the transaction result, -EBUSY if it is already queued, or
+   -ETIMEDOUT if it didn't complete in time (in which case it is still
+   queued, and must stay valid until done is set). */
+int i2c_queue_transfer(i2c_queue_t *q, i2c_trans_t *trans, xSemaphoreHandle sem,
+                       portTickType timeout);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
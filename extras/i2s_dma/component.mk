@@ -0,0 +1,8 @@
+# Component makefile for extras/i2s_dma
+
+INC_DIRS += $(i2s_dma_ROOT)
+
+# args for passing into compile rule generation
+i2s_dma_SRC_DIR =  $(i2s_dma_ROOT)
+
+$(eval $(call component_compile_rules,i2s_dma))
\ No newline at end of file
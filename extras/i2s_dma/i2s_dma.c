@@ -0,0 +1,294 @@
+/* I2S output and input driven by the SLC DMA engine.
+ *
+ * See i2s_dma.h for usage.
+ *
+ * The SLC names its links from the point of view of an SDIO host: the
+ * "RX" link moves data from memory to the I2S transmitter and the "TX"
+ * link moves data from the I2S receiver to memory.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <esp/i2s_regs.h>
+#include <esp/slc.h>
+#include <esp/iomux.h>
+#include <esp/interrupts.h>
+#include <common_macros.h>
+#include "sdk_internal.h"
+#include "i2s_dma.h"
+
+/* Audio clock output of the PLL, on the internal analog I2C bus */
+#define I2C_BBPLL                   0x67
+#define I2C_BBPLL_HOSTID            4
+#define I2C_BBPLL_EN_AUDIO_CLOCK    4
+#define I2C_BBPLL_EN_AUDIO_CLOCK_MSB 7
+#define I2C_BBPLL_EN_AUDIO_CLOCK_LSB 7
+
+#define I2S_FUNC 1
+
+typedef struct {
+    struct SLCDescriptor *desc;
+    uint32_t *buf;
+} i2s_chain_t;
+
+static struct {
+    bool initialised;
+    i2s_dma_config_t config;
+    i2s_chain_t tx;
+    i2s_chain_t rx;
+    struct SLCDescriptor *out;    /* first output descriptor, if any */
+    i2s_dma_eof_callback_t eof_callback;
+} i2s;
+
+/* The SLC expects both links to point at a valid descriptor even when
+   only one direction is in use */
+static uint32_t dummy_buf;
+static struct SLCDescriptor dummy_desc;
+
+i2s_clock_div_t i2s_dma_clock_div(uint32_t bit_freq)
+{
+    i2s_clock_div_t best = { 63, 63 };
+    uint32_t best_err = UINT32_MAX;
+
+    if (!bit_freq)
+        return best;
+    for (uint32_t bclk = 2; bclk < 64; bclk++) {
+        uint32_t clkm = (I2S_DMA_BASE_FREQ / bclk + bit_freq / 2) / bit_freq;
+        if (clkm < 2)
+            clkm = 2;
+        else if (clkm > 63)
+            clkm = 63;
+        uint32_t freq = I2S_DMA_BASE_FREQ / bclk / clkm;
+        uint32_t err = freq > bit_freq ? freq - bit_freq : bit_freq - freq;
+        if (err < best_err) {
+            best_err = err;
+            best.clkm_div = clkm;
+            best.bclk_div = bclk;
+        }
+    }
+    return best;
+}
+
+static void IRAM i2s_dma_isr(void)
+{
+    uint32_t status = SLC.INT_STATUS;
+    SLC.INT_CLEAR = 0xffffffff;
+
+    if (status & SLC_INT_STATUS_RX_EOF) {
+        /* An output buffer has been played */
+        struct SLCDescriptor *desc = (struct SLCDescriptor *)SLC.RX_EOF_DESCRIPTOR_ADDR;
+        if (i2s.eof_callback)
+            i2s.eof_callback(desc, i2s.config.arg);
+        else
+            i2s.config.tx_callback((uint32_t *)desc->buf_ptr, i2s.config.buf_size, i2s.config.arg);
+    }
+    if (status & SLC_INT_STATUS_TX_EOF) {
+        /* An input buffer has been filled */
+        struct SLCDescriptor *desc = (struct SLCDescriptor *)SLC.TX_EOF_DESCRIPTOR_ADDR;
+        i2s.config.rx_callback((uint32_t *)desc->buf_ptr, i2s.config.buf_size, i2s.config.arg);
+        desc->flags |= SLC_DESCRIPTOR_FLAGS_OWNER;
+    }
+}
+
+static void free_chain(i2s_chain_t *chain)
+{
+    free(chain->desc);
+    free(chain->buf);
+    chain->desc = NULL;
+    chain->buf = NULL;
+}
+
+static int alloc_chain(i2s_chain_t *chain, uint8_t count, uint16_t size)
+{
+    chain->desc = malloc(count * sizeof(struct SLCDescriptor));
+    chain->buf = malloc(count * size);
+    if (!chain->desc || !chain->buf) {
+        free_chain(chain);
+        return -ENOMEM;
+    }
+    memset(chain->buf, 0, count * size);
+    for (uint8_t i = 0; i < count; i++) {
+        chain->desc[i].flags = SLC_DESCRIPTOR_FLAGS(size, size, 0, 1, 1);
+        chain->desc[i].buf_ptr = (uint32_t)chain->buf + i * size;
+        chain->desc[i].next_link_ptr = (uint32_t)&chain->desc[(i + 1) % count];
+    }
+    return 0;
+}
+
+static void set_pins(bool tx, bool rx)
+{
+    if (tx) {
+        iomux_set_function(gpio_to_iomux(3), I2S_FUNC);
+        iomux_set_function(gpio_to_iomux(15), I2S_FUNC);
+        iomux_set_function(gpio_to_iomux(2), I2S_FUNC);
+    }
+    if (rx) {
+        iomux_set_function(gpio_to_iomux(12), I2S_FUNC);
+        iomux_set_function(gpio_to_iomux(13), I2S_FUNC);
+        iomux_set_function(gpio_to_iomux(14), I2S_FUNC);
+    }
+}
+
+static bool clock_div_valid(i2s_clock_div_t div)
+{
+    return div.clkm_div >= 2 && div.clkm_div <= 63 && div.bclk_div >= 2 && div.bclk_div <= 63;
+}
+
+static void hw_init(bool tx, bool rx, i2s_clock_div_t clock_div, uint8_t bits, uint16_t rx_buf_size)
+{
+    dummy_desc.flags = SLC_DESCRIPTOR_FLAGS(sizeof(dummy_buf), sizeof(dummy_buf), 0, 1, 1);
+    dummy_desc.buf_ptr = (uint32_t)&dummy_buf;
+    dummy_desc.next_link_ptr = (uint32_t)&dummy_desc;
+
+    set_pins(tx, rx);
+    sdk_rom_i2c_writeReg_Mask(I2C_BBPLL, I2C_BBPLL_HOSTID, I2C_BBPLL_EN_AUDIO_CLOCK,
+                              I2C_BBPLL_EN_AUDIO_CLOCK_MSB, I2C_BBPLL_EN_AUDIO_CLOCK_LSB, 1);
+
+    /* I2S: master, standard (Philips) framing, fed by DMA */
+    I2S.CONF |= I2S_CONF_RESET_MASK;
+    I2S.CONF &= ~I2S_CONF_RESET_MASK;
+    I2S.INT_CLEAR = 0x3f;
+    I2S.INT_ENABLE = 0;
+    I2S.FIFO_CONF = (I2S.FIFO_CONF & ~(FIELD_MASK(I2S_FIFO_CONF_RX_FIFO_MOD)
+                                       | FIELD_MASK(I2S_FIFO_CONF_TX_FIFO_MOD)))
+        | I2S_FIFO_CONF_DESCRIPTOR_ENABLE;
+    I2S.CONF_CHANNELS = 0;
+    I2S.CONF = (I2S.CONF & ~(FIELD_MASK(I2S_CONF_BCK_DIV) | FIELD_MASK(I2S_CONF_CLKM_DIV)
+                             | FIELD_MASK(I2S_CONF_BITS_MOD)
+                             | I2S_CONF_RX_SLAVE_MOD | I2S_CONF_TX_SLAVE_MOD))
+        | I2S_CONF_RIGHT_FIRST | I2S_CONF_MSB_RIGHT
+        | I2S_CONF_RX_MSB_SHIFT | I2S_CONF_TX_MSB_SHIFT
+        | VAL2FIELD_M(I2S_CONF_BCK_DIV, clock_div.bclk_div)
+        | VAL2FIELD_M(I2S_CONF_CLKM_DIV, clock_div.clkm_div)
+        | VAL2FIELD_M(I2S_CONF_BITS_MOD, bits - 16);
+    if (rx)
+        I2S.RX_EOF_NUM = rx_buf_size / 4;
+
+    /* SLC: descriptor mode, one EOF interrupt per buffer */
+    SLC.INT_ENABLE = 0;
+    SLC.INT_CLEAR = 0xffffffff;
+    SLC.CONF0 = SET_FIELD(SLC.CONF0, SLC_CONF0_MODE, 1);
+    SLC.RX_DESCRIPTOR_CONF = (SLC.RX_DESCRIPTOR_CONF
+                              & ~(SLC_RX_DESCRIPTOR_CONF_RX_FILL_ENABLE
+                                  | SLC_RX_DESCRIPTOR_CONF_RX_EOF_MODE
+                                  | SLC_RX_DESCRIPTOR_CONF_RX_FILL_MODE))
+        | SLC_RX_DESCRIPTOR_CONF_INFOR_NO_REPLACE | SLC_RX_DESCRIPTOR_CONF_TOKEN_NO_REPLACE;
+}
+
+int i2s_dma_init(const i2s_dma_config_t *config)
+{
+    if (i2s.initialised)
+        return -EBUSY;
+    if ((!config->tx && !config->rx) || (config->rx && !config->rx_callback)
+        || config->buf_count < 2 || !config->buf_size || (config->buf_size & 3)
+        || config->buf_size > I2S_DMA_MAX_BUF_SIZE
+        || config->bits < 16 || config->bits > 24
+        || !clock_div_valid(config->clock_div))
+        return -EINVAL;
+
+    i2s.config = *config;
+    if (config->tx && alloc_chain(&i2s.tx, config->buf_count, config->buf_size))
+        return -ENOMEM;
+    if (config->rx && alloc_chain(&i2s.rx, config->buf_count, config->buf_size)) {
+        free_chain(&i2s.tx);
+        return -ENOMEM;
+    }
+    if (config->tx && config->tx_callback) {
+        for (uint8_t i = 0; i < config->buf_count; i++)
+            config->tx_callback(i2s.tx.buf + i * config->buf_size / 4, config->buf_size, config->arg);
+    }
+    i2s.out = i2s.tx.desc;
+    i2s.eof_callback = NULL;
+    hw_init(config->tx, config->rx, config->clock_div, config->bits, config->buf_size);
+    _xt_isr_attach(INUM_SLC, i2s_dma_isr);
+    i2s.initialised = true;
+    return 0;
+}
+
+int i2s_dma_init_chain(i2s_clock_div_t clock_div, uint8_t bits, struct SLCDescriptor *chain,
+                       i2s_dma_eof_callback_t callback, void *arg)
+{
+    if (i2s.initialised)
+        return -EBUSY;
+    if (!chain || bits < 16 || bits > 24 || !clock_div_valid(clock_div))
+        return -EINVAL;
+
+    memset(&i2s.config, 0, sizeof(i2s.config));
+    i2s.config.tx = true;
+    i2s.config.clock_div = clock_div;
+    i2s.config.bits = bits;
+    i2s.config.arg = arg;
+    i2s.out = chain;
+    i2s.eof_callback = callback;
+    hw_init(true, false, clock_div, bits, 0);
+    _xt_isr_attach(INUM_SLC, i2s_dma_isr);
+    i2s.initialised = true;
+    return 0;
+}
+
+uint32_t *i2s_dma_tx_buffer(uint8_t index)
+{
+    if (!i2s.tx.buf || index >= i2s.config.buf_count)
+        return NULL;
+    return i2s.tx.buf + index * i2s.config.buf_size / 4;
+}
+
+void i2s_dma_start(void)
+{
+    if (!i2s.initialised)
+        return;
+    i2s_dma_stop();
+
+    for (uint8_t i = 0; i < i2s.config.buf_count && i2s.rx.desc; i++)
+        i2s.rx.desc[i].flags |= SLC_DESCRIPTOR_FLAGS_OWNER;
+
+    SLC.CONF0 |= SLC_CONF0_RX_LINK_RESET | SLC_CONF0_TX_LINK_RESET;
+    SLC.CONF0 &= ~(SLC_CONF0_RX_LINK_RESET | SLC_CONF0_TX_LINK_RESET);
+    I2S.CONF |= I2S_CONF_TX_FIFO_RESET | I2S_CONF_RX_FIFO_RESET;
+    I2S.CONF &= ~(I2S_CONF_TX_FIFO_RESET | I2S_CONF_RX_FIFO_RESET);
+
+    struct SLCDescriptor *out = i2s.out ? i2s.out : &dummy_desc;
+    struct SLCDescriptor *in = i2s.rx.desc ? i2s.rx.desc : &dummy_desc;
+    SLC.RX_LINK = SET_FIELD_M(SLC.RX_LINK & ~SLC_RX_LINK_STOP, SLC_RX_LINK_DESCRIPTOR_ADDR, (uint32_t)out);
+    SLC.TX_LINK = SET_FIELD_M(SLC.TX_LINK & ~SLC_TX_LINK_STOP, SLC_TX_LINK_DESCRIPTOR_ADDR, (uint32_t)in);
+
+    SLC.INT_CLEAR = 0xffffffff;
+    SLC.INT_ENABLE = (i2s.eof_callback || (i2s.out && i2s.config.tx_callback) ? SLC_INT_ENABLE_RX_EOF : 0)
+        | (i2s.rx.desc ? SLC_INT_ENABLE_TX_EOF : 0);
+    if (SLC.INT_ENABLE)
+        _xt_isr_unmask(BIT(INUM_SLC));
+
+    /* The "TX" (input) link must run even if only output is used */
+    SLC.TX_LINK |= SLC_TX_LINK_START;
+    if (i2s.out)
+        SLC.RX_LINK |= SLC_RX_LINK_START;
+    I2S.CONF |= (i2s.out ? I2S_CONF_TX_START : 0) | (i2s.rx.desc ? I2S_CONF_RX_START : 0);
+}
+
+void i2s_dma_stop(void)
+{
+    if (!i2s.initialised)
+        return;
+    _xt_isr_mask(BIT(INUM_SLC));
+    I2S.CONF &= ~(I2S_CONF_TX_START | I2S_CONF_RX_START);
+    SLC.RX_LINK |= SLC_RX_LINK_STOP;
+    SLC.TX_LINK |= SLC_TX_LINK_STOP;
+    SLC.INT_ENABLE = 0;
+    SLC.INT_CLEAR = 0xffffffff;
+}
+
+void i2s_dma_deinit(void)
+{
+    if (!i2s.initialised)
+        return;
+    i2s_dma_stop();
+    free_chain(&i2s.tx);
+    free_chain(&i2s.rx);
+    i2s.out = NULL;
+    i2s.eof_callback = NULL;
+    i2s.initialised = false;
+}
@@ -0,0 +1,116 @@
+/* i2s_dma.h
+ *
+ * I2S output and input driven by the SLC DMA engine.
+ *
+ * Data is streamed from (or to) a circular chain of DMA descriptors,
+ * each pointing at one buffer. The hardware moves every sample, the CPU
+ * only runs once per buffer: as each output buffer finishes playing it
+ * is passed to tx_callback to be refilled, and as each input buffer is
+ * filled it is passed to rx_callback. With two buffers this is classic
+ * double buffering; more buffers give the callbacks more slack.
+ *
+ * Without a tx_callback the output buffers are played over and over
+ * unchanged, so a waveform or bit pattern loaded once with
+ * i2s_dma_tx_buffer() is generated continuously with no CPU work.
+ *
+ * Pins (fixed by the hardware):
+ *   output: GPIO3 data, GPIO15 bit clock, GPIO2 word select
+ *   input:  GPIO12 data, GPIO13 bit clock, GPIO14 word select
+ *
+ * GPIO3 is the UART0 RX pin, and GPIO15 must be low at boot.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _I2S_DMA_H
+#define _I2S_DMA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <esp/slc.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/* The I2S clock is derived from the 160MHz PLL, divided by the master
+   clock divider and the bit clock divider */
+#define I2S_DMA_BASE_FREQ 160000000
+
+/* Largest buffer one DMA descriptor can hold */
+#define I2S_DMA_MAX_BUF_SIZE 4092
+
+typedef struct {
+    uint8_t clkm_div;       /* 2..63 */
+    uint8_t bclk_div;       /* 2..63 */
+} i2s_clock_div_t;
+
+/* Called from the SLC interrupt with a buffer to refill (output) or to
+   read (input). len is in bytes. */
+typedef void (*i2s_dma_callback_t)(uint32_t *buf, size_t len, void *arg);
+
+typedef struct {
+    bool tx;                /* enable output */
+    bool rx;                /* enable input */
+    i2s_clock_div_t clock_div;
+    uint8_t bits;           /* bits per channel, 16..24 */
+    uint8_t buf_count;      /* buffers per direction, at least 2 */
+    uint16_t buf_size;      /* bytes per buffer, multiple of 4 */
+    i2s_dma_callback_t tx_callback; /* may be NULL to loop the buffers */
+    i2s_dma_callback_t rx_callback;
+    void *arg;              /* passed to the callbacks */
+} i2s_dma_config_t;
+
+/* Called from the SLC interrupt with each output descriptor marked EOF
+   when it has been played, for i2s_dma_init_chain(). */
+typedef void (*i2s_dma_eof_callback_t)(struct SLCDescriptor *desc, void *arg);
+
+/* Find the dividers giving the nearest bit clock to 'bit_freq' Hz. */
+i2s_clock_div_t i2s_dma_clock_div(uint32_t bit_freq);
+
+/* Bit clock, in Hz, generated by a pair of dividers. */
+static inline uint32_t i2s_dma_bit_freq(i2s_clock_div_t div)
+{
+    return I2S_DMA_BASE_FREQ / div.clkm_div / div.bclk_div;
+}
+
+/* Dividers for a stereo sample rate (frames per second). */
+static inline i2s_clock_div_t i2s_dma_sample_rate_div(uint32_t rate, uint8_t bits)
+{
+    return i2s_dma_clock_div(rate * bits * 2);
+}
+
+/* Allocate the buffers and descriptor chains and configure the pins,
+   I2S and DMA. Output buffers are filled by tx_callback if there is
+   one, otherwise zeroed. Nothing is sent or received until
+   i2s_dma_start(). Returns 0 or -errno. */
+int i2s_dma_init(const i2s_dma_config_t *config);
+
+/* Output only, from a descriptor chain built by the caller (see
+   esp/slc.h), for data which doesn't fit the equal sized buffer ring of
+   i2s_dma_init(). The chain may loop or be relinked while running;
+   'callback' may be NULL. Stop and free with i2s_dma_deinit() as usual,
+   the chain itself belongs to the caller. */
+int i2s_dma_init_chain(i2s_clock_div_t clock_div, uint8_t bits, struct SLCDescriptor *chain,
+                       i2s_dma_eof_callback_t callback, void *arg);
+
+/* Output buffer 'index' (0 .. buf_count-1), for loading a pattern
+   before starting or while it is looping. NULL if out of range. */
+uint32_t *i2s_dma_tx_buffer(uint8_t index);
+
+/* Start (or restart) streaming from the first buffer. */
+void i2s_dma_start(void);
+
+/* Stop streaming. The current buffers are kept. */
+void i2s_dma_stop(void);
+
+/* Stop and free everything allocated by i2s_dma_init(). */
+void i2s_dma_deinit(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
@@ -2,91 +2,200 @@
 #include "string.h"
 #include "task.h"
 #include "esp/gpio.h"
+#include "esp/clocks.h"
+#include "xtensa_ops.h"
+#include "checksum.h"
 
 #define ONEWIRE_SELECT_ROM 0x55
 #define ONEWIRE_SKIP_ROM   0xcc
 #define ONEWIRE_SEARCH     0xf0
+#define ONEWIRE_OD_SKIP_ROM   0x3c
+#define ONEWIRE_OD_SELECT_ROM 0x69
+
+// All slots are timed from CCOUNT. Times below are in 80MHz cycles and
+// are doubled when the CPU runs at 160MHz.
+#define NS(ns) ((ns) * 80 / 1000)
+
+// Slot timings, the recommended values from Maxim application note 126.
+typedef struct {
+    uint32_t a;   // write 1 / read: low time
+    uint32_t b;   // write 1: rest of the slot
+    uint32_t c;   // write 0: low time
+    uint32_t d;   // write 0: recovery
+    uint32_t e;   // read: release to sample
+    uint32_t f;   // read: rest of the slot
+    uint32_t h;   // reset low time
+    uint32_t i;   // reset release to presence sample
+    uint32_t j;   // presence sample to end of reset
+    uint32_t slot_wait;   // for the bus to come high before a slot
+    uint32_t reset_wait;  // and before a reset
+} onewire_timing_t;
+
+// Interrupts are masked from the falling edge of each slot until the
+// line is released (or sampled, for a read), and only run between
+// slots and during recovery. A 0 held low past its maximum (120us, or
+// 16us at overdrive) isn't a valid 0, and past 480us it's a reset.
+
+static const onewire_timing_t standard_timing = {
+    NS(6000), NS(64000), NS(60000), NS(10000), NS(9000), NS(55000),
+    NS(480000), NS(70000), NS(410000),
+    NS(10000), NS(250000),
+};
+
+static const onewire_timing_t overdrive_timing = {
+    NS(1000), NS(7500), NS(7500), NS(2500), NS(1000), NS(7000),
+    NS(70000), NS(8500), NS(40000),
+    NS(10000), NS(250000),
+};
+
+// GPIO mask of buses running at overdrive speed
+static uint32_t overdrive_pins;
+
+static inline uint32_t _ccount(void) {
+    uint32_t r;
+    RSR(r, ccount);
+    return r;
+}
+
+static inline void _wait_until(uint32_t when) {
+    while ((int32_t)(_ccount() - when) < 0)
+        ;
+}
+
+// Timings for the buses in `mask`, scaled for the current CPU clock.
+// Buses handled together must all be at the same speed.
+static void _get_timing(uint32_t mask, onewire_timing_t *t) {
+    *t = (overdrive_pins & mask) ? overdrive_timing : standard_timing;
+    if (cpu_freq_get() == 160) {
+        uint32_t *v = (uint32_t *)t;
+        for (int i = 0; i < sizeof(*t) / sizeof(uint32_t); i++)
+            v[i] <<= 1;
+    }
+}
+
+static inline uint32_t _pin_mask(int pin) {
+    return (pin >= 0 && pin < 16) ? BIT(pin) : 0;
+}
 
-// Waits up to `max_wait` microseconds for the specified pin to go high.
-// Returns true if successful, false if the bus never comes high (likely
+// Waits up to `cycles` for all the buses in `mask` to go high.
+// Returns the mask of buses which are high (any others are likely
 // shorted).
-static inline bool _onewire_wait_for_bus(int pin, int max_wait) {
-    bool state;
-    for (int i = 0; i < ((max_wait + 4) / 5); i++) {
-        if (gpio_read(pin)) break;
-        sdk_os_delay_us(5);
+static uint32_t _wait_for_bus(uint32_t mask, uint32_t cycles) {
+    uint32_t start = _ccount();
+    while ((GPIO.IN & mask) != mask) {
+        if (_ccount() - start > cycles)
+            break;
     }
-    state = gpio_read(pin);
-    // Wait an extra 1us to make sure the devices have an adequate recovery
-    // time before we drive things low again.
-    sdk_os_delay_us(1);
-    return state;
+    return GPIO.IN & mask;
 }
 
-// Perform the onewire reset function.  We will wait up to 250uS for
-// the bus to come high, if it doesn't then it is broken or shorted
-// and we return false;
-//
-// Returns true if a device asserted a presence pulse, false otherwise.
-//
-bool onewire_reset(int pin) {
-    bool r;
+// Reset all the buses in `mask` together. Returns the mask of buses on
+// which at least one device sent a presence pulse.
+static uint32_t _reset_slots(uint32_t mask, const onewire_timing_t *t) {
+    uint32_t presence, start;
 
-    gpio_enable(pin, GPIO_OUT_OPEN_DRAIN);
-    gpio_write(pin, 1);
+    GPIO.OUT_SET = mask;
     // wait until the wire is high... just in case
-    if (!_onewire_wait_for_bus(pin, 250)) return false;
+    mask = _wait_for_bus(mask, t->reset_wait);
+    if (!mask) return 0;
+
+    // A longer standard speed reset is fine, so interrupts can run. An
+    // overdrive reset has to stay under 80us, so they're masked for all
+    // of it.
+    bool overdrive = overdrive_pins & mask;
+    if (overdrive)
+        taskENTER_CRITICAL();
+    GPIO.OUT_CLEAR = mask;
+    start = _ccount();
+    _wait_until(start + t->h);
+
+    if (!overdrive)
+        taskENTER_CRITICAL();
+    GPIO.OUT_SET = mask;  // allow it to float
+    start = _ccount();
+    _wait_until(start + t->i);
+    presence = ~GPIO.IN & mask;
+    taskEXIT_CRITICAL();
+
+    // Wait for all devices to finish pulling the bus low
+    _wait_until(start + t->i + t->j);
+    return presence & _wait_for_bus(mask, 0);
+}
 
-    gpio_write(pin, 0);
-    sdk_os_delay_us(480);
+// One write slot on each bus in `mask`, writing 1 on the buses in
+// `ones` and 0 on the rest
+static void _write_slots(uint32_t mask, uint32_t ones, const onewire_timing_t *t) {
+    uint32_t zeros = mask & ~ones;
+    uint32_t start, released = 0;
 
     taskENTER_CRITICAL();
-    gpio_write(pin, 1); // allow it to float
-    sdk_os_delay_us(70);
-    r = !gpio_read(pin);
+    GPIO.OUT_CLEAR = mask;  // drive output low
+    start = _ccount();
+    _wait_until(start + t->a);
+    GPIO.OUT_SET = ones;    // allow output high
+    if (zeros) {
+        _wait_until(start + t->c);
+        GPIO.OUT_SET = zeros;
+        released = _ccount();
+    }
     taskEXIT_CRITICAL();
 
-    // Wait for all devices to finish pulling the bus low before returning
-    if (!_onewire_wait_for_bus(pin, 410)) return false;
+    // The end of the slot, and at least the recovery time after the
+    // release
+    _wait_until(start + t->a + t->b);
+    if (zeros)
+        _wait_until(released + t->d);
+}
+
+// One read slot on each bus in `mask`. Returns the mask of buses which
+// read as 1.
+static uint32_t _read_slots(uint32_t mask, const onewire_timing_t *t) {
+    uint32_t r, start;
+
+    taskENTER_CRITICAL();
+    GPIO.OUT_CLEAR = mask;
+    start = _ccount();
+    _wait_until(start + t->a);
+    GPIO.OUT_SET = mask;  // let pin float, pull up will raise
+    _wait_until(start + t->a + t->e);
+    r = GPIO.IN & mask;   // Must sample within 15us of start
+    taskEXIT_CRITICAL();
+    _wait_until(start + t->a + t->e + t->f);
 
     return r;
 }
 
-static bool _onewire_write_bit(int pin, bool v) {
-    if (!_onewire_wait_for_bus(pin, 10)) return false;
-    if (v) {
-        taskENTER_CRITICAL();
-        gpio_write(pin, 0);  // drive output low
-        sdk_os_delay_us(10);
-        gpio_write(pin, 1);  // allow output high
-        taskEXIT_CRITICAL();
-        sdk_os_delay_us(55);
-    } else {
-        taskENTER_CRITICAL();
-        gpio_write(pin, 0);  // drive output low
-        sdk_os_delay_us(65);
-        gpio_write(pin, 1); // allow output high
-        taskEXIT_CRITICAL();
+static bool _write_byte(uint32_t mask, uint8_t v, const onewire_timing_t *t) {
+    for (uint8_t bitMask = 0x01; bitMask; bitMask <<= 1) {
+        if (_wait_for_bus(mask, t->slot_wait) != mask) return false;
+        _write_slots(mask, (v & bitMask) ? mask : 0, t);
     }
-    sdk_os_delay_us(1);
-
     return true;
 }
 
-static int _onewire_read_bit(int pin) {
-    int r;
+static int _read_byte(uint32_t mask, const onewire_timing_t *t) {
+    int r = 0;
+    for (uint8_t bitMask = 0x01; bitMask; bitMask <<= 1) {
+        if (_wait_for_bus(mask, t->slot_wait) != mask) return -1;
+        if (_read_slots(mask, t)) r |= bitMask;
+    }
+    return r;
+}
 
-    if (!_onewire_wait_for_bus(pin, 10)) return -1;
-    taskENTER_CRITICAL();
-    gpio_write(pin, 0);
-    sdk_os_delay_us(2);
-    gpio_write(pin, 1);  // let pin float, pull up will raise
-    sdk_os_delay_us(11);
-    r = gpio_read(pin);  // Must sample within 15us of start
-    taskEXIT_CRITICAL();
-    sdk_os_delay_us(48);
+// Perform the onewire reset function.  We will wait up to 250uS for
+// the bus to come high, if it doesn't then it is broken or shorted
+// and we return false;
+//
+// Returns true if a device asserted a presence pulse, false otherwise.
+//
+bool onewire_reset(int pin) {
+    uint32_t mask = _pin_mask(pin);
+    onewire_timing_t t;
 
-    return r;
+    if (!mask) return false;
+    gpio_enable(pin, GPIO_OUT_OPEN_DRAIN);
+    _get_timing(mask, &t);
+    return _reset_slots(mask, &t) != 0;
 }
 
 // Write a byte. The writing code uses open-drain mode and expects the pullup
@@ -95,21 +204,17 @@ static int _onewire_read_bit(int pin) {
 // onewire_power() after this is complete to actively drive the line high.
 //
 bool onewire_write(int pin, uint8_t v) {
-    uint8_t bitMask;
-
-    for (bitMask = 0x01; bitMask; bitMask <<= 1) {
-        if (!_onewire_write_bit(pin, (bitMask & v))) {
-            return false;
-        }
-    }
-    return true;
+    return onewire_write_bytes(pin, &v, 1);
 }
 
 bool onewire_write_bytes(int pin, const uint8_t *buf, size_t count) {
-    size_t i;
+    uint32_t mask = _pin_mask(pin);
+    onewire_timing_t t;
 
-    for (i = 0 ; i < count ; i++) {
-        if (!onewire_write(pin, buf[i])) {
+    if (!mask) return false;
+    _get_timing(mask, &t);
+    for (size_t i = 0; i < count; i++) {
+        if (!_write_byte(mask, buf[i], &t)) {
             return false;
         }
     }
@@ -119,27 +224,19 @@ bool onewire_write_bytes(int pin, const uint8_t *buf, size_t count) {
 // Read a byte
 //
 int onewire_read(int pin) {
-    uint8_t bitMask;
-    int r = 0;
-    int bit;
-
-    for (bitMask = 0x01; bitMask; bitMask <<= 1) {
-        bit = _onewire_read_bit(pin);
-        if (bit < 0) {
-            return -1;
-        } else if (bit) {
-            r |= bitMask;
-        }
-    }
-    return r;
+    uint8_t v;
+    return onewire_read_bytes(pin, &v, 1) ? v : -1;
 }
 
 bool onewire_read_bytes(int pin, uint8_t *buf, size_t count) {
-    size_t i;
+    uint32_t mask = _pin_mask(pin);
+    onewire_timing_t t;
     int b;
 
-    for (i = 0 ; i < count ; i++) {
-        b = onewire_read(pin);
+    if (!mask) return false;
+    _get_timing(mask, &t);
+    for (size_t i = 0; i < count; i++) {
+        b = _read_byte(mask, &t);
         if (b < 0) return false;
         buf[i] = b;
     }
@@ -147,30 +244,63 @@ bool onewire_read_bytes(int pin, uint8_t *buf, size_t count) {
 }
 
 bool onewire_select(int pin, onewire_addr_t addr) {
-    uint8_t i;
-
-    if (!onewire_write(pin, ONEWIRE_SELECT_ROM)) {
-        return false;
-    }
+    uint8_t buf[9];
 
-    for (i = 0; i < 8; i++) {
-        if (!onewire_write(pin, addr & 0xff)) {
-            return false;
-        }
+    buf[0] = ONEWIRE_SELECT_ROM;
+    for (int i = 1; i < 9; i++) {
+        buf[i] = addr & 0xff;
         addr >>= 8;
     }
-
-    return true;
+    return onewire_write_bytes(pin, buf, sizeof(buf));
 }
 
 bool onewire_skip_rom(int pin) {
     return onewire_write(pin, ONEWIRE_SKIP_ROM);
 }
 
+void onewire_set_overdrive(int pin, bool enable) {
+    if (enable)
+        overdrive_pins |= _pin_mask(pin);
+    else
+        overdrive_pins &= ~_pin_mask(pin);
+}
+
+bool onewire_is_overdrive(int pin) {
+    return overdrive_pins & _pin_mask(pin);
+}
+
+bool onewire_overdrive_skip_rom(int pin) {
+    onewire_set_overdrive(pin, false);
+    if (!onewire_write(pin, ONEWIRE_OD_SKIP_ROM))
+        return false;
+    onewire_set_overdrive(pin, true);
+    return true;
+}
+
+bool onewire_overdrive_select(int pin, onewire_addr_t addr) {
+    uint8_t buf[8];
+
+    onewire_set_overdrive(pin, false);
+    if (!onewire_write(pin, ONEWIRE_OD_SELECT_ROM))
+        return false;
+    // The ROM code itself is sent at overdrive speed
+    onewire_set_overdrive(pin, true);
+    for (int i = 0; i < 8; i++) {
+        buf[i] = addr & 0xff;
+        addr >>= 8;
+    }
+    return onewire_write_bytes(pin, buf, sizeof(buf));
+}
+
 bool onewire_power(int pin) {
     // Make sure the bus is not being held low before driving it high, or we
     // may end up shorting ourselves out.
-    if (!_onewire_wait_for_bus(pin, 10)) return false;
+    uint32_t mask = _pin_mask(pin);
+    onewire_timing_t t;
+
+    if (!mask) return false;
+    _get_timing(mask, &t);
+    if (!_wait_for_bus(mask, t.slot_wait)) return false;
 
     gpio_enable(pin, GPIO_OUTPUT);
     gpio_write(pin, 1);
@@ -198,62 +328,80 @@ void onewire_search_prefix(onewire_search_t *search, uint8_t family_code) {
     search->last_device_found = false;
 }
 
-// Perform a search. If the next device has been successfully enumerated, its
-// ROM address will be returned.  If there are no devices, no further
-// devices, or something horrible happens in the middle of the
-// enumeration then ONEWIRE_NONE is returned.  Use OneWire::reset_search() to
-// start over.
+onewire_addr_t onewire_search_next(onewire_search_t *search, int pin) {
+    onewire_addr_t addr;
+
+    // After the last device, return ONEWIRE_NONE once and start over
+    if (search->last_device_found) {
+        search->last_discrepancy = 0;
+        search->last_device_found = false;
+        return ONEWIRE_NONE;
+    }
+    onewire_search_next_multi(search, &pin, 1, &addr);
+    return addr;
+}
+
+// Perform a search on several buses at once. If the next device has been
+// successfully enumerated, its ROM address will be returned.  If there are
+// no devices, no further devices, or something horrible happens in the
+// middle of the enumeration then ONEWIRE_NONE is returned.  Use
+// onewire_search_start() to start over.
 //
-// --- Replaced by the one from the Dallas Semiconductor web site ---
+// --- Based on the one from the Dallas Semiconductor web site ---
 //--------------------------------------------------------------------------
 // Perform the 1-Wire Search Algorithm on the 1-Wire bus using the existing
-// search state.
-// Return 1 : device found, ROM number in ROM_NO buffer
-//        0 : device not found, end of search
+// search state. Each bus makes its own choice at every bit, but the slots
+// for all of them run together.
 //
-onewire_addr_t onewire_search_next(onewire_search_t *search, int pin) {
-    //TODO: add more checking for read/write errors
-    uint8_t id_bit_number;
-    uint8_t last_zero, search_result;
-    int rom_byte_number;
-    uint8_t id_bit, cmp_id_bit;
-    onewire_addr_t addr;
-    unsigned char rom_byte_mask;
-    bool search_direction;
-
-    // initialize for search
-    id_bit_number = 1;
-    last_zero = 0;
-    rom_byte_number = 0;
-    rom_byte_mask = 1;
-    search_result = 0;
-   
-    // if the last call was not the last one
-    if (!search->last_device_found) {
-        // 1-Wire reset
-        if (!onewire_reset(pin)) {
-            // reset the search
-            search->last_discrepancy = 0;
-            search->last_device_found = false;
-            return ONEWIRE_NONE;
+int onewire_search_next_multi(onewire_search_t *searches, const int *pins, size_t count,
+                              onewire_addr_t *addrs) {
+    uint8_t last_zero[ONEWIRE_MAX_PARALLEL];
+    uint32_t active = 0, found = 0;
+    onewire_timing_t t;
+    int result = 0;
+
+    if (count > ONEWIRE_MAX_PARALLEL) count = ONEWIRE_MAX_PARALLEL;
+    for (size_t n = 0; n < count; n++) {
+        addrs[n] = ONEWIRE_NONE;
+        last_zero[n] = 0;
+        // if the last call was not the last one
+        if (!searches[n].last_device_found && _pin_mask(pins[n])) {
+            active |= _pin_mask(pins[n]);
+            gpio_enable(pins[n], GPIO_OUT_OPEN_DRAIN);
         }
+    }
+
+    if (active) {
+        _get_timing(active, &t);
 
-        // issue the search command
-        onewire_write(pin, ONEWIRE_SEARCH);
+        // 1-Wire reset, then issue the search command
+        active = _reset_slots(active, &t);
+        if (active && !_write_byte(active, ONEWIRE_SEARCH, &t))
+            active = 0;
 
         // loop to do the search
-        do {
+        for (uint8_t id_bit_number = 1; id_bit_number <= 64 && active; id_bit_number++) {
+            uint8_t rom_byte_number = (id_bit_number - 1) / 8;
+            uint8_t rom_byte_mask = 1 << ((id_bit_number - 1) % 8);
+            uint32_t ones = 0;
+
             // read a bit and its complement
-            id_bit = _onewire_read_bit(pin);
-            cmp_id_bit = _onewire_read_bit(pin);
-
-            // check for no devices on 1-wire
-            if ((id_bit < 0) || (cmp_id_bit < 0)) {
-                // Read error
-                break;
-            } else if ((id_bit == 1) && (cmp_id_bit == 1)) {
-                break;
-            } else {
+            uint32_t id_bits = _read_slots(active, &t);
+            uint32_t cmp_id_bits = _read_slots(active, &t);
+
+            for (size_t n = 0; n < count; n++) {
+                onewire_search_t *search = &searches[n];
+                uint32_t mask = _pin_mask(pins[n]);
+                bool id_bit = id_bits & mask, cmp_id_bit = cmp_id_bits & mask;
+                bool search_direction;
+
+                if (!(active & mask)) continue;
+                // check for no devices on 1-wire
+                if (id_bit && cmp_id_bit) {
+                    active &= ~mask;
+                    continue;
+                }
+
                 // all devices coupled have 0 or 1
                 if (id_bit != cmp_id_bit) {
                     search_direction = id_bit;  // bit write value for search
@@ -269,7 +417,7 @@ onewire_addr_t onewire_search_next(onewire_search_t *search, int pin) {
 
                     // if 0 was picked then record its position in LastZero
                     if (!search_direction) {
-                        last_zero = id_bit_number;
+                        last_zero[n] = id_bit_number;
                     }
                 }
 
@@ -277,119 +425,56 @@ onewire_addr_t onewire_search_next(onewire_search_t *search, int pin) {
                 // with mask rom_byte_mask
                 if (search_direction) {
                     search->rom_no[rom_byte_number] |= rom_byte_mask;
+                    ones |= mask;
                 } else {
                     search->rom_no[rom_byte_number] &= ~rom_byte_mask;
                 }
+            }
 
-                // serial number search direction write bit
-                _onewire_write_bit(pin, search_direction);
-
-                // increment the byte counter id_bit_number
-                // and shift the mask rom_byte_mask
-                id_bit_number++;
-                rom_byte_mask <<= 1;
+            // serial number search direction write bits
+            if (active) _write_slots(active, ones, &t);
+            if (id_bit_number == 64) found = active;
+        }
+    }
 
-                // if the mask is 0 then go to new SerialNum byte rom_byte_number and reset mask
-                if (rom_byte_mask == 0) {
-                    rom_byte_number++;
-                    rom_byte_mask = 1;
-                }
-            }
-        } while (rom_byte_number < 8);  // loop until through all ROM bytes 0-7
+    for (size_t n = 0; n < count; n++) {
+        onewire_search_t *search = &searches[n];
 
+        // buses which are already finished stay that way
+        if (search->last_device_found) continue;
         // if the search was successful then
-        if (!(id_bit_number < 65)) {
-            // search successful so set last_discrepancy,last_device_found,search_result
-            search->last_discrepancy = last_zero;
-
+        if ((found & _pin_mask(pins[n])) && search->rom_no[0]) {
+            // search successful so set last_discrepancy,last_device_found
+            search->last_discrepancy = last_zero[n];
             // check for last device
             if (search->last_discrepancy == 0) {
                 search->last_device_found = true;
             }
-
-            search_result = 1;
-        }
-    }
-
-    // if no device found then reset counters so next 'search' will be like a first
-    if (!search_result || !search->rom_no[0]) {
-        search->last_discrepancy = 0;
-        search->last_device_found = false;
-        return ONEWIRE_NONE;
-    } else {
-        addr = 0;
-        for (rom_byte_number = 7; rom_byte_number >= 0; rom_byte_number--) {
-            addr = (addr << 8) | search->rom_no[rom_byte_number];
+            onewire_addr_t addr = 0;
+            for (int rom_byte_number = 7; rom_byte_number >= 0; rom_byte_number--) {
+                addr = (addr << 8) | search->rom_no[rom_byte_number];
+            }
+            addrs[n] = addr;
+            result++;
+        } else {
+            // if no device found then reset counters so next 'search' will be like a first
+            search->last_discrepancy = 0;
+            search->last_device_found = false;
         }
-        //printf("Ok I found something at %08x%08x...\n", (uint32_t)(addr >> 32), (uint32_t)addr);
     }
-    return addr;
+    return result;
 }
 
 // The 1-Wire CRC scheme is described in Maxim Application Note 27:
 // "Understanding and Using Cyclic Redundancy Checks with Maxim iButton Products"
-//
+// Both CRCs are computed with the table driven versions in core (see
+// checksum.h).
 
-#if ONEWIRE_CRC8_TABLE
-// This table comes from Dallas sample code where it is freely reusable,
-// though Copyright (C) 2000 Dallas Semiconductor Corporation
-static const uint8_t dscrc_table[] = {
-      0, 94,188,226, 97, 63,221,131,194,156,126, 32,163,253, 31, 65,
-    157,195, 33,127,252,162, 64, 30, 95,  1,227,189, 62, 96,130,220,
-     35,125,159,193, 66, 28,254,160,225,191, 93,  3,128,222, 60, 98,
-    190,224,  2, 92,223,129, 99, 61,124, 34,192,158, 29, 67,161,255,
-     70, 24,250,164, 39,121,155,197,132,218, 56,102,229,187, 89,  7,
-    219,133,103, 57,186,228,  6, 88, 25, 71,165,251,120, 38,196,154,
-    101, 59,217,135,  4, 90,184,230,167,249, 27, 69,198,152,122, 36,
-    248,166, 68, 26,153,199, 37,123, 58,100,134,216, 91,  5,231,185,
-    140,210, 48,110,237,179, 81, 15, 78, 16,242,172, 47,113,147,205,
-     17, 79,173,243,112, 46,204,146,211,141,111, 49,178,236, 14, 80,
-    175,241, 19, 77,206,144,114, 44,109, 51,209,143, 12, 82,176,238,
-     50,108,142,208, 83, 13,239,177,240,174, 76, 18,145,207, 45,115,
-    202,148,118, 40,171,245, 23, 73,  8, 86,180,234,105, 55,213,139,
-     87,  9,235,181, 54,104,138,212,149,203, 41,119,244,170, 72, 22,
-    233,183, 85, 11,136,214, 52,106, 43,117,151,201, 74, 20,246,168,
-    116, 42,200,150, 21, 75,169,247,182,232, 10, 84,215,137,107, 53};
-
-#ifndef pgm_read_byte
-#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
-#endif
-
-//
 // Compute a Dallas Semiconductor 8 bit CRC. These show up in the ROM
-// and the registers.  (note: this might better be done without to
-// table, it would probably be smaller and certainly fast enough
-// compared to all those delayMicrosecond() calls.  But I got
-// confused, so I use this table from the examples.)
-//
-uint8_t onewire_crc8(const uint8_t *data, uint8_t len) {
-    uint8_t crc = 0;
-
-    while (len--) {
-        crc = pgm_read_byte(dscrc_table + (crc ^ *data++));
-    }
-    return crc;
-}
-#else
-//
-// Compute a Dallas Semiconductor 8 bit CRC directly.
-// this is much slower, but much smaller, than the lookup table.
-//
+// and the registers.
 uint8_t onewire_crc8(const uint8_t *data, uint8_t len) {
-    uint8_t crc = 0;
-    
-    while (len--) {
-        uint8_t inbyte = *data++;
-        for (int i = 8; i; i--) {
-            uint8_t mix = (crc ^ inbyte) & 0x01;
-            crc >>= 1;
-            if (mix) crc ^= 0x8C;
-            inbyte >>= 1;
-        }
-    }
-    return crc;
+    return crc8_maxim(0, data, len);
 }
-#endif
 
 // Compute the 1-Wire CRC16 and compare it against the received CRC.
 // Example usage (reading a DS2408):
@@ -429,25 +514,5 @@ bool onewire_check_crc16(const uint8_t* input, size_t len, const uint8_t* invert
 // @param crc - The crc starting value (optional)
 // @return The CRC16, as defined by Dallas Semiconductor.
 uint16_t onewire_crc16(const uint8_t* input, size_t len, uint16_t crc_iv) {
-    uint16_t crc = crc_iv;
-    static const uint8_t oddparity[16] =
-        { 0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0 };
-
-    uint16_t i;
-    for (i = 0 ; i < len ; i++) {
-      // Even though we're just copying a byte from the input,
-      // we'll be doing 16-bit computation with it.
-      uint16_t cdata = input[i];
-      cdata = (cdata ^ crc) & 0xff;
-      crc >>= 8;
-
-      if (oddparity[cdata & 0x0F] ^ oddparity[cdata >> 4])
-          crc ^= 0xC001;
-
-      cdata <<= 6;
-      crc ^= cdata;
-      cdata <<= 1;
-      crc ^= cdata;
-    }
-    return crc;
+    return crc16_arc(crc_iv, input, len);
 }
@@ -8,20 +8,21 @@
  *
  *  Routines to access devices using the Dallas Semiconductor 1-Wire(tm)
  *  protocol.
+ *
+ *  Slots are timed from the CPU cycle counter, and interrupts are masked
+ *  from the start of each slot until the line is released or sampled
+ *  (up to 60us for a standard speed 0, 70us for the presence check of a
+ *  reset, or 79us for the whole low time and presence check of an
+ *  overdrive reset), and run between slots. Buses can be on any of GPIO0-15, and each
+ *  can run at standard or overdrive speed.
  */
 
-/** Select the table-lookup method of computing the 8-bit CRC
- *  by setting this to 1 during compilation.  The lookup table enlarges code
- *  size by about 250 bytes.  By default, a slower but very compact algorithm
- *  is used.
- */
-#ifndef ONEWIRE_CRC8_TABLE
-#define ONEWIRE_CRC8_TABLE 0
-#endif
-
 /** Type used to hold all 1-Wire device ROM addresses (64-bit) */
 typedef uint64_t onewire_addr_t;
 
+/** Maximum number of buses for onewire_search_next_multi() */
+#define ONEWIRE_MAX_PARALLEL 16
+
 /** Structure to contain the current state for onewire_search_next(), etc */
 typedef struct {
     uint8_t rom_no[8];
@@ -67,6 +68,48 @@ bool onewire_select(int pin, const onewire_addr_t addr);
  */
 bool onewire_skip_rom(int pin);
 
+/** Issue an "overdrive skip ROM" command, which selects *all* devices
+ *  capable of overdrive speed and switches them (and this bus) to it.
+ *
+ *  The command itself is sent at standard speed. After it, every
+ *  operation on the bus, including resets, runs at overdrive speed
+ *  until onewire_set_overdrive() is used to go back to standard speed.
+ *  The next (standard speed) reset then returns the devices to standard
+ *  speed too.
+ *
+ *  It is necessary to call onewire_reset() before calling this function.
+ *
+ *  @param pin   The GPIO pin connected to the 1-Wire bus.
+ *
+ *  @returns `true` if the command could be succesfully issued, `false`
+ *           if there was an error.
+ */
+bool onewire_overdrive_skip_rom(int pin);
+
+/** Issue an "overdrive match ROM" command, which selects one device
+ *  and switches it (and this bus) to overdrive speed. See
+ *  onewire_overdrive_skip_rom().
+ *
+ *  @param pin   The GPIO pin connected to the 1-Wire bus.
+ *  @param addr  The ROM address of the device to select
+ *
+ *  @returns `true` if the command could be succesfully issued, `false`
+ *           if there was an error.
+ */
+bool onewire_overdrive_select(int pin, const onewire_addr_t addr);
+
+/** Set the speed used for a bus without sending any command, e.g. to
+ *  return to standard speed (the next reset will then be a standard
+ *  speed reset, which returns all devices to standard speed.)
+ *
+ *  @param pin     The GPIO pin connected to the 1-Wire bus.
+ *  @param enable  `true` for overdrive speed, `false` for standard.
+ */
+void onewire_set_overdrive(int pin, bool enable);
+
+/** @returns `true` if the bus is running at overdrive speed. */
+bool onewire_is_overdrive(int pin);
+
 /** Write a byte on the onewire bus.
  *
  *  The writing code uses open-drain mode and expects the pullup resistor to
@@ -89,6 +132,9 @@ bool onewire_write(int pin, uint8_t v);
  *  @param buf    A pointer to the buffer of bytes to be written
  *  @param count  Number of bytes to write
  *
+ *  The bytes are written as one run of back-to-back slots, which is
+ *  faster than calling onewire_write() for each.
+ *
  *  @returns `true` if all bytes written successfully, `false` on error.
  */
 bool onewire_write_bytes(int pin, const uint8_t *buf, size_t count);
@@ -180,10 +226,34 @@ void onewire_search_prefix(onewire_search_t *search, uint8_t family_code);
  */
 onewire_addr_t onewire_search_next(onewire_search_t *search, int pin);
 
+/** Search for the next device on several buses at once.
+ *
+ *  Equivalent to calling onewire_search_next() for each bus, but the
+ *  reset and bit slots on all the buses are run together, so a scan of
+ *  several buses takes no longer than a scan of the one with the most
+ *  devices. All the buses must be at the same speed.
+ *
+ *  @param searches  One search state per bus.
+ *  @param pins      The GPIO pins of the buses.
+ *  @param count     Number of buses, up to ::ONEWIRE_MAX_PARALLEL.
+ *  @param addrs     Receives the address of the next device on each bus,
+ *                   or ::ONEWIRE_NONE as for onewire_search_next().
+ *
+ *  Unlike onewire_search_next(), a bus whose search has finished keeps
+ *  returning ::ONEWIRE_NONE (without any bus activity) until its search
+ *  is restarted with onewire_search_start(), so a scan of all the buses
+ *  is complete when this returns 0.
+ *
+ *  @returns the number of buses on which a device was found.
+ */
+int onewire_search_next_multi(onewire_search_t *searches, const int *pins, size_t count,
+                              onewire_addr_t *addrs);
+
 /** Compute a Dallas Semiconductor 8 bit CRC.
  *
  *  These are used in the ROM address and scratchpad registers to verify the
- *  transmitted data is correct.
+ *  transmitted data is correct. This and onewire_crc16() are wrappers for
+ *  the table driven CRCs in core (see checksum.h).
  */
 uint8_t onewire_crc8(const uint8_t *data, uint8_t len);
 
@@ -25,12 +25,13 @@
 #include <lwip/netdb.h>
 #include <lwip/sys.h>
 #include <string.h>
+#include <esp/systime.h>
 
 #include "MQTTESP8266.h"
 
 char  expired(Timer* timer)
 {
-    portTickType now = xTaskGetTickCount();
+    uint32_t now = systime_ms();
     int32_t left = timer->end_time - now;
     return (left < 0);
 }
@@ -38,8 +39,8 @@ char  expired(Timer* timer)
 
 void  countdown_ms(Timer* timer, unsigned int timeout)
 {
-    portTickType now = xTaskGetTickCount();
-    timer->end_time = now + timeout / portTICK_RATE_MS;
+    uint32_t now = systime_ms();
+    timer->end_time = now + timeout;
 }
 
 
@@ -51,9 +52,9 @@ void  countdown(Timer* timer, unsigned int timeout)
 
 int  left_ms(Timer* timer)
 {
-    portTickType now = xTaskGetTickCount();
+    uint32_t now = systime_ms();
     int32_t left = timer->end_time - now;
-    return (left < 0) ? 0 : left / portTICK_RATE_MS;
+    return (left < 0) ? 0 : left;
 }
 
 
@@ -28,7 +28,7 @@ typedef struct Timer Timer;
 
 struct Timer
 {
-    portTickType end_time;
+    uint32_t end_time; /* systime_ms() value */
 };
 
 typedef struct Network Network;
@@ -6,64 +6,78 @@
  * BSD Licensed as described in the file LICENSE
  */
 #include "pwm.h"
+#include "pwm_schedule.h"
 
 #include <espressif/esp_common.h>
 #include <espressif/sdk_private.h>
 #include <FreeRTOS.h>
 #include <esp8266.h>
 
-typedef struct PWMPinDefinition
-{
-    uint8_t pin;
-    uint8_t divider;
-} PWMPin;
-
-typedef enum {
-    PERIOD_ON   = 0,
-    PERIOD_OFF  = 1
-} pwm_step_t;
-
-
 typedef struct pwmInfoDefinition
 {
     uint8_t running;
 
     uint16_t freq;
-    uint16_t dutyCicle;
 
     /* private */
     uint32_t _maxLoad;
-    uint32_t _onLoad;
-    uint32_t _offLoad;
-    pwm_step_t _step;
+    uint32_t _minGap;
 
     uint16_t usedPins;
-    PWMPin pins[8];
+    uint8_t pins[MAX_PWM_PINS];
+    uint16_t masks[MAX_PWM_PINS];
+    uint16_t duty[MAX_PWM_PINS];
+    uint16_t phase[MAX_PWM_PINS];
+
+    /* The interrupt handler runs _schedules[_front]. Updates are built
+       in the other one and swapped in at the start of a period. */
+    pwm_schedule_t _schedules[2];
+    volatile uint8_t _front;
+    volatile bool _pending;
+    uint8_t _event;
 } PWMInfo;
 
 static PWMInfo pwmInfo;
 
-static void frc1_interrupt_handler(void)
+static void IRAM frc1_interrupt_handler(void)
 {
-    uint8_t i = 0;
-    bool out = true;
-    uint32_t load = pwmInfo._onLoad;
-    pwm_step_t step = PERIOD_ON;
+    uint8_t i = pwmInfo._event;
 
-    if (pwmInfo._step == PERIOD_ON)
+    if (i == 0 && pwmInfo._pending)
     {
-        out = false;
-        load = pwmInfo._offLoad;
-        step = PERIOD_OFF;
+        pwmInfo._front ^= 1;
+        pwmInfo._pending = false;
     }
 
-    for (; i < pwmInfo.usedPins; ++i)
-    {
-        gpio_write(pwmInfo.pins[i].pin, out);
-    }
+    const pwm_schedule_t *sched = &pwmInfo._schedules[pwmInfo._front];
+    const pwm_event_t *ev = &sched->events[i];
+
+    timer_set_load(FRC1, ev->ticks);
+    GPIO.OUT_SET = ev->set;
+    GPIO.OUT_CLEAR = ev->clear;
+
+    if (++i == sched->count)
+        i = 0;
+    pwmInfo._event = i;
+}
+
+static void pwm_build(pwm_schedule_t *sched)
+{
+    pwm_schedule_build(sched, pwmInfo._maxLoad, pwmInfo._minGap, pwmInfo.usedPins,
+                       pwmInfo.masks, pwmInfo.duty, pwmInfo.phase);
+}
+
+/* Rebuild the schedule after a duty or phase change */
+static void pwm_update(void)
+{
+    if (!pwmInfo.running || !pwmInfo._maxLoad)
+        return;
 
-    timer_set_load(FRC1, load);
-    pwmInfo._step = step;
+    /* With no swap pending the back schedule is not in use and can't be
+       swapped in while it is being rebuilt */
+    pwmInfo._pending = false;
+    pwm_build(&pwmInfo._schedules[pwmInfo._front ^ 1]);
+    pwmInfo._pending = true;
 }
 
 void pwm_init(uint8_t npins, uint8_t* pins)
@@ -75,19 +89,32 @@ void pwm_init(uint8_t npins, uint8_t* pins)
         return;
     }
 
+    uint8_t i = 0;
+    for (; i < npins; ++i)
+    {
+        if (pins[i] >= 16)
+        {
+            printf("Incorrect PWM pin (%d)\n", pins[i]);
+            return;
+        }
+    }
+
     /* Initialize */
     pwmInfo._maxLoad = 0;
-    pwmInfo._onLoad = 0;
-    pwmInfo._offLoad = 0;
-    pwmInfo._step = PERIOD_ON;
+    pwmInfo._minGap = 0;
+    pwmInfo._front = 0;
+    pwmInfo._pending = false;
+    pwmInfo._event = 0;
 
     /* Save pins information */
     pwmInfo.usedPins = npins;
 
-    uint8_t i = 0;
-    for (; i < npins; ++i)
+    for (i = 0; i < npins; ++i)
     {
-        pwmInfo.pins[i].pin = pins[i];
+        pwmInfo.pins[i] = pins[i];
+        pwmInfo.masks[i] = BIT(pins[i]);
+        pwmInfo.duty[i] = 0;
+        pwmInfo.phase[i] = 0;
 
         /* configure GPIOs */
         gpio_enable(pins[i], GPIO_OUTPUT);
@@ -116,6 +143,7 @@ void pwm_set_freq(uint16_t freq)
 
     timer_set_frequency(FRC1, freq);
     pwmInfo._maxLoad = timer_get_load(FRC1);
+    pwmInfo._minGap = (uint64_t)pwmInfo._maxLoad * freq * PWM_MIN_EDGE_GAP_US / 1000000 + 1;
 
     if (pwmInfo.running)
     {
@@ -125,22 +153,38 @@ void pwm_set_freq(uint16_t freq)
 
 void pwm_set_duty(uint16_t duty)
 {
-    bool output;
-
-    pwmInfo.dutyCicle = duty;
-    if (duty > 0 && duty < UINT16_MAX) {
-        pwm_restart();
-	return;
+    for (uint8_t i = 0; i < pwmInfo.usedPins; ++i)
+    {
+        pwmInfo.duty[i] = duty;
     }
+    pwm_update();
+}
 
-    // 0% and 100% duty cycle are special cases: constant output.
-    pwm_stop();
-    pwmInfo.running = 1;
-    output = (duty == UINT16_MAX);
+void pwm_set_channel_duty(uint8_t channel, uint16_t duty)
+{
+    if (channel >= pwmInfo.usedPins)
+        return;
+    pwmInfo.duty[channel] = duty;
+    pwm_update();
+}
+
+void pwm_set_channel_phase(uint8_t channel, uint16_t phase)
+{
+    if (channel >= pwmInfo.usedPins)
+        return;
+    pwmInfo.phase[channel] = phase;
+    pwm_update();
+}
+
+void pwm_set_channels(const uint16_t *duty, const uint16_t *phase)
+{
     for (uint8_t i = 0; i < pwmInfo.usedPins; ++i)
     {
-	gpio_write(pwmInfo.pins[i].pin, output);
+        pwmInfo.duty[i] = duty[i];
+        if (phase)
+            pwmInfo.phase[i] = phase[i];
     }
+    pwm_update();
 }
 
 void pwm_restart()
@@ -154,18 +198,20 @@ void pwm_restart()
 
 void pwm_start()
 {
-    pwmInfo._onLoad = pwmInfo.dutyCicle * pwmInfo._maxLoad / UINT16_MAX;
-    pwmInfo._offLoad = pwmInfo._maxLoad - pwmInfo._onLoad;
-    pwmInfo._step = PERIOD_ON;
+    if (!pwmInfo._maxLoad)
+        return;
 
-    // Trigger ON
-    uint8_t i = 0;
-    for (; i < pwmInfo.usedPins; ++i)
-    {
-        gpio_write(pwmInfo.pins[i].pin, true);
-    }
+    pwmInfo._front = 0;
+    pwmInfo._pending = false;
+    pwm_build(&pwmInfo._schedules[0]);
+
+    // Output the first event now, the interrupt takes it from there
+    const pwm_schedule_t *sched = &pwmInfo._schedules[0];
+    GPIO.OUT_SET = sched->events[0].set;
+    GPIO.OUT_CLEAR = sched->events[0].clear;
+    pwmInfo._event = sched->count > 1 ? 1 : 0;
 
-    timer_set_load(FRC1, pwmInfo._onLoad);
+    timer_set_load(FRC1, sched->events[0].ticks);
     timer_set_reload(FRC1, false);
     timer_set_interrupts(FRC1, true);
     timer_set_run(FRC1, true);
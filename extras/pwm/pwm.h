@@ -5,14 +5,37 @@
  * Copyright (C) 2015 Javier Cardona (https://github.com/jcard0na)
  * BSD Licensed as described in the file LICENSE
  */
+#ifndef _PWM_H
+#define _PWM_H
+
 #include <stdint.h>
 
 #define MAX_PWM_PINS    8
 
+/* Edges of different channels closer together than this are output
+   together, see pwm_schedule.h */
+#ifndef PWM_MIN_EDGE_GAP_US
+#define PWM_MIN_EDGE_GAP_US 4
+#endif
+
+/* Channels are numbered in the order of the pins passed to pwm_init().
+   Only GPIO0-15 can be used. */
 void pwm_init(uint8_t npins, uint8_t* pins);
 void pwm_set_freq(uint16_t freq);
+/* Set the duty cycle of all channels, 0 (off) to UINT16_MAX (on).
+   Duty and phase changes take effect at the start of the next period,
+   so the outputs never glitch. Set them from one task at a time. */
 void pwm_set_duty(uint16_t duty);
 
+/* Set the duty cycle of one channel */
+void pwm_set_channel_duty(uint8_t channel, uint16_t duty);
+/* Delay the start of a channel's pulse by phase/65536 of a period */
+void pwm_set_channel_phase(uint8_t channel, uint16_t phase);
+/* Set the duty cycle and phase (may be NULL) of all channels at once */
+void pwm_set_channels(const uint16_t *duty, const uint16_t *phase);
+
 void pwm_restart();
 void pwm_start();
 void pwm_stop();
+
+#endif
@@ -0,0 +1,97 @@
+/* PWM edge schedule.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2015 Guillem Pascual Ginovart (https://github.com/gpascualg)
+ * Copyright (C) 2015 Javier Cardona (https://github.com/jcard0na)
+ * BSD Licensed as described in the file LICENSE
+ */
+#include "pwm_schedule.h"
+
+typedef struct
+{
+    uint32_t time;
+    int32_t order;      /* sort key, negative for edges moved to time 0 */
+    uint16_t set;
+    uint16_t clear;
+} pwm_edge_t;
+
+static void add_edge(pwm_edge_t *edges, uint8_t *n, uint32_t time, uint32_t period,
+                     uint32_t min_gap, uint16_t set, uint16_t clear)
+{
+    /* An edge moved from the end of the period goes before anything at
+       the start of the next one, still in order with other moved edges */
+    int32_t order = time;
+    if (time + min_gap > period)
+    {
+        order = (int32_t)(time - period);
+        time = 0;
+    }
+
+    /* Insertion sort, the list is at most PWM_MAX_EVENTS long */
+    uint8_t i = *n;
+    while (i > 0 && edges[i - 1].order > order)
+    {
+        edges[i] = edges[i - 1];
+        i--;
+    }
+    edges[i].time = time;
+    edges[i].order = order;
+    edges[i].set = set;
+    edges[i].clear = clear;
+    (*n)++;
+}
+
+void pwm_schedule_build(pwm_schedule_t *s, uint32_t period, uint32_t min_gap, uint8_t nchannels,
+                        const uint16_t *masks, const uint16_t *duty, const uint16_t *phase)
+{
+    pwm_edge_t edges[PWM_MAX_EVENTS];
+    uint8_t n = 0;
+
+    /* Channels which are always off or on are refreshed at the start
+       of each period */
+    uint16_t set = 0, clear = 0;
+    for (uint8_t i = 0; i < nchannels; ++i)
+    {
+        if (duty[i] == 0)
+            clear |= masks[i];
+        else if (duty[i] == UINT16_MAX)
+            set |= masks[i];
+    }
+    add_edge(edges, &n, 0, period, min_gap, set, clear);
+
+    for (uint8_t i = 0; i < nchannels; ++i)
+    {
+        if (duty[i] == 0 || duty[i] == UINT16_MAX)
+            continue;
+        uint32_t on = ((uint64_t)phase[i] * period) >> 16;
+        uint32_t off = on + (uint64_t)duty[i] * period / UINT16_MAX;
+        if (off >= period)
+            off -= period;
+        add_edge(edges, &n, on, period, min_gap, masks[i], 0);
+        add_edge(edges, &n, off, period, min_gap, 0, masks[i]);
+    }
+
+    /* Merge edges which are too close together. Where one pin has two
+       edges in a merged event the later one wins, so a too short pulse
+       or gap is dropped rather than becoming a glitch. */
+    pwm_event_t *ev = s->events;
+    uint32_t start = 0;
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < n; ++i)
+    {
+        if (count && edges[i].time - start < min_gap)
+        {
+            ev[count - 1].set = (ev[count - 1].set & ~edges[i].clear) | edges[i].set;
+            ev[count - 1].clear = (ev[count - 1].clear & ~edges[i].set) | edges[i].clear;
+            continue;
+        }
+        if (count)
+            ev[count - 1].ticks = edges[i].time - start;
+        start = edges[i].time;
+        ev[count].set = edges[i].set;
+        ev[count].clear = edges[i].clear;
+        count++;
+    }
+    ev[count - 1].ticks = period - start;
+    s->count = count;
+}
@@ -0,0 +1,50 @@
+/* PWM edge schedule.
+ *
+ * The outputs of all channels over one period are precomputed as a
+ * list of events sorted by time. Each event gives the GPIO masks to set
+ * and clear together, and the timer ticks until the next event.
+ *
+ * This file has no hardware dependencies, so the schedule can be
+ * built and checked on a host.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2015 Guillem Pascual Ginovart (https://github.com/gpascualg)
+ * Copyright (C) 2015 Javier Cardona (https://github.com/jcard0na)
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _PWM_SCHEDULE_H
+#define _PWM_SCHEDULE_H
+
+#include <stdint.h>
+#include "pwm.h"
+
+/* Two edges per channel, plus the start of the period */
+#define PWM_MAX_EVENTS (2 * MAX_PWM_PINS + 1)
+
+typedef struct
+{
+    uint32_t ticks;     /* until the next event */
+    uint16_t set;       /* GPIO masks */
+    uint16_t clear;
+} pwm_event_t;
+
+typedef struct
+{
+    uint8_t count;
+    pwm_event_t events[PWM_MAX_EVENTS];
+} pwm_schedule_t;
+
+/* Build the schedule for 'nchannels' channels, each on the GPIOs in
+ * masks[i] with duty[i] and phase[i] in 1/UINT16_MAX and 1/65536ths of
+ * 'period' ticks. The first event is always at the start of the period.
+ *
+ * Edges closer together than 'min_gap' ticks are merged into one event
+ * (a pulse or gap shorter than that disappears), and edges within
+ * 'min_gap' of the end of the period move to its start, so the
+ * interrupt handler always has time to run. Each edge moves by less
+ * than 'min_gap', so a pulse width can be out by up to twice that.
+ */
+void pwm_schedule_build(pwm_schedule_t *s, uint32_t period, uint32_t min_gap, uint8_t nchannels,
+                        const uint16_t *masks, const uint16_t *duty, const uint16_t *phase);
+
+#endif
@@ -10,6 +10,7 @@
 
 #include <rboot-api.h>
 #include <string.h>
+#include <checksum.h>
 //#include <c_types.h>
 //#include <spi_flash.h>
 
@@ -289,12 +290,15 @@ bool rboot_verify_image(uint32_t initial_offset, uint32_t *image_length, const c
         }
 
         if(!is_new_header) {
-            /* Add individual data of the section to the checksum. */
-            char chunk[16] __attribute__((aligned(4)));
-            for(int i = 0; i < header.length; i++) {
-                if(i % sizeof(chunk) == 0)
-                    sdk_spi_flash_read(offset+i, (uint32_t *)chunk, sizeof(chunk));
-                checksum ^= chunk[i % sizeof(chunk)];
+            /* Add individual data of the section to the checksum. Lengths
+               are all multiples of 4, so read & XOR a word at a time. */
+            uint32_t chunk[16];
+            for(int i = 0; i < header.length; i += sizeof(chunk)) {
+                uint32_t len = header.length - i;
+                if(len > sizeof(chunk))
+                    len = sizeof(chunk);
+                sdk_spi_flash_read(offset+i, chunk, len);
+                checksum = checksum_xor8(checksum, chunk, len);
             }
         }
 
@@ -0,0 +1,11 @@
+# Component makefile for extras/rtos_trace
+#
+# Also needs configUSE_RTOS_TRACE set to 1 in the program's
+# FreeRTOSConfig.h, see examples/rtos_trace
+
+INC_DIRS += $(rtos_trace_ROOT)
+
+# args for passing into compile rule generation
+rtos_trace_SRC_DIR =  $(rtos_trace_ROOT)
+
+$(eval $(call component_compile_rules,rtos_trace))
@@ -0,0 +1,179 @@
+/* Binary scheduler & kernel object event tracing for FreeRTOS.
+ *
+ * See rtos_trace.h for usage.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <string.h>
+#include <stdio.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <common_macros.h>
+#include <xtensa_ops.h>
+#include <esp/interrupts.h>
+#include <esp/clocks.h>
+#include "rtos_trace.h"
+
+#if !configUSE_RTOS_TRACE
+#error "extras/rtos_trace needs configUSE_RTOS_TRACE set to 1 in a local FreeRTOSConfig.h, see examples/rtos_trace"
+#endif
+
+#define TRACE_MASK (RTOS_TRACE_BUFFER_EVENTS - 1)
+
+static struct rtos_trace_event trace_ring[RTOS_TRACE_BUFFER_EVENTS];
+
+/* Total number of events recorded since the last clear. Index into
+   the ring is (trace_head & TRACE_MASK). */
+static uint32_t trace_head;
+static volatile bool trace_running = true;
+
+volatile uint8_t rtos_trace_current_task;
+
+static struct {
+    char name[configMAX_TASK_NAME_LEN];
+    uint8_t priority;
+} trace_tasks[RTOS_TRACE_MAX_TASKS];
+static uint8_t trace_num_tasks;
+
+/* Timestamps are in CPU cycles, so the decoder needs to know when the
+   CPU clock changed */
+static cpu_freq_listener_t trace_cpu_freq_listener;
+static uint32_t trace_cpu_mhz;
+
+static void trace_cpu_freq_changed(uint32_t mhz, void *arg)
+{
+    rtos_trace_record(RTOS_TRACE_CPU_FREQ, rtos_trace_current_task,
+                      (trace_cpu_mhz << 8) | mhz);
+    trace_cpu_mhz = mhz;
+}
+
+/* Claiming a slot and filling it happens inside a short rsil window
+   (around a dozen instructions) so events can be recorded from any
+   task or ISR without locks. The kernel hooks are mostly already
+   called with interrupts disabled.
+
+   Like portDISABLE_INTERRUPTS, don't touch the interrupt level when
+   called from the NMI.
+*/
+void IRAM rtos_trace_record(uint8_t type, uint8_t task, uint16_t arg)
+{
+    uint32_t ps = 0;
+    if(!sdk_NMIIrqIsOn)
+        ps = _xt_disable_interrupts();
+
+    if(trace_running) {
+#if RTOS_TRACE_ONESHOT
+        if(trace_head == RTOS_TRACE_BUFFER_EVENTS) {
+            trace_running = false;
+            goto out;
+        }
+#endif
+        struct rtos_trace_event *ev = &trace_ring[trace_head++ & TRACE_MASK];
+        uint32_t ccount;
+        RSR(ccount, ccount);
+        ev->ccount = ccount;
+        ev->type = type;
+        ev->task = task;
+        ev->arg = arg;
+    }
+
+#if RTOS_TRACE_ONESHOT
+ out:
+#endif
+    if(!sdk_NMIIrqIsOn)
+        _xt_restore_interrupts(ps);
+}
+
+void IRAM rtos_trace_switched_in(uint8_t task)
+{
+    /* vTaskSwitchContext runs on every soft/tick interrupt, only
+       record the ones which actually change task */
+    if(task != rtos_trace_current_task) {
+        rtos_trace_current_task = task;
+        rtos_trace_record(RTOS_TRACE_TASK_SWITCHED_IN, task, 0);
+    }
+}
+
+/* Called with interrupts disabled, from inside xTaskGenericCreate's
+   critical section */
+uint8_t rtos_trace_task_create(const char *name, unsigned priority)
+{
+    uint8_t id = RTOS_TRACE_TASK_OTHER;
+    if(trace_num_tasks == 0) {
+        /* first task, no explicit init function to do this from */
+        trace_cpu_mhz = cpu_freq_get();
+        cpu_freq_add_listener(&trace_cpu_freq_listener, trace_cpu_freq_changed, NULL);
+    }
+    if(trace_num_tasks < RTOS_TRACE_MAX_TASKS && trace_num_tasks < RTOS_TRACE_TASK_OTHER - 1) {
+        strncpy(trace_tasks[trace_num_tasks].name, name, configMAX_TASK_NAME_LEN);
+        trace_tasks[trace_num_tasks].priority = priority;
+        id = ++trace_num_tasks;
+    }
+    rtos_trace_record(RTOS_TRACE_TASK_CREATE, id, priority);
+    return id;
+}
+
+void rtos_trace_start(void)
+{
+#if RTOS_TRACE_ONESHOT
+    rtos_trace_clear();
+#endif
+    trace_running = true;
+}
+
+void IRAM rtos_trace_stop(void)
+{
+    trace_running = false;
+}
+
+void rtos_trace_clear(void)
+{
+    uint32_t ps = _xt_disable_interrupts();
+    trace_head = 0;
+    _xt_restore_interrupts(ps);
+}
+
+uint32_t rtos_trace_read(struct rtos_trace_event *buf, uint32_t max_events)
+{
+    bool was_running = trace_running;
+    trace_running = false;
+
+    uint32_t count = trace_head < RTOS_TRACE_BUFFER_EVENTS ? trace_head : RTOS_TRACE_BUFFER_EVENTS;
+    if(count > max_events)
+        count = max_events;
+    /* oldest of the 'count' most recent events */
+    uint32_t first = trace_head - count;
+    for(uint32_t i = 0; i < count; i++) {
+        buf[i] = trace_ring[(first + i) & TRACE_MASK];
+    }
+
+    trace_running = was_running;
+    return count;
+}
+
+void rtos_trace_dump(void)
+{
+    bool was_running = trace_running;
+    trace_running = false;
+
+    uint32_t count = trace_head < RTOS_TRACE_BUFFER_EVENTS ? trace_head : RTOS_TRACE_BUFFER_EVENTS;
+    uint32_t first = trace_head - count;
+
+    /* CPU clock at the time of the dump, the decoder works backwards
+       through any RTOS_TRACE_CPU_FREQ events for earlier timestamps */
+    printf("RTOSTRACE BEGIN 1 %lu %u %u\n", (unsigned long)cpu_freq_get() * 1000000,
+           count, trace_head - count);
+    for(int i = 0; i < trace_num_tasks; i++) {
+        printf("RTOSTRACE T %u %u %.*s\n", i + 1, trace_tasks[i].priority,
+               configMAX_TASK_NAME_LEN, trace_tasks[i].name);
+    }
+    for(uint32_t i = 0; i < count; i++) {
+        struct rtos_trace_event *ev = &trace_ring[(first + i) & TRACE_MASK];
+        printf("RTOSTRACE E %08x %02x %02x %04x\n", ev->ccount, ev->type, ev->task, ev->arg);
+    }
+    printf("RTOSTRACE END\n");
+
+    trace_running = was_running;
+}
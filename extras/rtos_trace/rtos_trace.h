@@ -0,0 +1,174 @@
+/* rtos_trace.h
+ *
+ * Binary scheduler & kernel object event tracing for FreeRTOS.
+ *
+ * When enabled, the FreeRTOS trace* hook macros record compact
+ * 8 byte events (CCOUNT timestamp, event type, task id, argument)
+ * into a statically allocated RAM ring. The ring can be dumped over
+ * stdout with rtos_trace_dump() and converted on the host into a
+ * Chrome/Perfetto trace timeline with utils/rtos_trace_decode.py.
+ *
+ * To enable, add extras/rtos_trace to EXTRA_COMPONENTS and set
+ * configUSE_RTOS_TRACE to 1 in a program-local FreeRTOSConfig.h (see
+ * examples/rtos_trace.)
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _RTOS_TRACE_H
+#define _RTOS_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/* Number of events held in the trace ring. Must be a power of 2,
+   each event takes 8 bytes of RAM. */
+#ifndef RTOS_TRACE_BUFFER_EVENTS
+#define RTOS_TRACE_BUFFER_EVENTS 512
+#endif
+
+/* Maximum number of tasks which get their own task id. Tasks created
+   after this limit share RTOS_TRACE_TASK_OTHER. */
+#ifndef RTOS_TRACE_MAX_TASKS
+#define RTOS_TRACE_MAX_TASKS 24
+#endif
+
+/* If set to 1, stop recording once the ring is full instead of
+   overwriting the oldest events (ie capture the events after a
+   rtos_trace_start() rather than the events before a rtos_trace_stop().)
+*/
+#ifndef RTOS_TRACE_ONESHOT
+#define RTOS_TRACE_ONESHOT 0
+#endif
+
+/* If set to 1, record an event on every RTOS tick. */
+#ifndef RTOS_TRACE_TICKS
+#define RTOS_TRACE_TICKS 0
+#endif
+
+_Static_assert((RTOS_TRACE_BUFFER_EVENTS & (RTOS_TRACE_BUFFER_EVENTS - 1)) == 0,
+               "RTOS_TRACE_BUFFER_EVENTS must be a power of 2");
+
+/* Task id 0 is used for events recorded before the scheduler starts */
+#define RTOS_TRACE_TASK_NONE  0
+#define RTOS_TRACE_TASK_OTHER 0xff
+
+/* Kernel objects (queues, semaphores, mutexes) are all allocated in
+   data RAM, so their handles are stored as a 16-bit word offset from
+   the start of DRAM.
+*/
+#define RTOS_TRACE_DRAM_BASE 0x3FFE8000
+#define RTOS_TRACE_OBJ(handle) ((uint16_t)(((uint32_t)(handle) - RTOS_TRACE_DRAM_BASE) >> 2))
+
+/* Event types. 'task' field of the event is the subject task for
+   RTOS_TRACE_TASK_* events, and the task running at the time for
+   the queue events. */
+typedef enum {
+    RTOS_TRACE_TASK_CREATE = 0x01,           /* arg = priority */
+    RTOS_TRACE_TASK_DELETE,
+    RTOS_TRACE_TASK_SWITCHED_IN,
+    RTOS_TRACE_TASK_READY,
+    RTOS_TRACE_TASK_DELAY,
+    RTOS_TRACE_TASK_DELAY_UNTIL,
+    RTOS_TRACE_TASK_SUSPEND,
+    RTOS_TRACE_TASK_RESUME,
+    RTOS_TRACE_TASK_RESUME_FROM_ISR,
+    RTOS_TRACE_TASK_PRIORITY_SET,            /* arg = new priority */
+    RTOS_TRACE_TASK_PRIORITY_INHERIT,        /* arg = inherited priority */
+    RTOS_TRACE_TASK_PRIORITY_DISINHERIT,     /* arg = base priority */
+    RTOS_TRACE_TICK,                         /* arg = low 16 bits of tick count */
+    RTOS_TRACE_CPU_FREQ,                     /* arg = old MHz << 8 | new MHz */
+
+    /* Queue creation, queue type (queueQUEUE_TYPE_xxx) is added to
+       the event type. arg = object */
+    RTOS_TRACE_QUEUE_CREATE = 0x20,
+    RTOS_TRACE_QUEUE_DELETE = 0x28,
+
+    /* Queue/semaphore/mutex operations. arg = object */
+    RTOS_TRACE_QUEUE_SEND = 0x30,
+    RTOS_TRACE_QUEUE_SEND_FAILED,
+    RTOS_TRACE_QUEUE_BLOCKING_ON_SEND,
+    RTOS_TRACE_QUEUE_RECEIVE,
+    RTOS_TRACE_QUEUE_RECEIVE_FAILED,
+    RTOS_TRACE_QUEUE_BLOCKING_ON_RECEIVE,
+    RTOS_TRACE_QUEUE_PEEK,
+    RTOS_TRACE_QUEUE_SEND_FROM_ISR,
+    RTOS_TRACE_QUEUE_SEND_FROM_ISR_FAILED,
+    RTOS_TRACE_QUEUE_RECEIVE_FROM_ISR,
+    RTOS_TRACE_QUEUE_RECEIVE_FROM_ISR_FAILED,
+    RTOS_TRACE_QUEUE_PEEK_FROM_ISR,
+    RTOS_TRACE_MUTEX_TAKE_RECURSIVE,
+    RTOS_TRACE_MUTEX_TAKE_RECURSIVE_FAILED,
+    RTOS_TRACE_MUTEX_GIVE_RECURSIVE,
+    RTOS_TRACE_MUTEX_GIVE_RECURSIVE_FAILED,
+
+    /* Application defined events, see rtos_trace_user() */
+    RTOS_TRACE_USER = 0x80,
+} rtos_trace_event_type_t;
+
+struct rtos_trace_event {
+    uint32_t ccount;
+    uint8_t type;
+    uint8_t task;
+    uint16_t arg;
+};
+
+_Static_assert(sizeof(struct rtos_trace_event) == 8, "rtos_trace_event is the wrong size");
+
+/* Task id of the task which is currently running */
+extern volatile uint8_t rtos_trace_current_task;
+
+/* Record a single event. Safe to call from tasks & ISRs. */
+void rtos_trace_record(uint8_t type, uint8_t task, uint16_t arg);
+
+/* Record an event against the currently running task */
+static inline void rtos_trace_object(uint8_t type, const void *object)
+{
+    rtos_trace_record(type, rtos_trace_current_task, RTOS_TRACE_OBJ(object));
+}
+
+/* Record an application defined event (id 0-127) with a 16-bit value,
+   for marking points of interest on the timeline. */
+static inline void rtos_trace_user(uint8_t id, uint16_t value)
+{
+    rtos_trace_record(RTOS_TRACE_USER | (id & 0x7f), rtos_trace_current_task, value);
+}
+
+/* Called from the traceTASK_CREATE hook, allocates a task id and
+   remembers the task name for the dump. Returns the task id. */
+uint8_t rtos_trace_task_create(const char *name, unsigned priority);
+
+/* Called from the traceTASK_SWITCHED_IN hook. */
+void rtos_trace_switched_in(uint8_t task);
+
+/* Start (or resume) recording events. Recording is enabled from boot. */
+void rtos_trace_start(void);
+
+/* Stop recording events, leaving the ring contents intact. Can be
+   called from an ISR, for example to freeze the trace when a latency
+   spike is detected. */
+void rtos_trace_stop(void);
+
+/* Discard all recorded events. */
+void rtos_trace_clear(void);
+
+/* Copy the recorded events, oldest first, into buf. Returns the number
+   of events copied. Recording is paused during the copy. */
+uint32_t rtos_trace_read(struct rtos_trace_event *buf, uint32_t max_events);
+
+/* Write the task table & recorded events to stdout, as text lines
+   prefixed with "RTOSTRACE" which utils/rtos_trace_decode.py can pick
+   out of a serial log. Recording is paused during the dump.
+*/
+void rtos_trace_dump(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,93 @@
+/* rtos_trace_hooks.h
+ *
+ * FreeRTOS trace hook macro definitions for extras/rtos_trace.
+ *
+ * Included from the default FreeRTOSConfig.h when
+ * configUSE_RTOS_TRACE is set, so these are defined before
+ * FreeRTOS.h supplies its empty defaults. The macros expand inside
+ * tasks.c & queue.c, where pxCurrentTCB and the TCB/queue structure
+ * members are visible.
+ *
+ * Task ids are stored in the uxTaskNumber TCB field, which FreeRTOS
+ * reserves for third party trace code.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _RTOS_TRACE_HOOKS_H
+#define _RTOS_TRACE_HOOKS_H
+
+#include "rtos_trace.h"
+
+#define traceTASK_CREATE(pxNewTCB) \
+    (pxNewTCB)->uxTaskNumber = rtos_trace_task_create((const char *)(pxNewTCB)->pcTaskName, (pxNewTCB)->uxPriority)
+
+#define traceTASK_DELETE(pxTCB) \
+    rtos_trace_record(RTOS_TRACE_TASK_DELETE, (pxTCB)->uxTaskNumber, 0)
+
+#define traceTASK_SWITCHED_IN() \
+    rtos_trace_switched_in(pxCurrentTCB->uxTaskNumber)
+
+/* Used inside the prvAddTaskToReadyList macro, which doesn't supply a
+   trailing semicolon. */
+#define traceMOVED_TASK_TO_READY_STATE(pxTCB) \
+    rtos_trace_record(RTOS_TRACE_TASK_READY, (pxTCB)->uxTaskNumber, 0);
+
+#define traceTASK_DELAY() \
+    rtos_trace_record(RTOS_TRACE_TASK_DELAY, pxCurrentTCB->uxTaskNumber, 0)
+
+#define traceTASK_DELAY_UNTIL() \
+    rtos_trace_record(RTOS_TRACE_TASK_DELAY_UNTIL, pxCurrentTCB->uxTaskNumber, 0)
+
+#define traceTASK_SUSPEND(pxTCB) \
+    rtos_trace_record(RTOS_TRACE_TASK_SUSPEND, (pxTCB)->uxTaskNumber, 0)
+
+#define traceTASK_RESUME(pxTCB) \
+    rtos_trace_record(RTOS_TRACE_TASK_RESUME, (pxTCB)->uxTaskNumber, 0)
+
+#define traceTASK_RESUME_FROM_ISR(pxTCB) \
+    rtos_trace_record(RTOS_TRACE_TASK_RESUME_FROM_ISR, (pxTCB)->uxTaskNumber, 0)
+
+#define traceTASK_PRIORITY_SET(pxTCB, uxNewPriority) \
+    rtos_trace_record(RTOS_TRACE_TASK_PRIORITY_SET, (pxTCB)->uxTaskNumber, (uxNewPriority))
+
+#define traceTASK_PRIORITY_INHERIT(pxTCB, uxInheritedPriority) \
+    rtos_trace_record(RTOS_TRACE_TASK_PRIORITY_INHERIT, (pxTCB)->uxTaskNumber, (uxInheritedPriority))
+
+#define traceTASK_PRIORITY_DISINHERIT(pxTCB, uxOriginalPriority) \
+    rtos_trace_record(RTOS_TRACE_TASK_PRIORITY_DISINHERIT, (pxTCB)->uxTaskNumber, (uxOriginalPriority))
+
+#if RTOS_TRACE_TICKS
+#define traceTASK_INCREMENT_TICK(xTickCount) \
+    rtos_trace_record(RTOS_TRACE_TICK, rtos_trace_current_task, (uint16_t)(xTickCount))
+#endif
+
+#define traceQUEUE_CREATE(pxNewQueue) \
+    rtos_trace_object(RTOS_TRACE_QUEUE_CREATE + (pxNewQueue)->ucQueueType, (pxNewQueue))
+/* Mutexes don't go through xQueueGenericCreate(), ucQueueType is
+   still set before this is called */
+#define traceCREATE_MUTEX(pxNewQueue) \
+    rtos_trace_object(RTOS_TRACE_QUEUE_CREATE + (pxNewQueue)->ucQueueType, (pxNewQueue))
+#define traceQUEUE_DELETE(pxQueue) \
+    rtos_trace_object(RTOS_TRACE_QUEUE_DELETE, (pxQueue))
+
+#define traceQUEUE_SEND(pxQueue)                 rtos_trace_object(RTOS_TRACE_QUEUE_SEND, (pxQueue))
+#define traceQUEUE_SEND_FAILED(pxQueue)          rtos_trace_object(RTOS_TRACE_QUEUE_SEND_FAILED, (pxQueue))
+#define traceBLOCKING_ON_QUEUE_SEND(pxQueue)     rtos_trace_object(RTOS_TRACE_QUEUE_BLOCKING_ON_SEND, (pxQueue))
+#define traceQUEUE_RECEIVE(pxQueue)              rtos_trace_object(RTOS_TRACE_QUEUE_RECEIVE, (pxQueue))
+#define traceQUEUE_RECEIVE_FAILED(pxQueue)       rtos_trace_object(RTOS_TRACE_QUEUE_RECEIVE_FAILED, (pxQueue))
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue)  rtos_trace_object(RTOS_TRACE_QUEUE_BLOCKING_ON_RECEIVE, (pxQueue))
+#define traceQUEUE_PEEK(pxQueue)                 rtos_trace_object(RTOS_TRACE_QUEUE_PEEK, (pxQueue))
+#define traceQUEUE_SEND_FROM_ISR(pxQueue)        rtos_trace_object(RTOS_TRACE_QUEUE_SEND_FROM_ISR, (pxQueue))
+#define traceQUEUE_SEND_FROM_ISR_FAILED(pxQueue) rtos_trace_object(RTOS_TRACE_QUEUE_SEND_FROM_ISR_FAILED, (pxQueue))
+#define traceQUEUE_RECEIVE_FROM_ISR(pxQueue)     rtos_trace_object(RTOS_TRACE_QUEUE_RECEIVE_FROM_ISR, (pxQueue))
+#define traceQUEUE_RECEIVE_FROM_ISR_FAILED(pxQueue) rtos_trace_object(RTOS_TRACE_QUEUE_RECEIVE_FROM_ISR_FAILED, (pxQueue))
+#define traceQUEUE_PEEK_FROM_ISR(pxQueue)        rtos_trace_object(RTOS_TRACE_QUEUE_PEEK_FROM_ISR, (pxQueue))
+
+#define traceTAKE_MUTEX_RECURSIVE(pxMutex)        rtos_trace_object(RTOS_TRACE_MUTEX_TAKE_RECURSIVE, (pxMutex))
+#define traceTAKE_MUTEX_RECURSIVE_FAILED(pxMutex) rtos_trace_object(RTOS_TRACE_MUTEX_TAKE_RECURSIVE_FAILED, (pxMutex))
+#define traceGIVE_MUTEX_RECURSIVE(pxMutex)        rtos_trace_object(RTOS_TRACE_MUTEX_GIVE_RECURSIVE, (pxMutex))
+#define traceGIVE_MUTEX_RECURSIVE_FAILED(pxMutex) rtos_trace_object(RTOS_TRACE_MUTEX_GIVE_RECURSIVE_FAILED, (pxMutex))
+
+#endif
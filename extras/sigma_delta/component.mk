@@ -0,0 +1,10 @@
+# Component makefile for extras/sigma_delta
+#
+# Needs extras/hrtimer as well
+
+INC_DIRS += $(sigma_delta_ROOT)
+
+# args for passing into compile rule generation
+sigma_delta_SRC_DIR =  $(sigma_delta_ROOT)
+
+$(eval $(call component_compile_rules,sigma_delta))
@@ -0,0 +1,148 @@
+/* sigma_delta.c
+ *
+ * Driver for the hardware sigma-delta modulator.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <FreeRTOS.h>
+#include <task.h>
+#include <esp/gpio.h>
+#include "hrtimer.h"
+#include "sigma_delta.h"
+
+#define FADE_TICKS (SIGMA_DELTA_FADE_US / SIGMA_DELTA_DITHER_US)
+
+#if FADE_TICKS < 1 || FADE_TICKS > 0xffff
+#error SIGMA_DELTA_FADE_US must be 1 to 65535 times SIGMA_DELTA_DITHER_US
+#endif
+
+static struct {
+    hrtimer_t timer;
+    bool initialised;
+    uint32_t level;     /* 16 bit level in 16.16 fixed point */
+    int32_t step;       /* per fade step */
+    uint32_t steps;     /* fade steps left */
+    uint16_t fade_ticks; /* timer ticks until the next fade step */
+    uint16_t end;       /* level at the end of the fade */
+    uint16_t error;     /* dither error, in 1/256ths of a target step */
+} sd;
+
+static void IRAM dither_tick(void *arg)
+{
+    if (sd.steps && --sd.fade_ticks == 0) {
+        sd.fade_ticks = FADE_TICKS;
+        sd.level += sd.step;
+        if (--sd.steps == 0)
+            sd.level = (uint32_t)sd.end << 16;
+    }
+
+    /* Error diffusion: take the next target up whenever the accumulated
+       fractional parts reach a whole step */
+    uint16_t level = sd.level >> 16;
+    uint8_t target = level >> 8;
+    sd.error += level & 0xff;
+    if (sd.error >= 256) {
+        sd.error -= 256;
+        if (target < 255)
+            target++;
+    }
+    sigma_delta_set_target(target);
+
+    if (!sd.steps && !(level & 0xff))
+        hrtimer_stop(&sd.timer);
+}
+
+void sigma_delta_enable(uint8_t prescaler, uint8_t target)
+{
+    if (!sd.initialised) {
+        hrtimer_init(&sd.timer, dither_tick, NULL, HRTIMER_ISR);
+        sd.initialised = true;
+    }
+    taskENTER_CRITICAL();
+    sd.level = (uint32_t)target << 24;
+    sd.steps = 0;
+    sd.error = 0;
+    taskEXIT_CRITICAL();
+    GPIO.PWM = GPIO_PWM_ENABLE | VAL2FIELD(GPIO_PWM_PRESCALER, prescaler)
+        | VAL2FIELD(GPIO_PWM_TARGET, target);
+}
+
+void sigma_delta_disable(void)
+{
+    if (sd.initialised)
+        hrtimer_stop(&sd.timer);
+    sd.steps = 0;
+    GPIO.PWM &= ~GPIO_PWM_ENABLE;
+}
+
+void sigma_delta_attach(uint8_t gpio_num)
+{
+    if (gpio_num >= 16)
+        return;
+    gpio_enable(gpio_num, GPIO_OUTPUT);
+    GPIO.CONF[gpio_num] |= GPIO_CONF_SOURCE_PWM;
+}
+
+void sigma_delta_detach(uint8_t gpio_num)
+{
+    if (gpio_num >= 16)
+        return;
+    GPIO.CONF[gpio_num] &= ~GPIO_CONF_SOURCE_PWM;
+}
+
+/* Apply the current level now, and keep the timer running only if
+   there is something for it to do. Called with interrupts disabled. */
+static void update(void)
+{
+    uint16_t level = sd.level >> 16;
+    sigma_delta_set_target(level >> 8);
+    if (sd.steps || (level & 0xff)) {
+        if (!hrtimer_is_active(&sd.timer))
+            hrtimer_start(&sd.timer, SIGMA_DELTA_DITHER_US, SIGMA_DELTA_DITHER_US);
+    } else {
+        hrtimer_stop(&sd.timer);
+    }
+}
+
+void sigma_delta_set_level(uint16_t level)
+{
+    if (!sd.initialised)
+        return;
+    taskENTER_CRITICAL();
+    sd.level = (uint32_t)level << 16;
+    sd.steps = 0;
+    update();
+    taskEXIT_CRITICAL();
+}
+
+uint16_t sigma_delta_get_level(void)
+{
+    return sd.level >> 16;
+}
+
+void sigma_delta_fade(uint16_t level, uint32_t ms)
+{
+    if (!sd.initialised)
+        return;
+    uint32_t steps = (uint64_t)ms * 1000 / SIGMA_DELTA_FADE_US;
+    if (!steps) {
+        sigma_delta_set_level(level);
+        return;
+    }
+    taskENTER_CRITICAL();
+    /* The last step lands on 'level' exactly, so rounding doesn't matter */
+    int64_t delta = ((int64_t)level << 16) - sd.level;
+    sd.step = delta / steps;
+    sd.end = level;
+    sd.steps = steps;
+    sd.fade_ticks = FADE_TICKS;
+    update();
+    taskEXIT_CRITICAL();
+}
+
+bool sigma_delta_fading(void)
+{
+    return sd.steps != 0;
+}
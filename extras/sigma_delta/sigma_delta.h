@@ -0,0 +1,102 @@
+/* sigma_delta.h
+ *
+ * Driver for the hardware sigma-delta modulator.
+ *
+ * The modulator produces a pulse density of target/256, clocked from
+ * the 80MHz APB clock through an 8 bit prescaler (bigger values give
+ * slower edges, which suit LEDs and RC filters better.) Any of GPIO0-15
+ * can be switched from its normal output to the modulator, after which
+ * it needs no CPU time or interrupts at all.
+ *
+ * There is one modulator, so every attached pin has the same output.
+ *
+ * On top of the 8 bit hardware target, sigma_delta_set_level() and
+ * sigma_delta_fade() take 16 bit levels. The fractional part is dithered
+ * by an hrtimer which alternates between the two nearest targets, and
+ * fades are stepped by the same timer. The timer only runs while a
+ * fade is in progress or the level isn't a whole target.
+ *
+ * Dithering shows as flicker of one target step (1/256 of full scale).
+ * A fraction of n/256 with n odd repeats every 256 timer ticks, so its
+ * flicker is at 1/(256 * SIGMA_DELTA_DITHER_US): 78Hz with the default
+ * 50us. Each factor of 2 in n doubles that, e.g. 0x40/256 flickers at
+ * 4 * 78 = 312Hz. Each tick is an interrupt, 20000 a second by default,
+ * so make SIGMA_DELTA_DITHER_US bigger if the CPU time matters more than
+ * the flicker, or use whole targets only.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _SIGMA_DELTA_H
+#define _SIGMA_DELTA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp/gpio_regs.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/* Dither interval */
+#ifndef SIGMA_DELTA_DITHER_US
+#define SIGMA_DELTA_DITHER_US 50
+#endif
+
+/* Fade step interval, a multiple of SIGMA_DELTA_DITHER_US */
+#ifndef SIGMA_DELTA_FADE_US
+#define SIGMA_DELTA_FADE_US 1000
+#endif
+
+/* Enable the modulator. Call from task context. */
+void sigma_delta_enable(uint8_t prescaler, uint8_t target);
+
+/* Disable the modulator, attached pins go low. Stops any fade. */
+void sigma_delta_disable(void);
+
+static inline void sigma_delta_set_prescaler(uint8_t prescaler)
+{
+    GPIO.PWM = SET_FIELD(GPIO.PWM, GPIO_PWM_PRESCALER, prescaler);
+}
+
+static inline uint8_t sigma_delta_get_prescaler(void)
+{
+    return FIELD2VAL(GPIO_PWM_PRESCALER, GPIO.PWM);
+}
+
+/* Set the 8 bit target directly. Overridden by a running fade or
+   dithered level. */
+static inline void sigma_delta_set_target(uint8_t target)
+{
+    GPIO.PWM = SET_FIELD(GPIO.PWM, GPIO_PWM_TARGET, target);
+}
+
+static inline uint8_t sigma_delta_get_target(void)
+{
+    return FIELD2VAL(GPIO_PWM_TARGET, GPIO.PWM);
+}
+
+/* Connect a pin (GPIO0-15) to the modulator, enabling it as an output */
+void sigma_delta_attach(uint8_t gpio_num);
+
+/* Return a pin to normal GPIO output */
+void sigma_delta_detach(uint8_t gpio_num);
+
+/* Set a 16 bit level (target * 256 + fraction), cancelling any fade */
+void sigma_delta_set_level(uint16_t level);
+
+/* Current 16 bit level, part way through a fade if one is running */
+uint16_t sigma_delta_get_level(void);
+
+/* Fade linearly from the current level to 'level' over 'ms' milliseconds */
+void sigma_delta_fade(uint16_t level, uint32_t ms);
+
+/* Returns true while a fade is in progress */
+bool sigma_delta_fading(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
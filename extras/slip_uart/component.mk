@@ -0,0 +1,10 @@
+# Component makefile for extras/slip_uart
+#
+# Needs extras/uart_ring as well
+
+INC_DIRS += $(slip_uart_ROOT)
+
+# args for passing into compile rule generation
+slip_uart_SRC_DIR =  $(slip_uart_ROOT)
+
+$(eval $(call component_compile_rules,slip_uart))
@@ -0,0 +1,225 @@
+/* SLIP network interface over a UART.
+ *
+ * See slip_uart.h for usage.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <string.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+#include <lwip/opt.h>
+#include <lwip/pbuf.h>
+#include <lwip/stats.h>
+#include <lwip/snmp.h>
+#include <lwip/tcpip.h>
+#include <uart_ring.h>
+#include "slip_uart.h"
+
+#define SLIP_END     0xc0
+#define SLIP_ESC     0xdb
+#define SLIP_ESC_END 0xdc
+#define SLIP_ESC_ESC 0xdd
+
+/* Bytes read from the RX ring / encoded for the TX ring at a time */
+#define RX_CHUNK 64
+#define TX_CHUNK 64
+
+typedef enum {
+    RX_DATA,
+    RX_ESCAPE,
+    RX_DISCARD,    /* drop bytes until the next END */
+} rx_state_t;
+
+typedef struct {
+    struct netif netif;
+    int uart_num;
+    ip_addr_t *ipaddr;
+    ip_addr_t *netmask;
+    ip_addr_t *gw;
+    bool set_default;
+    xSemaphoreHandle done;
+    struct pbuf *rx_pbuf;
+    uint16_t rx_len;
+    rx_state_t rx_state;
+} slip_uart_t;
+
+/* One interface, the ESP8266 only has one UART with an RX pin */
+static slip_uart_t slip;
+
+static err_t slip_output(struct netif *netif, struct pbuf *p, ip_addr_t *ipaddr)
+{
+    slip_uart_t *s = netif->state;
+    uint8_t buf[TX_CHUNK];
+    size_t n = 0;
+
+    /* Leading END flushes any line noise received by the host */
+    buf[n++] = SLIP_END;
+    for(struct pbuf *q = p; q != NULL; q = q->next) {
+        const uint8_t *data = q->payload;
+        for(uint16_t i = 0; i < q->len; i++) {
+            if(n > sizeof(buf) - 2) {
+                uart_ring_write(s->uart_num, buf, n, portMAX_DELAY);
+                n = 0;
+            }
+            switch(data[i]) {
+            case SLIP_END:
+                buf[n++] = SLIP_ESC;
+                buf[n++] = SLIP_ESC_END;
+                break;
+            case SLIP_ESC:
+                buf[n++] = SLIP_ESC;
+                buf[n++] = SLIP_ESC_ESC;
+                break;
+            default:
+                buf[n++] = data[i];
+            }
+        }
+    }
+    if(n > sizeof(buf) - 1) {
+        uart_ring_write(s->uart_num, buf, n, portMAX_DELAY);
+        n = 0;
+    }
+    buf[n++] = SLIP_END;
+    uart_ring_write(s->uart_num, buf, n, portMAX_DELAY);
+
+    LINK_STATS_INC(link.xmit);
+    snmp_add_ifoutoctets(netif, p->tot_len);
+    snmp_inc_ifoutucastpkts(netif);
+    return ERR_OK;
+}
+
+static void rx_frame_end(slip_uart_t *s)
+{
+    if(s->rx_state != RX_DISCARD && s->rx_len > 0) {
+        struct pbuf *p = s->rx_pbuf;
+        pbuf_realloc(p, s->rx_len);
+        s->rx_pbuf = NULL;
+        LINK_STATS_INC(link.recv);
+        snmp_add_ifinoctets(&s->netif, s->rx_len);
+        snmp_inc_ifinucastpkts(&s->netif);
+        if(s->netif.input(p, &s->netif) != ERR_OK) {
+            pbuf_free(p);
+        }
+    }
+    s->rx_len = 0;
+    s->rx_state = RX_DATA;
+}
+
+static void rx_byte(slip_uart_t *s, uint8_t c)
+{
+    if(c == SLIP_END) {
+        rx_frame_end(s);
+        return;
+    }
+    switch(s->rx_state) {
+    case RX_DISCARD:
+        return;
+    case RX_ESCAPE:
+        s->rx_state = RX_DATA;
+        if(c == SLIP_ESC_END)
+            c = SLIP_END;
+        else if(c == SLIP_ESC_ESC)
+            c = SLIP_ESC;
+        break;
+    case RX_DATA:
+        if(c == SLIP_ESC) {
+            s->rx_state = RX_ESCAPE;
+            return;
+        }
+        break;
+    }
+
+    if(s->rx_len == SLIP_UART_MTU) {
+        LINK_STATS_INC(link.lenerr);
+        s->rx_state = RX_DISCARD;
+        return;
+    }
+    if(!s->rx_pbuf) {
+        /* Full size PBUF_RAM, so the frame is decoded straight into
+           one contiguous payload and trimmed when it ends */
+        s->rx_pbuf = pbuf_alloc(PBUF_RAW, SLIP_UART_MTU, PBUF_RAM);
+        if(!s->rx_pbuf) {
+            LINK_STATS_INC(link.memerr);
+            LINK_STATS_INC(link.drop);
+            s->rx_state = RX_DISCARD;
+            return;
+        }
+    }
+    ((uint8_t *)s->rx_pbuf->payload)[s->rx_len++] = c;
+}
+
+static void slip_task(void *pvParameters)
+{
+    slip_uart_t *s = pvParameters;
+    uint8_t buf[RX_CHUNK];
+    while(1) {
+        size_t n = uart_ring_read(s->uart_num, buf, sizeof(buf), portMAX_DELAY);
+        for(size_t i = 0; i < n; i++)
+            rx_byte(s, buf[i]);
+    }
+}
+
+static err_t slip_netif_init(struct netif *netif)
+{
+    netif->name[0] = 's';
+    netif->name[1] = 'l';
+    netif->output = slip_output;
+    netif->mtu = SLIP_UART_MTU;
+    netif->flags = NETIF_FLAG_POINTTOPOINT;
+    NETIF_INIT_SNMP(netif, snmp_ifType_slip, 0);
+    return ERR_OK;
+}
+
+/* netif list changes have to happen in the tcpip thread */
+static void slip_add_netif(void *arg)
+{
+    slip_uart_t *s = arg;
+    if(netif_add(&s->netif, s->ipaddr, s->netmask, s->gw, s, slip_netif_init, tcpip_input)) {
+        netif_set_up(&s->netif);
+        if(s->set_default)
+            netif_set_default(&s->netif);
+    } else {
+        s->netif.state = NULL;
+    }
+    xSemaphoreGive(s->done);
+}
+
+struct netif *slip_uart_init(int uart_num, ip_addr_t *ipaddr, ip_addr_t *netmask,
+                             ip_addr_t *gw, bool set_default)
+{
+    slip_uart_t *s = &slip;
+    if(s->netif.state)
+        return NULL; /* already running */
+
+    if(uart_ring_init(uart_num, SLIP_UART_RX_RING_SIZE, SLIP_UART_TX_RING_SIZE) < 0)
+        return NULL;
+
+    s->uart_num = uart_num;
+    s->ipaddr = ipaddr;
+    s->netmask = netmask;
+    s->gw = gw;
+    s->set_default = set_default;
+    s->rx_pbuf = NULL;
+    s->rx_len = 0;
+    s->rx_state = RX_DISCARD; /* until the first END */
+
+    vSemaphoreCreateBinary(s->done);
+    if(!s->done)
+        return NULL;
+    xSemaphoreTake(s->done, 0);
+    if(tcpip_callback(slip_add_netif, s) != ERR_OK) {
+        vSemaphoreDelete(s->done);
+        return NULL;
+    }
+    xSemaphoreTake(s->done, portMAX_DELAY);
+    vSemaphoreDelete(s->done);
+    if(!s->netif.state)
+        return NULL;
+
+    xTaskCreate(slip_task, (signed char *)"slip", SLIP_UART_TASK_STACK_SIZE,
+                s, SLIP_UART_TASK_PRIORITY, NULL);
+    return &s->netif;
+}
@@ -0,0 +1,76 @@
+/* slip_uart.h
+ *
+ * SLIP (RFC 1055) lwIP network interface over a UART, using the
+ * extras/uart_ring driver.
+ *
+ * Gives a wired IP link alongside (or instead of) Wi-Fi, e.g. for
+ * provisioning or for running the network stack against a Linux host
+ * without radio noise. On the host:
+ *
+ *   slattach -L -p slip -s 921600 /dev/ttyUSB0 &
+ *   ip addr add 192.168.240.1 peer 192.168.240.2 dev sl0
+ *   ip link set sl0 up mtu 1500
+ *
+ * Received bytes are collected by the UART interrupt handler and
+ * handed over in batches (when the RX FIFO threshold is reached or on
+ * the RX timeout at the end of a burst), so the "slip" task wakes
+ * once per batch rather than per byte. Frames are decoded straight
+ * into a pbuf and passed to the tcpip thread. Transmitted frames are
+ * encoded in small chunks into the TX ring from the tcpip thread.
+ *
+ * If UART0 is used, stdout shares the line with the SLIP frames, so
+ * the program shouldn't print once the interface is up.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _SLIP_UART_H
+#define _SLIP_UART_H
+
+#include <stdbool.h>
+#include <lwip/netif.h>
+#include <lwip/ip_addr.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/* Largest IP packet sent or received */
+#ifndef SLIP_UART_MTU
+#define SLIP_UART_MTU 1500
+#endif
+
+/* uart_ring sizes, if slip_uart_init sets up the UART */
+#ifndef SLIP_UART_RX_RING_SIZE
+#define SLIP_UART_RX_RING_SIZE 2048
+#endif
+#ifndef SLIP_UART_TX_RING_SIZE
+#define SLIP_UART_TX_RING_SIZE 2048
+#endif
+
+#ifndef SLIP_UART_TASK_PRIORITY
+#define SLIP_UART_TASK_PRIORITY (configMAX_PRIORITIES - 4)
+#endif
+#ifndef SLIP_UART_TASK_STACK_SIZE
+#define SLIP_UART_TASK_STACK_SIZE 384
+#endif
+
+/* Bring up a SLIP interface on 'uart_num' (set the baud rate first
+   with uart_set_baud.) 'ipaddr' is the local address and 'gw' the
+   address of the host at the other end of the line. If 'set_default'
+   is true the interface becomes lwIP's default route.
+
+   Must be called from task context, after the network stack has
+   started (i.e. not directly from user_init.)
+
+   Returns the lwIP netif, or NULL on failure.
+*/
+struct netif *slip_uart_init(int uart_num, ip_addr_t *ipaddr, ip_addr_t *netmask,
+                             ip_addr_t *gw, bool set_default);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
@@ -61,13 +61,14 @@ int sntp_set_servers(char *server_url[], int num_servers);
 void sntp_set_update_delay(uint32_t ms);
 
 /*
- * Returns the time read from RTC counter, in seconds from Epoch. If
+ * Returns the current time (the monotonic system clock, see
+ * esp/systime.h, plus the last SNTP offset) in seconds from Epoch. If
  * us is not null, it will be filled with the microseconds.
  */
 time_t sntp_get_rtc_time(int32_t *us);
 
 /*
- * Update RTC timer. This function is called by the SNTP module each time
+ * Update the time offset. This function is called by the SNTP module each time
  * an SNTP update is received.
  */
 void sntp_update_rtc(time_t t, uint32_t us);
@@ -0,0 +1,10 @@
+# Component makefile for extras/softuart
+#
+# Needs extras/hrtimer as well
+
+INC_DIRS += $(softuart_ROOT)
+
+# args for passing into compile rule generation
+softuart_SRC_DIR =  $(softuart_ROOT)
+
+$(eval $(call component_compile_rules,softuart))
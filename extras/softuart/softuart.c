@@ -0,0 +1,421 @@
+/* Interrupt driven software UARTs on arbitrary GPIOs.
+ *
+ * See softuart.h for usage.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <errno.h>
+#include <string.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+#include <common_macros.h>
+#include <xtensa_ops.h>
+#include <esp/gpio.h>
+#include <esp/clocks.h>
+#include <esp/interrupts.h>
+#include <hrtimer.h>
+#include "softuart.h"
+
+#if (SOFTUART_RX_RING_SIZE & (SOFTUART_RX_RING_SIZE - 1)) || (SOFTUART_TX_RING_SIZE & (SOFTUART_TX_RING_SIZE - 1))
+#error "softuart ring sizes must be powers of 2"
+#endif
+
+#define RX_MASK (SOFTUART_RX_RING_SIZE - 1)
+#define TX_MASK (SOFTUART_TX_RING_SIZE - 1)
+
+/* 8N1: start bit, 8 data bits, stop bit */
+#define FRAME_BITS 10
+#define STOP_BIT BIT(9)
+
+/* rx_inv_bit fixed point shift, bit positions are computed with a
+   multiply rather than a (software) divide in the edge interrupt */
+#define INV_SHIFT 24
+
+typedef struct {
+    bool open;
+    int8_t rx_gpio;
+    int8_t tx_gpio;
+    int8_t de_gpio;
+    uint32_t baud;
+
+    /* Receiver, timed in CPU cycles */
+    uint32_t rx_half_bit;       /* cycles in half a bit */
+    uint32_t rx_frame_cycles;   /* cycles in a whole frame */
+    uint32_t rx_inv_bit;        /* 2^INV_SHIFT / cycles per bit */
+    uint32_t rx_timeout_ticks;  /* hrtimer counts from start edge to mid stop bit */
+    volatile bool rx_busy;
+    uint32_t rx_start;          /* CCOUNT at the start bit edge */
+    uint8_t rx_pos;             /* bits of the frame accounted for so far */
+    uint8_t rx_level;           /* line level since the last edge */
+    uint16_t rx_frame;
+    hrtimer_t rx_timer;
+    uint8_t rx_buf[SOFTUART_RX_RING_SIZE];
+    volatile uint32_t rx_head;
+    volatile uint32_t rx_tail;
+    xSemaphoreHandle rx_sem;
+
+    /* Transmitter, timed in hrtimer counts */
+    uint32_t tx_bit_q8;         /* hrtimer counts per bit, 24.8 fixed point */
+    volatile bool tx_busy;
+    uint16_t tx_frame;
+    uint8_t tx_bit;             /* next bit boundary the timer is set for */
+    uint8_t tx_frame_frac;      /* fractional part of tx_frame_start */
+    uint32_t tx_frame_start;
+    hrtimer_t tx_timer;
+    uint8_t tx_buf[SOFTUART_TX_RING_SIZE];
+    volatile uint32_t tx_head;
+    volatile uint32_t tx_tail;
+    xSemaphoreHandle tx_sem;
+
+    softuart_stats_t stats;
+} softuart_t;
+
+static softuart_t channels[SOFTUART_MAX_CHANNELS];
+static softuart_t *rx_channels[16];
+
+static cpu_freq_listener_t cpu_freq_listener;
+static bool cpu_freq_listening;
+
+static void set_rx_timing(softuart_t *ch, uint32_t cpu_mhz)
+{
+    uint32_t bit_cycles = cpu_mhz * 1000000 / ch->baud;
+    ch->rx_half_bit = bit_cycles / 2;
+    ch->rx_frame_cycles = bit_cycles * FRAME_BITS;
+    ch->rx_inv_bit = (1 << INV_SHIFT) / bit_cycles;
+}
+
+/* CCOUNT runs at the CPU clock. A byte being received during the
+   switch may be garbled. */
+static void cpu_freq_changed(uint32_t cpu_mhz, void *arg)
+{
+    for(int i = 0; i < SOFTUART_MAX_CHANNELS; i++) {
+        if(channels[i].open)
+            set_rx_timing(&channels[i], cpu_mhz);
+    }
+}
+
+/* Account for the frame bits up to bit boundary 'n' at the current
+   line level */
+static inline void rx_fill(softuart_t *ch, uint32_t n)
+{
+    if(n > FRAME_BITS)
+        n = FRAME_BITS;
+    if(n <= ch->rx_pos)
+        return;
+    if(ch->rx_level)
+        ch->rx_frame |= BIT(n) - BIT(ch->rx_pos);
+    ch->rx_pos = n;
+}
+
+static void IRAM rx_complete(softuart_t *ch, portBASE_TYPE *woken)
+{
+    rx_fill(ch, FRAME_BITS);
+    ch->rx_busy = false;
+    if(!(ch->rx_frame & STOP_BIT)) {
+        ch->stats.rx_framing_errors++;
+        return;
+    }
+    uint32_t head = ch->rx_head;
+    uint32_t used = head - ch->rx_tail;
+    if(used == SOFTUART_RX_RING_SIZE) {
+        ch->stats.rx_overruns++;
+        return;
+    }
+    ch->rx_buf[head & RX_MASK] = ch->rx_frame >> 1;
+    ch->rx_head = head + 1;
+    ch->stats.rx_bytes++;
+    /* The reader only waits when the ring is empty */
+    if(used == 0)
+        xSemaphoreGiveFromISR(ch->rx_sem, woken);
+}
+
+static void IRAM rx_edge(uint8_t gpio_num)
+{
+    uint32_t now, end;
+    RSR(now, ccount);
+    softuart_t *ch = rx_channels[gpio_num];
+    uint32_t level = gpio_read(gpio_num) ? 1 : 0;
+    portBASE_TYPE woken = pdFALSE;
+
+    if(ch->rx_busy) {
+        uint32_t elapsed = now - ch->rx_start + ch->rx_half_bit;
+        if(elapsed >= ch->rx_frame_cycles) {
+            /* Completion timer hasn't run yet, this is likely the next
+               start bit */
+            hrtimer_stop(&ch->rx_timer);
+            rx_complete(ch, &woken);
+        } else {
+            uint32_t n = (elapsed * ch->rx_inv_bit) >> INV_SHIFT;
+            if(n == 0) {
+                /* glitch rather than a start bit */
+                hrtimer_stop(&ch->rx_timer);
+                ch->rx_busy = false;
+                ch->stats.rx_noise++;
+            } else {
+                rx_fill(ch, n);
+                ch->rx_level = level;
+            }
+        }
+    }
+
+    if(!ch->rx_busy && level == 0) {
+        ch->rx_busy = true;
+        ch->rx_start = now;
+        ch->rx_pos = 0;
+        ch->rx_level = 0;
+        ch->rx_frame = 0;
+        hrtimer_start_at(&ch->rx_timer, hrtimer_get_ticks() + ch->rx_timeout_ticks, 0);
+    }
+
+    RSR(end, ccount);
+    ch->stats.rx_cycles += end - now;
+    if(woken)
+        portYIELD();
+}
+
+/* Fires half way through the stop bit */
+static void IRAM rx_timeout(void *arg)
+{
+    uint32_t start, end;
+    RSR(start, ccount);
+    softuart_t *ch = arg;
+    portBASE_TYPE woken = pdFALSE;
+    if(ch->rx_busy)
+        rx_complete(ch, &woken);
+    RSR(end, ccount);
+    ch->stats.rx_cycles += end - start;
+    if(woken)
+        portYIELD();
+}
+
+static inline void tx_load_frame(softuart_t *ch)
+{
+    uint32_t tail = ch->tx_tail;
+    ch->tx_frame = (ch->tx_buf[tail & TX_MASK] << 1) | STOP_BIT;
+    ch->tx_tail = tail + 1;
+    ch->tx_bit = 0;
+    ch->stats.tx_bytes++;
+}
+
+/* Called at each point where the TX level changes, and at the end of
+   each frame. Sets the line and schedules the next change. */
+static void IRAM tx_edge(softuart_t *ch, portBASE_TYPE *woken)
+{
+    if(ch->tx_bit >= FRAME_BITS) {
+        /* Stop bit finished */
+        if(ch->tx_head == ch->tx_tail) {
+            ch->tx_busy = false;
+            if(ch->de_gpio != SOFTUART_NO_PIN)
+                gpio_write(ch->de_gpio, false);
+            xSemaphoreGiveFromISR(ch->tx_sem, woken);
+            return;
+        }
+        uint32_t t = ch->tx_frame_frac + FRAME_BITS * ch->tx_bit_q8;
+        ch->tx_frame_start += t >> 8;
+        ch->tx_frame_frac = t & 0xff;
+        bool was_full = ch->tx_head - ch->tx_tail == SOFTUART_TX_RING_SIZE;
+        tx_load_frame(ch);
+        if(was_full)
+            xSemaphoreGiveFromISR(ch->tx_sem, woken);
+    }
+
+    uint32_t k = ch->tx_bit;
+    uint32_t level = (ch->tx_frame >> k) & 1;
+    gpio_write(ch->tx_gpio, level);
+    do {
+        k++;
+    } while(k < FRAME_BITS && ((ch->tx_frame >> k) & 1) == level);
+    ch->tx_bit = k;
+    hrtimer_start_at(&ch->tx_timer,
+                     ch->tx_frame_start + ((ch->tx_frame_frac + k * ch->tx_bit_q8) >> 8), 0);
+}
+
+static void IRAM tx_timeout(void *arg)
+{
+    portBASE_TYPE woken = pdFALSE;
+    tx_edge(arg, &woken);
+    if(woken)
+        portYIELD();
+}
+
+/* Called with interrupts disabled, with data in the TX ring */
+static void tx_start(softuart_t *ch)
+{
+    ch->tx_busy = true;
+    if(ch->de_gpio != SOFTUART_NO_PIN)
+        gpio_write(ch->de_gpio, true);
+    ch->tx_frame_start = hrtimer_get_ticks();
+    ch->tx_frame_frac = 0;
+    tx_load_frame(ch);
+    tx_edge(ch, NULL);
+}
+
+static bool valid_pin(int gpio)
+{
+    return gpio == SOFTUART_NO_PIN || (gpio >= 0 && gpio < 16);
+}
+
+int softuart_open(int channel, const softuart_config_t *config)
+{
+    if(channel < 0 || channel >= SOFTUART_MAX_CHANNELS
+       || config->baud < SOFTUART_MIN_BAUD || config->baud > SOFTUART_MAX_BAUD
+       || !valid_pin(config->rx_gpio) || !valid_pin(config->tx_gpio) || !valid_pin(config->de_gpio)
+       || (config->rx_gpio == SOFTUART_NO_PIN && config->tx_gpio == SOFTUART_NO_PIN))
+        return -EINVAL;
+    if(config->rx_gpio != SOFTUART_NO_PIN && rx_channels[config->rx_gpio])
+        return -EBUSY;
+
+    softuart_t *ch = &channels[channel];
+    if(ch->open)
+        return -EBUSY;
+
+    memset(ch, 0, sizeof(*ch));
+    ch->rx_gpio = config->rx_gpio;
+    ch->tx_gpio = config->tx_gpio;
+    ch->de_gpio = config->de_gpio;
+    ch->baud = config->baud;
+    set_rx_timing(ch, cpu_freq_get());
+    ch->rx_timeout_ticks = HRTIMER_US_TO_TICKS(1000000) * 19 / (2 * ch->baud);
+    ch->tx_bit_q8 = (HRTIMER_US_TO_TICKS(1000000) << 8) / ch->baud;
+    ch->tx_bit = FRAME_BITS;
+    vSemaphoreCreateBinary(ch->rx_sem);
+    vSemaphoreCreateBinary(ch->tx_sem);
+    xSemaphoreTake(ch->rx_sem, 0);
+    xSemaphoreTake(ch->tx_sem, 0);
+    hrtimer_init(&ch->rx_timer, rx_timeout, ch, HRTIMER_ISR);
+    hrtimer_init(&ch->tx_timer, tx_timeout, ch, HRTIMER_ISR);
+
+    if(!cpu_freq_listening) {
+        cpu_freq_add_listener(&cpu_freq_listener, cpu_freq_changed, NULL);
+        cpu_freq_listening = true;
+    }
+
+    if(ch->de_gpio != SOFTUART_NO_PIN) {
+        gpio_enable(ch->de_gpio, GPIO_OUTPUT);
+        gpio_write(ch->de_gpio, false);
+    }
+    if(ch->tx_gpio != SOFTUART_NO_PIN) {
+        gpio_enable(ch->tx_gpio, GPIO_OUTPUT);
+        gpio_write(ch->tx_gpio, true); /* idle */
+    }
+    ch->open = true;
+    if(ch->rx_gpio != SOFTUART_NO_PIN) {
+        gpio_enable(ch->rx_gpio, GPIO_INPUT);
+        gpio_set_pullup(ch->rx_gpio, true, false);
+        rx_channels[ch->rx_gpio] = ch;
+        gpio_set_pin_handler(ch->rx_gpio, rx_edge);
+        gpio_set_interrupt(ch->rx_gpio, GPIO_INTTYPE_EDGE_ANY);
+    }
+    return 0;
+}
+
+void softuart_close(int channel)
+{
+    softuart_t *ch = &channels[channel];
+    if(!ch->open)
+        return;
+    if(ch->rx_gpio != SOFTUART_NO_PIN) {
+        gpio_set_interrupt(ch->rx_gpio, GPIO_INTTYPE_NONE);
+        gpio_set_pin_handler(ch->rx_gpio, NULL);
+        rx_channels[ch->rx_gpio] = NULL;
+    }
+    uint32_t ps = _xt_disable_interrupts();
+    hrtimer_stop(&ch->rx_timer);
+    hrtimer_stop(&ch->tx_timer);
+    ch->open = false;
+    ch->tx_busy = false;
+    _xt_restore_interrupts(ps);
+    if(ch->tx_gpio != SOFTUART_NO_PIN)
+        gpio_write(ch->tx_gpio, true);
+    if(ch->de_gpio != SOFTUART_NO_PIN)
+        gpio_write(ch->de_gpio, false);
+    vSemaphoreDelete(ch->rx_sem);
+    vSemaphoreDelete(ch->tx_sem);
+}
+
+size_t softuart_write(int channel, const void *buf, size_t len, portTickType timeout)
+{
+    softuart_t *ch = &channels[channel];
+    const uint8_t *p = buf;
+    size_t written = 0;
+
+    if(!ch->open || ch->tx_gpio == SOFTUART_NO_PIN)
+        return 0;
+
+    xTimeOutType time_out;
+    vTaskSetTimeOutState(&time_out);
+    while(1) {
+        uint32_t ps = _xt_disable_interrupts();
+        uint32_t head = ch->tx_head;
+        while(written < len && head - ch->tx_tail < SOFTUART_TX_RING_SIZE)
+            ch->tx_buf[head++ & TX_MASK] = p[written++];
+        ch->tx_head = head;
+        if(!ch->tx_busy && head != ch->tx_tail)
+            tx_start(ch);
+        _xt_restore_interrupts(ps);
+
+        if(written == len
+           || xTaskCheckForTimeOut(&time_out, &timeout) != pdFALSE
+           || xSemaphoreTake(ch->tx_sem, timeout) != pdTRUE)
+            break;
+    }
+    return written;
+}
+
+size_t softuart_read(int channel, void *buf, size_t len, portTickType timeout)
+{
+    softuart_t *ch = &channels[channel];
+    uint8_t *p = buf;
+
+    if(!ch->open || ch->rx_gpio == SOFTUART_NO_PIN || len == 0)
+        return 0;
+
+    xTimeOutType time_out;
+    vTaskSetTimeOutState(&time_out);
+    while(ch->rx_head == ch->rx_tail) {
+        if(xTaskCheckForTimeOut(&time_out, &timeout) != pdFALSE
+           || xSemaphoreTake(ch->rx_sem, timeout) != pdTRUE)
+            return 0;
+    }
+
+    uint32_t tail = ch->rx_tail;
+    uint32_t count = ch->rx_head - tail;
+    if(count > len)
+        count = len;
+    for(uint32_t i = 0; i < count; i++)
+        p[i] = ch->rx_buf[tail++ & RX_MASK];
+    ch->rx_tail = tail;
+    return count;
+}
+
+size_t softuart_rx_available(int channel)
+{
+    softuart_t *ch = &channels[channel];
+    return ch->rx_head - ch->rx_tail;
+}
+
+bool softuart_flush(int channel, portTickType timeout)
+{
+    softuart_t *ch = &channels[channel];
+    xTimeOutType time_out;
+    vTaskSetTimeOutState(&time_out);
+    while(ch->tx_busy) {
+        if(xTaskCheckForTimeOut(&time_out, &timeout) != pdFALSE
+           || xSemaphoreTake(ch->tx_sem, timeout) != pdTRUE)
+            return false;
+    }
+    return true;
+}
+
+void softuart_get_stats(int channel, softuart_stats_t *stats, bool reset)
+{
+    softuart_t *ch = &channels[channel];
+    uint32_t ps = _xt_disable_interrupts();
+    *stats = ch->stats;
+    if(reset)
+        memset(&ch->stats, 0, sizeof(ch->stats));
+    _xt_restore_interrupts(ps);
+}
@@ -0,0 +1,112 @@
+/* softuart.h
+ *
+ * Interrupt driven software UARTs (8N1) on arbitrary GPIOs.
+ *
+ * Receiving doesn't poll or busy-wait: each edge on the RX pin
+ * raises a GPIO interrupt which timestamps it with CCOUNT, and the
+ * bits between two edges are worked out from the time difference. An
+ * hrtimer fires in the stop bit to complete bytes which end in a run
+ * of 1 bits (no final edge.) Decoded bytes go into an RX ring.
+ *
+ * Transmitting is timed by hrtimer: the timer is only
+ * scheduled for the points where the TX level actually changes, not
+ * once per bit.
+ *
+ * SOFTUART_MAX_CHANNELS channels can be open at once. All four at
+ * 57600 baud is the design target; examples/softuart runs that case
+ * and prints the CPU cycles spent per received byte. The receiver
+ * tolerates interrupt latency of up to about a quarter of a bit time.
+ *
+ * An optional driver-enable pin (RS-485 transceiver DE/RE) is held
+ * high while a channel is transmitting.
+ *
+ * Uses extras/hrtimer, and gpio_set_pin_handler() for the RX pins.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _SOFTUART_H
+#define _SOFTUART_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <FreeRTOS.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#ifndef SOFTUART_MAX_CHANNELS
+#define SOFTUART_MAX_CHANNELS 4
+#endif
+
+/* Ring sizes per channel, must be powers of 2 */
+#ifndef SOFTUART_RX_RING_SIZE
+#define SOFTUART_RX_RING_SIZE 128
+#endif
+#ifndef SOFTUART_TX_RING_SIZE
+#define SOFTUART_TX_RING_SIZE 64
+#endif
+
+#define SOFTUART_MIN_BAUD 1200
+#define SOFTUART_MAX_BAUD 115200
+
+/* Pass for an unused pin */
+#define SOFTUART_NO_PIN -1
+
+typedef struct {
+    uint32_t baud;
+    int8_t rx_gpio;     /* SOFTUART_NO_PIN for TX only */
+    int8_t tx_gpio;     /* SOFTUART_NO_PIN for RX only */
+    int8_t de_gpio;     /* RS-485 driver enable, or SOFTUART_NO_PIN */
+} softuart_config_t;
+
+typedef struct {
+    uint32_t rx_bytes;
+    uint32_t tx_bytes;
+    uint32_t rx_framing_errors; /* stop bit was 0 */
+    uint32_t rx_noise;          /* start bit shorter than half a bit */
+    uint32_t rx_overruns;       /* bytes lost because the RX ring was full */
+    /* CPU cycles spent in the RX edge & byte completion handlers,
+       divide by rx_bytes for the cost per byte. Doesn't include
+       interrupt entry/dispatch overhead. */
+    uint32_t rx_cycles;
+} softuart_stats_t;
+
+/* Open a channel (0 to SOFTUART_MAX_CHANNELS-1.) Configures the pins.
+   Must be called from task context.
+
+   Returns 0 on success, -EINVAL for a bad channel, baud rate or pin,
+   -EBUSY if the channel is already open.
+*/
+int softuart_open(int channel, const softuart_config_t *config);
+
+/* Close a channel and release its pins. Data still in the TX ring is
+   discarded. */
+void softuart_close(int channel);
+
+/* Queue up to 'len' bytes for transmission, waiting up to 'timeout'
+   ticks for ring space if necessary. Returns the number queued. */
+size_t softuart_write(int channel, const void *buf, size_t len, portTickType timeout);
+
+/* Read up to 'len' bytes, waiting up to 'timeout' ticks for at least
+   one byte to arrive. Returns the number read. */
+size_t softuart_read(int channel, void *buf, size_t len, portTickType timeout);
+
+/* Number of received bytes waiting in the RX ring */
+size_t softuart_rx_available(int channel);
+
+/* Wait up to 'timeout' ticks until everything queued has been sent
+   (including the last stop bit.) Returns true if so. */
+bool softuart_flush(int channel, portTickType timeout);
+
+/* Copy the channel counters, optionally resetting them */
+void softuart_get_stats(int channel, softuart_stats_t *stats, bool reset);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,8 @@
+# Component makefile for extras/spi_bus
+
+INC_DIRS += $(spi_bus_ROOT)
+
+# args for passing into compile rule generation
+spi_bus_SRC_DIR =  $(spi_bus_ROOT)
+
+$(eval $(call component_compile_rules,spi_bus))
@@ -0,0 +1,232 @@
+/* Shared SPI bus manager.
+ *
+ * See spi_bus.h for usage.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <string.h>
+#include <errno.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+#include <esp/spi.h>
+#include <esp/gpio.h>
+#include <esp/iomux_regs.h>
+#include "spi_bus.h"
+
+typedef struct {
+    bool initialised;
+    bool minimal_pins;
+    xSemaphoreHandle mutex;
+    xTaskHandle owner;            /* task holding the mutex */
+    spi_device_t *owner_dev;
+    uint8_t depth;                /* nested acquires by the owner */
+    spi_device_t *active;         /* device the registers are set up for */
+    spi_trans_t *queue;           /* sorted by priority, FIFO within one */
+    xSemaphoreHandle queue_sem;   /* given when the queue becomes non-empty */
+    bool task_started;
+} spi_bus_t;
+
+static spi_bus_t buses[2];
+
+static uint32_t clock_equ_sys_bit(uint8_t bus)
+{
+    return bus == 0 ? IOMUX_CONF_SPI0_CLOCK_EQU_SYS_CLOCK : IOMUX_CONF_SPI1_CLOCK_EQU_SYS_CLOCK;
+}
+
+static void load_registers(spi_device_t *dev)
+{
+    uint8_t bus = dev->bus;
+    SPI(bus).USER0 = dev->user0;
+    SPI(bus).CTRL0 = dev->ctrl0;
+    SPI(bus).CLOCK = dev->clock;
+    SPI(bus).PIN = dev->pin;
+    if(dev->clock_equ_sys)
+        IOMUX.CONF |= clock_equ_sys_bit(bus);
+    else
+        IOMUX.CONF &= ~clock_equ_sys_bit(bus);
+}
+
+static void save_registers(spi_device_t *dev)
+{
+    uint8_t bus = dev->bus;
+    dev->user0 = SPI(bus).USER0;
+    dev->ctrl0 = SPI(bus).CTRL0;
+    dev->clock = SPI(bus).CLOCK;
+    dev->pin = SPI(bus).PIN;
+    dev->clock_equ_sys = IOMUX.CONF & clock_equ_sys_bit(bus);
+}
+
+bool spi_bus_init(uint8_t bus, bool minimal_pins)
+{
+    if(bus > 1)
+        return false;
+    spi_bus_t *b = &buses[bus];
+    if(b->initialised)
+        return b->minimal_pins == minimal_pins;
+
+    /* Pin muxing, anything else is overwritten per device */
+    if(!spi_init(bus, SPI_MODE0, SPI_FREQ_DIV_1M, true, SPI_LITTLE_ENDIAN, minimal_pins))
+        return false;
+    b->mutex = xSemaphoreCreateMutex();
+    vSemaphoreCreateBinary(b->queue_sem);
+    if(b->queue_sem)
+        xSemaphoreTake(b->queue_sem, 0);
+    if(!b->mutex || !b->queue_sem)
+        return false;
+    b->minimal_pins = minimal_pins;
+    b->initialised = true;
+    return true;
+}
+
+bool spi_bus_add_device(spi_device_t *dev, uint8_t bus, const spi_device_config_t *config)
+{
+    if(bus > 1 || !buses[bus].initialised)
+        return false;
+    spi_bus_t *b = &buses[bus];
+    if(config->cs_gpio == SPI_BUS_CS_HW && b->minimal_pins)
+        return false;
+
+    dev->bus = bus;
+    dev->cs_gpio = config->cs_gpio;
+    dev->priority = config->priority;
+    if(dev->cs_gpio != SPI_BUS_CS_HW) {
+        gpio_enable(dev->cs_gpio, GPIO_OUTPUT);
+        gpio_write(dev->cs_gpio, true);
+    }
+
+    /* Build the register image with the core setters, so the encoding
+       is exactly theirs, then leave the bus for the next transaction
+       to load whichever device it is for */
+    xSemaphoreTake(b->mutex, portMAX_DELAY);
+    SPI(bus).USER0 = SPI_USER0_MOSI | SPI_USER0_CLOCK_IN_EDGE | SPI_USER0_DUPLEX |
+        (dev->cs_gpio == SPI_BUS_CS_HW ? (SPI_USER0_CS_HOLD | SPI_USER0_CS_SETUP) : 0);
+    spi_set_frequency_div(bus, config->freq_divider);
+    spi_set_mode(bus, config->mode);
+    spi_set_msb(bus, config->msb);
+    spi_set_endianness(bus, config->endianness);
+    if(dev->cs_gpio == SPI_BUS_CS_HW)
+        SPI(bus).PIN &= ~SPI_PIN_CS0_DISABLE;
+    else
+        SPI(bus).PIN |= SPI_PIN_CS0_DISABLE;
+    save_registers(dev);
+    b->active = NULL;
+    xSemaphoreGive(b->mutex);
+    return true;
+}
+
+bool spi_device_acquire(spi_device_t *dev, portTickType timeout)
+{
+    spi_bus_t *b = &buses[dev->bus];
+    xTaskHandle self = xTaskGetCurrentTaskHandle();
+
+    if(b->owner == self) {
+        if(b->owner_dev != dev)
+            return false; /* can't switch device inside an acquired section */
+        b->depth++;
+        return true;
+    }
+    if(xSemaphoreTake(b->mutex, timeout) != pdTRUE)
+        return false;
+    b->owner = self;
+    b->owner_dev = dev;
+    b->depth = 1;
+
+    if(b->active != dev) {
+        load_registers(dev);
+        b->active = dev;
+    }
+    if(dev->cs_gpio != SPI_BUS_CS_HW)
+        gpio_write(dev->cs_gpio, false);
+    return true;
+}
+
+void spi_device_release(spi_device_t *dev)
+{
+    spi_bus_t *b = &buses[dev->bus];
+    if(b->owner != xTaskGetCurrentTaskHandle() || --b->depth)
+        return;
+    if(dev->cs_gpio != SPI_BUS_CS_HW)
+        gpio_write(dev->cs_gpio, true);
+    b->owner = NULL;
+    b->owner_dev = NULL;
+    xSemaphoreGive(b->mutex);
+}
+
+size_t spi_device_transfer(spi_device_t *dev, const void *out_data, void *in_data,
+                           size_t len, spi_word_size_t word_size)
+{
+    if(!spi_device_acquire(dev, portMAX_DELAY))
+        return 0;
+    /* Long transfers on bus 1 let the CPU go while the interrupt
+       handler feeds the bus */
+    size_t res = len;
+    if(dev->bus != 1 || len * word_size < SPI_BUS_ASYNC_MIN_BYTES
+       || !spi_transfer_async(1, out_data, in_data, len, word_size, NULL, NULL))
+        res = spi_transfer(dev->bus, out_data, in_data, len, word_size);
+    else
+        spi_transfer_wait(1, portMAX_DELAY);
+    spi_device_release(dev);
+    return res;
+}
+
+static void spi_bus_task(void *pvParameters)
+{
+    spi_bus_t *b = pvParameters;
+    while(1) {
+        taskENTER_CRITICAL();
+        spi_trans_t *trans = b->queue;
+        if(trans) {
+            b->queue = trans->next;
+            trans->queued = false;
+        }
+        taskEXIT_CRITICAL();
+        if(!trans) {
+            xSemaphoreTake(b->queue_sem, portMAX_DELAY);
+            continue;
+        }
+
+        trans->result = spi_device_transfer(trans->device, trans->out_data, trans->in_data,
+                                            trans->len, trans->word_size);
+        if(trans->callback)
+            trans->callback(trans);
+        /* A requeued transfer completes when it runs again. Once done
+           is set the submitter may reuse trans, so don't touch it
+           after that. */
+        if(!trans->queued)
+            trans->done = true;
+    }
+}
+
+int spi_device_queue(spi_trans_t *trans)
+{
+    spi_bus_t *b = &buses[trans->device->bus];
+
+    if(!b->task_started) {
+        taskENTER_CRITICAL();
+        bool start = !b->task_started;
+        b->task_started = true;
+        taskEXIT_CRITICAL();
+        if(start)
+            xTaskCreate(spi_bus_task, (signed char *)"spibus", SPI_BUS_TASK_STACK_SIZE,
+                        b, SPI_BUS_TASK_PRIORITY, NULL);
+    }
+
+    taskENTER_CRITICAL();
+    if(trans->queued) {
+        taskEXIT_CRITICAL();
+        return -EBUSY;
+    }
+    trans->done = false;
+    trans->queued = true;
+    spi_trans_t **p = &b->queue;
+    while(*p && (*p)->device->priority >= trans->device->priority)
+        p = &(*p)->next;
+    trans->next = *p;
+    *p = trans;
+    taskEXIT_CRITICAL();
+    xSemaphoreGive(b->queue_sem);
+    return 0;
+}
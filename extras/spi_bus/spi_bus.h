@@ -0,0 +1,139 @@
+/* spi_bus.h
+ *
+ * Shared SPI bus manager: several devices (each with their own mode,
+ * clock, bit & byte order and chip select) on one hardware SPI bus.
+ *
+ * Each device keeps a cached image of the bus configuration registers,
+ * built once by spi_bus_add_device(). The registers are only rewritten
+ * when a transaction is for a different device from the previous one,
+ * so back-to-back transfers to the same device cost nothing extra.
+ *
+ * Access is serialised with a mutex. Simple users call
+ * spi_device_transfer(), sequences which must not be interleaved with
+ * other devices (e.g. command then data, with a GPIO chip select held
+ * low throughout) are bracketed by spi_device_acquire()/release().
+ * Transfers can also be queued with spi_device_queue(), to be carried
+ * out by a per-bus worker task in device priority order.
+ *
+ * Chip selects are either the hardware CS0 pin (GPIO15 on bus 1, which
+ * the hardware asserts per 64 byte transaction) or any GPIO, driven by
+ * the bus manager and held for the whole transfer or acquired section.
+ *
+ * Don't use the core spi_set_* functions on a managed bus.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _SPI_BUS_H
+#define _SPI_BUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <FreeRTOS.h>
+#include <esp/spi.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#ifndef SPI_BUS_TASK_PRIORITY
+#define SPI_BUS_TASK_PRIORITY (configMAX_PRIORITIES - 3)
+#endif
+#ifndef SPI_BUS_TASK_STACK_SIZE
+#define SPI_BUS_TASK_STACK_SIZE 256
+#endif
+
+/* Transfers on bus 1 at least this long use spi_transfer_async(), so
+   the calling task blocks rather than spins */
+#ifndef SPI_BUS_ASYNC_MIN_BYTES
+#define SPI_BUS_ASYNC_MIN_BYTES 256
+#endif
+
+/* cs_gpio value for the hardware chip select */
+#define SPI_BUS_CS_HW -1
+
+typedef struct {
+    spi_mode_t mode;
+    uint32_t freq_divider;        /* see SPI_GET_FREQ_DIV() */
+    bool msb;                     /* MSB first if true */
+    spi_endianness_t endianness;
+    int8_t cs_gpio;               /* GPIO number, or SPI_BUS_CS_HW */
+    uint8_t priority;             /* for queued transfers, higher goes first */
+} spi_device_config_t;
+
+/* Device handle, allocated by the caller. Fields are private. */
+typedef struct spi_device {
+    uint8_t bus;
+    int8_t cs_gpio;
+    uint8_t priority;
+    /* register images */
+    uint32_t user0;
+    uint32_t ctrl0;
+    uint32_t clock;
+    uint32_t pin;
+    bool clock_equ_sys;
+} spi_device_t;
+
+struct spi_trans;
+typedef void (*spi_trans_callback_t)(struct spi_trans *trans);
+
+/* Queued transfer, see spi_device_queue(). The caller fills in the
+   first group of fields, zeroes the rest before first use (an
+   initialiser does that) and must keep the structure (and buffers)
+   valid until the transfer is done. */
+typedef struct spi_trans {
+    spi_device_t *device;
+    const void *out_data;
+    void *in_data;                /* may be NULL */
+    size_t len;                   /* in words */
+    spi_word_size_t word_size;
+    spi_trans_callback_t callback; /* called from the bus task, may be NULL */
+    void *arg;
+
+    volatile bool done;
+    size_t result;                /* words transferred, valid once done */
+    bool queued;
+    struct spi_trans *next;
+} spi_trans_t;
+
+/* Set up a bus for use by the manager. 'minimal_pins' as for spi_init,
+   it must be false for devices to use SPI_BUS_CS_HW. Call from task
+   context. Returns false on error. */
+bool spi_bus_init(uint8_t bus, bool minimal_pins);
+
+/* Register a device on an initialised bus, computing its register
+   image and configuring its GPIO chip select (if any.) */
+bool spi_bus_add_device(spi_device_t *dev, uint8_t bus, const spi_device_config_t *config);
+
+/* Take exclusive use of the bus for a device, configuring the bus for
+   it if needed and asserting a GPIO chip select. Returns false on
+   timeout. */
+bool spi_device_acquire(spi_device_t *dev, portTickType timeout);
+
+/* End an acquired section, releasing the chip select and the bus */
+void spi_device_release(spi_device_t *dev);
+
+/* Transfer a buffer of words (as spi_transfer()) with the bus acquired
+   for 'dev'. May also be used inside an acquired section. Returns the
+   number of words transferred. */
+size_t spi_device_transfer(spi_device_t *dev, const void *out_data, void *in_data,
+                           size_t len, spi_word_size_t word_size);
+
+/* Queue a transfer for the bus task. Transfers are carried out in
+   order of device priority, and in order of queueing within a
+   priority. Once it is complete the callback is called (it may queue
+   the same transfer again) and then trans->done is set, so once done
+   is set the bus task has finished with it. If the callback queues it
+   again, done waits for the next run instead.
+
+   Returns 0, or -EBUSY if the transfer is already queued, in which
+   case it is left where it is. */
+int spi_device_queue(spi_trans_t *trans);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
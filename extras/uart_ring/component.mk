@@ -0,0 +1,8 @@
+# Component makefile for extras/uart_ring
+
+INC_DIRS += $(uart_ring_ROOT)
+
+# args for passing into compile rule generation
+uart_ring_SRC_DIR =  $(uart_ring_ROOT)
+
+$(eval $(call component_compile_rules,uart_ring))
@@ -0,0 +1,390 @@
+/* Interrupt driven UART driver with software TX & RX ring buffers.
+ *
+ * See uart_ring.h for usage.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/reent.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+#include <common_macros.h>
+#include <esp/uart.h>
+#include <esp/interrupts.h>
+#include "uart_ring.h"
+
+/* Maximum bytes copied into the TX ring per critical section, bounds
+   interrupt latency for long writes */
+#define TX_CHUNK 32
+
+#define RX_INTERRUPTS (UART_INT_ENABLE_RXFIFO_FULL | UART_INT_ENABLE_RXFIFO_TIMEOUT \
+                       | UART_INT_ENABLE_RXFIFO_OVERFLOW | UART_INT_ENABLE_FRAMING_ERR \
+                       | UART_INT_ENABLE_PARITY_ERR)
+
+/* 'head' counts bytes ever written and 'tail' bytes ever read, they
+   are only reduced modulo the ring size when indexing. Each is only
+   written by one side (task or ISR.) */
+typedef struct {
+    uint8_t *buf;
+    uint32_t mask;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+} ring_t;
+
+typedef struct {
+    bool initialised;
+    ring_t rx;
+    ring_t tx;
+    xSemaphoreHandle rx_sem;    /* given by the ISR when bytes arrive */
+    xSemaphoreHandle tx_sem;    /* given by the ISR when TX ring space frees up */
+    xSemaphoreHandle tx_mutex;  /* keeps concurrent blocking writes whole */
+    xSemaphoreHandle rx_mutex;
+    uart_ring_stats_t stats;
+} uart_ring_t;
+
+static uart_ring_t uarts[2];
+
+static inline uint32_t ring_used(const ring_t *ring)
+{
+    return ring->head - ring->tail;
+}
+
+static inline uint32_t ring_free(const ring_t *ring)
+{
+    return ring->mask + 1 - ring_used(ring);
+}
+
+static inline void IRAM handle_rx(int uart_num, uart_ring_t *u, uint32_t status, portBASE_TYPE *woken)
+{
+    if(status & UART_INT_STATUS_RXFIFO_OVERFLOW)
+        u->stats.rx_fifo_overflows++;
+    if(status & (UART_INT_STATUS_FRAMING_ERR | UART_INT_STATUS_PARITY_ERR))
+        u->stats.rx_errors++;
+
+    ring_t *rx = &u->rx;
+    uint32_t head = rx->head;
+    uint32_t count = FIELD2VAL(UART_STATUS_RXFIFO_COUNT, UART(uart_num).STATUS);
+    for(uint32_t i = 0; i < count; i++) {
+        uint8_t c = UART(uart_num).FIFO;
+        if(head - rx->tail <= rx->mask)
+            rx->buf[head++ & rx->mask] = c;
+        else
+            u->stats.rx_overruns++;
+    }
+    if(head != rx->head) {
+        rx->head = head;
+        xSemaphoreGiveFromISR(u->rx_sem, woken);
+    }
+}
+
+static inline void IRAM handle_tx(int uart_num, uart_ring_t *u, portBASE_TYPE *woken)
+{
+    ring_t *tx = &u->tx;
+    uint32_t tail = tx->tail;
+    uint32_t space = UART_FIFO_MAX - FIELD2VAL(UART_STATUS_TXFIFO_COUNT, UART(uart_num).STATUS);
+    while(space-- && tail != tx->head) {
+        UART(uart_num).FIFO = tx->buf[tail++ & tx->mask];
+    }
+    tx->tail = tail;
+    if(tail == tx->head) {
+        /* nothing left to send, re-enabled by the next write */
+        UART(uart_num).INT_ENABLE &= ~UART_INT_ENABLE_TXFIFO_EMPTY;
+    }
+    xSemaphoreGiveFromISR(u->tx_sem, woken);
+}
+
+/* Both UARTs share one interrupt */
+static void IRAM uart_ring_interrupt_handler(void)
+{
+    portBASE_TYPE woken = pdFALSE;
+
+    for(int uart_num = 0; uart_num < 2; uart_num++) {
+        uart_ring_t *u = &uarts[uart_num];
+        if(!u->initialised)
+            continue;
+        uint32_t status = UART(uart_num).INT_STATUS;
+        if(!status)
+            continue;
+        if(status & RX_INTERRUPTS)
+            handle_rx(uart_num, u, status, &woken);
+        if(status & UART_INT_STATUS_TXFIFO_EMPTY)
+            handle_tx(uart_num, u, &woken);
+        UART(uart_num).INT_CLEAR = status;
+    }
+
+    if(woken)
+        portYIELD();
+}
+
+static bool ring_alloc(ring_t *ring, size_t size)
+{
+    if(size & (size - 1))
+        return false;
+    ring->head = ring->tail = 0;
+    ring->mask = size - 1;
+    ring->buf = NULL;
+    if(size == 0)
+        return true;
+    ring->buf = malloc(size);
+    return ring->buf != NULL;
+}
+
+int uart_ring_init(int uart_num, size_t rx_size, size_t tx_size)
+{
+    if(uart_num < 0 || uart_num > 1 || tx_size == 0 || (rx_size & (rx_size - 1)) || (tx_size & (tx_size - 1)))
+        return -EINVAL;
+
+    uart_ring_t *u = &uarts[uart_num];
+    if(u->initialised)
+        return 0;
+
+    if(!ring_alloc(&u->rx, rx_size) || !ring_alloc(&u->tx, tx_size)) {
+        free(u->rx.buf);
+        free(u->tx.buf);
+        return -ENOMEM;
+    }
+    vSemaphoreCreateBinary(u->rx_sem);
+    vSemaphoreCreateBinary(u->tx_sem);
+    u->tx_mutex = xSemaphoreCreateMutex();
+    u->rx_mutex = xSemaphoreCreateMutex();
+    memset(&u->stats, 0, sizeof(u->stats));
+
+    /* Wait for anything already written with uart_putc to go out */
+    uart_flush_txfifo(uart_num);
+
+    _xt_isr_mask(BIT(INUM_UART));
+    UART(uart_num).INT_ENABLE = 0;
+    UART(uart_num).INT_CLEAR = 0x1ff;
+
+    uint32_t conf1 = UART(uart_num).CONF1;
+    conf1 = SET_FIELD(conf1, UART_CONF1_TXFIFO_EMPTY_THRESHOLD, UART_RING_TXFIFO_EMPTY_THRESHOLD);
+    conf1 = SET_FIELD(conf1, UART_CONF1_RXFIFO_FULL_THRESHOLD, UART_RING_RXFIFO_FULL_THRESHOLD);
+    conf1 = SET_FIELD(conf1, UART_CONF1_RX_TIMEOUT_THRESHOLD, UART_RING_RX_TIMEOUT);
+    conf1 |= UART_CONF1_RX_TIMEOUT_ENABLE;
+    UART(uart_num).CONF1 = conf1;
+
+    u->initialised = true;
+    if(rx_size)
+        UART(uart_num).INT_ENABLE = RX_INTERRUPTS;
+
+    _xt_isr_attach(INUM_UART, uart_ring_interrupt_handler);
+    _xt_isr_unmask(BIT(INUM_UART));
+    return 0;
+}
+
+/* Copy up to TX_CHUNK bytes into the TX ring and make sure the
+   TXFIFO_EMPTY interrupt is enabled to send them */
+static size_t tx_push(int uart_num, uart_ring_t *u, const uint8_t *buf, size_t len)
+{
+    ring_t *tx = &u->tx;
+    if(len > TX_CHUNK)
+        len = TX_CHUNK;
+
+    uint32_t ps = _xt_disable_interrupts();
+    uint32_t space = ring_free(tx);
+    if(len > space)
+        len = space;
+    uint32_t head = tx->head;
+    for(size_t i = 0; i < len; i++)
+        tx->buf[head++ & tx->mask] = buf[i];
+    tx->head = head;
+    if(len)
+        UART(uart_num).INT_ENABLE |= UART_INT_ENABLE_TXFIFO_EMPTY;
+    _xt_restore_interrupts(ps);
+    return len;
+}
+
+/* Before the scheduler is running we can't block waiting for the
+   ISR, so move bytes from the ring to the FIFO directly */
+static void tx_drain_polled(int uart_num, uart_ring_t *u)
+{
+    ring_t *tx = &u->tx;
+    uint32_t ps = _xt_disable_interrupts();
+    while(tx->tail != tx->head) {
+        uart_putc(uart_num, tx->buf[tx->tail & tx->mask]);
+        tx->tail++;
+    }
+    _xt_restore_interrupts(ps);
+}
+
+size_t uart_ring_write(int uart_num, const void *buf, size_t len, portTickType timeout)
+{
+    uart_ring_t *u = &uarts[uart_num];
+    const uint8_t *p = buf;
+    size_t done = 0;
+
+    if(xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) {
+        while(done < len) {
+            size_t n = tx_push(uart_num, u, p + done, len - done);
+            if(n == 0)
+                tx_drain_polled(uart_num, u);
+            done += n;
+        }
+        return done;
+    }
+
+    xTimeOutType time_out;
+    vTaskSetTimeOutState(&time_out);
+    if(xSemaphoreTake(u->tx_mutex, timeout) != pdTRUE)
+        return 0;
+    while(done < len) {
+        size_t n = tx_push(uart_num, u, p + done, len - done);
+        done += n;
+        if(n == 0) {
+            if(xTaskCheckForTimeOut(&time_out, &timeout) != pdFALSE
+               || xSemaphoreTake(u->tx_sem, timeout) != pdTRUE)
+                break;
+        }
+    }
+    xSemaphoreGive(u->tx_mutex);
+    return done;
+}
+
+size_t uart_ring_write_nowait(int uart_num, const void *buf, size_t len)
+{
+    uart_ring_t *u = &uarts[uart_num];
+    const uint8_t *p = buf;
+    size_t done = 0;
+    while(done < len) {
+        size_t n = tx_push(uart_num, u, p + done, len - done);
+        if(n == 0)
+            break;
+        done += n;
+    }
+    u->stats.tx_dropped += len - done;
+    return done;
+}
+
+size_t uart_ring_read(int uart_num, void *buf, size_t len, portTickType timeout)
+{
+    uart_ring_t *u = &uarts[uart_num];
+    ring_t *rx = &u->rx;
+    uint8_t *p = buf;
+
+    if(!rx->buf || len == 0)
+        return 0;
+
+    xTimeOutType time_out;
+    vTaskSetTimeOutState(&time_out);
+    if(xSemaphoreTake(u->rx_mutex, timeout) != pdTRUE)
+        return 0;
+    while(ring_used(rx) == 0) {
+        if(xTaskCheckForTimeOut(&time_out, &timeout) != pdFALSE
+           || xSemaphoreTake(u->rx_sem, timeout) != pdTRUE) {
+            xSemaphoreGive(u->rx_mutex);
+            return 0;
+        }
+    }
+
+    uint32_t tail = rx->tail;
+    uint32_t count = rx->head - tail;
+    if(count > len)
+        count = len;
+    for(uint32_t i = 0; i < count; i++)
+        p[i] = rx->buf[tail++ & rx->mask];
+    rx->tail = tail;
+    xSemaphoreGive(u->rx_mutex);
+    return count;
+}
+
+size_t uart_ring_rx_available(int uart_num)
+{
+    return uarts[uart_num].rx.buf ? ring_used(&uarts[uart_num].rx) : 0;
+}
+
+size_t uart_ring_tx_free(int uart_num)
+{
+    return ring_free(&uarts[uart_num].tx);
+}
+
+bool uart_ring_flush(int uart_num, portTickType timeout)
+{
+    uart_ring_t *u = &uarts[uart_num];
+    xTimeOutType time_out;
+    vTaskSetTimeOutState(&time_out);
+    while(ring_used(&u->tx) != 0) {
+        if(xTaskCheckForTimeOut(&time_out, &timeout) != pdFALSE)
+            return false;
+        xSemaphoreTake(u->tx_sem, timeout);
+    }
+    /* at most UART_FIFO_MAX bytes left in the hardware FIFO */
+    uart_flush_txfifo(uart_num);
+    return true;
+}
+
+void uart_ring_get_stats(int uart_num, uart_ring_stats_t *stats, bool reset)
+{
+    uart_ring_t *u = &uarts[uart_num];
+    uint32_t ps = _xt_disable_interrupts();
+    *stats = u->stats;
+    if(reset)
+        memset(&u->stats, 0, sizeof(u->stats));
+    _xt_restore_interrupts(ps);
+}
+
+/* stdio syscalls, replacing the polled versions in
+   core/newlib_syscalls.c. These are in this file so they're linked in
+   along with uart_ring_init(). */
+
+static void stdout_write(const char *buf, int len)
+{
+    if(!uarts[0].initialised) {
+        for(int i = 0; i < len; i++)
+            uart_putc(0, buf[i]);
+    } else if(UART_RING_STDOUT_DROP) {
+        uart_ring_write_nowait(0, buf, len);
+    } else {
+        uart_ring_write(0, buf, len, portMAX_DELAY);
+    }
+}
+
+long _write_r(struct _reent *r, int fd, const char *ptr, int len)
+{
+    if(fd != r->_stdout->_file) {
+        r->_errno = EBADF;
+        return -1;
+    }
+
+    /* Auto convert CR to CRLF, ignore other LFs (compatible with
+       Espressif SDK behaviour), same as the polled version */
+    char buf[TX_CHUNK];
+    int n = 0;
+    for(int i = 0; i < len; i++) {
+        if(ptr[i] == '\r')
+            continue;
+        if(ptr[i] == '\n')
+            buf[n++] = '\r';
+        buf[n++] = ptr[i];
+        if(n >= TX_CHUNK - 1) {
+            stdout_write(buf, n);
+            n = 0;
+        }
+    }
+    stdout_write(buf, n);
+    return len;
+}
+
+long _read_r(struct _reent *r, int fd, char *ptr, int len)
+{
+    if(fd != r->_stdin->_file) {
+        r->_errno = EBADF;
+        return -1;
+    }
+    if(!uarts[0].initialised || !uarts[0].rx.buf) {
+        /* polled, as per core/newlib_syscalls.c */
+        int ch, i;
+        uart_rxfifo_wait(0, 1);
+        for(i = 0; i < len; i++) {
+            ch = uart_getc_nowait(0);
+            if (ch < 0) break;
+            ptr[i] = ch;
+        }
+        return i;
+    }
+    return uart_ring_read(0, ptr, len, portMAX_DELAY);
+}
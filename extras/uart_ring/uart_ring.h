@@ -0,0 +1,109 @@
+/* uart_ring.h
+ *
+ * Interrupt driven UART driver with software TX & RX ring buffers,
+ * for UART0 and UART1.
+ *
+ * Writes copy into the TX ring and return, the TXFIFO_EMPTY interrupt
+ * refills the 128 byte hardware FIFO in the background. Received
+ * bytes are moved from the hardware FIFO into the RX ring by the
+ * RXFIFO_FULL and RX timeout interrupts, so a reader blocks on a
+ * semaphore rather than polling.
+ *
+ * Once uart_ring_init(0, ...) has been called, stdout/stdin
+ * (printf, read, etc.) use the UART0 rings. This replaces
+ * extras/stdin_uart_interrupt, don't use both in the same program.
+ *
+ * UART1 only has a TX pin (GPIO2) available on ESP8266, its RX ring
+ * size can be 0. Pin muxing is left to the caller.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _UART_RING_H
+#define _UART_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <FreeRTOS.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/* Interrupt when the TX FIFO has fewer than this many bytes left */
+#ifndef UART_RING_TXFIFO_EMPTY_THRESHOLD
+#define UART_RING_TXFIFO_EMPTY_THRESHOLD 16
+#endif
+
+/* Interrupt when the RX FIFO has at least this many bytes, or when
+   bytes have been waiting for UART_RING_RX_TIMEOUT character times */
+#ifndef UART_RING_RXFIFO_FULL_THRESHOLD
+#define UART_RING_RXFIFO_FULL_THRESHOLD 96
+#endif
+#ifndef UART_RING_RX_TIMEOUT
+#define UART_RING_RX_TIMEOUT 2
+#endif
+
+/* If set to 1, stdout drops output (counted in tx_dropped) rather
+   than blocking the writer when the UART0 TX ring is full. */
+#ifndef UART_RING_STDOUT_DROP
+#define UART_RING_STDOUT_DROP 0
+#endif
+
+typedef struct {
+    uint32_t rx_overruns;       /* bytes lost because the RX ring was full */
+    uint32_t rx_fifo_overflows; /* hardware RX FIFO overflowed before the ISR ran */
+    uint32_t rx_errors;         /* framing/parity errors */
+    uint32_t tx_dropped;        /* bytes not queued by non-blocking writes */
+} uart_ring_stats_t;
+
+/* Set up the driver for a UART. Ring sizes must be powers of 2 (or 0
+   for no RX ring.) Baud rate etc. are configured as usual via
+   esp/uart.h. Call from task context.
+
+   Returns 0 on success, -EINVAL for a bad UART number or size, -ENOMEM
+   if the rings can't be allocated.
+*/
+int uart_ring_init(int uart_num, size_t rx_size, size_t tx_size);
+
+/* Queue up to 'len' bytes for transmission, waiting up to 'timeout'
+   ticks for ring space if necessary.
+
+   Returns the number of bytes queued.
+*/
+size_t uart_ring_write(int uart_num, const void *buf, size_t len, portTickType timeout);
+
+/* Queue as many of 'len' bytes as fit in the TX ring without waiting,
+   the rest are counted in tx_dropped. Can be called from an ISR.
+
+   Returns the number of bytes queued.
+*/
+size_t uart_ring_write_nowait(int uart_num, const void *buf, size_t len);
+
+/* Read up to 'len' bytes, waiting up to 'timeout' ticks for at least
+   one byte to arrive.
+
+   Returns the number of bytes read.
+*/
+size_t uart_ring_read(int uart_num, void *buf, size_t len, portTickType timeout);
+
+/* Number of received bytes waiting in the RX ring */
+size_t uart_ring_rx_available(int uart_num);
+
+/* Free space in the TX ring */
+size_t uart_ring_tx_free(int uart_num);
+
+/* Wait up to 'timeout' ticks until the TX ring and FIFO are empty.
+   Returns true if everything has been sent. */
+bool uart_ring_flush(int uart_num, portTickType timeout);
+
+/* Copy the error/overrun counters, optionally resetting them */
+void uart_ring_get_stats(int uart_num, uart_ring_stats_t *stats, bool reset);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
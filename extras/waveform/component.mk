@@ -0,0 +1,8 @@
+# Component makefile for extras/waveform
+
+INC_DIRS += $(waveform_ROOT)
+
+# args for passing into compile rule generation
+waveform_SRC_DIR =  $(waveform_ROOT)
+
+$(eval $(call component_compile_rules,waveform))
@@ -0,0 +1,49 @@
+/* waveform.c
+ *
+ * Cycle-timed GPIO waveforms.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <FreeRTOS.h>
+#include <task.h>
+#include <xtensa_ops.h>
+#include <esp/gpio_regs.h>
+#include <esp/clocks.h>
+#include "waveform.h"
+
+int IRAM waveform_play(const waveform_step_t *steps, size_t count, uint32_t *samples)
+{
+    /* Delays are in 80MHz cycles */
+    uint32_t shift = (cpu_freq_get() == 160) ? 1 : 0;
+    uint32_t due, now;
+    int late = 0;
+
+    taskENTER_CRITICAL();
+    RSR(due, ccount);
+    for (size_t i = 0; i < count; i++) {
+        uint32_t pins = steps[i].pins;
+        uint32_t delay = steps[i].delay;
+
+        /* Each step is timed from the previous one's due time, not from
+           when it actually ran, so errors don't add up */
+        due += (delay & WAVEFORM_DELAY_MASK) << shift;
+        RSR(now, ccount);
+        if ((int32_t)(now - due) > 0) {
+            late++;
+        } else {
+            do {
+                RSR(now, ccount);
+            } while ((int32_t)(now - due) < 0);
+        }
+
+        if (delay & WAVEFORM_SAMPLE)
+            *samples++ = GPIO.IN;
+        GPIO.OUT_SET = pins & GPIO_OUT_PIN_MASK;
+        GPIO.OUT_CLEAR = pins >> 16;
+    }
+    taskEXIT_CRITICAL();
+
+    return late;
+}
@@ -0,0 +1,84 @@
+/* waveform.h
+ *
+ * Cycle-timed GPIO waveforms.
+ *
+ * A waveform is a list of steps, each of which sets and clears a mask
+ * of GPIO0-15 a given number of cycles after the previous step, and can
+ * sample all the inputs first. waveform_play() runs the list from IRAM
+ * with interrupts disabled, timing every step from CCOUNT relative to
+ * the start, so call overhead doesn't accumulate and timing holds to a
+ * few cycles. A bit-banged protocol becomes a table of steps rather
+ * than a sequence of gpio_write() and sdk_os_delay_us() calls.
+ *
+ * Delays are given in 80MHz cycles (12.5ns) whatever the CPU clock, so
+ * one table works at both 80 and 160MHz.
+ *
+ * Interrupts are off for the whole waveform, so keep each one short
+ * (tens of microseconds, WiFi starts to suffer beyond that) and split
+ * longer exchanges into several calls.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _WAVEFORM_H
+#define _WAVEFORM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <common_macros.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/* Fields are all words, so tables can be const and live in flash.
+   Copy a table to RAM first if the first run must be cycle exact, a
+   flash cache miss in the middle can delay a step by a microsecond or
+   more. */
+typedef struct {
+    uint32_t pins;    /* GPIO mask to set in bits 0-15, to clear in 16-31 */
+    uint32_t delay;   /* 80MHz cycles after the previous step, plus flags */
+} waveform_step_t;
+
+/* Sample GPIO.IN just before this step changes any outputs */
+#define WAVEFORM_SAMPLE BIT(31)
+#define WAVEFORM_DELAY_MASK 0x7fffffff
+
+/* Delay conversions for building tables at compile time */
+#define WAVEFORM_NS(ns) ((uint32_t)(ns) * 2 / 25)
+#define WAVEFORM_US(us) ((uint32_t)(us) * 80)
+
+/* Step 'delay' 80MHz cycles after the previous one (or after the call
+   to waveform_play() for the first), setting the pins in 'set' and then
+   clearing the pins in 'clear' */
+#define WAVEFORM_STEP(set, clear, delay) \
+    { ((set) & 0xffff) | ((uint32_t)(clear) << 16), (delay) }
+
+/* As WAVEFORM_STEP, but sample the inputs at the step time first */
+#define WAVEFORM_SAMPLE_STEP(set, clear, delay) \
+    { ((set) & 0xffff) | ((uint32_t)(clear) << 16), (delay) | WAVEFORM_SAMPLE }
+
+/* Play 'count' steps. For each step with WAVEFORM_SAMPLE, GPIO.IN is
+   stored in the next entry of 'samples', which can be NULL if there
+   are none.
+
+   Returns the number of steps which were late (due before the
+   previous one had finished, because the delay was too short to
+   allow for the step itself or a flash read stalled), so 0 means
+   the waveform was exact.
+*/
+int waveform_play(const waveform_step_t *steps, size_t count, uint32_t *samples);
+
+/* Level of a GPIO in a sample taken by waveform_play() */
+static inline bool waveform_sample_pin(uint32_t sample, uint8_t gpio_num)
+{
+    return sample & BIT(gpio_num);
+}
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
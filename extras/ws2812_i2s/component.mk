@@ -0,0 +1,8 @@
+# Component makefile for extras/ws2812_i2s
+
+INC_DIRS += $(ws2812_i2s_ROOT)
+
+# args for passing into compile rule generation
+ws2812_i2s_SRC_DIR =  $(ws2812_i2s_ROOT)
+
+$(eval $(call component_compile_rules,ws2812_i2s))
\ No newline at end of file
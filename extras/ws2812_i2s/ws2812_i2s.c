@@ -0,0 +1,158 @@
+/**
+ * @file   ws2812_i2s.c
+ * @brief  ESP8266 DMA driver for WS2812
+ *
+ * Each frame is a descriptor chain: the encoded pixels, split into
+ * blocks the DMA can handle, then a block of zeros for the reset gap,
+ * which links back to the start of the same frame. Showing a new frame
+ * relinks the front frame's reset block to the new frame, which then
+ * loops on its own. Every block raises an EOF interrupt; the first one
+ * from the new frame means the old one is no longer in use.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <FreeRTOS.h>
+#include <semphr.h>
+#include <esp/slc.h>
+#include "i2s_dma.h"
+#include "ws2812_i2s.h"
+
+/* Largest multiple of a pixel that fits in one descriptor */
+#define BLOCK_BYTES (I2S_DMA_MAX_BUF_SIZE / (WS2812_I2S_WORDS_PER_PIXEL * 4) \
+                     * (WS2812_I2S_WORDS_PER_PIXEL * 4))
+
+typedef struct {
+    uint32_t *data;
+    struct SLCDescriptor *desc;   /* data blocks, then the reset block */
+} frame_t;
+
+static struct {
+    size_t count;
+    uint8_t blocks;               /* data blocks per frame */
+    frame_t frame[2];
+    volatile uint8_t front;       /* frame being refreshed, or about to be */
+    volatile bool pending;        /* front has not started yet */
+    xSemaphoreHandle back_free;
+} ws;
+
+static uint32_t reset_data[WS2812_I2S_RESET_BYTES / 4];
+
+static void IRAM eof_callback(struct SLCDescriptor *desc, void *arg)
+{
+    frame_t *f = &ws.frame[ws.front];
+    if (!ws.pending || desc < f->desc || desc > f->desc + ws.blocks)
+        return;
+    ws.pending = false;
+    portBASE_TYPE woken = pdFALSE;
+    xSemaphoreGiveFromISR(ws.back_free, &woken);
+    if (woken)
+        portYIELD();
+}
+
+static void free_frames(void)
+{
+    for (int i = 0; i < 2; i++) {
+        free(ws.frame[i].data);
+        free(ws.frame[i].desc);
+        ws.frame[i].data = NULL;
+        ws.frame[i].desc = NULL;
+    }
+}
+
+static int alloc_frame(frame_t *f)
+{
+    size_t bytes = ws.count * WS2812_I2S_WORDS_PER_PIXEL * 4;
+
+    f->data = malloc(bytes);
+    f->desc = malloc((ws.blocks + 1) * sizeof(struct SLCDescriptor));
+    if (!f->data || !f->desc)
+        return -ENOMEM;
+
+    for (uint8_t i = 0; i < ws.blocks; i++) {
+        size_t len = bytes - i * BLOCK_BYTES;
+        if (len > BLOCK_BYTES)
+            len = BLOCK_BYTES;
+        f->desc[i].flags = SLC_DESCRIPTOR_FLAGS(len, len, 0, 1, 1);
+        f->desc[i].buf_ptr = (uint32_t)f->data + i * BLOCK_BYTES;
+        f->desc[i].next_link_ptr = (uint32_t)&f->desc[i + 1];
+    }
+    struct SLCDescriptor *reset = &f->desc[ws.blocks];
+    reset->flags = SLC_DESCRIPTOR_FLAGS(sizeof(reset_data), sizeof(reset_data), 0, 1, 1);
+    reset->buf_ptr = (uint32_t)reset_data;
+    reset->next_link_ptr = (uint32_t)&f->desc[0];
+    return 0;
+}
+
+int ws2812_i2s_init(size_t count)
+{
+    if (!count)
+        return -EINVAL;
+    if (ws.count)
+        return -EBUSY;
+
+    ws.count = count;
+    ws.blocks = (count * WS2812_I2S_WORDS_PER_PIXEL * 4 + BLOCK_BYTES - 1) / BLOCK_BYTES;
+    if (!ws.back_free)
+        vSemaphoreCreateBinary(ws.back_free);
+    if (!ws.back_free || alloc_frame(&ws.frame[0]) || alloc_frame(&ws.frame[1])) {
+        free_frames();
+        ws.count = 0;
+        return -ENOMEM;
+    }
+    for (int i = 0; i < 2; i++) {
+        for (size_t j = 0; j < count * WS2812_I2S_WORDS_PER_PIXEL; j++)
+            ws.frame[i].data[j] = ws2812_i2s_encode_byte(0);
+    }
+    ws.front = 0;
+    ws.pending = false;
+    xSemaphoreGive(ws.back_free);
+
+    int res = i2s_dma_init_chain(i2s_dma_clock_div(WS2812_I2S_BIT_FREQ), 16,
+                                 ws.frame[0].desc, eof_callback, NULL);
+    if (res < 0) {
+        free_frames();
+        ws.count = 0;
+        return res;
+    }
+    i2s_dma_start();
+    return 0;
+}
+
+bool ws2812_i2s_show(const uint32_t *rgbs, portTickType timeout)
+{
+    if (!ws.count || xSemaphoreTake(ws.back_free, timeout) != pdTRUE)
+        return false;
+
+    uint8_t back = ws.front ^ 1;
+    frame_t *b = &ws.frame[back];
+    frame_t *f = &ws.frame[ws.front];
+    ws2812_i2s_encode(b->data, rgbs, ws.count);
+    b->desc[ws.blocks].next_link_ptr = (uint32_t)&b->desc[0];
+
+    /* Switch over at the end of the current reset gap */
+    ws.front = back;
+    ws.pending = true;
+    f->desc[ws.blocks].next_link_ptr = (uint32_t)&b->desc[0];
+    return true;
+}
+
+bool ws2812_i2s_wait(portTickType timeout)
+{
+    if (!ws.count || xSemaphoreTake(ws.back_free, timeout) != pdTRUE)
+        return false;
+    xSemaphoreGive(ws.back_free);
+    return true;
+}
+
+void ws2812_i2s_deinit(void)
+{
+    if (!ws.count)
+        return;
+    i2s_dma_deinit();
+    free_frames();
+    ws.count = 0;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file   ws2812_i2s.h
+ * @brief  ESP8266 DMA driver for WS2812
+ *
+ * Unlike the bit-banging driver in extras/ws2812, this one leaves
+ * interrupts (and the NMI) alone: pixels are encoded into an I2S
+ * bitstream (see ws2812_i2s_encode.h) and streamed by DMA.
+ *
+ * Two encoded frames are kept. The DMA refreshes the strip continuously
+ * from the front frame, followed by a reset gap. ws2812_i2s_show()
+ * encodes into the back frame and links it in after the current reset
+ * gap, so the strip switches cleanly between complete frames, then
+ * returns without waiting for it to be sent.
+ *
+ * A strip of N pixels takes 30*N + 320µs per refresh, e.g. about 18ms
+ * (55 refreshes/s) for 600 pixels, and 2 * 12 * N bytes of RAM.
+ *
+ * The data line is GPIO3 (I2S data out), which is also UART0 RX.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef WS2812_I2S_H
+#define WS2812_I2S_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <FreeRTOS.h>
+
+#include "ws2812_i2s_encode.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/** Zero bytes sent between frames, must be >= 120 (300µs) for WS2812B */
+#ifndef WS2812_I2S_RESET_BYTES
+#define WS2812_I2S_RESET_BYTES 128
+#endif
+
+/**
+ * @brief Allocate the frames and start refreshing the strip (all off).
+ *
+ * @param count : number of pixels on the strip
+ * @return 0 or -errno
+ */
+int ws2812_i2s_init(size_t count);
+
+/**
+ * @brief Display a new frame.
+ *
+ * Waits (up to timeout) for the previous frame to have started, then
+ * encodes the pixels and queues them to be shown after the current
+ * refresh. The array can be reused as soon as this returns.
+ *
+ * @param rgbs : array of RGB colors in the 0x00RRGGBB format, one per pixel
+ * @param timeout : RTOS ticks to wait for the back frame, 0 to not wait
+ * @return false on timeout
+ */
+bool ws2812_i2s_show(const uint32_t *rgbs, portTickType timeout);
+
+/**
+ * @brief Wait until the last frame passed to ws2812_i2s_show() is on
+ *        the strip.
+ *
+ * @param timeout : RTOS ticks
+ * @return false on timeout
+ */
+bool ws2812_i2s_wait(portTickType timeout);
+
+/**
+ * @brief Stop the DMA and free the frames.
+ */
+void ws2812_i2s_deinit(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* WS2812_I2S_H */
@@ -0,0 +1,32 @@
+/**
+ * @file   ws2812_i2s_encode.c
+ * @brief  WS2812 to I2S bitstream encoder
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#include "ws2812_i2s_encode.h"
+
+/** I2S bits for each nibble, most significant bit first. Words rather
+    than halfwords because constants live in flash, which only allows
+    32 bit loads. */
+static const uint32_t nibble_bits[16] = {
+    0x8888, 0x888e, 0x88e8, 0x88ee, 0x8e88, 0x8e8e, 0x8ee8, 0x8eee,
+    0xe888, 0xe88e, 0xe8e8, 0xe8ee, 0xee88, 0xee8e, 0xeee8, 0xeeee,
+};
+
+uint32_t ws2812_i2s_encode_byte(uint8_t byte)
+{
+    return (nibble_bits[byte >> 4] << 16) | nibble_bits[byte & 0x0f];
+}
+
+void ws2812_i2s_encode(uint32_t *dst, const uint32_t *rgbs, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        uint32_t rgb = rgbs[i];
+        *dst++ = ws2812_i2s_encode_byte(rgb >> 8);
+        *dst++ = ws2812_i2s_encode_byte(rgb >> 16);
+        *dst++ = ws2812_i2s_encode_byte(rgb);
+    }
+}
@@ -0,0 +1,56 @@
+/**
+ * @file   ws2812_i2s_encode.h
+ * @brief  WS2812 to I2S bitstream encoder
+ *
+ * Each WS2812 bit is sent as four I2S bits at 3.2MHz (1.25µs per bit):
+ * 1000 for a "0" (312ns high) and 1110 for a "1" (937ns high). One
+ * colour byte therefore becomes exactly one 32 bit I2S word, which the
+ * hardware shifts out MSB first.
+ *
+ * This file has no hardware dependencies, so the encoder can be built
+ * and checked on a host.
+ *
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Superhouse Automation Pty Ltd
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef WS2812_I2S_ENCODE_H
+#define WS2812_I2S_ENCODE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/** I2S bit clock for the encoding above */
+#define WS2812_I2S_BIT_FREQ 3200000
+
+/** Encoded words per pixel (one per colour byte) */
+#define WS2812_I2S_WORDS_PER_PIXEL 3
+
+/**
+ * @brief Encode one colour byte.
+ *
+ * @param byte : colour component
+ * @return I2S word for it
+ */
+uint32_t ws2812_i2s_encode_byte(uint8_t byte);
+
+/**
+ * @brief Encode pixels into an I2S bitstream.
+ *
+ * Colours are sent in the G, R, B order WS2812 expects.
+ *
+ * @param dst : WS2812_I2S_WORDS_PER_PIXEL words per pixel
+ * @param rgbs : array of RGB colors in the 0x00RRGGBB format
+ * @param count : number of elements in the array
+ */
+void ws2812_i2s_encode(uint32_t *dst, const uint32_t *rgbs, size_t count);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* WS2812_I2S_ENCODE_H */
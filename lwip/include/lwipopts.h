@@ -369,6 +369,13 @@
    ---------- Checksum options ----------
    --------------------------------------
 */
+/**
+ * LWIP_CHKSUM: Use the core Internet checksum (see checksum.h), which
+ * reads 32 bits at a time, in place of lwip's 16 bit loop. Set
+ * CHECKSUM_IRAM=1 when building to run it from IRAM.
+ */
+#include <checksum.h>
+#define LWIP_CHKSUM                     checksum_inet
 
 /*
    ---------------------------------------
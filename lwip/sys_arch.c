@@ -49,6 +49,8 @@
 #include "lwip/mem.h"
 #include "lwip/stats.h"
 
+#include <esp/systime.h>
+
 extern bool esp_in_isr;
 
 /* Based on the default xInsideISR mechanism to determine
@@ -487,7 +489,7 @@ void sys_init(void)
 
 u32_t sys_now(void)
 {
-    return xTaskGetTickCount() * portTICK_RATE_MS;
+    return systime_ms();
 }
 
 /*---------------------------------------------------------------------------*
@@ -85,6 +85,11 @@ SPLIT_SECTIONS ?= 1
 # compile without warnings to be accepted.
 WARNINGS_AS_ERRORS ?= 0
 
+# Set this to 1 to place the checksum & CRC routines (core/checksum.c,
+# which lwip uses for its Internet checksums) in IRAM instead of flash.
+# Networking gets a little faster, at the cost of under 1KB of IRAM.
+CHECKSUM_IRAM ?= 0
+
 # Common flags for both C & C++_
 C_CXX_FLAGS ?= -Wall -Wl,-EL -nostdlib $(EXTRA_C_CXX_FLAGS)
 # Flags for C only
@@ -127,6 +132,8 @@ ifeq ($(GITSHORTREV),\"\")
 endif
 CPPFLAGS += -DGITSHORTREV=$(GITSHORTREV)
 
+CPPFLAGS += -DCHECKSUM_IRAM=$(CHECKSUM_IRAM)
+
 LINKER_SCRIPTS += $(ROOT)ld/program.ld $(ROOT)ld/rom.ld
 
 # rboot firmware binary paths for flashing
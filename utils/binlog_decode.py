@@ -0,0 +1,201 @@
+#!/usr/bin/env python
+#
+# Decode extras/binlog binary mode output (BINLOG_MODE_BINARY) against
+# the program ELF file.
+#
+# Records only carry the address of their format string, so the
+# format strings (and any %s arguments which point into flash or
+# initialised data) are looked up in the ELF. Make sure the ELF
+# matches the firmware which produced the log.
+#
+# Bytes outside binlog frames (ordinary printf output sharing the
+# UART) are passed through unchanged.
+#
+# Works with a serial port if the --port option is supplied (needs
+# pyserial), otherwise reads the file given or stdin.
+#
+import argparse
+import re
+import struct
+import sys
+
+SYNC_BYTE = b"\xa5"
+FRAME_RECORD = 0x01
+FRAME_MODULE = 0x02
+FRAME_DROPPED = 0x03
+
+# 3 header words plus up to 8 arguments
+MAX_PAYLOAD = 44
+
+LEVELS = "-EWIDV??"
+
+SHT_PROGBITS = 1
+SHF_ALLOC = 0x2
+
+C_FORMAT = re.compile(r"%([-+ #0]*)(\d+|\*)?(?:\.(\d+|\*))?(hh|h|ll|l|z|j|t)?([diouxXcsp%])")
+
+
+class Elf(object):
+    """ Minimal 32-bit little endian ELF reader, just enough to read
+    bytes at a load address """
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[4:5] != b"\x01":
+            raise ValueError("%s is not a 32-bit ELF file" % path)
+        (shoff,) = struct.unpack_from("<I", self.data, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", self.data, 0x2e)
+        self.sections = []
+        for i in range(shnum):
+            (_, sh_type, flags, addr, offset, size) = struct.unpack_from(
+                "<IIIIII", self.data, shoff + i * shentsize)
+            if sh_type == SHT_PROGBITS and flags & SHF_ALLOC and size:
+                self.sections.append((addr, offset, size))
+
+    def string_at(self, addr):
+        for (base, offset, size) in self.sections:
+            if base <= addr < base + size:
+                start = offset + addr - base
+                end = self.data.find(b"\0", start, offset + size)
+                if end < 0:
+                    end = offset + size
+                return self.data[start:end].decode("latin-1")
+        return None
+
+
+def signed32(v):
+    return v - (1 << 32) if v & 0x80000000 else v
+
+
+def format_record(elf, fmt_addr, args):
+    fmt = elf.string_at(fmt_addr)
+    if fmt is None:
+        return "<unknown format 0x%08x, wrong ELF?> %s" % (
+            fmt_addr, " ".join("0x%x" % a for a in args))
+    args = list(args)
+
+    def convert(m):
+        flags, width, precision, _, conv = m.groups()
+        if conv == "%":
+            return "%"
+        if width == "*":
+            width = str(signed32(args.pop(0))) if args else ""
+        if precision == "*":
+            precision = str(signed32(args.pop(0))) if args else ""
+        spec = "%" + (flags or "") + (width or "")
+        if precision is not None:
+            spec += "." + precision
+        value = args.pop(0) if args else 0
+        if conv in "di":
+            return (spec + "d") % signed32(value)
+        if conv == "u":
+            return (spec + "d") % value
+        if conv == "c":
+            return (spec + "c") % chr(value & 0xff)
+        if conv == "p":
+            return "0x%08x" % value
+        if conv == "s":
+            s = elf.string_at(value)
+            return (spec + "s") % (s if s is not None else "<0x%08x>" % value)
+        return (spec + conv) % value
+
+    return C_FORMAT.sub(convert, fmt)
+
+
+class Decoder(object):
+    def __init__(self, elf, out):
+        self.elf = elf
+        self.out = out
+        self.modules = {}
+        self.buf = bytearray()
+        self.time_hi = 0
+        self.last_time = 0
+
+    def frame(self, ftype, payload):
+        if ftype == FRAME_MODULE:
+            self.modules[payload[0]] = payload[1:].decode("latin-1")
+        elif ftype == FRAME_DROPPED:
+            self.out.write("*** %d records dropped in total\n" % struct.unpack("<I", payload)[0])
+        elif ftype == FRAME_RECORD:
+            words = struct.unpack("<%dI" % (len(payload) // 4), payload)
+            fmt, timestamp, meta = words[:3]
+            # 32-bit microsecond timestamps wrap every ~71 minutes
+            if timestamp < self.last_time:
+                self.time_hi += 1 << 32
+            self.last_time = timestamp
+            us = self.time_hi + timestamp
+            module = self.modules.get((meta >> 8) & 0xff, "?")
+            self.out.write("%6d.%06d %s %s: %s\n" % (
+                us // 1000000, us % 1000000, LEVELS[(meta >> 4) & 7], module,
+                format_record(self.elf, fmt, words[3:3 + (meta & 0x0f)])))
+
+    def feed(self, data):
+        self.buf += data
+        while self.buf:
+            sync = self.buf.find(SYNC_BYTE)
+            if sync < 0:
+                self.passthrough(self.buf)
+                self.buf = bytearray()
+                return
+            if sync:
+                self.passthrough(self.buf[:sync])
+                del self.buf[:sync]
+            if len(self.buf) < 3:
+                return
+            ftype, length = self.buf[1], self.buf[2]
+            valid = ftype in (FRAME_RECORD, FRAME_MODULE, FRAME_DROPPED) and length <= MAX_PAYLOAD
+            if valid and len(self.buf) < 4 + length:
+                return
+            payload = bytes(self.buf[3:3 + length])
+            if not valid or (ftype + length + sum(bytearray(payload))) & 0xff != self.buf[3 + length]:
+                # not a frame after all, resynchronise on the next byte
+                self.passthrough(self.buf[:1])
+                del self.buf[:1]
+                continue
+            self.frame(ftype, bytearray(payload))
+            del self.buf[:4 + length]
+        self.out.flush()
+
+    def finish(self):
+        self.passthrough(self.buf)
+        self.buf = bytearray()
+        self.out.flush()
+
+    def passthrough(self, data):
+        self.out.write(bytes(data).decode("latin-1"))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="extras/binlog binary log decoder", prog="binlog_decode")
+    parser.add_argument("elf", help="ELF file (*.out) of the running firmware")
+    parser.add_argument("input", nargs="?", help="Captured log file (stdin if omitted)")
+    parser.add_argument("--port", "-p", help="Serial port to read from", default=None)
+    parser.add_argument("--baud", "-b", help="Baud rate for serial port", type=int, default=115200)
+    args = parser.parse_args()
+
+    decoder = Decoder(Elf(args.elf), sys.stdout)
+    if args.port is not None:
+        import serial
+        port = serial.Serial(args.port, baudrate=args.baud, timeout=0.1)
+        read = lambda: port.read(256)
+    elif args.input is not None:
+        f = open(args.input, "rb")
+        read = lambda: f.read(4096)
+    else:
+        stdin = sys.stdin.buffer if hasattr(sys.stdin, "buffer") else sys.stdin
+        read = lambda: stdin.read(4096)
+
+    try:
+        while True:
+            data = read()
+            if not data:
+                if args.port is not None:
+                    continue
+                break
+            decoder.feed(bytearray(data))
+    except KeyboardInterrupt:
+        pass
+    decoder.finish()
+
+if __name__ == "__main__":
+    main()
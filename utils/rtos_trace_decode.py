@@ -0,0 +1,194 @@
+#!/usr/bin/env python
+#
+# Convert an extras/rtos_trace dump (the "RTOSTRACE" lines printed by
+# rtos_trace_dump()) into Chrome Trace Event JSON, which can be opened
+# in chrome://tracing or https://ui.perfetto.dev
+#
+# Each task gets its own track, with a slice for every period the task
+# was running. Queue/semaphore operations, priority changes and user
+# events are shown as instant events on the track of the task they
+# happened in. Each slice also records how long the task waited
+# between becoming ready and being switched in.
+#
+# The input can be a raw serial log, other lines are ignored.
+#
+import argparse
+import json
+import sys
+
+EVENT_NAMES = {
+    0x01: "create",
+    0x02: "delete",
+    0x03: "switched in",
+    0x04: "ready",
+    0x05: "delay",
+    0x06: "delay until",
+    0x07: "suspend",
+    0x08: "resume",
+    0x09: "resume from ISR",
+    0x0a: "priority set",
+    0x0b: "priority inherit",
+    0x0c: "priority disinherit",
+    0x0d: "tick",
+    0x0e: "CPU frequency",
+    0x28: "queue delete",
+    0x30: "queue send",
+    0x31: "queue send failed",
+    0x32: "blocking on queue send",
+    0x33: "queue receive",
+    0x34: "queue receive failed",
+    0x35: "blocking on queue receive",
+    0x36: "queue peek",
+    0x37: "queue send from ISR",
+    0x38: "queue send from ISR failed",
+    0x39: "queue receive from ISR",
+    0x3a: "queue receive from ISR failed",
+    0x3b: "queue peek from ISR",
+    0x3c: "mutex take recursive",
+    0x3d: "mutex take recursive failed",
+    0x3e: "mutex give recursive",
+    0x3f: "mutex give recursive failed",
+}
+
+QUEUE_TYPES = ["queue", "mutex", "counting semaphore", "binary semaphore", "recursive mutex"]
+
+EV_SWITCHED_IN = 0x03
+EV_READY = 0x04
+EV_CPU_FREQ = 0x0e
+EV_QUEUE_CREATE = 0x20
+EV_USER = 0x80
+
+DRAM_BASE = 0x3FFE8000
+
+def parse_dump(lines):
+    """ Return (header, tasks, events) for the last complete dump in lines """
+    dumps = []
+    current = None
+    for line in lines:
+        idx = line.find("RTOSTRACE ")
+        if idx < 0:
+            continue
+        fields = line[idx:].split()
+        if fields[1] == "BEGIN":
+            current = { "cpu_hz" : int(fields[3]), "dropped" : int(fields[5]),
+                        "tasks" : {}, "events" : [] }
+        elif current is None:
+            continue
+        elif fields[1] == "T":
+            name = " ".join(fields[4:]) if len(fields) > 4 else "task%s" % fields[2]
+            current["tasks"][int(fields[2])] = (name, int(fields[3]))
+        elif fields[1] == "E":
+            current["events"].append(tuple(int(f, 16) for f in fields[2:6]))
+        elif fields[1] == "END":
+            dumps.append(current)
+            current = None
+    if not dumps:
+        raise RuntimeError("No complete RTOSTRACE dump found in input")
+    return dumps[-1]
+
+def object_name(arg, objects):
+    addr = DRAM_BASE + (arg << 2)
+    kind = objects.get(arg, "object")
+    return "%s 0x%08x" % (kind, addr)
+
+def initial_cpu_mhz(dump):
+    """ CPU clock at the start of the dump. The header has the clock at
+    the time of the dump, the first CPU frequency event (if any) records
+    what it was before that. """
+    for (ccount, ev_type, task, arg) in dump["events"]:
+        if ev_type == EV_CPU_FREQ:
+            return float(arg >> 8)
+    return dump["cpu_hz"] / 1000000.0
+
+def running_slice(running, end, tasks):
+    tid, start, latency = running
+    slice_args = { }
+    if latency is not None:
+        slice_args["ready_latency_us"] = round(latency, 2)
+    return { "ph" : "X", "name" : tasks.get(tid, ("task%d" % tid, 0))[0],
+             "pid" : 0, "tid" : tid, "ts" : start,
+             "dur" : end - start, "args" : slice_args }
+
+def convert(dump):
+    cpu_mhz = initial_cpu_mhz(dump)
+    tasks = dict(dump["tasks"])
+    tasks.setdefault(0, ("(startup)", 0))
+    tasks.setdefault(0xff, ("(other tasks)", 0))
+
+    out = []
+    for tid, (name, prio) in tasks.items():
+        out.append({ "ph" : "M", "name" : "thread_name", "pid" : 0, "tid" : tid,
+                     "args" : { "name" : "%s (prio %d)" % (name, prio) } })
+
+    # unwrap the 32-bit CCOUNT timestamps into a monotonic microsecond value
+    timestamp = 0.0
+    last_ccount = None
+    objects = {}
+    ready_at = {}
+    running = None  # (tid, start timestamp, ready latency)
+
+    for (ccount, ev_type, task, arg) in dump["events"]:
+        if last_ccount is not None:
+            timestamp += ((ccount - last_ccount) & 0xffffffff) / cpu_mhz
+        last_ccount = ccount
+
+        if ev_type == EV_CPU_FREQ:
+            cpu_mhz = float(arg & 0xff)
+
+        if ev_type == EV_SWITCHED_IN:
+            if running is not None:
+                out.append(running_slice(running, timestamp, tasks))
+            latency = None
+            if task in ready_at:
+                latency = timestamp - ready_at.pop(task)
+            running = (task, timestamp, latency)
+            continue
+
+        if ev_type == EV_READY:
+            ready_at.setdefault(task, timestamp)
+
+        if EV_QUEUE_CREATE <= ev_type < EV_QUEUE_CREATE + len(QUEUE_TYPES):
+            objects[arg] = QUEUE_TYPES[ev_type - EV_QUEUE_CREATE]
+            name = "create " + QUEUE_TYPES[ev_type - EV_QUEUE_CREATE]
+            args = { "object" : object_name(arg, objects) }
+        elif ev_type >= EV_USER:
+            name = "user %d" % (ev_type - EV_USER)
+            args = { "value" : arg }
+        elif ev_type >= 0x28:
+            name = EVENT_NAMES.get(ev_type, "event 0x%02x" % ev_type)
+            args = { "object" : object_name(arg, objects) }
+        elif ev_type == EV_CPU_FREQ:
+            name = EVENT_NAMES[ev_type]
+            args = { "old_mhz" : arg >> 8, "new_mhz" : arg & 0xff }
+        else:
+            name = EVENT_NAMES.get(ev_type, "event 0x%02x" % ev_type)
+            args = { "arg" : arg }
+        out.append({ "ph" : "i", "s" : "t", "name" : name, "pid" : 0, "tid" : task,
+                     "ts" : timestamp, "args" : args })
+
+    # the task running when the dump was taken gets a slice up to the
+    # last event
+    if running is not None:
+        out.append(running_slice(running, timestamp, tasks))
+
+    return { "traceEvents" : out, "displayTimeUnit" : "ns",
+             "otherData" : { "cpu_hz" : dump["cpu_hz"], "dropped_events" : dump["dropped"] } }
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert an esp-open-rtos rtos_trace dump to Chrome trace JSON',
+                                     prog='rtos_trace_decode')
+    parser.add_argument('input', nargs='?', help='Serial log containing the dump (default stdin)')
+    parser.add_argument('--output', '-o', help='Output JSON file (default stdout)')
+    args = parser.parse_args()
+
+    infile = open(args.input) if args.input else sys.stdin
+    dump = parse_dump(infile)
+    result = convert(dump)
+
+    outfile = open(args.output, "w") if args.output else sys.stdout
+    json.dump(result, outfile)
+    if dump["dropped"]:
+        sys.stderr.write("Note: %d older events were overwritten in the ring\n" % dump["dropped"])
+
+if __name__ == "__main__":
+    main()